@@ -0,0 +1,132 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "batchtransformhelper.h"
+
+// Qt
+#include <QPointer>
+#include <QProgressDialog>
+#include <QStringList>
+
+// KDE
+#include <KLocalizedString>
+#include <KMessageBox>
+
+// Local
+#include <lib/batchtransformjob.h>
+#include <lib/document/documentfactory.h>
+#include <lib/transformimageoperation.h>
+
+namespace Gwenview
+{
+
+struct BatchTransformHelperPrivate
+{
+    QWidget* mParent;
+    QProgressDialog* mProgressDialog;
+    QPointer<BatchTransformJob> mJob;
+    QStringList mErrorList;
+};
+
+BatchTransformHelper::BatchTransformHelper(QWidget* parent)
+: d(new BatchTransformHelperPrivate)
+{
+    d->mParent = parent;
+    d->mProgressDialog = new QProgressDialog(parent);
+    connect(d->mProgressDialog, &QProgressDialog::canceled, this, &BatchTransformHelper::slotCanceled);
+    d->mProgressDialog->setLabelText(i18nc("@info:progress rotating or flipping several images", "Transforming images..."));
+    d->mProgressDialog->setCancelButtonText(i18n("&Stop"));
+    d->mProgressDialog->setMinimum(0);
+}
+
+BatchTransformHelper::~BatchTransformHelper()
+{
+    delete d;
+}
+
+void BatchTransformHelper::transform(const QList<QUrl>& urls, Orientation orientation)
+{
+    QList<QUrl> losslessUrls;
+    Q_FOREACH(const QUrl& url, urls) {
+        Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+        if (BatchTransformJob::canTransform(url) && !(doc && doc->isModified())) {
+            losslessUrls << url;
+        } else {
+            // Modified documents and non-JPEG images are transformed in
+            // memory, like a single image would be
+            TransformImageOperation* op = new TransformImageOperation(orientation);
+            op->applyToDocument(DocumentFactory::instance()->load(url));
+        }
+    }
+    if (losslessUrls.isEmpty()) {
+        return;
+    }
+
+    d->mJob = new BatchTransformJob(losslessUrls, orientation);
+    connect(d->mJob.data(), SIGNAL(processedAmount(KJob*,KJob::Unit,qulonglong)),
+            SLOT(slotProcessedAmount(KJob*,KJob::Unit,qulonglong)));
+    connect(d->mJob.data(), &KJob::result, this, &BatchTransformHelper::slotResult);
+    d->mProgressDialog->setRange(0, losslessUrls.size());
+    d->mProgressDialog->setValue(0);
+    d->mJob->start();
+
+    d->mProgressDialog->exec();
+
+    // Done, show message if necessary
+    if (d->mErrorList.count() > 0) {
+        QString msg = i18ncp("@info", "One image could not be transformed:", "%1 images could not be transformed:", d->mErrorList.count());
+        msg += "<ul>";
+        Q_FOREACH(const QString & item, d->mErrorList) {
+            msg += "<li>" + item + "</li>";
+        }
+        msg += "</ul>";
+        KMessageBox::sorry(d->mParent, msg);
+    }
+}
+
+void BatchTransformHelper::slotCanceled()
+{
+    if (d->mJob) {
+        d->mJob->kill();
+    }
+}
+
+void BatchTransformHelper::slotProcessedAmount(KJob*, KJob::Unit unit, qulonglong amount)
+{
+    if (unit == KJob::Files) {
+        d->mProgressDialog->setValue(amount);
+    }
+}
+
+void BatchTransformHelper::slotResult(KJob*)
+{
+    const QMap<QUrl, QString> errors = d->mJob->errors();
+    QMap<QUrl, QString>::ConstIterator it = errors.constBegin(), end = errors.constEnd();
+    for (; it != end; ++it) {
+        const QUrl url = it.key();
+        QString name = url.fileName().isEmpty() ? url.toDisplayString() : url.fileName();
+        d->mErrorList << xi18nc("@info %1 is the name of the image which failed to be transformed, %2 is the reason for the failure",
+                                "<filename>%1</filename>: %2", name, it.value());
+    }
+    d->mProgressDialog->setValue(d->mProgressDialog->maximum());
+}
+
+} // namespace
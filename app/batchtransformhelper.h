@@ -0,0 +1,64 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef BATCHTRANSFORMHELPER_H
+#define BATCHTRANSFORMHELPER_H
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QUrl>
+
+// KDE
+#include <KJob>
+
+// Local
+#include <lib/orientation.h>
+
+namespace Gwenview
+{
+
+struct BatchTransformHelperPrivate;
+/**
+ * Rotates or flips several images at once. JPEG files which have not been
+ * modified are transformed directly on disk with a BatchTransformJob, other
+ * images go through the usual document-based image operation.
+ */
+class BatchTransformHelper : public QObject
+{
+    Q_OBJECT
+public:
+    BatchTransformHelper(QWidget* parent);
+    ~BatchTransformHelper();
+
+    void transform(const QList<QUrl>& urls, Orientation orientation);
+
+private Q_SLOTS:
+    void slotCanceled();
+    void slotProcessedAmount(KJob*, KJob::Unit, qulonglong);
+    void slotResult(KJob*);
+
+private:
+    BatchTransformHelperPrivate* const d;
+};
+
+} // namespace
+
+#endif /* BATCHTRANSFORMHELPER_H */
@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <KActionCategory>
 
 // Local
+#include "batchtransformhelper.h"
 #include "viewmainpage.h"
 #include "gvcore.h"
 #include "mainwindow.h"
@@ -44,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <lib/eventwatcher.h>
 #include <lib/redeyereduction/redeyereductiontool.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/mimetypeutils.h>
 #include <lib/resize/resizeimageoperation.h>
 #include <lib/resize/resizeimagedialog.h>
 #include <lib/transformimageoperation.h>
@@ -142,6 +144,28 @@ struct ImageOpsContextManagerItem::Private
         );
         return false;
     }
+
+    QList<QUrl> selectedRasterImageUrls() const
+    {
+        QList<QUrl> list;
+        Q_FOREACH(const KFileItem& item, q->contextManager()->selectedFileItemList()) {
+            if (MimeTypeUtils::fileItemKind(item) == MimeTypeUtils::KIND_RASTER_IMAGE) {
+                list << item.url();
+            }
+        }
+        return list;
+    }
+
+    void applyTransformation(Orientation orientation)
+    {
+        if (!mMainWindow->viewMainPage()->isVisible()
+            && q->contextManager()->selectedFileItemList().count() > 1) {
+            BatchTransformHelper helper(mMainWindow);
+            helper.transform(selectedRasterImageUrls(), orientation);
+            return;
+        }
+        q->applyImageOperation(new TransformImageOperation(orientation));
+    }
 };
 
 ImageOpsContextManagerItem::ImageOpsContextManagerItem(ContextManager* manager, MainWindow* mainWindow)
@@ -185,20 +209,27 @@ void ImageOpsContextManagerItem::updateSideBarContent()
 void ImageOpsContextManagerItem::updateActions()
 {
     bool canModify = contextManager()->currentUrlIsRasterImage();
+    bool canTransform = canModify;
     bool viewMainPageIsVisible = d->mMainWindow->viewMainPage()->isVisible();
     if (!viewMainPageIsVisible) {
-        // Since we only support image operations on one image for now,
-        // disable actions if several images are selected and the document
-        // view is not visible.
-        if (contextManager()->selectedFileItemList().count() != 1) {
+        // Rotating and flipping can be applied to several images at once,
+        // other operations only support one image: disable them if several
+        // images are selected and the document view is not visible.
+        int count = contextManager()->selectedFileItemList().count();
+        if (count != 1) {
             canModify = false;
         }
+        if (count > 1) {
+            canTransform = !d->selectedRasterImageUrls().isEmpty();
+        } else {
+            canTransform = canModify;
+        }
     }
 
-    d->mRotateLeftAction->setEnabled(canModify);
-    d->mRotateRightAction->setEnabled(canModify);
-    d->mMirrorAction->setEnabled(canModify);
-    d->mFlipAction->setEnabled(canModify);
+    d->mRotateLeftAction->setEnabled(canTransform);
+    d->mRotateRightAction->setEnabled(canTransform);
+    d->mMirrorAction->setEnabled(canTransform);
+    d->mFlipAction->setEnabled(canTransform);
     d->mResizeAction->setEnabled(canModify);
     d->mCropAction->setEnabled(canModify && viewMainPageIsVisible);
     d->mRedEyeReductionAction->setEnabled(canModify && viewMainPageIsVisible);
@@ -208,26 +239,22 @@ void ImageOpsContextManagerItem::updateActions()
 
 void ImageOpsContextManagerItem::rotateLeft()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_270);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_270);
 }
 
 void ImageOpsContextManagerItem::rotateRight()
 {
-    TransformImageOperation* op = new TransformImageOperation(ROT_90);
-    applyImageOperation(op);
+    d->applyTransformation(ROT_90);
 }
 
 void ImageOpsContextManagerItem::mirror()
 {
-    TransformImageOperation* op = new TransformImageOperation(HFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(HFLIP);
 }
 
 void ImageOpsContextManagerItem::flip()
 {
-    TransformImageOperation* op = new TransformImageOperation(VFLIP);
-    applyImageOperation(op);
+    d->applyTransformation(VFLIP);
 }
 
 void ImageOpsContextManagerItem::resizeImage()
@@ -239,10 +266,12 @@ void ImageOpsContextManagerItem::resizeImage()
     doc->startLoadingFullImage();
     ResizeImageDialog dialog(d->mMainWindow);
     dialog.setOriginalSize(doc->size());
+    dialog.setFilter(GwenviewConfig::resizeFilter());
     if (!dialog.exec()) {
         return;
     }
-    ResizeImageOperation* op = new ResizeImageOperation(dialog.size());
+    GwenviewConfig::setResizeFilter(dialog.filter());
+    ResizeImageOperation* op = new ResizeImageOperation(dialog.size(), dialog.filter());
     applyImageOperation(op);
 }
 
@@ -38,7 +38,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include <lib/about.h>
 #include <lib/imageformats/imageformats.h>
+#include <lib/perfcounters.h>
 #include "mainwindow.h"
+#include "perfcountersexporter.h"
 
 class StartHelper
 {
@@ -148,6 +150,12 @@ int main(int argc, char *argv[])
     //KF5 TODO
     //Gwenview::ImageFormats::registerPlugins();
 
+    // Makes it possible to collect performance counters with scripts
+    Gwenview::PerfCountersExporter perfCountersExporter;
+    if (Gwenview::PerfCounters::isReportingEnabled()) {
+        perfCountersExporter.registerOnSessionBus();
+    }
+
     // startHelper must live for the whole life of the application
     StartHelper startHelper(parser.positionalArguments(),
                             parser.isSet(QStringLiteral("f")),
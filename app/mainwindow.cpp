@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Qt
 #include <QApplication>
 #include <QDateTime>
+#include <QDesktopWidget>
 #include <QPushButton>
 #include <QShortcut>
 #include <QSplitter>
@@ -1375,6 +1376,9 @@ void MainWindow::toggleSlideShow()
                 break;
             }
         }
+        // The slideshow is shown full screen, but the window may not have
+        // been resized yet
+        d->mSlideShow->setPreloadSize(QApplication::desktop()->screenGeometry(this).size());
         d->mSlideShow->start(list);
     }
     updateSlideShowAction();
@@ -1481,6 +1485,10 @@ void MainWindow::preloadNextUrl()
         qDebug() << "Preloading disabled";
         return;
     }
+    if (d->mSlideShow->isRunning()) {
+        // The slideshow preloads its next slides itself
+        return;
+    }
     QItemSelection selection = d->mThumbnailView->selectionModel()->selection();
     if (selection.size() != 1) {
         return;
@@ -0,0 +1,75 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "perfcountersexporter.h"
+
+// Qt
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/perfcounters.h>
+
+namespace Gwenview
+{
+
+PerfCountersExporter::PerfCountersExporter(QObject* parent)
+: QObject(parent)
+{
+}
+
+bool PerfCountersExporter::registerOnSessionBus()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        return false;
+    }
+    if (!bus.registerObject("/PerfCounters", this, QDBusConnection::ExportScriptableSlots)) {
+        qWarning() << "Could not register performance counters on the session bus";
+        return false;
+    }
+    const QString service = QString("org.kde.gwenview-%1").arg(QCoreApplication::applicationPid());
+    if (!bus.registerService(service)) {
+        qWarning() << "Could not register" << service << "on the session bus";
+        return false;
+    }
+    return true;
+}
+
+QVariantMap PerfCountersExporter::counters() const
+{
+    return PerfCounters::snapshot();
+}
+
+QString PerfCountersExporter::report() const
+{
+    return PerfCounters::report();
+}
+
+void PerfCountersExporter::reset()
+{
+    PerfCounters::reset();
+}
+
+} // namespace
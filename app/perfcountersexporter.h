@@ -0,0 +1,65 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef PERFCOUNTERSEXPORTER_H
+#define PERFCOUNTERSEXPORTER_H
+
+// Qt
+#include <QObject>
+#include <QVariantMap>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+/**
+ * Exports PerfCounters on the session bus, so that they can be collected by
+ * scripts. The application only registers it when
+ * PerfCounters::isReportingEnabled() is true. The object is registered as
+ * /PerfCounters, on the
+ * org.kde.gwenview-<pid> service:
+ *
+ *   qdbus org.kde.gwenview-1234 /PerfCounters org.kde.gwenview.PerfCounters.counters
+ */
+class PerfCountersExporter : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.gwenview.PerfCounters")
+public:
+    PerfCountersExporter(QObject* parent = 0);
+
+    /**
+     * Registers the object and the service, returns false if the session bus
+     * is not available
+     */
+    bool registerOnSessionBus();
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QVariantMap counters() const;
+    Q_SCRIPTABLE QString report() const;
+    Q_SCRIPTABLE void reset();
+};
+
+} // namespace
+
+#endif /* PERFCOUNTERSEXPORTER_H */
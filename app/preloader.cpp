@@ -75,7 +75,7 @@ void Preloader::preload(const QUrl &url, const QSize& size)
         disconnect(d->mDocument.data(), 0, this, 0);
     }
 
-    d->mDocument = DocumentFactory::instance()->load(url);
+    d->mDocument = DocumentFactory::instance()->load(url, TaskScheduler::Preload);
     d->mSize = size;
     connect(d->mDocument.data(), SIGNAL(metaInfoUpdated()),
             SLOT(doPreload()));
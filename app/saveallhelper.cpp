@@ -22,9 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "saveallhelper.h"
 
 // Qt
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QSet>
+#include <QHash>
 #include <QStringList>
 #include <QUrl>
 #include <QProgressDialog>
@@ -45,14 +43,26 @@ struct SaveAllHelperPrivate
 {
     QWidget* mParent;
     QProgressDialog* mProgressDialog;
-    QSet<DocumentJob*> mJobSet;
+    // Percentage of each running job
+    QHash<DocumentJob*, int> mJobPercents;
+    int mFinishedCount;
     QStringList mErrorList;
+
+    void updateProgress()
+    {
+        int value = mFinishedCount * 100;
+        Q_FOREACH(int percent, mJobPercents) {
+            value += percent;
+        }
+        mProgressDialog->setValue(value);
+    }
 };
 
 SaveAllHelper::SaveAllHelper(QWidget* parent)
 : d(new SaveAllHelperPrivate)
 {
     d->mParent = parent;
+    d->mFinishedCount = 0;
     d->mProgressDialog = new QProgressDialog(parent);
     connect(d->mProgressDialog, &QProgressDialog::canceled, this, &SaveAllHelper::slotCanceled);
     d->mProgressDialog->setLabelText(i18nc("@info:progress saving all image changes", "Saving..."));
@@ -68,16 +78,27 @@ SaveAllHelper::~SaveAllHelper()
 void SaveAllHelper::save()
 {
     QList<QUrl> list = DocumentFactory::instance()->modifiedDocumentList();
-    d->mProgressDialog->setRange(0, list.size());
+    // Each document counts for 100, so that the progress of the documents
+    // being saved can be shown
+    d->mProgressDialog->setRange(0, list.size() * 100);
     d->mProgressDialog->setValue(0);
     Q_FOREACH(const QUrl &url, list) {
         Document::Ptr doc = DocumentFactory::instance()->load(url);
         DocumentJob* job = doc->save(url, doc->format());
+        if (!job) {
+            d->mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
+                                    "<filename>%1</filename>: %2", url.fileName(), doc->errorString());
+            ++d->mFinishedCount;
+            continue;
+        }
         connect(job, &DocumentJob::result, this, &SaveAllHelper::slotResult);
-        d->mJobSet << job;
+        connect(job, SIGNAL(percent(KJob*,ulong)), SLOT(slotPercent(KJob*,ulong)));
+        d->mJobPercents.insert(job, 0);
     }
 
-    d->mProgressDialog->exec();
+    if (!d->mJobPercents.isEmpty()) {
+        d->mProgressDialog->exec();
+    }
 
     // Done, show message if necessary
     if (d->mErrorList.count() > 0) {
@@ -93,11 +114,21 @@ void SaveAllHelper::save()
 
 void SaveAllHelper::slotCanceled()
 {
-    Q_FOREACH(DocumentJob * job, d->mJobSet) {
+    Q_FOREACH(DocumentJob * job, d->mJobPercents.keys()) {
         job->kill();
     }
 }
 
+void SaveAllHelper::slotPercent(KJob* job, unsigned long percent)
+{
+    QHash<DocumentJob*, int>::Iterator it = d->mJobPercents.find(static_cast<DocumentJob*>(job));
+    if (it == d->mJobPercents.end()) {
+        return;
+    }
+    *it = qMin(int(percent), 100);
+    d->updateProgress();
+}
+
 void SaveAllHelper::slotResult(KJob* _job)
 {
     DocumentJob* job = static_cast<DocumentJob*>(_job);
@@ -107,8 +138,9 @@ void SaveAllHelper::slotResult(KJob* _job)
         d->mErrorList << xi18nc("@info %1 is the name of the document which failed to save, %2 is the reason for the failure",
                                 "<filename>%1</filename>: %2", name, job->errorString());
     }
-    d->mJobSet.remove(job);
-    d->mProgressDialog->setValue(d->mProgressDialog->value() + 1);
+    d->mJobPercents.remove(job);
+    ++d->mFinishedCount;
+    d->updateProgress();
 }
 
 } // namespace
@@ -45,6 +45,7 @@ public:
 
 private Q_SLOTS:
     void slotCanceled();
+    void slotPercent(KJob*, unsigned long);
     void slotResult(KJob*);
 
 private:
@@ -21,8 +21,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Qt
 #include <QCheckBox>
+#include <QFontDatabase>
 #include <QItemSelectionModel>
+#include <QLabel>
 #include <QShortcut>
+#include <QTimer>
 #include <QToolButton>
 #include <QVBoxLayout>
 #include <QDebug>
@@ -49,12 +52,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/documentview/documentviewsynchronizer.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/imagescaler.h>
 #include <lib/paintutils.h>
+#include <lib/perfcounters.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
 #include <lib/slidecontainer.h>
 #include <lib/slideshow.h>
 #include <lib/statusbartoolbutton.h>
 #include <lib/thumbnailview/thumbnailbarview.h>
+#include <lib/widgetfloater.h>
 #include <lib/zoomwidget.h>
 #include <lib/zoommode.h>
 
@@ -72,6 +78,9 @@ namespace Gwenview
 
 const int ViewMainPage::MaxViewCount = 6;
 
+// How often the performance overlay is refreshed, in milliseconds
+static const int PERF_OVERLAY_INTERVAL = 1000;
+
 static QString rgba(const QColor &color)
 {
     return QString::fromAscii("rgba(%1, %2, %3, %4)")
@@ -143,6 +152,8 @@ struct ViewMainPagePrivate
     DocumentViewController* mDocumentViewController;
     QList<DocumentView*> mDocumentViews;
     DocumentViewSynchronizer* mSynchronizer;
+    // Scales the images of all the views together in compare mode
+    ImageScalerBatch* mScalerBatch;
     QToolButton* mToggleSideBarButton;
     QToolButton* mToggleThumbnailBarButton;
     ZoomWidget* mZoomWidget;
@@ -153,6 +164,8 @@ struct ViewMainPagePrivate
     KToggleAction* mToggleThumbnailBarAction;
     KToggleAction* mSynchronizeAction;
     QCheckBox* mSynchronizeCheckBox;
+    // Shows PerfCounters over the views, only created if GV_PERF_OVERLAY is set
+    QLabel* mPerfOverlay;
 
     // Activity Resource events reporting needs to be above KPart,
     // in the shell itself, to avoid problems with other MDI applications
@@ -238,6 +251,7 @@ struct ViewMainPagePrivate
         mDocumentViewController->setZoomWidget(mZoomWidget);
         mDocumentViewController->setToolContainer(mToolContainer);
         mSynchronizer = new DocumentViewSynchronizer(&mDocumentViews, q);
+        mScalerBatch = new ImageScalerBatch(q);
     }
 
     DocumentView* createDocumentView()
@@ -308,6 +322,33 @@ struct ViewMainPagePrivate
         layout->addWidget(mZoomWidget);
     }
 
+    void setupPerfOverlay()
+    {
+        mPerfOverlay = 0;
+        if (!PerfCounters::isReportingEnabled()) {
+            return;
+        }
+        mPerfOverlay = new QLabel;
+        mPerfOverlay->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        mPerfOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+        mPerfOverlay->setStyleSheet(
+            "QLabel {"
+            "	background-color: rgba(0, 0, 0, 160);"
+            "	color: white;"
+            "	padding: 4px;"
+            "}");
+
+        WidgetFloater* floater = new WidgetFloater(mDocumentViewContainer);
+        floater->setChildWidget(mPerfOverlay);
+        floater->setAlignment(Qt::AlignTop | Qt::AlignLeft);
+
+        QTimer* timer = new QTimer(q);
+        timer->setInterval(PERF_OVERLAY_INTERVAL);
+        QObject::connect(timer, &QTimer::timeout, q, &ViewMainPage::updatePerfOverlay);
+        timer->start();
+        q->updatePerfOverlay();
+    }
+
     void setupSplitter()
     {
         Qt::Orientation orientation = GwenviewConfig::thumbnailBarOrientation();
@@ -418,6 +459,8 @@ ViewMainPage::ViewMainPage(QWidget* parent, SlideShow* slideShow, KActionCollect
 
     d->setupDocumentViewController();
 
+    d->setupPerfOverlay();
+
     KActionCategory* view = new KActionCategory(i18nc("@title actions category - means actions changing smth in interface", "View"), actionCollection);
 
     d->mToggleThumbnailBarAction = view->add<KToggleAction>(QString("toggle_thumbnailbar"));
@@ -676,6 +719,7 @@ void ViewMainPage::openUrls(const QList<QUrl>& allUrls, const QUrl &currentUrl)
     // Init views
     Q_FOREACH(DocumentView * view, d->mDocumentViews) {
         view->setCompareMode(d->mCompareMode);
+        view->setScalerBatch(d->mCompareMode ? d->mScalerBatch : 0);
         if (view->url() == currentUrl) {
             d->setCurrentView(view);
         } else {
@@ -762,6 +806,13 @@ void ViewMainPage::deselectView(DocumentView* view)
     }
 }
 
+void ViewMainPage::updatePerfOverlay()
+{
+    GV_RETURN_IF_FAIL(d->mPerfOverlay);
+    d->mPerfOverlay->setText(PerfCounters::report());
+    d->mPerfOverlay->adjustSize();
+}
+
 QToolButton* ViewMainPage::toggleSideBarButton() const
 {
     return d->mToggleSideBarButton;
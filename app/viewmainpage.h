@@ -140,6 +140,8 @@ private Q_SLOTS:
     void trashView(DocumentView*);
     void deselectView(DocumentView*);
 
+    void updatePerfOverlay();
+
 private:
     friend struct ViewMainPagePrivate;
     ViewMainPagePrivate* const d;
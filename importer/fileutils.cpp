@@ -48,21 +48,32 @@ namespace FileUtils
 bool contentsAreIdentical(const KUrl& url1, const KUrl& url2, QWidget* authWindow)
 {
     // FIXME: Support remote urls
-    QFile file1(KIO::NetAccess::mostLocalUrl(url1, authWindow).toLocalFile());
+    return contentsAreIdentical(
+        KIO::NetAccess::mostLocalUrl(url1, authWindow).toLocalFile(),
+        KIO::NetAccess::mostLocalUrl(url2, authWindow).toLocalFile());
+}
+
+bool contentsAreIdentical(const QString& path1, const QString& path2)
+{
+    QFile file1(path1);
     if (!file1.open(QIODevice::ReadOnly)) {
-        // Can't read url1, assume it's different from url2
-        qWarning() << "Can't read" << url1;
+        // Can't read path1, assume it's different from path2
+        qWarning() << "Can't read" << path1;
         return false;
     }
 
-    QFile file2(KIO::NetAccess::mostLocalUrl(url2, authWindow).toLocalFile());
+    QFile file2(path2);
     if (!file2.open(QIODevice::ReadOnly)) {
-        // Can't read url2, assume it's different from url1
-        qWarning() << "Can't read" << url2;
+        // Can't read path2, assume it's different from path1
+        qWarning() << "Can't read" << path2;
         return false;
     }
 
-    const int CHUNK_SIZE = 4096;
+    if (file1.size() != file2.size()) {
+        return false;
+    }
+
+    const int CHUNK_SIZE = 256 * 1024;
     while (!file1.atEnd() && !file2.atEnd()) {
         QByteArray url1Array = file1.read(CHUNK_SIZE);
         QByteArray url2Array = file2.read(CHUNK_SIZE);
@@ -79,8 +90,42 @@ bool contentsAreIdentical(const KUrl& url1, const KUrl& url2, QWidget* authWindo
     }
 }
 
+static RenameResult renameLocalFile(const QString& src, const QString& dst_)
+{
+    QString dst = dst_;
+    RenameResult result = RenamedOK;
+    int count = 1;
+
+    QFileInfo fileInfo(dst);
+    const QString prefix = fileInfo.absolutePath() + '/' + fileInfo.completeBaseName() + '_';
+    const QString suffix = '.' + fileInfo.suffix();
+
+    // Find unique name
+    while (QFile::exists(dst)) {
+        // File exists. If it's not the same, try to create a new name
+        if (contentsAreIdentical(src, dst)) {
+            // Already imported, skip it
+            QFile::remove(src);
+            return Skipped;
+        }
+        result = RenamedUnderNewName;
+
+        dst = prefix + QString::number(count) + suffix;
+        ++count;
+    }
+
+    if (!QFile::rename(src, dst)) {
+        result = RenameFailed;
+    }
+    return result;
+}
+
 RenameResult rename(const KUrl& src, const KUrl& dst_, QWidget* authWindow)
 {
+    if (src.isLocalFile() && dst_.isLocalFile()) {
+        return renameLocalFile(src.toLocalFile(), dst_.toLocalFile());
+    }
+
     KUrl dst = dst_;
     RenameResult result = RenamedOK;
     int count = 1;
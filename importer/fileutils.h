@@ -40,11 +40,24 @@ enum RenameResult {
 
 /**
  * Compare content of two urls, returns whether they are the same
+ *
+ * The urls are resolved with KIO::NetAccess::mostLocalUrl(), which runs a
+ * nested event loop: only call it from the GUI thread.
  */
 bool contentsAreIdentical(const KUrl& url1, const KUrl& url2, QWidget* authWindow = 0);
 
+/**
+ * Compare content of two local files, returns whether they are the same
+ *
+ * Does not use KIO, so it can be called from a worker thread.
+ */
+bool contentsAreIdentical(const QString& path1, const QString& path2);
+
 /**
  * Rename src to dst, returns RenameResult
+ *
+ * If both urls are local files, no KIO job is used, so it can be called from
+ * a worker thread. Otherwise it must be called from the GUI thread.
  */
 RenameResult rename(const KUrl& src, const KUrl& dst, QWidget* authWindow = 0);
 
@@ -22,6 +22,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "importer.moc"
 
 // Qt
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QHash>
+
+// System
+#include <sys/types.h>
+#include <utime.h>
 
 // KDE
 #include <KDateTime>
@@ -42,31 +53,139 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include <fileutils.h>
 #include <filenameformater.h>
+#include <importindex.h>
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+#include <lib/remotefilecache.h>
+#include <lib/taskscheduler.h>
 #include <lib/timeutils.h>
 #include <QDir>
 
 namespace Gwenview
 {
 
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+static const int MAX_CONCURRENT_COPIES = qMax(1, envInt("GV_MAX_CONCURRENT_IMPORTS", 4));
+
+/**
+ * A document being imported. It goes through these steps:
+ * - if the document is local and the destination contains a file of the same
+ *   size, check in the thread pool whether the document has already been
+ *   imported, in which case the next steps are skipped
+ * - copy to the temporary import dir, with a KIO job. Remote documents are
+ *   checked for duplicates at this point, and skipped before being renamed
+ * - date extraction, in the thread pool, only if auto-rename is enabled
+ * - rename to its final name, in the thread pool
+ *
+ * Copies and date extractions of several items run at the same time, but
+ * items are renamed one at a time, in the order of the url list, so that
+ * name collisions are always resolved the same way.
+ */
+struct ImportItem
+{
+    KUrl mSrcUrl;
+    // What to copy: mSrcUrl or its copy in the RemoteFileCache
+    KUrl mCopySrcUrl;
+    // Url of the copy in the temporary import dir
+    KUrl mTempUrl;
+    KIO::filesize_t mSize;
+    // Local file compared to the destination folder: mCopySrcUrl if it is
+    // local, otherwise mTempUrl once the copy is done
+    QString mCheckedPath;
+    ImportIndex* mIndex;
+    QFuture<void> mDuplicateFuture;
+    bool mIsDuplicate;
+    // Modification time of mSrcUrl, only set if it is copied from the
+    // RemoteFileCache
+    time_t mCachedCopyTime;
+    // Path of the RemoteFileCache copy, leased until it has been copied
+    QString mCachedCopyPath;
+    bool mCopyDone;
+    bool mCopyFailed;
+    // Modification time of the copy, read in the GUI thread
+    QDateTime mFileTime;
+    KDateTime mDateTime;
+    QFuture<void> mDateFuture;
+    FileUtils::RenameResult mRenameResult;
+
+    ImportItem(const KUrl& url)
+    : mSrcUrl(url)
+    , mCopySrcUrl(url)
+    , mSize(0)
+    , mIndex(0)
+    , mIsDuplicate(false)
+    , mCachedCopyTime(-1)
+    , mCopyDone(false)
+    , mCopyFailed(false)
+    , mRenameResult(FileUtils::RenameFailed)
+    {}
+
+    ~ImportItem()
+    {
+        releaseCachedCopy();
+    }
+
+    void releaseCachedCopy()
+    {
+        if (!mCachedCopyPath.isEmpty()) {
+            RemoteFileCache::instance()->release(mCachedCopyPath);
+            mCachedCopyPath.clear();
+        }
+    }
+
+    void checkDuplicate()
+    {
+        mIsDuplicate = mIndex->contains(mSize, mCheckedPath);
+    }
+
+    void extractDateTime()
+    {
+        // Runs in a worker thread: only read the file, KFileItem must not be
+        // used here. The result is not cached because mTempUrl is temporary.
+        const QDateTime dateTime = TimeUtils::dateTimeFromExif(mTempUrl.toLocalFile());
+        mDateTime = dateTime.isValid() ? dateTime : mFileTime;
+    }
+};
+
 struct ImporterPrivate
 {
     Importer* q;
     QWidget* mAuthWindow;
     std::auto_ptr<FileNameFormater> mFileNameFormater;
+    KUrl mDestUrl;
     KUrl mTempImportDir;
+    std::auto_ptr<ImportIndex> mIndex;
 
     /* @defgroup reset Should be reset in start()
      * @{ */
-    KUrl::List mUrlList;
+    QList<ImportItem*> mItems;
     KUrl::List mImportedUrlList;
     KUrl::List mSkippedUrlList;
     int mRenamedCount;
     int mProgress;
-    int mJobProgress;
+    // Index of the next item to copy
+    int mNextCopy;
+    // Index of the next item to rename
+    int mNextRename;
+    QHash<KJob*, ImportItem*> mItemForJob;
+    QHash<KJob*, int> mPercentForJob;
+    // Items being checked for duplicates
+    QHash<QObject*, ImportItem*> mItemForChecker;
+    QFuture<void> mRenameFuture;
+    // True from the start of a rename until slotRenameDone() is called
+    bool mRenaming;
+    qint64 mCopiedBytes;
+    QElapsedTimer mTimer;
     /* @} */
 
-    KUrl mCurrentUrl;
-
     void emitError(const QString& message)
     {
         QMetaObject::invokeMethod(q, "error", Q_ARG(QString, message));
@@ -90,60 +209,117 @@ struct ImporterPrivate
         return true;
     }
 
-    void importNext()
+    void clearItems()
+    {
+        TaskScheduler* scheduler = TaskScheduler::instance();
+        Q_FOREACH(KJob* job, mItemForJob.keys()) {
+            job->kill();
+        }
+        mItemForJob.clear();
+        mPercentForJob.clear();
+        // Deleting watchers is enough to stop them
+        qDeleteAll(mItemForChecker.keys());
+        mItemForChecker.clear();
+        Q_FOREACH(ImportItem* item, mItems) {
+            scheduler->cancel(item->mDuplicateFuture);
+            scheduler->cancel(item->mDateFuture);
+            scheduler->waitForFinished(item->mDuplicateFuture);
+            scheduler->waitForFinished(item->mDateFuture);
+        }
+        scheduler->waitForFinished(mRenameFuture);
+        qDeleteAll(mItems);
+        mItems.clear();
+    }
+
+    void startCopies()
+    {
+        while (mItemForJob.count() + mItemForChecker.count() < MAX_CONCURRENT_COPIES && mNextCopy < mItems.count()) {
+            ImportItem* item = mItems.at(mNextCopy);
+            ++mNextCopy;
+            if (item->mSrcUrl.isLocalFile()) {
+                item->mSize = QFileInfo(item->mSrcUrl.toLocalFile()).size();
+                checkDuplicateOrCopy(item);
+                continue;
+            }
+            // Stat the file first, it may have already been downloaded to
+            // show it or generate its thumbnail
+            KIO::Job* job = KIO::stat(item->mSrcUrl, KIO::HideProgressInfo);
+            if (job->ui()) {
+                job->ui()->setWindow(mAuthWindow);
+            }
+            mItemForJob.insert(job, item);
+            QObject::connect(job, SIGNAL(result(KJob*)),
+                             q, SLOT(slotStatDone(KJob*)));
+        }
+    }
+
+    void checkDuplicateOrCopy(ImportItem* item)
     {
-        if (mUrlList.empty()) {
-            q->finalizeImport();
+        if (!mIndex->containsSize(item->mSize)) {
+            copy(item, item->mCopySrcUrl);
+            return;
+        }
+        if (!item->mCopySrcUrl.isLocalFile()) {
+            // Remote documents are compared once they have been copied, see
+            // slotCopyDone()
+            copy(item, item->mCopySrcUrl);
             return;
         }
-        mCurrentUrl = mUrlList.takeFirst();
+        item->mCheckedPath = item->mCopySrcUrl.toLocalFile();
+        QFutureWatcher<void>* watcher = startDuplicateCheck(item);
+        mItemForChecker.insert(watcher, item);
+        QObject::connect(watcher, SIGNAL(finished()),
+                         q, SLOT(slotDuplicateChecked()));
+    }
+
+    QFutureWatcher<void>* startDuplicateCheck(ImportItem* item)
+    {
+        item->mIndex = mIndex.get();
+        item->mDuplicateFuture = TaskScheduler::instance()->run(TaskScheduler::Import, item, &ImportItem::checkDuplicate);
+        QFutureWatcher<void>* watcher = new QFutureWatcher<void>(q);
+        watcher->setFuture(item->mDuplicateFuture);
+        return watcher;
+    }
+
+    void copy(ImportItem* item, const KUrl& src)
+    {
+        // Each item gets its own dir, so that items with the same name do
+        // not overwrite each other
         KUrl dst = mTempImportDir;
-        dst.addPath(mCurrentUrl.fileName());
-        KIO::Job* job = KIO::copy(mCurrentUrl, dst, KIO::HideProgressInfo);
+        dst.addPath(QString::number(mItems.indexOf(item)));
+        if (!QDir().mkpath(dst.toLocalFile())) {
+            qWarning() << "Could not create" << dst;
+            item->mCopyDone = true;
+            item->mCopyFailed = true;
+            QMetaObject::invokeMethod(q, "renameNext", Qt::QueuedConnection);
+            return;
+        }
+        dst.addPath(item->mSrcUrl.fileName());
+        KIO::Job* job = KIO::copy(src, dst, KIO::HideProgressInfo);
         if (job->ui()) {
             job->ui()->setWindow(mAuthWindow);
         }
+        mItemForJob.insert(job, item);
         QObject::connect(job, SIGNAL(result(KJob*)),
                          q, SLOT(slotCopyDone(KJob*)));
         QObject::connect(job, SIGNAL(percent(KJob*,ulong)),
                          q, SLOT(slotPercent(KJob*,ulong)));
     }
 
-    void renameImportedUrl(const KUrl& src)
+    void renameItem()
     {
-        KUrl dst = src;
-        dst.cd("..");
+        ImportItem* item = mItems.at(mNextRename);
         QString fileName;
         if (mFileNameFormater.get()) {
-            KFileItem item(KFileItem::Unknown, KFileItem::Unknown, src, true /* delayedMimeTypes */);
-            // Get the document time, but do not cache the result because the
-            // 'src' url is temporary: if we import "foo/image.jpg" and
-            // "bar/image.jpg", both images will be temporarily saved in the
-            // 'src' url.
-            KDateTime dateTime = TimeUtils::dateTimeForFileItem(item, TimeUtils::SkipCache);
-            fileName = mFileNameFormater->format(src, dateTime);
+            fileName = mFileNameFormater->format(item->mTempUrl, item->mDateTime);
         } else {
-            fileName = src.fileName();
-        }
-        dst.setFileName(fileName);
-
-        FileUtils::RenameResult result = FileUtils::rename(src, dst, mAuthWindow);
-        switch (result) {
-        case FileUtils::RenamedOK:
-            mImportedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::RenamedUnderNewName:
-            mRenamedCount++;
-            mImportedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::Skipped:
-            mSkippedUrlList << mCurrentUrl;
-            break;
-        case FileUtils::RenameFailed:
-            qWarning() << "Rename failed for" << mCurrentUrl;
+            fileName = item->mTempUrl.fileName();
         }
-        q->advance();
-        importNext();
+        KUrl dst = mDestUrl;
+        dst.addPath(fileName);
+
+        // Both urls are local, so this does not use KIO
+        item->mRenameResult = FileUtils::rename(item->mTempUrl, dst);
     }
 };
 
@@ -153,10 +329,17 @@ Importer::Importer(QWidget* parent)
 {
     d->q = this;
     d->mAuthWindow = parent;
+    d->mRenamedCount = 0;
+    d->mProgress = 0;
+    d->mNextCopy = 0;
+    d->mNextRename = 0;
+    d->mRenaming = false;
+    d->mCopiedBytes = 0;
 }
 
 Importer::~Importer()
 {
+    d->clearItems();
     delete d;
 }
 
@@ -171,39 +354,182 @@ void Importer::setAutoRenameFormat(const QString& format)
 
 void Importer::start(const KUrl::List& list, const KUrl& destination)
 {
-    d->mUrlList = list;
+    d->clearItems();
+    Q_FOREACH(const KUrl& url, list) {
+        d->mItems << new ImportItem(url);
+    }
     d->mImportedUrlList.clear();
     d->mSkippedUrlList.clear();
     d->mRenamedCount = 0;
     d->mProgress = 0;
-    d->mJobProgress = 0;
+    d->mNextCopy = 0;
+    d->mNextRename = 0;
+    d->mRenaming = false;
+    d->mCopiedBytes = 0;
+    d->mTimer.start();
+    d->mDestUrl = destination;
 
     emitProgressChanged();
-    maximumChanged(d->mUrlList.count() * 100);
+    maximumChanged(d->mItems.count() * 100);
 
     if (!d->createImportDir(destination)) {
         qWarning() << "Could not create import dir";
         return;
     }
-    d->importNext();
+    d->mIndex.reset(new ImportIndex(destination.toLocalFile()));
+    if (d->mItems.isEmpty()) {
+        finalizeImport();
+        return;
+    }
+    d->startCopies();
+}
+
+void Importer::slotStatDone(KJob* _job)
+{
+    KIO::StatJob* job = static_cast<KIO::StatJob*>(_job);
+    ImportItem* item = d->mItemForJob.take(job);
+    GV_RETURN_IF_FAIL(item);
+    if (job->error()) {
+        // Let the copy job report the problem
+        d->copy(item, item->mSrcUrl);
+        return;
+    }
+    const KIO::UDSEntry entry = job->statResult();
+    const time_t mtime = entry.numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+    item->mSize = entry.numberValue(KIO::UDSEntry::UDS_SIZE, 0);
+    const QString path = RemoteFileCache::instance()->acquire(item->mSrcUrl, mtime, item->mSize);
+    if (!path.isEmpty()) {
+        item->mCachedCopyTime = mtime;
+        item->mCachedCopyPath = path;
+        item->mCopySrcUrl = KUrl::fromPath(path);
+    }
+    d->checkDuplicateOrCopy(item);
+}
+
+void Importer::slotDuplicateChecked()
+{
+    ImportItem* item = d->mItemForChecker.take(sender());
+    GV_RETURN_IF_FAIL(item);
+    sender()->deleteLater();
+    if (item->mIsDuplicate) {
+        LOG(item->mSrcUrl << "has already been imported");
+        item->mCopyDone = true;
+        d->startCopies();
+        renameNext();
+        return;
+    }
+    d->copy(item, item->mCopySrcUrl);
 }
 
 void Importer::slotCopyDone(KJob* _job)
 {
     KIO::CopyJob* job = static_cast<KIO::CopyJob*>(_job);
-    KUrl url = job->destUrl();
+    ImportItem* item = d->mItemForJob.take(job);
+    d->mPercentForJob.remove(job);
+    GV_RETURN_IF_FAIL(item);
+    item->mCopyDone = true;
+    item->releaseCachedCopy();
     if (job->error()) {
         qWarning() << "FIXME: What do we do with failed urls?";
+        item->mCopyFailed = true;
+    } else {
+        item->mTempUrl = job->destUrl();
+        const QString path = item->mTempUrl.toLocalFile();
+        if (item->mCachedCopyTime != -1) {
+            // The cached copy does not have the modification time of the
+            // original, which may be used to name the imported file
+            struct utimbuf times;
+            times.actime = item->mCachedCopyTime;
+            times.modtime = item->mCachedCopyTime;
+            utime(QFile::encodeName(path).constData(), &times);
+        }
+        const QFileInfo info(path);
+        item->mFileTime = info.lastModified();
+        d->mCopiedBytes += info.size();
+        if (!item->mCopySrcUrl.isLocalFile() && d->mIndex->containsSize(info.size())) {
+            // Now that we have the whole document, check whether it has
+            // already been imported. renameNext() waits for it.
+            item->mSize = info.size();
+            item->mCheckedPath = path;
+            QFutureWatcher<void>* watcher = d->startDuplicateCheck(item);
+            connect(watcher, SIGNAL(finished()), SLOT(renameNext()));
+            connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+        }
+        const qint64 elapsed = d->mTimer.elapsed();
+        if (elapsed > 0) {
+            throughputChanged(d->mCopiedBytes * 1000 / elapsed);
+        }
+        if (d->mFileNameFormater.get()) {
+            item->mDateFuture = TaskScheduler::instance()->run(TaskScheduler::Import, item, &ImportItem::extractDateTime);
+            QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
+            connect(watcher, SIGNAL(finished()), SLOT(renameNext()));
+            connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+            watcher->setFuture(item->mDateFuture);
+        }
+    }
+    d->startCopies();
+    renameNext();
+}
+
+void Importer::renameNext()
+{
+    if (d->mRenaming || d->mNextRename >= d->mItems.count()) {
+        return;
+    }
+    ImportItem* item = d->mItems.at(d->mNextRename);
+    if (!item->mCopyDone || item->mDuplicateFuture.isRunning() || item->mDateFuture.isRunning()) {
+        // Not ready yet, we will be called again
+        return;
+    }
+    if (item->mIsDuplicate) {
+        ++d->mNextRename;
+        d->mSkippedUrlList << item->mSrcUrl;
         advance();
-        d->importNext();
+        renameNext();
         return;
     }
+    if (item->mCopyFailed) {
+        ++d->mNextRename;
+        advance();
+        renameNext();
+        return;
+    }
+    d->mRenaming = true;
+    d->mRenameFuture = TaskScheduler::instance()->run(TaskScheduler::Import, d, &ImporterPrivate::renameItem);
+    QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
+    connect(watcher, SIGNAL(finished()), SLOT(slotRenameDone()));
+    connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+    watcher->setFuture(d->mRenameFuture);
+}
 
-    d->renameImportedUrl(url);
+void Importer::slotRenameDone()
+{
+    d->mRenaming = false;
+    ImportItem* item = d->mItems.at(d->mNextRename);
+    ++d->mNextRename;
+    switch (item->mRenameResult) {
+    case FileUtils::RenamedOK:
+        d->mImportedUrlList << item->mSrcUrl;
+        break;
+    case FileUtils::RenamedUnderNewName:
+        d->mRenamedCount++;
+        d->mImportedUrlList << item->mSrcUrl;
+        break;
+    case FileUtils::Skipped:
+        d->mSkippedUrlList << item->mSrcUrl;
+        break;
+    case FileUtils::RenameFailed:
+        qWarning() << "Rename failed for" << item->mSrcUrl;
+    }
+    advance();
+    renameNext();
 }
 
 void Importer::finalizeImport()
 {
+    if (d->mIndex.get()) {
+        d->mIndex->save();
+    }
     KIO::Job* job = KIO::del(d->mTempImportDir, KIO::HideProgressInfo);
     if (job->ui()) {
         job->ui()->setWindow(d->mAuthWindow);
@@ -214,19 +540,25 @@ void Importer::finalizeImport()
 void Importer::advance()
 {
     ++d->mProgress;
-    d->mJobProgress = 0;
     emitProgressChanged();
+    if (d->mProgress == d->mItems.count()) {
+        finalizeImport();
+    }
 }
 
-void Importer::slotPercent(KJob*, unsigned long percent)
+void Importer::slotPercent(KJob* job, unsigned long percent)
 {
-    d->mJobProgress = percent;
+    d->mPercentForJob[job] = percent;
     emitProgressChanged();
 }
 
 void Importer::emitProgressChanged()
 {
-    progressChanged(d->mProgress * 100 + d->mJobProgress);
+    int progress = d->mProgress * 100;
+    Q_FOREACH(int percent, d->mPercentForJob) {
+        progress += percent;
+    }
+    progressChanged(progress);
 }
 
 KUrl::List Importer::importedUrlList() const
@@ -69,6 +69,11 @@ Q_SIGNALS:
 
     void maximumChanged(int);
 
+    /**
+     * Average number of bytes copied per second since the import started
+     */
+    void throughputChanged(qint64 bytesPerSecond);
+
     /**
      * An error has occurred and caused the whole process to stop without
      * importing anything
@@ -76,7 +81,11 @@ Q_SIGNALS:
     void error(const QString& message);
 
 private Q_SLOTS:
+    void slotStatDone(KJob*);
+    void slotDuplicateChecked();
     void slotCopyDone(KJob*);
+    void renameNext();
+    void slotRenameDone();
     void slotPercent(KJob*, unsigned long);
     void emitProgressChanged();
 
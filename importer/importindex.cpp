@@ -0,0 +1,230 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "importindex.h"
+
+// Qt
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMultiHash>
+#include <QMutex>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <fileutils.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Increase when the format of the stored file changes
+static const qint32 INDEX_VERSION = 1;
+
+struct IndexEntry
+{
+    qint64 mSize;
+    qint64 mMTime;
+    // Empty until needed
+    QByteArray mHash;
+};
+
+static QDataStream& operator<<(QDataStream& stream, const IndexEntry& entry)
+{
+    return stream << entry.mSize << entry.mMTime << entry.mHash;
+}
+
+static QDataStream& operator>>(QDataStream& stream, IndexEntry& entry)
+{
+    return stream >> entry.mSize >> entry.mMTime >> entry.mHash;
+}
+
+static QByteArray hashHead(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read" << path;
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(file.read(ImportIndex::HEAD_SIZE), QCryptographicHash::Md5);
+}
+
+struct ImportIndexPrivate
+{
+    QMutex mMutex;
+    QString mDirPath;
+    QString mIndexPath;
+    // File name => entry
+    QHash<QString, IndexEntry> mEntries;
+    // Size => file name
+    QMultiHash<qint64, QString> mNamesForSize;
+
+    void load()
+    {
+        QFile file(mIndexPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        QDataStream stream(&file);
+        qint32 version;
+        stream >> version;
+        if (version != INDEX_VERSION) {
+            LOG("Ignoring index with version" << version);
+            return;
+        }
+        stream >> mEntries;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << "Could not read import index" << mIndexPath;
+            mEntries.clear();
+        }
+        LOG("Loaded" << mEntries.count() << "entries");
+    }
+
+    void scan()
+    {
+        // Keep the hashes of the files which did not change
+        QHash<QString, IndexEntry> oldEntries = mEntries;
+        mEntries.clear();
+        mNamesForSize.clear();
+        const QFileInfoList list = QDir(mDirPath).entryInfoList(QDir::Files | QDir::Hidden);
+        Q_FOREACH(const QFileInfo& info, list) {
+            IndexEntry entry;
+            entry.mSize = info.size();
+            entry.mMTime = info.lastModified().toTime_t();
+            QHash<QString, IndexEntry>::ConstIterator it = oldEntries.constFind(info.fileName());
+            if (it != oldEntries.constEnd() && it->mSize == entry.mSize && it->mMTime == entry.mMTime) {
+                entry.mHash = it->mHash;
+            }
+            mEntries.insert(info.fileName(), entry);
+            mNamesForSize.insert(entry.mSize, info.fileName());
+        }
+    }
+};
+
+ImportIndex::ImportIndex(const QString& dirPath, const QString& cacheDir_)
+: d(new ImportIndexPrivate)
+{
+    d->mDirPath = dirPath;
+    QString cacheDir = cacheDir_;
+    if (cacheDir.isEmpty()) {
+        cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/importer-index");
+    }
+    const QByteArray key = QCryptographicHash::hash(QFile::encodeName(QDir(dirPath).absolutePath()), QCryptographicHash::Md5);
+    d->mIndexPath = cacheDir + '/' + QString::fromLatin1(key.toHex());
+    d->load();
+    d->scan();
+}
+
+ImportIndex::~ImportIndex()
+{
+    delete d;
+}
+
+bool ImportIndex::containsSize(qint64 size) const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mNamesForSize.contains(size);
+}
+
+bool ImportIndex::contains(qint64 size, const QString& path)
+{
+    const QByteArray hash = hashHead(path);
+    if (hash.isEmpty()) {
+        return false;
+    }
+
+    // Take a snapshot of the candidates, so that files are not read while
+    // the index is locked
+    typedef QPair<QString, QByteArray> Candidate;
+    QList<Candidate> candidates;
+    {
+        QMutexLocker locker(&d->mMutex);
+        QMultiHash<qint64, QString>::ConstIterator it = d->mNamesForSize.constFind(size);
+        for (; it != d->mNamesForSize.constEnd() && it.key() == size; ++it) {
+            candidates << qMakePair(it.value(), d->mEntries.value(it.value()).mHash);
+        }
+    }
+
+    Q_FOREACH(const Candidate& candidate, candidates) {
+        const QString candidatePath = d->mDirPath + '/' + candidate.first;
+        QByteArray candidateHash = candidate.second;
+        if (candidateHash.isEmpty()) {
+            LOG("Hashing" << candidate.first);
+            candidateHash = hashHead(candidatePath);
+            if (candidateHash.isEmpty()) {
+                continue;
+            }
+            QMutexLocker locker(&d->mMutex);
+            QHash<QString, IndexEntry>::Iterator entryIt = d->mEntries.find(candidate.first);
+            // The folder may have been listed again in the meantime
+            if (entryIt != d->mEntries.end() && entryIt->mSize == size) {
+                entryIt->mHash = candidateHash;
+            }
+        }
+        // Files with the same beginning are common: photos in burst mode,
+        // or files with the same large header. Only trust the whole content.
+        if (candidateHash == hash && FileUtils::contentsAreIdentical(path, candidatePath)) {
+            LOG("Found" << candidate.first);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ImportIndex::save()
+{
+    QMutexLocker locker(&d->mMutex);
+    d->scan();
+    if (!QDir().mkpath(QFileInfo(d->mIndexPath).absolutePath())) {
+        qWarning() << "Could not create dir for import index" << d->mIndexPath;
+        return;
+    }
+    QSaveFile file(d->mIndexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not save import index" << d->mIndexPath << file.errorString();
+        return;
+    }
+    QDataStream stream(&file);
+    stream << INDEX_VERSION << d->mEntries;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Could not save import index" << d->mIndexPath;
+    }
+}
+
+} // namespace
@@ -0,0 +1,88 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMPORTINDEX_H
+#define IMPORTINDEX_H
+
+// Qt
+#include <QtGlobal>
+
+// KDE
+
+// Local
+
+class QString;
+
+namespace Gwenview
+{
+
+struct ImportIndexPrivate;
+/**
+ * Knows the content of an import destination folder, so that documents which
+ * have already been imported can be skipped without being copied.
+ *
+ * A document is considered already imported if a file of the folder has the
+ * same content. Candidates are found by size and by a hash of their first
+ * HEAD_SIZE bytes, then the whole content is compared. The hashes are only
+ * computed for files whose size matches the size of a document, and they are
+ * stored in the user cache dir, so that the next imports do not have to read
+ * the folder again.
+ *
+ * contains() can be called from any thread. Files are only read while the
+ * index is not locked.
+ */
+class ImportIndex
+{
+public:
+    enum { HEAD_SIZE = 64 * 1024 };
+
+    /**
+     * Lists the files of @a dirPath. @a cacheDir is where the hashes are
+     * stored, it defaults to the user cache dir.
+     */
+    ImportIndex(const QString& dirPath, const QString& cacheDir = QString());
+    ~ImportIndex();
+
+    /**
+     * Returns true if the folder contains a file of @a size bytes. If it
+     * does not, there is no need to read the document to call contains().
+     */
+    bool containsSize(qint64 size) const;
+
+    /**
+     * Returns true if the folder contains a file with the same content as the
+     * local file @a path, which is @a size bytes long.
+     */
+    bool contains(qint64 size, const QString& path);
+
+    /**
+     * Lists the folder again, to take imported files into account, and
+     * stores the known hashes
+     */
+    void save();
+
+private:
+    Q_DISABLE_COPY(ImportIndex)
+    ImportIndexPrivate* const d;
+};
+
+} // namespace
+
+#endif /* IMPORTINDEX_H */
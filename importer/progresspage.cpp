@@ -21,6 +21,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Self
 #include "progresspage.h"
 
+// KDE
+#include <KIO/Global>
+#include <KLocalizedString>
+
 // Local
 #include <ui_progresspage.h>
 #include "importer.h"
@@ -45,6 +49,8 @@ ProgressPage::ProgressPage(Importer* importer)
             d->mProgressBar, SLOT(setValue(int)));
     connect(d->mImporter, SIGNAL(maximumChanged(int)),
             d->mProgressBar, SLOT(setMaximum(int)));
+    connect(d->mImporter, SIGNAL(throughputChanged(qint64)),
+            SLOT(slotThroughputChanged(qint64)));
 }
 
 ProgressPage::~ProgressPage()
@@ -52,4 +58,10 @@ ProgressPage::~ProgressPage()
     delete d;
 }
 
+void ProgressPage::slotThroughputChanged(qint64 bytesPerSecond)
+{
+    d->mThroughputLabel->setText(
+        i18nc("@info:status %1 is a size, like 12.5 MiB", "%1/s", KIO::convertSize(bytesPerSecond)));
+}
+
 } // namespace
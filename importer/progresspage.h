@@ -42,6 +42,9 @@ public:
     ProgressPage(Importer*);
     ~ProgressPage();
 
+private Q_SLOTS:
+    void slotThroughputChanged(qint64 bytesPerSecond);
+
 private:
     ProgressPagePrivate* const d;
 };
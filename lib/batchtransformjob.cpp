@@ -0,0 +1,256 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "batchtransformjob.h"
+
+// Qt
+#include <QAtomicInt>
+#include <QFuture>
+#include <QImage>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QDebug>
+
+// KDE
+#include <KLocalizedString>
+
+// Local
+#include <lib/document/documentfactory.h>
+#include <lib/gwenviewconfig.h>
+#include <lib/imageutils.h>
+#include <lib/jpegcontent.h>
+#include <lib/taskscheduler.h>
+#include <lib/thumbnailprovider/thumbnailprovider.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Each orientation is described as an optional horizontal flip followed by a
+// clockwise rotation of ORIENTATION_ROTATION[orientation] quarter turns.
+static const int ORIENTATION_ROTATION[] = { 0, 0, 0, 2, 2, 3, 1, 1, 3 };
+static const bool ORIENTATION_FLIP[] = { false, false, true, false, true, true, false, true, false };
+
+/**
+ * Returns the orientation equivalent to applying @a first, then @a second
+ */
+static Orientation combineOrientations(Orientation first, Orientation second)
+{
+    // Moving a flip before a rotation reverses the rotation
+    int rotation = ORIENTATION_FLIP[second]
+                   ? ORIENTATION_ROTATION[second] - ORIENTATION_ROTATION[first]
+                   : ORIENTATION_ROTATION[second] + ORIENTATION_ROTATION[first];
+    rotation = (rotation + 4) % 4;
+    const bool flip = ORIENTATION_FLIP[first] != ORIENTATION_FLIP[second];
+    for (int orientation = NORMAL; orientation <= ROT_270; ++orientation) {
+        if (ORIENTATION_ROTATION[orientation] == rotation && ORIENTATION_FLIP[orientation] == flip) {
+            return Orientation(orientation);
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * Transforms the file at @a path, returns an error message on failure. If
+ * @a applyExifOrientation is true, the EXIF orientation is baked into the
+ * pixels.
+ */
+static QString transformFile(const QString& path, Orientation orientation, bool applyExifOrientation)
+{
+    JpegContent content;
+    if (!content.load(path)) {
+        return i18nc("@info", "Could not load file.");
+    }
+
+    Orientation exifOrientation = applyExifOrientation ? content.orientation() : NORMAL;
+    if (exifOrientation < NORMAL || exifOrientation > ROT_270) {
+        exifOrientation = NORMAL;
+    }
+    const Orientation finalOrientation = combineOrientations(exifOrientation, orientation);
+    LOG(path << "exif orientation:" << exifOrientation << "final orientation:" << finalOrientation);
+
+    // Like the pixels, the EXIF thumbnail is stored without the EXIF
+    // orientation applied
+    QImage thumbnail = content.thumbnail();
+    content.transform(finalOrientation);
+    if (applyExifOrientation) {
+        content.resetOrientation();
+    }
+    if (!thumbnail.isNull()) {
+        content.setThumbnail(thumbnail.transformed(ImageUtils::transformMatrix(finalOrientation)));
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return i18nc("@info", "Could not open file for writing.");
+    }
+    if (!content.save(&file)) {
+        file.cancelWriting();
+        return content.errorString();
+    }
+    if (!file.commit()) {
+        return file.errorString();
+    }
+    return QString();
+}
+
+class BatchTransformTask;
+
+struct BatchTransformJobPrivate
+{
+    BatchTransformJob* q;
+    QList<QUrl> mUrls;
+    Orientation mOrientation;
+    // Read in the GUI thread, GwenviewConfig must not be used by the tasks
+    bool mApplyExifOrientation;
+    QList<BatchTransformTask*> mTasks;
+    QList<QFuture<void> > mFutures;
+    QAtomicInt mCanceled;
+    int mDoneCount;
+    QMap<QUrl, QString> mErrors;
+
+    void cancelTasks();
+};
+
+class BatchTransformTask
+{
+public:
+    BatchTransformTask(BatchTransformJobPrivate* d, const QUrl& url)
+    : mD(d)
+    , mUrl(url)
+    {}
+
+    void run()
+    {
+        if (mD->mCanceled.load() || TaskScheduler::isCurrentTaskCanceled()) {
+            return;
+        }
+        const QString errorString = transformFile(mUrl.toLocalFile(), mD->mOrientation, mD->mApplyExifOrientation);
+        QMetaObject::invokeMethod(mD->q, "slotFileDone", Qt::QueuedConnection,
+                                  Q_ARG(QUrl, mUrl), Q_ARG(QString, errorString));
+    }
+
+private:
+    BatchTransformJobPrivate* mD;
+    QUrl mUrl;
+};
+
+void BatchTransformJobPrivate::cancelTasks()
+{
+    mCanceled.store(1);
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    Q_FOREACH(const QFuture<void>& future, mFutures) {
+        scheduler->cancel(future);
+    }
+    Q_FOREACH(const QFuture<void>& future, mFutures) {
+        scheduler->waitForFinished(future);
+    }
+    mFutures.clear();
+    qDeleteAll(mTasks);
+    mTasks.clear();
+}
+
+BatchTransformJob::BatchTransformJob(const QList<QUrl>& urls, Orientation orientation, QObject* parent)
+: KJob(parent)
+, d(new BatchTransformJobPrivate)
+{
+    d->q = this;
+    d->mUrls = urls;
+    d->mOrientation = orientation;
+    d->mApplyExifOrientation = GwenviewConfig::applyExifOrientation();
+    d->mDoneCount = 0;
+}
+
+BatchTransformJob::~BatchTransformJob()
+{
+    d->cancelTasks();
+    delete d;
+}
+
+void BatchTransformJob::start()
+{
+    setTotalAmount(KJob::Files, d->mUrls.count());
+    if (d->mUrls.isEmpty()) {
+        emitResult();
+        return;
+    }
+    Q_FOREACH(const QUrl& url, d->mUrls) {
+        BatchTransformTask* task = new BatchTransformTask(d, url);
+        d->mTasks << task;
+        d->mFutures << TaskScheduler::instance()->run(TaskScheduler::Save, task, &BatchTransformTask::run);
+    }
+}
+
+bool BatchTransformJob::doKill()
+{
+    d->cancelTasks();
+    return true;
+}
+
+QMap<QUrl, QString> BatchTransformJob::errors() const
+{
+    return d->mErrors;
+}
+
+bool BatchTransformJob::canTransform(const QUrl& url)
+{
+    if (!url.isLocalFile()) {
+        return false;
+    }
+    QMimeDatabase db;
+    return db.mimeTypeForFile(url.toLocalFile(), QMimeDatabase::MatchExtension).inherits(QStringLiteral("image/jpeg"));
+}
+
+void BatchTransformJob::slotFileDone(const QUrl& url, const QString& errorString)
+{
+    if (errorString.isEmpty()) {
+        ThumbnailProvider::deleteImageThumbnail(url);
+        Document::Ptr doc = DocumentFactory::instance()->getCachedDocument(url);
+        if (doc && !doc->isModified()) {
+            doc->reload();
+        }
+        emit urlTransformed(url);
+    } else {
+        LOG("Failed to transform" << url << ":" << errorString);
+        d->mErrors.insert(url, errorString);
+    }
+
+    ++d->mDoneCount;
+    setProcessedAmount(KJob::Files, d->mDoneCount);
+    if (d->mDoneCount < d->mUrls.count()) {
+        return;
+    }
+    if (!d->mErrors.isEmpty()) {
+        setError(UserDefinedError);
+        setErrorText(i18ncp("@info", "One file could not be transformed.", "%1 files could not be transformed.", d->mErrors.count()));
+    }
+    emitResult();
+}
+
+} // namespace
@@ -0,0 +1,89 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef BATCHTRANSFORMJOB_H
+#define BATCHTRANSFORMJOB_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QList>
+#include <QMap>
+#include <QUrl>
+
+// KDE
+#include <KJob>
+
+// Local
+#include <lib/orientation.h>
+
+namespace Gwenview
+{
+
+struct BatchTransformJobPrivate;
+/**
+ * Applies the same transformation to a list of JPEG files, without going
+ * through Document.
+ *
+ * Files are transformed losslessly in the DCT domain by JpegContent, as
+ * TaskScheduler::Save tasks. If GwenviewConfig::applyExifOrientation() is
+ * set when the job is created, the EXIF orientation is baked into the pixels
+ * and reset. The EXIF thumbnail is transformed as well. Files are replaced
+ * atomically.
+ *
+ * Progress is reported in KJob::Files units. Use canTransform() to find out
+ * which urls can be handled by this job.
+ */
+class GWENVIEWLIB_EXPORT BatchTransformJob : public KJob
+{
+    Q_OBJECT
+public:
+    BatchTransformJob(const QList<QUrl>& urls, Orientation orientation, QObject* parent = 0);
+    ~BatchTransformJob();
+
+    void start() Q_DECL_OVERRIDE;
+
+    /**
+     * Returns the urls which could not be transformed, associated with the
+     * reason of the failure
+     */
+    QMap<QUrl, QString> errors() const;
+
+    /**
+     * Returns true if @a url is a local JPEG file
+     */
+    static bool canTransform(const QUrl& url);
+
+Q_SIGNALS:
+    void urlTransformed(const QUrl&);
+
+protected:
+    bool doKill() Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void slotFileDone(const QUrl& url, const QString& errorString);
+
+private:
+    BatchTransformJobPrivate* const d;
+};
+
+} // namespace
+
+#endif /* BATCHTRANSFORMJOB_H */
@@ -32,6 +32,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/document.h"
 #include "document/documentjob.h"
 #include "document/abstractdocumenteditor.h"
+#include "gwenviewconfig.h"
+#include "undoimagedata.h"
 
 namespace Gwenview
 {
@@ -39,8 +41,11 @@ namespace Gwenview
 class CropJob : public ThreadedDocumentJob
 {
 public:
-    CropJob(const QRect& rect)
+    CropJob(const QRect& rect, bool exact, bool applyExifOrientation, UndoImageData* undoData)
         : mRect(rect)
+        , mExact(exact)
+        , mApplyExifOrientation(applyExifOrientation)
+        , mUndoData(undoData)
     {}
 
     virtual void threadedStart()
@@ -49,19 +54,25 @@ public:
             return;
         }
         const QImage src = document()->image();
-        const QImage dst = src.copy(mRect);
-        document()->editor()->setImage(dst);
+        mUndoData->storeImage(src);
+        if (document()->editor()->applyLosslessCrop(mRect, mExact, mApplyExifOrientation).isNull()) {
+            const QImage dst = src.copy(mRect);
+            document()->editor()->setImage(dst);
+        }
         setError(NoError);
     }
 
 private:
     QRect mRect;
+    bool mExact;
+    bool mApplyExifOrientation;
+    UndoImageData* mUndoData;
 };
 
 struct CropImageOperationPrivate
 {
     QRect mRect;
-    QImage mOriginalImage;
+    QScopedPointer<UndoImageData> mUndoData;
 };
 
 CropImageOperation::CropImageOperation(const QRect& rect)
@@ -78,8 +89,10 @@ CropImageOperation::~CropImageOperation()
 
 void CropImageOperation::redo()
 {
-    d->mOriginalImage = document()->image();
-    redoAsDocumentJob(new CropJob(d->mRect));
+    d->mUndoData.reset(new UndoImageData(document().data()));
+    // The configuration must be read here, CropJob runs in a worker thread
+    redoAsDocumentJob(new CropJob(d->mRect, GwenviewConfig::cropPixelExact(),
+                                  GwenviewConfig::applyExifOrientation(), d->mUndoData.data()));
 }
 
 void CropImageOperation::undo()
@@ -88,7 +101,7 @@ void CropImageOperation::undo()
         qWarning() << "!document->editor()";
         return;
     }
-    document()->editor()->setImage(d->mOriginalImage);
+    document()->editor()->setImage(d->mUndoData->restore(document()->image()));
 }
 
 } // namespace
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/gwenviewlib_export.h>
 
 // Qt
+#include <QRect>
 
 // KDE
 
@@ -64,6 +65,29 @@ public:
      * AbstractImageOperation and applied through Document::undoStack().
      */
     virtual void applyTransformation(Orientation) = 0;
+
+    /**
+     * Crops the document image to @a rect without decoding and encoding it
+     * again, if the implementation supports it. Depending on the format, the
+     * rect may have to be adjusted a bit, unless @a exact is true.
+     * @a applyExifOrientation tells whether the image is shown with its EXIF
+     * orientation applied. Callers read it from the configuration on the GUI
+     * thread, since this method runs in a worker thread.
+     *
+     * Returns the rect which has been cropped, or a null rect if the image
+     * could not be cropped this way: in this case, callers must crop it
+     * themselves and use setImage().
+     *
+     * This method should only be called from a subclass of
+     * AbstractImageOperation and applied through Document::undoStack().
+     */
+    virtual QRect applyLosslessCrop(const QRect& rect, bool exact, bool applyExifOrientation)
+    {
+        Q_UNUSED(rect);
+        Q_UNUSED(exact);
+        Q_UNUSED(applyExifOrientation);
+        return QRect();
+    }
 };
 
 } // namespace
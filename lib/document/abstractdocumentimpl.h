@@ -40,6 +40,7 @@ namespace Gwenview
 class Document;
 class DocumentJob;
 class AbstractDocumentEditor;
+class AnimationPlayer;
 
 struct AbstractDocumentImplPrivate;
 class AbstractDocumentImpl : public QObject
@@ -88,6 +89,18 @@ public:
     virtual void stopAnimation()
     {}
 
+    virtual AnimationPlayer* animationPlayer() const
+    {
+        return 0;
+    }
+
+    /**
+     * Called when the document is promoted, so that the tasks it has queued
+     * can be moved to the new priority
+     */
+    virtual void setTaskPriority(TaskScheduler::Priority)
+    {}
+
     Document* document() const;
 
     virtual QSvgRenderer* svgRenderer() const
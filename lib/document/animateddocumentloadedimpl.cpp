@@ -22,14 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "animateddocumentloadedimpl.h"
 
 // Qt
-#include <QBuffer>
 #include <QImage>
-#include <QMovie>
 #include <QDebug>
 
 // KDE
 
 // Local
+#include "animationplayer.h"
 
 namespace Gwenview
 {
@@ -37,8 +36,7 @@ namespace Gwenview
 struct AnimatedDocumentLoadedImplPrivate
 {
     QByteArray mRawData;
-    QBuffer mMovieBuffer;
-    QMovie mMovie;
+    AnimationPlayer* mPlayer;
 };
 
 AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document* document, const QByteArray& rawData)
@@ -46,12 +44,7 @@ AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document* document, const
 , d(new AnimatedDocumentLoadedImplPrivate)
 {
     d->mRawData = rawData;
-
-    connect(&d->mMovie, &QMovie::frameChanged, this, &AnimatedDocumentLoadedImpl::slotFrameChanged);
-
-    d->mMovieBuffer.setBuffer(&d->mRawData);
-    d->mMovieBuffer.open(QIODevice::ReadOnly);
-    d->mMovie.setDevice(&d->mMovieBuffer);
+    d->mPlayer = new AnimationPlayer(d->mRawData, this);
 }
 
 AnimatedDocumentLoadedImpl::~AnimatedDocumentLoadedImpl()
@@ -81,13 +74,6 @@ QByteArray AnimatedDocumentLoadedImpl::rawData() const
     return d->mRawData;
 }
 
-void AnimatedDocumentLoadedImpl::slotFrameChanged(int /*frameNumber*/)
-{
-    QImage image = d->mMovie.currentImage();
-    setDocumentImage(image);
-    emit imageRectUpdated(image.rect());
-}
-
 bool AnimatedDocumentLoadedImpl::isAnimated() const
 {
     return true;
@@ -95,18 +81,17 @@ bool AnimatedDocumentLoadedImpl::isAnimated() const
 
 void AnimatedDocumentLoadedImpl::startAnimation()
 {
-    d->mMovie.start();
-    if (d->mMovie.state() == QMovie::NotRunning) {
-        // This is true with qt-copy as of 2008.08.23
-        //qDebug() << "QMovie didn't start. This can happen in some cases when starting for the second time.";
-        //qDebug() << "Trying to start again, it usually fixes the bug.";
-        d->mMovie.start();
-    }
+    d->mPlayer->start();
 }
 
 void AnimatedDocumentLoadedImpl::stopAnimation()
 {
-    d->mMovie.stop();
+    d->mPlayer->stop();
+}
+
+AnimationPlayer* AnimatedDocumentLoadedImpl::animationPlayer() const
+{
+    return d->mPlayer;
 }
 
 } // namespace
@@ -45,9 +45,7 @@ public:
     virtual bool isAnimated() const Q_DECL_OVERRIDE;
     virtual void startAnimation() Q_DECL_OVERRIDE;
     virtual void stopAnimation() Q_DECL_OVERRIDE;
-
-private Q_SLOTS:
-    void slotFrameChanged(int frameNumber);
+    virtual AnimationPlayer* animationPlayer() const Q_DECL_OVERRIDE;
 
 private:
     AnimatedDocumentLoadedImplPrivate* const d;
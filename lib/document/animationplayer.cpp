@@ -0,0 +1,394 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "animationplayer.h"
+
+// Qt
+#include <QBuffer>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+#include <QDebug>
+
+// KDE
+
+// Local
+
+// LCMS2
+#include <lcms2.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// The ring buffer holds at most MAX_QUEUED_FRAMES frames, and stops growing
+// before that if the queued frames use more than MAX_QUEUED_BYTES.
+static const int MAX_QUEUED_FRAMES = 8;
+static const int MAX_QUEUED_BYTES = 32 * 1024 * 1024;
+
+// Like web browsers, use a sensible delay for frames which claim to need
+// (almost) no delay
+static const int MIN_FRAME_DELAY = 10;
+static const int DEFAULT_FRAME_DELAY = 100;
+
+struct AnimationFrame
+{
+    QImage mImage;
+    int mDelay;
+};
+
+/**
+ * Decodes frames in a worker thread, until the ring buffer is full
+ */
+class AnimationFrameDecoder : public QThread
+{
+public:
+    AnimationFrameDecoder(QObject* player, const QByteArray& rawData)
+    : mPlayer(player)
+    , mRawData(rawData)
+    , mZoom(1)
+    , mQueuedBytes(0)
+    , mCancel(false)
+    , mTransform(0)
+    {}
+
+    ~AnimationFrameDecoder()
+    {
+        {
+            QMutexLocker locker(&mMutex);
+            mCancel = true;
+            mCond.wakeOne();
+        }
+        wait();
+        if (mTransform) {
+            cmsDeleteTransform(mTransform);
+        }
+    }
+
+    void setZoom(qreal zoom)
+    {
+        QMutexLocker locker(&mMutex);
+        mZoom = zoom;
+    }
+
+    // Takes ownership of transform
+    void setTransform(cmsHTRANSFORM transform)
+    {
+        QMutexLocker locker(&mTransformMutex);
+        if (mTransform) {
+            cmsDeleteTransform(mTransform);
+        }
+        mTransform = transform;
+    }
+
+    bool takeFrame(AnimationFrame* frame)
+    {
+        QMutexLocker locker(&mMutex);
+        if (mFrames.isEmpty()) {
+            return false;
+        }
+        *frame = mFrames.dequeue();
+        mQueuedBytes -= frame->mImage.byteCount();
+        mCond.wakeOne();
+        return true;
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        QBuffer buffer(&mRawData);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        // Same semantic as QMovie: number of times the animation is
+        // restarted, -1 means forever
+        int remainingLoops = reader.loopCount();
+        int decodedFramesInLoop = 0;
+
+        while (true) {
+            {
+                QMutexLocker locker(&mMutex);
+                while (!mCancel && isQueueFull()) {
+                    mCond.wait(&mMutex);
+                }
+                if (mCancel) {
+                    return;
+                }
+            }
+
+            QImage image;
+            if (!reader.read(&image)) {
+                if (decodedFramesInLoop == 0 || remainingLoops == 0) {
+                    LOG("Reached end of animation");
+                    return;
+                }
+                if (remainingLoops > 0) {
+                    --remainingLoops;
+                }
+                buffer.seek(0);
+                reader.setDevice(&buffer);
+                decodedFramesInLoop = 0;
+                continue;
+            }
+            ++decodedFramesInLoop;
+
+            AnimationFrame frame;
+            frame.mDelay = reader.nextImageDelay();
+            if (frame.mDelay <= MIN_FRAME_DELAY) {
+                frame.mDelay = DEFAULT_FRAME_DELAY;
+            }
+            frame.mImage = processFrame(image);
+
+            bool wasEmpty;
+            {
+                QMutexLocker locker(&mMutex);
+                wasEmpty = mFrames.isEmpty();
+                mFrames.enqueue(frame);
+                mQueuedBytes += frame.mImage.byteCount();
+            }
+            if (wasEmpty) {
+                QMetaObject::invokeMethod(mPlayer, "slotFrameDecoded", Qt::QueuedConnection);
+            }
+        }
+    }
+
+private:
+    QObject* mPlayer;
+    QByteArray mRawData;
+
+    QMutex mMutex;
+    QWaitCondition mCond;
+    qreal mZoom;
+    QQueue<AnimationFrame> mFrames;
+    int mQueuedBytes;
+    bool mCancel;
+
+    // Separate mutex so that the GUI thread can dequeue frames while the
+    // worker thread is applying the transform
+    QMutex mTransformMutex;
+    cmsHTRANSFORM mTransform;
+
+    bool isQueueFull() const
+    {
+        // Always accept at least one frame, even a huge one
+        return !mFrames.isEmpty()
+               && (mFrames.size() >= MAX_QUEUED_FRAMES || mQueuedBytes >= MAX_QUEUED_BYTES);
+    }
+
+    QImage processFrame(const QImage& frame)
+    {
+        qreal zoom;
+        {
+            QMutexLocker locker(&mMutex);
+            zoom = mZoom;
+        }
+        QImage image = frame.convertToFormat(frame.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+        if (zoom > 0 && zoom < 1) {
+            QSize size = image.size() * zoom;
+            if (!size.isEmpty()) {
+                image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+        }
+
+        QMutexLocker locker(&mTransformMutex);
+        if (mTransform) {
+            quint8* bytes = image.bits();
+            cmsDoTransform(mTransform, bytes, bytes, image.width() * image.height());
+        }
+        return image;
+    }
+};
+
+struct AnimationPlayerPrivate
+{
+    AnimationPlayer* q;
+    QByteArray mRawData;
+    AnimationFrameDecoder* mDecoder;
+    QTimer* mTimer;
+    bool mRunning;
+    // True if showNextFrame() was called while the ring buffer was empty
+    bool mWaitingForFrame;
+    // Zoom of each view showing the animation
+    QHash<QObject*, qreal> mZooms;
+    Cms::Profile::Ptr mImageProfile;
+    Cms::Profile::Ptr mDisplayProfile;
+
+    qreal decodingZoom() const
+    {
+        if (mZooms.isEmpty()) {
+            return 1;
+        }
+        qreal zoom = 0;
+        Q_FOREACH(qreal viewZoom, mZooms) {
+            zoom = qMax(zoom, viewZoom);
+        }
+        return zoom;
+    }
+
+    cmsHTRANSFORM createTransform() const
+    {
+        if (!mImageProfile || !mDisplayProfile) {
+            return 0;
+        }
+        // cmsFLAGS_NOCACHE: the transform is used from the worker thread
+        return cmsCreateTransform(mImageProfile->handle(), TYPE_BGRA_8,
+                                  mDisplayProfile->handle(), TYPE_BGRA_8,
+                                  INTENT_PERCEPTUAL, cmsFLAGS_BLACKPOINTCOMPENSATION | cmsFLAGS_NOCACHE);
+    }
+
+    /**
+     * Replaces mDecoder with a decoder which starts from the first frame
+     */
+    void resetDecoder()
+    {
+        if (mDecoder) {
+            QObject::disconnect(mDecoder, 0, q, 0);
+            delete mDecoder;
+        }
+        mDecoder = new AnimationFrameDecoder(q, mRawData);
+        mDecoder->setZoom(decodingZoom());
+        mDecoder->setTransform(createTransform());
+        QObject::connect(mDecoder, SIGNAL(finished()), q, SLOT(slotDecoderFinished()));
+    }
+};
+
+AnimationPlayer::AnimationPlayer(const QByteArray& rawData, QObject* parent)
+: QObject(parent)
+, d(new AnimationPlayerPrivate)
+{
+    d->q = this;
+    d->mRawData = rawData;
+    d->mDecoder = 0;
+    d->mRunning = false;
+    d->mWaitingForFrame = false;
+    d->resetDecoder();
+
+    d->mTimer = new QTimer(this);
+    d->mTimer->setSingleShot(true);
+    connect(d->mTimer, &QTimer::timeout, this, &AnimationPlayer::showNextFrame);
+}
+
+AnimationPlayer::~AnimationPlayer()
+{
+    delete d->mDecoder;
+    delete d;
+}
+
+void AnimationPlayer::setZoom(QObject* view, qreal zoom)
+{
+    if (!d->mZooms.contains(view)) {
+        connect(view, SIGNAL(destroyed(QObject*)), SLOT(removeView(QObject*)));
+    }
+    d->mZooms.insert(view, zoom);
+    d->mDecoder->setZoom(d->decodingZoom());
+}
+
+void AnimationPlayer::removeView(QObject* view)
+{
+    if (d->mZooms.remove(view) == 0) {
+        return;
+    }
+    disconnect(view, SIGNAL(destroyed(QObject*)), this, SLOT(removeView(QObject*)));
+    d->mDecoder->setZoom(d->decodingZoom());
+}
+
+void AnimationPlayer::setColorProfiles(Cms::Profile::Ptr imageProfile, Cms::Profile::Ptr displayProfile)
+{
+    d->mImageProfile = imageProfile;
+    d->mDisplayProfile = displayProfile;
+    d->mDecoder->setTransform(d->createTransform());
+}
+
+void AnimationPlayer::start()
+{
+    if (d->mRunning) {
+        return;
+    }
+    d->mRunning = true;
+    // Like QMovie, always start from the first frame, even if the animation
+    // was stopped in the middle or has already been played
+    if (d->mDecoder->isRunning() || d->mDecoder->isFinished()) {
+        d->resetDecoder();
+    }
+    d->mDecoder->start();
+    showNextFrame();
+}
+
+void AnimationPlayer::stop()
+{
+    d->mRunning = false;
+    d->mWaitingForFrame = false;
+    d->mTimer->stop();
+}
+
+bool AnimationPlayer::isRunning() const
+{
+    return d->mRunning;
+}
+
+void AnimationPlayer::showNextFrame()
+{
+    // Check if the decoder is done before looking at the ring buffer, so that
+    // a frame queued in between is not missed
+    const bool decoderFinished = d->mDecoder->isFinished();
+    AnimationFrame frame;
+    if (!d->mDecoder->takeFrame(&frame)) {
+        if (decoderFinished) {
+            LOG("Reached end of animation");
+            d->mRunning = false;
+            d->mWaitingForFrame = false;
+        } else {
+            LOG("Decoder is late");
+            d->mWaitingForFrame = true;
+        }
+        return;
+    }
+    d->mWaitingForFrame = false;
+    emit frameReady(frame.mImage);
+    d->mTimer->start(frame.mDelay);
+}
+
+void AnimationPlayer::slotFrameDecoded()
+{
+    if (d->mRunning && d->mWaitingForFrame) {
+        showNextFrame();
+    }
+}
+
+void AnimationPlayer::slotDecoderFinished()
+{
+    // The decoder may have stopped without queuing any frame
+    slotFrameDecoded();
+}
+
+} // namespace
@@ -0,0 +1,103 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef ANIMATIONPLAYER_H
+#define ANIMATIONPLAYER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+
+// KDE
+
+// Local
+#include <lib/cms/cmsprofile.h>
+
+class QImage;
+
+namespace Gwenview
+{
+
+struct AnimationPlayerPrivate;
+/**
+ * Plays an animated image without going through Document::image().
+ *
+ * Frames are decoded ahead of time in a worker thread and stored in a
+ * bounded ring buffer. Before being queued, each frame is scaled down to the
+ * zoom set with setZoom() and converted with the color transform set with
+ * setColorProfiles(), so that the GUI thread only has to blit it.
+ *
+ * Frames are delivered through the frameReady() signal. Several views can
+ * show the same animation, each at its own zoom: frames are decoded for the
+ * biggest one. Frames which were decoded before a zoom change still have the
+ * previous scale: receivers must stretch the frame they get to the document
+ * size multiplied by their zoom.
+ *
+ * Like QMovie, start() plays the animation from the first frame. Animations
+ * which do not loop forever stop by themselves once their last frame has
+ * been shown.
+ */
+class GWENVIEWLIB_EXPORT AnimationPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    AnimationPlayer(const QByteArray& rawData, QObject* parent = 0);
+    ~AnimationPlayer();
+
+    /**
+     * Sets the zoom at which @a view shows the frames. Frames are never
+     * scaled up: for zoom values bigger than 1, frames are decoded at their
+     * original size.
+     */
+    void setZoom(QObject* view, qreal zoom);
+
+    /**
+     * Convert decoded frames from @a imageProfile to @a displayProfile.
+     * Pass null pointers to disable color conversion.
+     */
+    void setColorProfiles(Cms::Profile::Ptr imageProfile, Cms::Profile::Ptr displayProfile);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+public Q_SLOTS:
+    /**
+     * Forgets the zoom of @a view. Called automatically when @a view is
+     * destroyed.
+     */
+    void removeView(QObject* view);
+
+Q_SIGNALS:
+    void frameReady(const QImage&);
+
+private Q_SLOTS:
+    void showNextFrame();
+    void slotFrameDecoded();
+    void slotDecoderFinished();
+
+private:
+    AnimationPlayerPrivate* const d;
+};
+
+} // namespace
+
+#endif /* ANIMATIONPLAYER_H */
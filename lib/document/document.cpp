@@ -21,7 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "document_p.h"
 
 // Qt
-#include <QApplication>
+#include <QEventLoop>
 #include <QImage>
 #include <QUndoStack>
 #include <QUrl>
@@ -38,7 +38,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "imagemetainfomodel.h"
 #include "loadingdocumentimpl.h"
 #include "loadingjob.h"
+#include "perfcounters.h"
 #include "savejob.h"
+#include "tracer.h"
+#include "undoimagedata.h"
 
 namespace Gwenview
 {
@@ -101,41 +104,118 @@ void DocumentPrivate::scheduleImageDownSampling(int invertedZoom)
         LOG("Current job is already doing it");
         return;
     }
+    if (mDownSamplingJob && mDownSamplingJob->mInvertedZoom == invertedZoom) {
+        LOG("Already running outside of the queue");
+        return;
+    }
 
     // Remove any previously scheduled downsampling job
-    DocumentJobQueue::Iterator it;
-    for (it = mJobQueue.begin(); it != mJobQueue.end(); ++it) {
+    DocumentJobQueue::Iterator it = mJobQueue.begin();
+    while (it != mJobQueue.end()) {
         DownSamplingJob* job = qobject_cast<DownSamplingJob*>(*it);
         if (!job) {
+            ++it;
             continue;
         }
         if (job->mInvertedZoom == invertedZoom) {
             // Already scheduled, nothing to do
             LOG("Already scheduled");
             return;
-        } else {
-            LOG("Removing downsampling job");
-            mJobQueue.erase(it);
-            delete job;
         }
+        LOG("Removing downsampling job");
+        it = mJobQueue.erase(it);
+        PerfCounters::add(PerfCounters::DocumentPendingJobs, -1);
+        delete job;
+    }
+    if (mDownSamplingJob) {
+        LOG("Discarding downsampling job running outside of the queue");
+        mDownSamplingJob->discard();
+        mDownSamplingJob.clear();
+    }
+
+    job = new DownSamplingJob(invertedZoom);
+    if (hasImageModifyingJob()) {
+        // Down sample the image once it has been modified
+        q->enqueueJob(job);
+        return;
     }
-    q->enqueueJob(new DownSamplingJob(invertedZoom));
+    // Nothing is going to modify the image, no need to wait for the other
+    // jobs
+    LOG("Starting downsampling job outside of the queue");
+    job->setDocument(Document::Ptr(q));
+    mDownSamplingJob = job;
+    job->start();
 }
 
-void DocumentPrivate::downSampleImage(int invertedZoom)
+bool DocumentPrivate::hasImageModifyingJob() const
 {
-    mDownSampledImageMap[invertedZoom] = mImage.scaled(mImage.size() / invertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
-    if (mDownSampledImageMap[invertedZoom].size().isEmpty()) {
-        mDownSampledImageMap[invertedZoom] = mImage;
+    if (mCurrentJob && !mCurrentJob.data()->isReadOnly()) {
+        return true;
+    }
+    Q_FOREACH(const DocumentJob* job, mJobQueue) {
+        if (!job->isReadOnly()) {
+            return true;
+        }
     }
-    q->downSampledImageReady();
+    return false;
 }
 
 //- DownSamplingJob ---------------------------------------
+DownSamplingJob::~DownSamplingJob()
+{
+    TaskScheduler::instance()->cancel(mFuture);
+    TaskScheduler::instance()->waitForFinished(mFuture);
+}
+
+bool DownSamplingJob::isReadOnly() const
+{
+    return true;
+}
+
+void DownSamplingJob::discard()
+{
+    TaskScheduler::instance()->cancel(mFuture);
+}
+
+void DownSamplingJob::setTaskPriority(TaskScheduler::Priority priority)
+{
+    TaskScheduler::instance()->setPriority(mFuture, priority);
+}
+
 void DownSamplingJob::doStart()
+{
+    // Keep a reference to the current image: if the document image is
+    // replaced or modified while we work, our copy does not change
+    mSourceImage = document()->d->mImage;
+    connect(&mFutureWatcher, SIGNAL(finished()), SLOT(finish()));
+    mFuture = TaskScheduler::instance()->run(document()->taskPriority(), this, &DownSamplingJob::downSample);
+    mFutureWatcher.setFuture(mFuture);
+}
+
+void DownSamplingJob::downSample()
+{
+    GV_TRACE_SCOPE("downSampleImage");
+    mImage = mSourceImage.scaled(mSourceImage.size() / mInvertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
+    if (mImage.size().isEmpty()) {
+        mImage = mSourceImage;
+    }
+}
+
+void DownSamplingJob::finish()
 {
     DocumentPrivate* d = document()->d;
-    d->downSampleImage(mInvertedZoom);
+    if (d->mDownSamplingJob == this) {
+        d->mDownSamplingJob.clear();
+    }
+    if (mFuture.isCanceled()) {
+        LOG("Downsampling job has been discarded");
+    } else if (mSourceImage.cacheKey() != d->mImage.cacheKey()) {
+        LOG("Image changed while downsampling, dropping the result");
+    } else {
+        d->mDownSampledImageMap[mInvertedZoom] = mImage;
+        d->q->downSampledImageReady();
+    }
+    mSourceImage = QImage();
     setError(NoError);
     emitResult();
 }
@@ -146,7 +226,7 @@ qreal Document::maxDownSampledZoom()
     return 0.5;
 }
 
-Document::Document(const QUrl &url)
+Document::Document(const QUrl &url, TaskScheduler::Priority priority)
 : QObject()
 , d(new DocumentPrivate)
 {
@@ -154,6 +234,7 @@ Document::Document(const QUrl &url)
     d->mImpl = 0;
     d->mUrl = url;
     d->mKeepRawData = false;
+    d->mTaskPriority = priority;
     connect(&d->mUndoStack, SIGNAL(indexChanged(int)), SLOT(slotUndoIndexChanged()));
 
     reload();
@@ -165,6 +246,10 @@ Document::~Document()
     // ourself while we are being destroyed.
     disconnect(&d->mUndoStack, 0, this, 0);
 
+    // Jobs which never finished are not pending anymore
+    const int pendingJobCount = d->mJobQueue.count() + (d->mCurrentJob ? 1 : 0);
+    PerfCounters::add(PerfCounters::DocumentPendingJobs, -pendingJobCount);
+
     delete d->mImpl;
     delete d;
 }
@@ -284,15 +369,44 @@ void Document::setKeepRawData(bool value)
     d->mKeepRawData = value;
 }
 
+TaskScheduler::Priority Document::taskPriority() const
+{
+    return d->mTaskPriority;
+}
+
+void Document::setTaskPriority(TaskScheduler::Priority priority)
+{
+    d->mTaskPriority = priority;
+    // Tasks queued with the previous priority must not wait behind the
+    // ones of lower priority documents
+    if (d->mImpl) {
+        d->mImpl->setTaskPriority(priority);
+    }
+    DownSamplingJob* job = qobject_cast<DownSamplingJob*>(d->mCurrentJob.data());
+    if (job) {
+        job->setTaskPriority(priority);
+    }
+    if (d->mDownSamplingJob) {
+        d->mDownSamplingJob->setTaskPriority(priority);
+    }
+}
+
 void Document::waitUntilLoaded()
 {
     startLoadingFullImage();
+    // Sleep in an event loop instead of spinning, and check the state again
+    // each time a signal which may come with a state change is emitted
+    QEventLoop loop;
+    connect(this, &Document::loaded, &loop, &QEventLoop::quit);
+    connect(this, &Document::loadingFailed, &loop, &QEventLoop::quit);
+    connect(this, &Document::imageRectUpdated, &loop, &QEventLoop::quit);
+    connect(this, &Document::isAnimatedUpdated, &loop, &QEventLoop::quit);
     while (true) {
         LoadingState state = loadingState();
         if (state == Loaded || state == LoadingFailed) {
             return;
         }
-        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
     }
 }
 
@@ -361,11 +475,11 @@ bool Document::hasAlphaChannel() const
     }
 }
 
-int Document::memoryUsage() const
+qint64 Document::memoryUsage() const
 {
-    // FIXME: Take undo stack into account
-    int usage = d->mImage.numBytes();
+    qint64 usage = qint64(d->mImage.bytesPerLine()) * d->mImage.height();
     usage += rawData().length();
+    usage += UndoImageData::memoryUsage(this);
     return usage;
 }
 
@@ -515,11 +629,17 @@ void Document::stopAnimation()
     return d->mImpl->stopAnimation();
 }
 
+AnimationPlayer* Document::animationPlayer() const
+{
+    return d->mImpl->animationPlayer();
+}
+
 void Document::enqueueJob(DocumentJob* job)
 {
     LOG("job=" << job);
     job->setDocument(Ptr(this));
     connect(job, &LoadingJob::finished, this, &Document::slotJobFinished);
+    PerfCounters::add(PerfCounters::DocumentPendingJobs);
     if (d->mCurrentJob) {
         d->mJobQueue.enqueue(job);
     } else {
@@ -534,7 +654,19 @@ void Document::enqueueJob(DocumentJob* job)
 void Document::slotJobFinished(KJob* job)
 {
     LOG("job=" << job);
-    GV_RETURN_IF_FAIL(job == d->mCurrentJob.data());
+    if (job != d->mCurrentJob.data()) {
+        // A queued job has been killed before it could start, for example
+        // by SaveAllHelper. Killed jobs emit finished() even when killed
+        // quietly.
+        if (d->mJobQueue.removeOne(static_cast<DocumentJob*>(job))) {
+            PerfCounters::add(PerfCounters::DocumentPendingJobs, -1);
+            LOG_QUEUE("Removed killed job", d);
+        } else {
+            qWarning() << "Unknown job" << job;
+        }
+        return;
+    }
+    PerfCounters::add(PerfCounters::DocumentPendingJobs, -1);
 
     if (d->mJobQueue.isEmpty()) {
         LOG("All done");
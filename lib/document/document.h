@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include <lib/mimetypeutils.h>
 #include <lib/cms/cmsprofile.h>
+#include <lib/taskscheduler.h>
 
 class QImage;
 class QRect;
@@ -51,6 +52,7 @@ namespace Gwenview
 
 class AbstractDocumentEditor;
 class AbstractDocumentImpl;
+class AnimationPlayer;
 class DocumentJob;
 class DocumentFactory;
 struct DocumentPrivate;
@@ -158,10 +160,23 @@ public:
 
     bool keepRawData() const;
 
+    /**
+     * The priority used to schedule the background work needed to load this
+     * document. Documents loaded ahead of time use TaskScheduler::Preload so
+     * that they do not slow down the document the user is looking at.
+     */
+    TaskScheduler::Priority taskPriority() const;
+
+    /**
+     * Changes the task priority. Tasks which are already queued are moved
+     * to the new priority.
+     */
+    void setTaskPriority(TaskScheduler::Priority);
+
     /**
      * Returns how much bytes the document is using
      */
-    int memoryUsage() const;
+    qint64 memoryUsage() const;
 
     /**
      * Returns the compressed version of the document, if it is still
@@ -198,6 +213,13 @@ public:
      */
     void stopAnimation();
 
+    /**
+     * Returns the player used to animate this document if it is animated.
+     * Animation frames are delivered by the player, they do not change
+     * image(). Returns a NULL pointer for non-animated documents.
+     */
+    AnimationPlayer* animationPlayer() const;
+
     void enqueueJob(DocumentJob*);
 
     /**
@@ -243,7 +265,7 @@ private:
     void setErrorString(const QString&);
     void setCmsProfile(Cms::Profile::Ptr);
 
-    Document(const QUrl&);
+    Document(const QUrl&, TaskScheduler::Priority);
     DocumentPrivate * const d;
 };
 
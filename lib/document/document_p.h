@@ -29,7 +29,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QUrl>
 
 // Qt
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QImage>
+#include <QPointer>
 #include <QQueue>
 #include <QUndoStack>
 #include <QWeakPointer>
@@ -37,6 +40,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 namespace Gwenview
 {
 
+class DownSamplingJob;
+
 typedef QQueue<DocumentJob*> DocumentJobQueue;
 struct DocumentPrivate
 {
@@ -44,8 +49,11 @@ struct DocumentPrivate
     AbstractDocumentImpl* mImpl;
     QUrl mUrl;
     bool mKeepRawData;
+    TaskScheduler::Priority mTaskPriority;
     QWeakPointer<DocumentJob> mCurrentJob;
     DocumentJobQueue mJobQueue;
+    // Down sampling job running outside of mJobQueue, if any
+    QPointer<DownSamplingJob> mDownSamplingJob;
 
     /**
      * @defgroup imagedata should be reset in reload()
@@ -65,10 +73,14 @@ struct DocumentPrivate
 
     void scheduleImageLoading(int invertedZoom);
     void scheduleImageDownSampling(int invertedZoom);
-    void downSampleImage(int invertedZoom);
+    bool hasImageModifyingJob() const;
 };
 
 
+/**
+ * Scales down a copy of the document image in a worker thread. The result is
+ * dropped if the document image has changed in the meantime.
+ */
 class DownSamplingJob : public DocumentJob
 {
     Q_OBJECT
@@ -77,9 +89,35 @@ public:
     : mInvertedZoom(invertedZoom)
     {}
 
-    void doStart() Q_DECL_OVERRIDE;
+    ~DownSamplingJob();
+
+    bool isReadOnly() const Q_DECL_OVERRIDE;
+
+    /**
+     * Makes the job drop its result, without waiting for it to finish
+     */
+    void discard();
+
+    /**
+     * Moves the downsampling task to @a priority if it has not started yet
+     */
+    void setTaskPriority(TaskScheduler::Priority priority);
 
     int mInvertedZoom;
+
+protected:
+    void doStart() Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void finish();
+
+private:
+    void downSample();
+
+    QImage mSourceImage;
+    QImage mImage;
+    QFuture<void> mFuture;
+    QFutureWatcher<void> mFutureWatcher;
 };
 
 
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include <gvdebug.h>
+#include <perfcounters.h>
 
 namespace Gwenview
 {
@@ -114,13 +115,28 @@ struct DocumentFactoryPrivate
             Q_ASSERT(it != map.end());
             delete it.value();
             map.erase(it);
+            PerfCounters::add(PerfCounters::DocumentCacheEvictions);
         }
+        updateMemoryUsage(map);
 
 #ifdef ENABLE_LOG
         logDocumentMap(map);
 #endif
     }
 
+    /**
+     * Publishes the memory used by the documents of @a map. Called whenever
+     * documents are loaded or collected.
+     */
+    void updateMemoryUsage(const DocumentMap& map)
+    {
+        qint64 usage = 0;
+        Q_FOREACH(const DocumentInfo* info, map) {
+            usage += info->mDocument->memoryUsage();
+        }
+        PerfCounters::set(PerfCounters::DocumentCacheKiB, int(usage / 1024));
+    }
+
     void logDocumentMap(const DocumentMap& map)
     {
         LOG("map:");
@@ -160,7 +176,7 @@ Document::Ptr DocumentFactory::getCachedDocument(const QUrl &url) const
     return info ? info->mDocument : Document::Ptr();
 }
 
-Document::Ptr DocumentFactory::load(const QUrl &url)
+Document::Ptr DocumentFactory::load(const QUrl &url, TaskScheduler::Priority priority)
 {
     GV_RETURN_VALUE_IF_FAIL(!url.isEmpty(), Document::Ptr());
     DocumentInfo* info = 0;
@@ -171,6 +187,9 @@ Document::Ptr DocumentFactory::load(const QUrl &url)
         LOG(url.fileName() << "url in mDocumentMap");
         info = it.value();
         info->mLastAccess = QDateTime::currentDateTime();
+        if (priority < info->mDocument->taskPriority()) {
+            info->mDocument->setTaskPriority(priority);
+        }
         return info->mDocument;
     }
 
@@ -178,7 +197,7 @@ Document::Ptr DocumentFactory::load(const QUrl &url)
 
     // Start loading the document
     LOG(url.fileName() << "loading");
-    Document* doc = new Document(url);
+    Document* doc = new Document(url, priority);
     connect(doc, &Document::loaded, this, &DocumentFactory::slotLoaded);
     connect(doc, &Document::saved, this, &DocumentFactory::slotSaved);
     connect(doc, &Document::modified, this, &DocumentFactory::slotModified);
@@ -213,10 +232,12 @@ void DocumentFactory::clearCache()
     qDeleteAll(d->mDocumentMap);
     d->mDocumentMap.clear();
     d->mModifiedDocumentList.clear();
+    d->updateMemoryUsage(d->mDocumentMap);
 }
 
 void DocumentFactory::slotLoaded(const QUrl &url)
 {
+    d->updateMemoryUsage(d->mDocumentMap);
     if (d->mModifiedDocumentList.contains(url)) {
         d->mModifiedDocumentList.removeAll(url);
         emit modifiedDocumentListChanged();
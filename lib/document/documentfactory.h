@@ -52,8 +52,11 @@ public:
      * Loads the document associated with url, or returns an already cached
      * instance of Document::Ptr if there is any.
      * This method updates the last-access timestamp.
+     *
+     * @a priority is used to schedule the loading of a new document. Loading
+     * an already cached document with a higher priority promotes it.
      */
-    Document::Ptr load(const QUrl &url);
+    Document::Ptr load(const QUrl &url, TaskScheduler::Priority priority = TaskScheduler::VisibleDocument);
 
     /**
      * Returns a document if it has already been loaded once with load().
@@ -24,7 +24,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Qt
 #include <QFuture>
 #include <QFutureWatcher>
-#include <QtConcurrentRun>
 #include <QApplication>
 #include <QDebug>
 
@@ -33,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <KLocalizedString>
 
 // Local
+#include <lib/taskscheduler.h>
 
 namespace Gwenview
 {
@@ -72,6 +72,11 @@ void DocumentJob::start()
     QMetaObject::invokeMethod(this, "doStart", Qt::QueuedConnection);
 }
 
+bool DocumentJob::isReadOnly() const
+{
+    return false;
+}
+
 bool DocumentJob::checkDocumentEditor()
 {
     if (!document()->editor()) {
@@ -84,7 +89,7 @@ bool DocumentJob::checkDocumentEditor()
 
 void ThreadedDocumentJob::doStart()
 {
-    QFuture<void> future = QtConcurrent::run(this, &ThreadedDocumentJob::threadedStart);
+    QFuture<void> future = TaskScheduler::instance()->run(document()->taskPriority(), this, &ThreadedDocumentJob::threadedStart);
     QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
     connect(watcher, SIGNAL(finished()), SLOT(emitResult()));
     watcher->setFuture(future);
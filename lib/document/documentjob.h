@@ -43,7 +43,8 @@ struct DocumentJobPrivate;
  *
  * The task behavior must be implemented in run()
  *
- * Tasks are always started from the GUI thread, and are never parallelized.
+ * Tasks are always started from the GUI thread, and are never parallelized,
+ * except for down sampling which may run next to read-only tasks.
  * You can of course use threading inside your task implementation to speed it
  * up.
  */
@@ -61,6 +62,12 @@ public:
 
     virtual void start() Q_DECL_OVERRIDE;
 
+    /**
+     * Returns true if the job does not modify the image of the document.
+     * The document image can be down sampled while such jobs are running.
+     */
+    virtual bool isReadOnly() const;
+
 protected Q_SLOTS:
     /**
      * Implement this method to provide the task behavior.
@@ -93,6 +100,7 @@ private:
     DocumentJobPrivate* const d;
 
     friend class Document;
+    friend struct DocumentPrivate;
 };
 
 /**
@@ -83,6 +83,18 @@ void JpegDocumentLoadedImpl::applyTransformation(Orientation orientation)
     d->mJpegContent->transform(orientation);
 }
 
+QRect JpegDocumentLoadedImpl::applyLosslessCrop(const QRect& rect, bool exact, bool applyExifOrientation)
+{
+    const QRect cropRect = d->mJpegContent->crop(rect, exact, applyExifOrientation);
+    if (cropRect.isNull()) {
+        return QRect();
+    }
+    // Do not go through setImage(): JpegContent already contains the
+    // cropped image
+    DocumentLoadedImpl::setImage(document()->image().copy(cropRect));
+    return cropRect;
+}
+
 QByteArray JpegDocumentLoadedImpl::rawData() const
 {
     return d->mJpegContent->rawData();
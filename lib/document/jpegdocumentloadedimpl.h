@@ -50,6 +50,7 @@ protected:
     // AbstractDocumentEditor
     virtual void setImage(const QImage&) Q_DECL_OVERRIDE;
     virtual void applyTransformation(Orientation orientation) Q_DECL_OVERRIDE;
+    virtual QRect applyLosslessCrop(const QRect& rect, bool exact, bool applyExifOrientation) Q_DECL_OVERRIDE;
     //
 
 private:
@@ -33,7 +33,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QImage>
 #include <QImageReader>
 #include <QPointer>
-#include <QtConcurrent>
 #include <QUrl>
 #include <QDebug>
 
@@ -59,7 +58,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "jpegcontent.h"
 #include "jpegdocumentloadedimpl.h"
 #include "orientation.h"
+#include "perfcounters.h"
+#include "remotefilecache.h"
+#include "remotefilereader.h"
 #include "svgdocumentloadedimpl.h"
+#include "taskscheduler.h"
+#include "tracer.h"
 #include "urlutils.h"
 #include "videodocumentloadedimpl.h"
 #include "gwenviewconfig.h"
@@ -84,6 +88,14 @@ struct LoadingDocumentImplPrivate
 {
     LoadingDocumentImpl* q;
     QPointer<KIO::TransferJob> mTransferJob;
+    QPointer<RemoteFileReader> mHeaderReader;
+    // Data received by mTransferJob. It is only moved to mData once the
+    // transfer is done, because mData may be in use by loadMetaInfo()
+    QByteArray mTransferData;
+    // Modification time and size of the remote file, used as the key of the
+    // RemoteFileCache
+    time_t mRemoteTime;
+    KIO::filesize_t mRemoteSize;
     QFuture<bool> mMetaInfoFuture;
     QFutureWatcher<bool> mMetaInfoFutureWatcher;
     QFuture<void> mImageDataFuture;
@@ -94,6 +106,9 @@ struct LoadingDocumentImplPrivate
     int mImageDataInvertedZoom;
 
     bool mMetaInfoLoaded;
+    // True if mData only contains the beginning of a remote file: enough to
+    // load the meta info, but not the image
+    bool mDataIsPartial;
     bool mAnimated;
     bool mDownSampledImageLoaded;
     QByteArray mFormatHint;
@@ -159,8 +174,7 @@ struct LoadingDocumentImplPrivate
             //
             mFormatHint = q->document()->url().fileName()
                 .section('.', -1).toAscii().toLower();
-            mMetaInfoFuture = QtConcurrent::run(this, &LoadingDocumentImplPrivate::loadMetaInfo);
-            mMetaInfoFutureWatcher.setFuture(mMetaInfoFuture);
+            startMetaInfoLoading();
             break;
 
         case MimeTypeUtils::KIND_SVG_IMAGE:
@@ -176,18 +190,89 @@ struct LoadingDocumentImplPrivate
         }
     }
 
+    /**
+     * Loads the content of a local file, returns false if it cannot be read
+     */
+    bool loadLocalFile(const QString& path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            q->setDocumentErrorString(i18nc("@info", "Could not open file %1", path));
+            emit q->loadingFailed();
+            q->switchToImpl(new EmptyDocumentImpl(q->document()));
+            return false;
+        }
+        mData = file.read(HEADER_SIZE);
+        if (determineKind()) {
+            return true;
+        }
+        mData += file.readAll();
+        startLoading();
+        return true;
+    }
+
+    void startHeaderReading()
+    {
+        // Only read the beginning of the file for now: the whole file is
+        // transferred once the image is needed
+        mHeaderReader = new RemoteFileReader(q->document()->url(), q);
+        QObject::connect(mHeaderReader, SIGNAL(headerRead(QByteArray,bool)),
+                         q, SLOT(slotHeaderRead(QByteArray,bool)));
+        QObject::connect(mHeaderReader, SIGNAL(failed(QString)),
+                         q, SLOT(slotHeaderReadFailed()));
+        mHeaderReader->readHeader(REMOTE_HEADER_SIZE);
+    }
+
+    void startMetaInfoLoading()
+    {
+        LOG("");
+        mMetaInfoFuture = TaskScheduler::instance()->run(q->document()->taskPriority(), this, &LoadingDocumentImplPrivate::loadMetaInfo);
+        mMetaInfoFutureWatcher.setFuture(mMetaInfoFuture);
+    }
+
+    void startTransfer()
+    {
+        LOG("");
+        mTransferData.clear();
+        mTransferJob = KIO::get(q->document()->url(), KIO::NoReload, KIO::HideProgressInfo);
+        QObject::connect(mTransferJob, SIGNAL(data(KIO::Job*,QByteArray)),
+                         q, SLOT(slotDataReceived(KIO::Job*,QByteArray)));
+        QObject::connect(mTransferJob, SIGNAL(result(KJob*)),
+                         q, SLOT(slotTransferFinished(KJob*)));
+        mTransferJob->start();
+    }
+
+    /**
+     * Returns true if the meta info cannot be loaded from the beginning of
+     * the file
+     */
+    bool needsWholeFileForMetaInfo() const
+    {
+        if (q->document()->kind() != MimeTypeUtils::KIND_RASTER_IMAGE) {
+            return true;
+        }
+#ifdef KDCRAW_FOUND
+        const QString extension = q->document()->url().fileName().section('.', -1).toLower();
+        if (KDcrawIface::KDcraw::rawFilesList().contains(extension)) {
+            return true;
+        }
+#endif
+        return false;
+    }
+
     void startImageDataLoading()
     {
         LOG("");
         Q_ASSERT(mMetaInfoLoaded);
         Q_ASSERT(mImageDataInvertedZoom != 0);
         Q_ASSERT(!mImageDataFuture.isRunning());
-        mImageDataFuture = QtConcurrent::run(this, &LoadingDocumentImplPrivate::loadImageData);
+        mImageDataFuture = TaskScheduler::instance()->run(q->document()->taskPriority(), this, &LoadingDocumentImplPrivate::loadImageData);
         mImageDataFutureWatcher.setFuture(mImageDataFuture);
     }
 
     bool loadMetaInfo()
     {
+        GV_TRACE_SCOPE("loadMetaInfo");
         LOG("mFormatHint" << mFormatHint);
         QBuffer buffer;
         buffer.setBuffer(&mData);
@@ -291,6 +376,8 @@ struct LoadingDocumentImplPrivate
 
     void loadImageData()
     {
+        GV_TRACE_SCOPE("loadImageData");
+        GV_LATENCY_SCOPE(DecodeLatency);
         QBuffer buffer;
         buffer.setBuffer(&mData);
         buffer.open(QIODevice::ReadOnly);
@@ -356,6 +443,9 @@ LoadingDocumentImpl::LoadingDocumentImpl(Document* document)
 {
     d->q = this;
     d->mMetaInfoLoaded = false;
+    d->mDataIsPartial = false;
+    d->mRemoteTime = -1;
+    d->mRemoteSize = 0;
     d->mAnimated = false;
     d->mDownSampledImageLoaded = false;
     d->mImageDataInvertedZoom = 0;
@@ -374,8 +464,10 @@ LoadingDocumentImpl::~LoadingDocumentImpl()
     d->mMetaInfoFutureWatcher.disconnect();
     d->mImageDataFutureWatcher.disconnect();
 
-    d->mMetaInfoFutureWatcher.waitForFinished();
-    d->mImageDataFutureWatcher.waitForFinished();
+    TaskScheduler::instance()->cancel(d->mMetaInfoFuture);
+    TaskScheduler::instance()->cancel(d->mImageDataFuture);
+    TaskScheduler::instance()->waitForFinished(d->mMetaInfoFuture);
+    TaskScheduler::instance()->waitForFinished(d->mImageDataFuture);
 
     if (d->mTransferJob) {
         d->mTransferJob->kill();
@@ -383,34 +475,70 @@ LoadingDocumentImpl::~LoadingDocumentImpl()
     delete d;
 }
 
+void LoadingDocumentImpl::setTaskPriority(TaskScheduler::Priority priority)
+{
+    TaskScheduler::instance()->setPriority(d->mMetaInfoFuture, priority);
+    TaskScheduler::instance()->setPriority(d->mImageDataFuture, priority);
+}
+
 void LoadingDocumentImpl::init()
 {
     QUrl url = document()->url();
 
     if (UrlUtils::urlIsFastLocalFile(url)) {
         // Load file content directly
-        QFile file(url.toLocalFile());
-        if (!file.open(QIODevice::ReadOnly)) {
-            setDocumentErrorString(i18nc("@info", "Could not open file %1", url.toLocalFile()));
-            emit loadingFailed();
-            switchToImpl(new EmptyDocumentImpl(document()));
-            return;
-        }
-        d->mData = file.read(HEADER_SIZE);
-        if (d->determineKind()) {
+        d->loadLocalFile(url.toLocalFile());
+    } else {
+        // Stat the file first, we may have a copy of it
+        KIO::StatJob* job = KIO::stat(url, KIO::StatJob::SourceSide, 0, KIO::HideProgressInfo);
+        connect(job, SIGNAL(result(KJob*)), SLOT(slotStatFinished(KJob*)));
+    }
+}
+
+void LoadingDocumentImpl::slotStatFinished(KJob* job)
+{
+    if (!job->error()) {
+        const KIO::UDSEntry entry = static_cast<KIO::StatJob*>(job)->statResult();
+        d->mRemoteTime = entry.numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+        d->mRemoteSize = entry.numberValue(KIO::UDSEntry::UDS_SIZE, 0);
+        const QString path = RemoteFileCache::instance()->acquire(document()->url(), d->mRemoteTime, d->mRemoteSize);
+        if (!path.isEmpty()) {
+            LOG("Loading cached copy" << path);
+            // The copy is read right away, it can be released afterwards
+            d->loadLocalFile(path);
+            RemoteFileCache::instance()->release(path);
             return;
         }
-        d->mData += file.readAll();
-        d->startLoading();
-    } else {
-        // Transfer file via KIO
-        d->mTransferJob = KIO::get(document()->url(), KIO::NoReload, KIO::HideProgressInfo);
-        connect(d->mTransferJob, SIGNAL(data(KIO::Job*,QByteArray)),
-                SLOT(slotDataReceived(KIO::Job*,QByteArray)));
-        connect(d->mTransferJob, SIGNAL(result(KJob*)),
-                SLOT(slotTransferFinished(KJob*)));
-        d->mTransferJob->start();
     }
+    d->startHeaderReading();
+}
+
+void LoadingDocumentImpl::slotHeaderRead(const QByteArray& data, bool complete)
+{
+    LOG("Read" << data.size() << "bytes, complete:" << complete);
+    d->mHeaderReader->deleteLater();
+    d->mData = data;
+    if (complete) {
+        RemoteFileCache::instance()->insert(document()->url(), d->mRemoteTime, d->mRemoteSize, data);
+    }
+    if (d->determineKind()) {
+        return;
+    }
+    if (!complete && d->needsWholeFileForMetaInfo()) {
+        d->startTransfer();
+        return;
+    }
+    d->mDataIsPartial = !complete;
+    d->startLoading();
+}
+
+void LoadingDocumentImpl::slotHeaderReadFailed()
+{
+    // The protocol probably does not support random access
+    LOG("Falling back to a full transfer");
+    d->mHeaderReader->deleteLater();
+    d->mData.clear();
+    d->startTransfer();
 }
 
 void LoadingDocumentImpl::loadImage(int invertedZoom)
@@ -423,9 +551,18 @@ void LoadingDocumentImpl::loadImage(int invertedZoom)
         LOG("Ignoring request: we are loading a full image");
         return;
     }
-    d->mImageDataFutureWatcher.waitForFinished();
+    TaskScheduler::instance()->waitForFinished(d->mImageDataFuture);
     d->mImageDataInvertedZoom = invertedZoom;
 
+    if (d->mDataIsPartial) {
+        // The image is needed now, get the whole file. Loading continues in
+        // slotTransferFinished()
+        if (!d->mTransferJob) {
+            d->startTransfer();
+        }
+        return;
+    }
+
     if (d->mMetaInfoLoaded) {
         // Do not test on mMetaInfoFuture.isRunning() here: it might not have
         // started if we are downloading the image from a remote url
@@ -435,8 +572,10 @@ void LoadingDocumentImpl::loadImage(int invertedZoom)
 
 void LoadingDocumentImpl::slotDataReceived(KIO::Job* job, const QByteArray& chunk)
 {
-    d->mData.append(chunk);
-    if (document()->kind() == MimeTypeUtils::KIND_UNKNOWN && d->mData.length() >= HEADER_SIZE) {
+    d->mTransferData.append(chunk);
+    if (document()->kind() == MimeTypeUtils::KIND_UNKNOWN && d->mTransferData.length() >= HEADER_SIZE) {
+        // Nothing uses mData before the kind is known
+        d->mData = d->mTransferData;
         if (d->determineKind()) {
             job->kill();
             return;
@@ -452,6 +591,18 @@ void LoadingDocumentImpl::slotTransferFinished(KJob* job)
         switchToImpl(new EmptyDocumentImpl(document()));
         return;
     }
+    // Make sure loadMetaInfo() is not using mData anymore
+    TaskScheduler::instance()->waitForFinished(d->mMetaInfoFuture);
+    d->mData = d->mTransferData;
+    d->mTransferData.clear();
+    RemoteFileCache::instance()->insert(document()->url(), d->mRemoteTime, d->mRemoteSize, d->mData);
+    if (d->mDataIsPartial) {
+        // Meta info has been loaded from the beginning of the file, load it
+        // again: JpegContent needs the whole file
+        d->mDataIsPartial = false;
+        d->startMetaInfoLoading();
+        return;
+    }
     d->startLoading();
 }
 
@@ -477,6 +628,15 @@ void LoadingDocumentImpl::slotMetaInfoLoaded()
 {
     LOG("");
     Q_ASSERT(!d->mMetaInfoFuture.isRunning());
+    if (!d->mMetaInfoFuture.result() && d->mDataIsPartial) {
+        // The beginning of the file was not enough, try again with the
+        // whole file
+        LOG("Could not load meta info from partial data");
+        if (!d->mTransferJob) {
+            d->startTransfer();
+        }
+        return;
+    }
     if (!d->mMetaInfoFuture.result()) {
         setDocumentErrorString(
             i18nc("@info", "Loading meta information failed.")
@@ -491,8 +651,15 @@ void LoadingDocumentImpl::slotMetaInfoLoaded()
     setDocumentExiv2Image(d->mExiv2Image);
     setDocumentCmsProfile(d->mCmsProfile);
 
-    d->mMetaInfoLoaded = true;
-    emit metaInfoLoaded();
+    if (!d->mMetaInfoLoaded) {
+        d->mMetaInfoLoaded = true;
+        emit metaInfoLoaded();
+    }
+
+    if (d->mDataIsPartial) {
+        // loadImage() takes care of getting the whole file
+        return;
+    }
 
     // Start image loading if necessary
     // We test if mImageDataFuture is not already running because code connected to
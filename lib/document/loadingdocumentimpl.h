@@ -48,6 +48,7 @@ public:
     virtual void init() Q_DECL_OVERRIDE;
     virtual Document::LoadingState loadingState() const Q_DECL_OVERRIDE;
     virtual bool isEditable() const Q_DECL_OVERRIDE;
+    virtual void setTaskPriority(TaskScheduler::Priority) Q_DECL_OVERRIDE;
 
     void loadImage(int invertedZoom);
 
@@ -56,6 +57,9 @@ private Q_SLOTS:
     void slotImageLoaded();
     void slotDataReceived(KIO::Job*, const QByteArray&);
     void slotTransferFinished(KJob*);
+    void slotStatFinished(KJob*);
+    void slotHeaderRead(const QByteArray&, bool complete);
+    void slotHeaderReadFailed();
 
 private:
     LoadingDocumentImplPrivate* const d;
@@ -22,14 +22,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "savejob.h"
 
 // Qt
+#include <QFileInfo>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QScopedPointer>
-#include <QtConcurrentRun>
 #include <QUrl>
 #include <QApplication>
 #include <QTemporaryFile>
 #include <QSaveFile>
+#include <QDebug>
 
 // KDE
 #include <KIO/CopyJob>
@@ -39,10 +40,84 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include "documentloadedimpl.h"
+#include "taskscheduler.h"
+#include "tracer.h"
 
 namespace Gwenview
 {
 
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Progress is reported at most once per PROGRESS_STEP bytes, big writes are
+// split in chunks of this size so that they report progress too
+static const qint64 PROGRESS_STEP = 256 * 1024;
+
+/**
+ * Forwards writes to the QSaveFile and reports how many bytes have been
+ * written to the job
+ */
+class ProgressDevice : public QIODevice
+{
+public:
+    ProgressDevice(QIODevice* target, QObject* job)
+    : mTarget(target)
+    , mJob(job)
+    , mWritten(0)
+    , mReported(0)
+    {
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+
+    bool seek(qint64 pos) Q_DECL_OVERRIDE
+    {
+        return QIODevice::seek(pos) && mTarget->seek(pos);
+    }
+
+    qint64 size() const Q_DECL_OVERRIDE
+    {
+        return mTarget->size();
+    }
+
+protected:
+    qint64 readData(char*, qint64) Q_DECL_OVERRIDE
+    {
+        return -1;
+    }
+
+    qint64 writeData(const char* data, qint64 size) Q_DECL_OVERRIDE
+    {
+        qint64 written = 0;
+        while (written < size) {
+            qint64 result = mTarget->write(data + written, qMin(size - written, PROGRESS_STEP));
+            if (result < 0) {
+                setErrorString(mTarget->errorString());
+                return written > 0 ? written : -1;
+            }
+            written += result;
+            mWritten += result;
+            if (mWritten - mReported >= PROGRESS_STEP) {
+                mReported = mWritten;
+                QMetaObject::invokeMethod(mJob, "slotBytesWritten", Qt::QueuedConnection,
+                                          Q_ARG(qulonglong, qulonglong(mWritten)));
+            }
+        }
+        return written;
+    }
+
+private:
+    QIODevice* mTarget;
+    QObject* mJob;
+    qint64 mWritten;
+    qint64 mReported;
+};
+
 struct SaveJobPrivate
 {
     DocumentLoadedImpl* mImpl;
@@ -51,7 +126,9 @@ struct SaveJobPrivate
     QByteArray mFormat;
     QScopedPointer<QTemporaryFile> mTemporaryFile;
     QScopedPointer<QSaveFile> mSaveFile;
-    QScopedPointer<QFutureWatcher<void> > mInternalSaveWatcher;
+    QFuture<void> mSaveFuture;
+    QFutureWatcher<void> mSaveFutureWatcher;
+    qulonglong mBytesWritten;
 
     bool mKillReceived;
 };
@@ -63,24 +140,44 @@ SaveJob::SaveJob(DocumentLoadedImpl* impl, const QUrl &url, const QByteArray& fo
     d->mOldUrl = impl->document()->url();
     d->mNewUrl = url;
     d->mFormat = format;
+    d->mBytesWritten = 0;
     d->mKillReceived = false;
     setCapabilities(Killable);
+    connect(&d->mSaveFutureWatcher, SIGNAL(finished()), SLOT(finishSave()));
 }
 
 SaveJob::~SaveJob()
 {
+    d->mSaveFutureWatcher.disconnect();
+    TaskScheduler::instance()->cancel(d->mSaveFuture);
+    TaskScheduler::instance()->waitForFinished(d->mSaveFuture);
     delete d;
 }
 
 void SaveJob::saveInternal()
 {
-    if (!d->mImpl->saveInternal(d->mSaveFile.data(), d->mFormat)) {
+    GV_TRACE_SCOPE("SaveJob::saveInternal");
+    ProgressDevice device(d->mSaveFile.data(), this);
+    if (!d->mImpl->saveInternal(&device, d->mFormat)) {
         d->mSaveFile->cancelWriting();
         setError(UserDefinedError + 2);
         setErrorText(d->mImpl->document()->errorString());
     }
 }
 
+void SaveJob::slotBytesWritten(qulonglong bytes)
+{
+    if (d->mKillReceived || bytes <= d->mBytesWritten) {
+        return;
+    }
+    d->mBytesWritten = bytes;
+    // The expected size is only an estimate
+    if (bytes > totalAmount(KJob::Bytes)) {
+        setTotalAmount(KJob::Bytes, bytes);
+    }
+    setProcessedAmount(KJob::Bytes, bytes);
+}
+
 void SaveJob::doStart()
 {
     if (d->mKillReceived) {
@@ -110,15 +207,22 @@ void SaveJob::doStart()
         return;
     }
 
-    QFuture<void> future = QtConcurrent::run(this, &SaveJob::saveInternal);
-    d->mInternalSaveWatcher.reset(new QFutureWatcher<void>(this));
-    connect(d->mInternalSaveWatcher.data(), SIGNAL(finished()), SLOT(finishSave()));
-    d->mInternalSaveWatcher->setFuture(future);
+    // Use the size of the file being overwritten as an estimate of the size
+    // of the new one
+    const QString oldFileName = d->mOldUrl.isLocalFile() ? d->mOldUrl.toLocalFile() : QString();
+    if (!oldFileName.isEmpty()) {
+        setTotalAmount(KJob::Bytes, QFileInfo(oldFileName).size());
+    }
+
+    // Saving many documents at once must not starve loading and thumbnail
+    // generation: the Save class of the scheduler has its own limit
+    d->mSaveFuture = TaskScheduler::instance()->run(TaskScheduler::Save, this, &SaveJob::saveInternal);
+    d->mSaveFutureWatcher.setFuture(d->mSaveFuture);
 }
 
 void SaveJob::finishSave()
 {
-    d->mInternalSaveWatcher.reset(0);
+    GV_TRACE_SCOPE("SaveJob::finishSave");
     if (d->mKillReceived) {
         return;
     }
@@ -132,9 +236,15 @@ void SaveJob::finishSave()
         setErrorText(xi18nc("@info", "Could not overwrite file, check that you have the necessary rights to write in <filename>%1</filename>.",
                             d->mNewUrl.toString()));
         setError(UserDefinedError + 3);
+        emitResult();
         return;
     }
 
+    const qulonglong size = QFileInfo(d->mSaveFile->fileName()).size();
+    d->mBytesWritten = size;
+    setTotalAmount(KJob::Bytes, size);
+    setProcessedAmount(KJob::Bytes, size);
+
     if (d->mNewUrl.isLocalFile()) {
         emitResult();
     } else {
@@ -162,12 +272,16 @@ QUrl SaveJob::newUrl() const
     return d->mNewUrl;
 }
 
+bool SaveJob::isReadOnly() const
+{
+    return true;
+}
+
 bool SaveJob::doKill()
 {
     d->mKillReceived = true;
-    if (d->mInternalSaveWatcher) {
-        d->mInternalSaveWatcher->waitForFinished();
-    }
+    TaskScheduler::instance()->cancel(d->mSaveFuture);
+    TaskScheduler::instance()->waitForFinished(d->mSaveFuture);
     return true;
 }
 
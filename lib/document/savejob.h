@@ -50,6 +50,8 @@ public:
     QUrl oldUrl() const;
     QUrl newUrl() const;
 
+    bool isReadOnly() const Q_DECL_OVERRIDE;
+
 protected Q_SLOTS:
     virtual void doStart() Q_DECL_OVERRIDE;
     virtual void slotResult(KJob*) Q_DECL_OVERRIDE;
@@ -59,6 +61,7 @@ protected:
 
 private Q_SLOTS:
     void finishSave();
+    void slotBytesWritten(qulonglong);
 
 private:
     SaveJobPrivate* const d;
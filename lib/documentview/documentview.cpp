@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsSceneWheelEvent>
 #include <QPainter>
+#include <QPointer>
 #include <QPropertyAnimation>
 #include <QWeakPointer>
 #include <QDebug>
@@ -54,6 +55,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/graphicswidgetfloater.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/imagescaler.h>
 #include <lib/mimetypeutils.h>
 #include <lib/signalblocker.h>
 
@@ -95,6 +97,7 @@ struct DocumentViewPrivate
     bool mCurrent;
     bool mCompareMode;
     bool mEraseBorders;
+    QPointer<ImageScalerBatch> mScalerBatch;
 
     void setCurrentAdapter(AbstractDocumentViewAdapter* adapter)
     {
@@ -151,6 +154,7 @@ struct DocumentViewPrivate
         if (adapter->rasterImageView()) {
             QObject::connect(adapter->rasterImageView(), SIGNAL(currentToolChanged(AbstractRasterImageViewTool*)),
                              q, SIGNAL(currentToolChanged(AbstractRasterImageViewTool*)));
+            adapter->rasterImageView()->setScalerBatch(mScalerBatch.data());
         }
     }
 
@@ -631,6 +635,14 @@ void DocumentView::setCompareMode(bool compare)
     }
 }
 
+void DocumentView::setScalerBatch(ImageScalerBatch* batch)
+{
+    d->mScalerBatch = batch;
+    if (d->mAdapter->rasterImageView()) {
+        d->mAdapter->rasterImageView()->setScalerBatch(batch);
+    }
+}
+
 void DocumentView::setCurrent(bool value)
 {
     d->mCurrent = value;
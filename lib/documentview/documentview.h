@@ -38,6 +38,7 @@ namespace Gwenview
 {
 
 class AbstractRasterImageViewTool;
+class ImageScalerBatch;
 class RasterImageView;
 
 struct DocumentViewPrivate;
@@ -107,6 +108,12 @@ public:
 
     void setCompareMode(bool);
 
+    /**
+     * Sets the batch used to scale raster images, so that several views can
+     * be repainted together. Pass 0 to scale on demand.
+     */
+    void setScalerBatch(ImageScalerBatch*);
+
     bool zoomToFit() const;
 
     QPoint position() const;
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "rasterimageview.h"
 
 // Local
+#include <lib/document/animationplayer.h>
 #include <lib/documentview/abstractrasterimageviewtool.h>
 #include <lib/imagescaler.h>
 #include <lib/cms/cmsprofile.h>
@@ -67,6 +68,11 @@ struct RasterImageViewPrivate
 
     QWeakPointer<AbstractRasterImageViewTool> mTool;
 
+    // Set while the document is animated: frames come straight from the
+    // player and are not scaled by mScaler
+    QWeakPointer<AnimationPlayer> mAnimationPlayer;
+    QImage mAnimationFrame;
+
     bool mApplyDisplayTransform; // Defaults to true. Can be set to false if there is no need or no way to apply color profile
     cmsHTRANSFORM mDisplayTransform;
 
@@ -132,9 +138,57 @@ struct RasterImageViewPrivate
 
     void startAnimationIfNecessary()
     {
-        if (q->document() && q->isVisible()) {
-            q->document()->startAnimation();
+        if (!q->document() || !q->isVisible()) {
+            return;
+        }
+        AnimationPlayer* player = q->document()->animationPlayer();
+        if (player && player != mAnimationPlayer.data()) {
+            mAnimationPlayer = player;
+            QObject::connect(player, SIGNAL(frameReady(QImage)),
+                             q, SLOT(updateFromAnimationFrame(QImage)));
+            player->setZoom(q, q->zoom());
+            if (mApplyDisplayTransform) {
+                Cms::Profile::Ptr profile = q->document()->cmsProfile();
+                if (!profile) {
+                    profile = Cms::Profile::getSRgbProfile();
+                }
+                player->setColorProfiles(profile, Cms::Profile::getMonitorProfile());
+            }
+        }
+        q->document()->startAnimation();
+    }
+
+    void resetAnimationPlayer()
+    {
+        if (mAnimationPlayer) {
+            QObject::disconnect(mAnimationPlayer.data(), 0, q, 0);
+            mAnimationPlayer.data()->removeView(q);
+        }
+        mAnimationPlayer.clear();
+        mAnimationFrame = QImage();
+    }
+
+    void drawAnimationFrame(const QRegion& region)
+    {
+        resizeBuffer();
+        if (mCurrentBuffer.isNull()) {
+            return;
+        }
+        mBufferIsEmpty = false;
+        QPainter painter(&mCurrentBuffer);
+        painter.setClipRegion(region);
+        // The frame may have been scaled for a previous zoom, stretch it
+        // to the current one
+        const QRectF targetRect(-q->scrollPos(), q->documentSize() * q->zoom());
+        if (q->document()->hasAlphaChannel()) {
+            drawAlphaBackground(&painter, mCurrentBuffer.rect(), q->scrollPos().toPoint());
+        } else {
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+        }
+        if (targetRect.size() != QSizeF(mAnimationFrame.size())) {
+            painter.setRenderHint(QPainter::SmoothPixmapTransform, q->zoom() < 2.);
         }
+        painter.drawImage(targetRect, mAnimationFrame);
     }
 
     QRectF mapViewportToZoomedImage(const QRectF& viewportRect) const
@@ -238,8 +292,14 @@ void RasterImageView::setAlphaBackgroundColor(const QColor& color)
     }
 }
 
+void RasterImageView::setScalerBatch(ImageScalerBatch* batch)
+{
+    d->mScaler->setBatch(batch);
+}
+
 void RasterImageView::loadFromDocument()
 {
+    d->resetAnimationPlayer();
     Document::Ptr doc = document();
     if (!doc) {
         return;
@@ -311,6 +371,18 @@ void RasterImageView::slotDocumentIsAnimatedUpdated()
     d->startAnimationIfNecessary();
 }
 
+void RasterImageView::updateFromAnimationFrame(const QImage& frame)
+{
+    d->mAnimationFrame = frame;
+    d->drawAnimationFrame(d->mCurrentBuffer.rect());
+    update();
+
+    if (!d->mEmittedCompleted) {
+        d->mEmittedCompleted = true;
+        completed();
+    }
+}
+
 void RasterImageView::updateFromScaler(int zoomedImageLeft, int zoomedImageTop, const QImage& image)
 {
     if (d->mApplyDisplayTransform) {
@@ -349,6 +421,9 @@ void RasterImageView::updateFromScaler(int zoomedImageLeft, int zoomedImageTop,
 
 void RasterImageView::onZoomChanged()
 {
+    if (d->mAnimationPlayer) {
+        d->mAnimationPlayer.data()->setZoom(this, zoom());
+    }
     // If we zoom more than twice, then assume the user wants to see the real
     // pixels, for example to fine tune a crop operation
     if (zoom() < 2.) {
@@ -438,6 +513,11 @@ void RasterImageView::resizeEvent(QGraphicsSceneResizeEvent* event)
 void RasterImageView::updateBuffer(const QRegion& region)
 {
     d->mUpdateTimer->stop();
+    if (!d->mAnimationFrame.isNull()) {
+        d->drawAnimationFrame(region.isEmpty() ? QRegion(d->mCurrentBuffer.rect()) : region.translated(-scrollPos().toPoint()));
+        update();
+        return;
+    }
     d->mScaler->setZoom(zoom());
     if (region.isEmpty()) {
         d->setScalerRegionToVisibleRect();
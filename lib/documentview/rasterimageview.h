@@ -34,6 +34,7 @@ namespace Gwenview
 {
 
 class AbstractRasterImageViewTool;
+class ImageScalerBatch;
 
 struct RasterImageViewPrivate;
 class GWENVIEWLIB_EXPORT RasterImageView : public AbstractImageView
@@ -56,6 +57,11 @@ public:
     void setAlphaBackgroundMode(AlphaBackgroundMode mode);
     void setAlphaBackgroundColor(const QColor& color);
 
+    /**
+     * Makes the view scale the image as part of @a batch, see ImageScalerBatch
+     */
+    void setScalerBatch(ImageScalerBatch* batch);
+
 Q_SIGNALS:
     void currentToolChanged(AbstractRasterImageViewTool*);
 
@@ -78,6 +84,7 @@ private Q_SLOTS:
     void slotDocumentIsAnimatedUpdated();
     void finishSetDocument();
     void updateFromScaler(int, int, const QImage&);
+    void updateFromAnimationFrame(const QImage&);
     void updateImageRect(const QRect& imageRect);
     void updateBuffer(const QRegion& region = QRegion());
 
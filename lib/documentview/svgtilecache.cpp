@@ -0,0 +1,408 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "svgtilecache.h"
+
+// System
+#include <math.h>
+
+// Qt
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QThread>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+#include <lib/taskscheduler.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+static const int TILE_SIZE = 256;
+
+// Number of zooms, besides the current one, whose tiles are kept to be
+// painted while the tiles of the current zoom are rendered
+static const int MAX_FALLBACK_ZOOMS = 4;
+
+struct SvgTileKey
+{
+    qint64 mZoomKey;
+    int mColumn;
+    int mRow;
+
+    bool operator==(const SvgTileKey& other) const
+    {
+        return mZoomKey == other.mZoomKey && mColumn == other.mColumn && mRow == other.mRow;
+    }
+};
+
+inline uint qHash(const SvgTileKey& key)
+{
+    return uint(key.mZoomKey) ^ (uint(key.mColumn) << 16) ^ uint(key.mRow);
+}
+
+// Zooms are compared with a limited precision, so that tiles can be found
+// again after rounding errors
+static qint64 zoomKey(qreal zoom)
+{
+    return qRound64(zoom * 10000);
+}
+
+struct SvgTileCachePrivate;
+
+/**
+ * Renders one tile in a worker thread
+ */
+class SvgTileTask
+{
+public:
+    SvgTileTask(SvgTileCachePrivate* cache, const SvgTileKey& key, qreal zoom, const QSize& size, const QRect& rect)
+    : mCache(cache)
+    , mKey(key)
+    , mZoom(zoom)
+    , mSize(size)
+    , mRect(rect)
+    , mWatcher(new QFutureWatcher<QImage>)
+    {}
+
+    QImage run();
+
+    SvgTileCachePrivate* mCache;
+    SvgTileKey mKey;
+    qreal mZoom;
+    // Size of the document at zoom 1
+    QSize mSize;
+    // Rect of the tile, in zoomed image coordinates
+    QRect mRect;
+    QFutureWatcher<QImage>* mWatcher;
+};
+
+struct SvgTileCachePrivate
+{
+    SvgTileCache* q;
+    QSize mSize;
+    qreal mZoom;
+    QCache<SvgTileKey, QImage> mTiles;
+    // Zooms which may still have tiles in mTiles, most recent first
+    QList<qreal> mFallbackZooms;
+    QHash<SvgTileKey, SvgTileTask*> mPendingTasks;
+
+    // Protects the members below, which are used by the worker threads
+    QMutex mRendererMutex;
+    QByteArray mData;
+    QList<QSvgRenderer*> mIdleRenderers;
+
+    QRect zoomedImageRect(qreal zoom) const
+    {
+        return QRect(QPoint(0, 0), (QSizeF(mSize) * zoom).toSize());
+    }
+
+    QRect tileRect(int column, int row, qreal zoom) const
+    {
+        return QRect(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE) & zoomedImageRect(zoom);
+    }
+
+    /**
+     * Returns a renderer which is not used by any other thread
+     */
+    QSvgRenderer* takeRenderer()
+    {
+        QByteArray data;
+        {
+            QMutexLocker locker(&mRendererMutex);
+            if (!mIdleRenderers.isEmpty()) {
+                return mIdleRenderers.takeLast();
+            }
+            data = mData;
+        }
+        // QSvgRenderer is not thread-safe: each thread rendering at the same
+        // time gets its own copy of the document
+        LOG("Creating renderer");
+        QSvgRenderer* renderer = new QSvgRenderer;
+        // Do not start an animation timer in the worker thread
+        renderer->setFramesPerSecond(0);
+        renderer->load(data);
+        renderer->moveToThread(q->thread());
+        return renderer;
+    }
+
+    void releaseRenderer(QSvgRenderer* renderer)
+    {
+        QMutexLocker locker(&mRendererMutex);
+        mIdleRenderers << renderer;
+    }
+
+    void requestTile(const SvgTileKey& key, const QRect& rect)
+    {
+        if (mPendingTasks.contains(key)) {
+            return;
+        }
+        SvgTileTask* task = new SvgTileTask(this, key, mZoom, mSize, rect);
+        mPendingTasks.insert(key, task);
+        QObject::connect(task->mWatcher, SIGNAL(finished()), q, SLOT(slotTileFinished()));
+        task->mWatcher->setFuture(TaskScheduler::instance()->run(TaskScheduler::VisibleDocument, task, &SvgTileTask::run));
+    }
+
+    /**
+     * Cancels pending tasks. If @a zoom is not null, tasks for this zoom are
+     * kept.
+     */
+    void cancelPendingTasks(qint64 zoom)
+    {
+        Q_FOREACH(SvgTileTask* task, mPendingTasks) {
+            if (task->mKey.mZoomKey != zoom) {
+                TaskScheduler::instance()->cancel(task->mWatcher->future());
+            }
+        }
+    }
+
+    /**
+     * Cancels all pending tasks and waits for the running ones to finish
+     */
+    void stopPendingTasks()
+    {
+        cancelPendingTasks(0);
+        Q_FOREACH(SvgTileTask* task, mPendingTasks) {
+            TaskScheduler::instance()->waitForFinished(task->mWatcher->future());
+            delete task->mWatcher;
+            delete task;
+        }
+        mPendingTasks.clear();
+    }
+
+    void deleteIdleRenderers()
+    {
+        QMutexLocker locker(&mRendererMutex);
+        qDeleteAll(mIdleRenderers);
+        mIdleRenderers.clear();
+    }
+
+    void removeTiles(qint64 zoom)
+    {
+        Q_FOREACH(const SvgTileKey& key, mTiles.keys()) {
+            if (key.mZoomKey == zoom) {
+                mTiles.remove(key);
+            }
+        }
+    }
+
+    /**
+     * Paints the tiles of the zoom closest to mZoom which cover @a rect, a
+     * rect of the current zoom, at @a pos
+     */
+    void paintFallback(QPainter* painter, const QPointF& pos, const QRect& rect)
+    {
+        QList<qreal> zooms = mFallbackZooms;
+        // Closest zoom first
+        for (int idx = 1; idx < zooms.size(); ++idx) {
+            for (int idx2 = idx; idx2 > 0 && zoomDistance(zooms[idx2]) < zoomDistance(zooms[idx2 - 1]); --idx2) {
+                zooms.swap(idx2, idx2 - 1);
+            }
+        }
+
+        Q_FOREACH(qreal zoom, zooms) {
+            const qreal ratio = zoom / mZoom;
+            const QRect zoomRect = QRectF(rect.x() * ratio, rect.y() * ratio, rect.width() * ratio, rect.height() * ratio).toAlignedRect()
+                                   & zoomedImageRect(zoom);
+            if (zoomRect.isEmpty()) {
+                continue;
+            }
+            const qint64 key = zoomKey(zoom);
+            QList<QPair<QPoint, QImage> > tiles;
+            for (int row = zoomRect.top() / TILE_SIZE; row <= zoomRect.bottom() / TILE_SIZE; ++row) {
+                for (int column = zoomRect.left() / TILE_SIZE; column <= zoomRect.right() / TILE_SIZE; ++column) {
+                    const SvgTileKey tileKey = { key, column, row };
+                    const QImage* image = mTiles.object(tileKey);
+                    if (image) {
+                        tiles << qMakePair(QPoint(column * TILE_SIZE, row * TILE_SIZE), *image);
+                    }
+                }
+            }
+            if (tiles.isEmpty()) {
+                continue;
+            }
+
+            painter->save();
+            painter->setClipRect(QRectF(pos, QSizeF(rect.size())), Qt::IntersectClip);
+            painter->setRenderHint(QPainter::SmoothPixmapTransform);
+            // Switch to the coordinates of the fallback zoom
+            painter->translate(pos);
+            painter->scale(1 / ratio, 1 / ratio);
+            painter->translate(-QPointF(rect.topLeft()) * ratio);
+            for (int idx = 0; idx < tiles.size(); ++idx) {
+                painter->drawImage(tiles[idx].first, tiles[idx].second);
+            }
+            painter->restore();
+            return;
+        }
+    }
+
+    qreal zoomDistance(qreal zoom) const
+    {
+        return qAbs(log(zoom / mZoom));
+    }
+};
+
+QImage SvgTileTask::run()
+{
+    QImage image(mRect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QSvgRenderer* renderer = mCache->takeRenderer();
+    {
+        QPainter painter(&image);
+        painter.translate(-mRect.topLeft());
+        renderer->render(&painter, QRectF(QPointF(0, 0), QSizeF(mSize) * mZoom));
+    }
+    mCache->releaseRenderer(renderer);
+    return image;
+}
+
+SvgTileCache::SvgTileCache(QObject* parent)
+: QObject(parent)
+, d(new SvgTileCachePrivate)
+{
+    d->q = this;
+    d->mZoom = 0;
+    // Costs are in kilobytes
+    d->mTiles.setMaxCost(qMax(1, envInt("GV_SVG_TILE_CACHE_SIZE", 64)) * 1024);
+}
+
+SvgTileCache::~SvgTileCache()
+{
+    d->stopPendingTasks();
+    d->deleteIdleRenderers();
+    delete d;
+}
+
+void SvgTileCache::setData(const QByteArray& data, const QSize& size)
+{
+    d->stopPendingTasks();
+    d->deleteIdleRenderers();
+    d->mTiles.clear();
+    d->mFallbackZooms.clear();
+    {
+        QMutexLocker locker(&d->mRendererMutex);
+        d->mData = data;
+    }
+    d->mSize = size;
+}
+
+void SvgTileCache::setZoom(qreal zoom)
+{
+    if (zoomKey(zoom) == zoomKey(d->mZoom)) {
+        return;
+    }
+    if (d->mZoom > 0) {
+        d->mFallbackZooms.prepend(d->mZoom);
+    }
+    d->mZoom = zoom;
+
+    // If we come back to a previous zoom, it is not a fallback anymore
+    const qint64 key = zoomKey(zoom);
+    for (int idx = d->mFallbackZooms.size() - 1; idx >= 0; --idx) {
+        if (zoomKey(d->mFallbackZooms.at(idx)) == key) {
+            d->mFallbackZooms.removeAt(idx);
+        }
+    }
+    while (d->mFallbackZooms.size() > MAX_FALLBACK_ZOOMS) {
+        d->removeTiles(zoomKey(d->mFallbackZooms.takeLast()));
+    }
+    d->cancelPendingTasks(key);
+}
+
+void SvgTileCache::paint(QPainter* painter, const QPointF& pos, const QRect& rect)
+{
+    if (d->mSize.isEmpty() || d->mZoom <= 0) {
+        return;
+    }
+    const QRect visibleRect = rect & d->zoomedImageRect(d->mZoom);
+    if (visibleRect.isEmpty()) {
+        return;
+    }
+    const qint64 key = zoomKey(d->mZoom);
+    for (int row = visibleRect.top() / TILE_SIZE; row <= visibleRect.bottom() / TILE_SIZE; ++row) {
+        for (int column = visibleRect.left() / TILE_SIZE; column <= visibleRect.right() / TILE_SIZE; ++column) {
+            const SvgTileKey tileKey = { key, column, row };
+            const QRect tileRect = d->tileRect(column, row, d->mZoom);
+            const QPointF tilePos = pos + (tileRect.topLeft() - rect.topLeft());
+            const QImage* image = d->mTiles.object(tileKey);
+            if (image) {
+                painter->drawImage(tilePos, *image);
+            } else {
+                d->requestTile(tileKey, tileRect);
+                d->paintFallback(painter, tilePos, tileRect);
+            }
+        }
+    }
+}
+
+void SvgTileCache::slotTileFinished()
+{
+    QFutureWatcher<QImage>* watcher = static_cast<QFutureWatcher<QImage>*>(sender());
+    SvgTileTask* task = 0;
+    Q_FOREACH(SvgTileTask* pendingTask, d->mPendingTasks) {
+        if (pendingTask->mWatcher == watcher) {
+            task = pendingTask;
+            break;
+        }
+    }
+    GV_RETURN_IF_FAIL(task);
+    d->mPendingTasks.remove(task->mKey);
+
+    const QFuture<QImage> future = watcher->future();
+    if (future.isResultReadyAt(0)) {
+        // Tiles of a zoom we do not keep anymore are dropped
+        const qint64 key = task->mKey.mZoomKey;
+        bool wanted = key == zoomKey(d->mZoom);
+        Q_FOREACH(qreal zoom, d->mFallbackZooms) {
+            wanted = wanted || key == zoomKey(zoom);
+        }
+        if (wanted) {
+            const QImage image = future.result();
+            d->mTiles.insert(task->mKey, new QImage(image), qMax(1, image.byteCount() / 1024));
+            if (key == zoomKey(d->mZoom)) {
+                emit tileRendered(task->mRect);
+            }
+        }
+    }
+    watcher->deleteLater();
+    delete task;
+}
+
+} // namespace
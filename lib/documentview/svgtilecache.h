@@ -0,0 +1,94 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SVGTILECACHE_H
+#define SVGTILECACHE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+
+// KDE
+
+// Local
+
+class QByteArray;
+class QPainter;
+class QPointF;
+class QRect;
+class QSize;
+
+namespace Gwenview
+{
+
+struct SvgTileCachePrivate;
+/**
+ * Renders an SVG document as raster tiles in worker threads, and keeps them
+ * in a bounded cache, so that repainting the view does not render the
+ * vector content again.
+ *
+ * Tiles are only rendered for the current zoom. While they are not ready,
+ * paint() draws the scaled tiles of the closest zoom which is still cached.
+ * The size of the cache can be changed with the GV_SVG_TILE_CACHE_SIZE
+ * environment variable (in megabytes).
+ */
+class GWENVIEWLIB_EXPORT SvgTileCache : public QObject
+{
+    Q_OBJECT
+public:
+    SvgTileCache(QObject* parent = 0);
+    ~SvgTileCache();
+
+    /**
+     * Sets the SVG document to render. @a size is the size of the document
+     * at zoom 1.
+     */
+    void setData(const QByteArray& data, const QSize& size);
+
+    /**
+     * Sets the zoom of the tiles painted by paint(). Tiles which are still
+     * waiting to be rendered for other zooms are dropped.
+     */
+    void setZoom(qreal zoom);
+
+    /**
+     * Paints the @a rect part of the zoomed image, with its top-left corner at
+     * @a pos. Missing tiles are scheduled for rendering.
+     */
+    void paint(QPainter* painter, const QPointF& pos, const QRect& rect);
+
+Q_SIGNALS:
+    /**
+     * Emitted when a tile of the current zoom has been rendered. @a rect is
+     * in zoomed image coordinates.
+     */
+    void tileRendered(const QRect& rect);
+
+private Q_SLOTS:
+    void slotTileFinished();
+
+private:
+    SvgTileCachePrivate* const d;
+};
+
+} // namespace
+
+#endif /* SVGTILECACHE_H */
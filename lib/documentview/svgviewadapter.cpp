@@ -23,9 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QCursor>
-#include <QGraphicsSvgItem>
 #include <QGraphicsTextItem>
 #include <QGraphicsWidget>
+#include <QPainter>
 #include <QSvgRenderer>
 #include <QDebug>
 
@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include "document/documentfactory.h"
 #include <qgraphicssceneevent.h>
+#include <lib/documentview/svgtilecache.h>
 #include <lib/gvdebug.h>
 
 namespace Gwenview
@@ -42,8 +43,9 @@ namespace Gwenview
 /// SvgImageView ////
 SvgImageView::SvgImageView(QGraphicsItem* parent)
 : AbstractImageView(parent)
-, mSvgItem(new QGraphicsSvgItem(this))
+, mTileCache(new SvgTileCache(this))
 {
+    connect(mTileCache, &SvgTileCache::tileRendered, this, &SvgImageView::slotTileRendered);
 }
 
 void SvgImageView::loadFromDocument()
@@ -63,11 +65,12 @@ void SvgImageView::finishLoadFromDocument()
 {
     QSvgRenderer* renderer = document()->svgRenderer();
     GV_RETURN_IF_FAIL(renderer);
-    mSvgItem->setSharedRenderer(renderer);
+    mTileCache->setData(document()->rawData(), renderer->defaultSize());
     if (zoomToFit()) {
         setZoom(computeZoomToFit(), QPointF(-1, -1), ForceUpdate);
     } else {
-        mSvgItem->setScale(zoom());
+        mTileCache->setZoom(zoom());
+        update();
     }
     applyPendingScrollPos();
     completed();
@@ -75,23 +78,34 @@ void SvgImageView::finishLoadFromDocument()
 
 void SvgImageView::onZoomChanged()
 {
-    mSvgItem->setScale(zoom());
-    adjustItemPos();
+    mTileCache->setZoom(zoom());
+    update();
 }
 
 void SvgImageView::onImageOffsetChanged()
 {
-    adjustItemPos();
+    update();
 }
 
 void SvgImageView::onScrollPosChanged(const QPointF& /* oldPos */)
 {
-    adjustItemPos();
+    update();
 }
 
-void SvgImageView::adjustItemPos()
+void SvgImageView::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/)
 {
-    mSvgItem->setPos(imageOffset() - scrollPos());
+    // The part of the zoomed image which is visible, and where it goes
+    const QPointF topLeft = imageOffset();
+    const QRect rect = QRectF(scrollPos(), size() - QSizeF(topLeft.x(), topLeft.y())).toAlignedRect();
+    painter->save();
+    painter->setClipRect(QRectF(QPointF(0, 0), size()), Qt::IntersectClip);
+    mTileCache->paint(painter, topLeft + rect.topLeft() - scrollPos(), rect);
+    painter->restore();
+}
+
+void SvgImageView::slotTileRendered(const QRect& rect)
+{
+    update(QRectF(imageOffset() + rect.topLeft() - scrollPos(), QSizeF(rect.size())));
 }
 
 //// SvgViewAdapter ////
@@ -32,17 +32,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/documentview/abstractimageview.h>
 #include <lib/documentview/abstractdocumentviewadapter.h>
 
-class QGraphicsSvgItem;
-
 namespace Gwenview
 {
 
+class SvgTileCache;
+
 class SvgImageView : public AbstractImageView
 {
     Q_OBJECT
 public:
     SvgImageView(QGraphicsItem* parent = 0);
 
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) Q_DECL_OVERRIDE;
+
 protected:
     void loadFromDocument() Q_DECL_OVERRIDE;
     void onZoomChanged() Q_DECL_OVERRIDE;
@@ -51,10 +53,10 @@ protected:
 
 private Q_SLOTS:
     void finishLoadFromDocument();
+    void slotTileRendered(const QRect& rect);
 
 private:
-    QGraphicsSvgItem* mSvgItem;
-    void adjustItemPos();
+    SvgTileCache* mTileCache;
 };
 
 struct SvgViewAdapterPrivate;
@@ -24,10 +24,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Qt
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QDebug>
+#include <QMultiMap>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
 #include <QUrl>
 #include <QMimeDatabase>
-#include <QTemporaryFile>
 
 // KDE
 #include <KConfig>
@@ -44,52 +49,160 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 namespace Gwenview
 {
 
-struct HistoryItem : public QStandardItem
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Name of the store file, inside the storage dir
+static const char STORE_FILE_NAME[] = "history";
+
+// Size of the blocks read when looking for the most recent records
+static const qint64 READ_BLOCK_SIZE = 16 * 1024;
+
+// The store is rewritten with only the live records when it is
+// COMPACTION_RATIO times bigger than them, and bigger than MIN_COMPACTION_SIZE
+static const qint64 COMPACTION_RATIO = 4;
+static const qint64 MIN_COMPACTION_SIZE = 16 * 1024;
+
+/**
+ * A line of the store. A url is visited with:
+ *
+ * A<tab>date time in ISO format<tab>encoded url
+ *
+ * and removed from the history with:
+ *
+ * R<tab>encoded url
+ *
+ * The most recent record of a url is the last one.
+ */
+struct HistoryRecord
 {
-    void save() const
+    bool mRemoved;
+    QUrl mUrl;
+    QDateTime mDateTime;
+
+    static QByteArray added(const QUrl& url, const QDateTime& dateTime)
     {
-        KConfig config(mConfigPath, KConfig::SimpleConfig);
-        KConfigGroup group(&config, "general");
-        group.writeEntry("url", mUrl.toString());
-        group.writeEntry("dateTime", mDateTime.toString(Qt::ISODate));
-        config.sync();
+        return "A\t" + dateTime.toString(Qt::ISODate).toLatin1() + '\t' + url.toEncoded() + '\n';
     }
 
-    static HistoryItem* create(const QUrl &url, const QDateTime& dateTime, const QString& storageDir)
+    static QByteArray removed(const QUrl& url)
     {
-        if (!QDir().mkpath(storageDir)) {
-            qCritical() << "Could not create history dir" << storageDir;
-            return 0;
+        return "R\t" + url.toEncoded() + '\n';
+    }
+
+    bool parse(const QByteArray& line)
+    {
+        const QList<QByteArray> tokens = line.split('\t');
+        if (tokens.count() == 3 && tokens.at(0) == "A") {
+            mRemoved = false;
+            mDateTime = QDateTime::fromString(QString::fromLatin1(tokens.at(1)), Qt::ISODate);
+            mUrl = QUrl::fromEncoded(tokens.at(2));
+            return mDateTime.isValid() && mUrl.isValid();
         }
-        QTemporaryFile file(storageDir + QStringLiteral("/gvhistoryXXXXXXrc"));
-        file.setAutoRemove(false);
-        if (!file.open()) {
-            qCritical() << "Could not create history file";
-            return 0;
+        if (tokens.count() == 2 && tokens.at(0) == "R") {
+            mRemoved = true;
+            mUrl = QUrl::fromEncoded(tokens.at(1));
+            return mUrl.isValid();
         }
-
-        HistoryItem* item = new HistoryItem(url, dateTime, file.fileName());
-        item->save();
-        return item;
+        return false;
     }
+};
+
+/**
+ * Returns the lines of a file from the last one to the first one, so that
+ * only the end of a long store has to be read
+ */
+class ReverseLineReader
+{
+public:
+    ReverseLineReader(QFile* file)
+    : mFile(file)
+    , mPos(file->size())
+    {}
 
-    static HistoryItem* load(const QString& fileName)
+    bool readLine(QByteArray* line)
     {
-        KConfig config(fileName, KConfig::SimpleConfig);
-        KConfigGroup group(&config, "general");
+        while (true) {
+            if (mBuffer.endsWith('\n')) {
+                mBuffer.chop(1);
+            }
+            const int idx = mBuffer.lastIndexOf('\n');
+            if (idx >= 0) {
+                *line = mBuffer.mid(idx + 1);
+                mBuffer.truncate(idx);
+                return true;
+            }
+            if (mPos == 0) {
+                if (mBuffer.isEmpty()) {
+                    return false;
+                }
+                *line = mBuffer;
+                mBuffer.clear();
+                return true;
+            }
+            const qint64 size = qMin(mPos, READ_BLOCK_SIZE);
+            mPos -= size;
+            mFile->seek(mPos);
+            mBuffer.prepend(mFile->read(size));
+        }
+    }
 
-        QUrl url(group.readEntry("url"));
-        if (!url.isValid()) {
-            qCritical() << "Invalid url" << url;
-            return 0;
+private:
+    QFile* mFile;
+    qint64 mPos;
+    QByteArray mBuffer;
+};
+
+/**
+ * Appends records to the store, or replaces its content when compacting.
+ * Jobs run in a single thread, in the order they were queued.
+ */
+class HistoryWriteJob : public QRunnable
+{
+public:
+    HistoryWriteJob(const QString& path, const QByteArray& data, bool replace)
+    : mPath(path)
+    , mData(data)
+    , mReplace(replace)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        const QString dirPath = QFileInfo(mPath).absolutePath();
+        if (!QDir().mkpath(dirPath)) {
+            qCritical() << "Could not create history dir" << dirPath;
+            return;
         }
-        QDateTime dateTime = QDateTime::fromString(group.readEntry("dateTime"), Qt::ISODate);
-        if (!dateTime.isValid()) {
-            qCritical() << "Invalid dateTime" << dateTime;
-            return 0;
+        if (mReplace) {
+            QSaveFile file(mPath);
+            if (!file.open(QIODevice::WriteOnly) || file.write(mData) != mData.size() || !file.commit()) {
+                qCritical() << "Could not compact history file" << mPath;
+            }
+        } else {
+            QFile file(mPath);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(mData) != mData.size()) {
+                qCritical() << "Could not write history file" << mPath;
+            }
         }
+    }
 
-        return new HistoryItem(url, dateTime, fileName);
+private:
+    QString mPath;
+    QByteArray mData;
+    bool mReplace;
+};
+
+struct HistoryItem : public QStandardItem
+{
+    static HistoryItem* create(const QUrl &url, const QDateTime& dateTime)
+    {
+        return new HistoryItem(url, dateTime);
     }
 
     QUrl url() const
@@ -104,26 +217,16 @@ struct HistoryItem : public QStandardItem
 
     void setDateTime(const QDateTime& dateTime)
     {
-        if (mDateTime != dateTime) {
-            mDateTime = dateTime;
-            save();
-        }
-    }
-
-    void unlink()
-    {
-        QFile::remove(mConfigPath);
+        mDateTime = dateTime;
     }
 
 private:
     QUrl mUrl;
     QDateTime mDateTime;
-    QString mConfigPath;
 
-    HistoryItem(const QUrl &url, const QDateTime& dateTime, const QString& configPath)
+    HistoryItem(const QUrl &url, const QDateTime& dateTime)
         : mUrl(url)
-        , mDateTime(dateTime)
-        , mConfigPath(configPath) {
+        , mDateTime(dateTime) {
         setText(mUrl.toDisplayString());
 
         QMimeDatabase db;
@@ -152,43 +255,135 @@ struct HistoryModelPrivate
 
     QMap<QUrl, HistoryItem*> mHistoryItemForUrl;
 
-    void load()
+    QThreadPool mWriterPool;
+    // Size of the store once the queued writes are done
+    qint64 mStoreSize;
+
+    QString storePath() const
+    {
+        return QDir(mStorageDir).filePath(QLatin1String(STORE_FILE_NAME));
+    }
+
+    void write(const QByteArray& data, bool replace)
+    {
+        mStoreSize = replace ? data.size() : mStoreSize + data.size();
+        mWriterPool.start(new HistoryWriteJob(storePath(), data, replace));
+    }
+
+    QByteArray liveRecords() const
+    {
+        // Oldest first, so that the most recent items are read first
+        QByteArray data;
+        for (int row = q->rowCount() - 1; row >= 0; --row) {
+            const HistoryItem* item = static_cast<HistoryItem*>(q->item(row, 0));
+            data += HistoryRecord::added(item->url(), item->dateTime());
+        }
+        return data;
+    }
+
+    void compactIfNeeded()
+    {
+        if (mStoreSize < MIN_COMPACTION_SIZE) {
+            return;
+        }
+        const QByteArray data = liveRecords();
+        if (mStoreSize < COMPACTION_RATIO * data.size()) {
+            return;
+        }
+        LOG("Compacting history store from" << mStoreSize << "to" << data.size() << "bytes");
+        write(data, true);
+    }
+
+    /**
+     * Older versions stored each url in its own KConfig file. Move them to
+     * the store.
+     */
+    void importLegacyFiles()
     {
         QDir dir(mStorageDir);
-        if (!dir.exists()) {
+        const QStringList names = dir.entryList(QStringList() << QStringLiteral("gvhistory*rc"), QDir::Files);
+        if (names.isEmpty()) {
             return;
         }
-        Q_FOREACH(const QString & name, dir.entryList(QStringList() << "*rc")) {
-            HistoryItem* item = HistoryItem::load(dir.filePath(name));
-            if (!item) {
+        QMap<QUrl, QDateTime> dateTimeForUrl;
+        Q_FOREACH(const QString & name, names) {
+            KConfig config(dir.filePath(name), KConfig::SimpleConfig);
+            KConfigGroup group(&config, "general");
+            const QUrl url(group.readEntry("url"));
+            const QDateTime dateTime = QDateTime::fromString(group.readEntry("dateTime"), Qt::ISODate);
+            if (!url.isValid() || !dateTime.isValid()) {
                 continue;
             }
-
-            QUrl itemUrl = item->url();
-            if (UrlUtils::urlIsFastLocalFile(itemUrl)) {
-                if (!QFile::exists(itemUrl.path())) {
-                    qDebug() << "Removing" << itemUrl.path() << "from recent folders. It does not exist anymore";
-                    item->unlink();
-                    delete item;
-                    continue;
-                }
+            QMap<QUrl, QDateTime>::ConstIterator it = dateTimeForUrl.constFind(url);
+            if (it == dateTimeForUrl.constEnd() || it.value() < dateTime) {
+                dateTimeForUrl.insert(url, dateTime);
             }
+        }
+
+        QMultiMap<QDateTime, QUrl> urlsByDateTime;
+        QMap<QUrl, QDateTime>::ConstIterator it = dateTimeForUrl.constBegin(), end = dateTimeForUrl.constEnd();
+        for (; it != end; ++it) {
+            urlsByDateTime.insert(it.value(), it.key());
+        }
+        QByteArray data;
+        QMultiMap<QDateTime, QUrl>::ConstIterator urlIt = urlsByDateTime.constBegin(), urlEnd = urlsByDateTime.constEnd();
+        for (; urlIt != urlEnd; ++urlIt) {
+            data += HistoryRecord::added(urlIt.value(), urlIt.key());
+        }
+
+        QSaveFile file(storePath());
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qCritical() << "Could not import history files into" << storePath();
+            return;
+        }
+        LOG("Imported" << names.count() << "history files");
+        Q_FOREACH(const QString & name, names) {
+            QFile::remove(dir.filePath(name));
+        }
+    }
 
-            HistoryItem* existingItem = mHistoryItemForUrl.value(item->url());
-            if (existingItem) {
-                // We already know this url(!) update existing item dateTime
-                // and get rid of duplicate
-                if (existingItem->dateTime() < item->dateTime()) {
-                    existingItem->setDateTime(item->dateTime());
+    void load()
+    {
+        QFile file(storePath());
+        if (!file.exists()) {
+            importLegacyFiles();
+        }
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        mStoreSize = file.size();
+
+        // Only create items for the most recent records
+        ReverseLineReader reader(&file);
+        QSet<QUrl> knownUrls;
+        QByteArray line;
+        while (q->rowCount() < mMaxCount && reader.readLine(&line)) {
+            HistoryRecord record;
+            if (!record.parse(line)) {
+                continue;
+            }
+            if (knownUrls.contains(record.mUrl)) {
+                // Outdated record
+                continue;
+            }
+            knownUrls.insert(record.mUrl);
+            if (record.mRemoved) {
+                continue;
+            }
+            if (UrlUtils::urlIsFastLocalFile(record.mUrl)) {
+                if (!QFile::exists(record.mUrl.path())) {
+                    // Not written back, the next compaction drops it
+                    qDebug() << "Removing" << record.mUrl.path() << "from recent folders. It does not exist anymore";
+                    continue;
                 }
-                item->unlink();
-                delete item;
-            } else {
-                mHistoryItemForUrl.insert(item->url(), item);
-                q->appendRow(item);
             }
+            HistoryItem* item = HistoryItem::create(record.mUrl, record.mDateTime);
+            mHistoryItemForUrl.insert(record.mUrl, item);
+            q->appendRow(item);
         }
+        file.close();
         q->sort(0);
+        compactIfNeeded();
     }
 
     void garbageCollect()
@@ -196,7 +391,7 @@ struct HistoryModelPrivate
         while (q->rowCount() > mMaxCount) {
             HistoryItem* item = static_cast<HistoryItem*>(q->takeRow(q->rowCount() - 1).at(0));
             mHistoryItemForUrl.remove(item->url());
-            item->unlink();
+            write(HistoryRecord::removed(item->url()), false);
             delete item;
         }
     }
@@ -209,32 +404,40 @@ HistoryModel::HistoryModel(QObject* parent, const QString& storageDir, int maxCo
     d->q = this;
     d->mStorageDir = storageDir;
     d->mMaxCount = maxCount;
+    d->mStoreSize = 0;
+    d->mWriterPool.setMaxThreadCount(1);
     d->load();
 }
 
 HistoryModel::~HistoryModel()
 {
+    d->mWriterPool.waitForDone();
     delete d;
 }
 
 void HistoryModel::addUrl(const QUrl &url, const QDateTime& _dateTime)
 {
     QDateTime dateTime = _dateTime.isValid() ? _dateTime : QDateTime::currentDateTime();
+    // Must be written before garbageCollect() removes the item
+    d->write(HistoryRecord::added(url, dateTime), false);
     HistoryItem* historyItem = d->mHistoryItemForUrl.value(url);
     if (historyItem) {
         historyItem->setDateTime(dateTime);
         sort(0);
     } else {
-        historyItem = HistoryItem::create(url, dateTime, d->mStorageDir);
-        if (!historyItem) {
-            qCritical() << "Could not save history for url" << url;
-            return;
-        }
+        historyItem = HistoryItem::create(url, dateTime);
         d->mHistoryItemForUrl.insert(url, historyItem);
         appendRow(historyItem);
         sort(0);
         d->garbageCollect();
     }
+    d->compactIfNeeded();
+}
+
+QModelIndex HistoryModel::indexForUrl(const QUrl &url) const
+{
+    const HistoryItem* item = d->mHistoryItemForUrl.value(url);
+    return item ? item->index() : QModelIndex();
 }
 
 bool HistoryModel::removeRows(int start, int count, const QModelIndex& parent)
@@ -244,9 +447,11 @@ bool HistoryModel::removeRows(int start, int count, const QModelIndex& parent)
         HistoryItem* historyItem = static_cast<HistoryItem*>(item(row, 0));
         Q_ASSERT(historyItem);
         d->mHistoryItemForUrl.remove(historyItem->url());
-        historyItem->unlink();
+        d->write(HistoryRecord::removed(historyItem->url()), false);
     }
-    return QStandardItemModel::removeRows(start, count, parent);
+    const bool ok = QStandardItemModel::removeRows(start, count, parent);
+    d->compactIfNeeded();
+    return ok;
 }
 
 } // namespace
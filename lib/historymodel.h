@@ -39,7 +39,12 @@ struct HistoryModelPrivate;
 /**
  * A model which maintains a list of urls in the dir specified by the
  * storageDir parameter of its ctor.
- * Each url is stored in a separate KConfig file to avoid concurrency issues.
+ *
+ * Changes are appended to a single store file in a worker thread, the store
+ * is rewritten with only the live urls once it has grown enough. At startup
+ * the store is read from its end, until maxCount urls have been found.
+ * History files of older versions, one KConfig file per url, are imported
+ * the first time.
  */
 class GWENVIEWLIB_EXPORT HistoryModel : public QStandardItemModel
 {
@@ -50,6 +55,12 @@ public:
 
     void addUrl(const QUrl&, const QDateTime& dateTime = QDateTime());
 
+    /**
+     * Returns the index of the item for @a url, or an invalid index if there
+     * is no such item.
+     */
+    QModelIndex indexForUrl(const QUrl&) const;
+
     virtual bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) Q_DECL_OVERRIDE;
 
 private:
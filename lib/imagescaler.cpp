@@ -20,7 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "imagescaler.h"
 
 // Qt
+#include <QFutureWatcher>
 #include <QImage>
+#include <QPointer>
 #include <QRegion>
 #include <QDebug>
 
@@ -29,6 +31,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include <lib/document/document.h>
 #include <lib/paintutils.h>
+#include <lib/perfcounters.h>
+#include <lib/taskscheduler.h>
+#include <lib/tracer.h>
 
 #undef ENABLE_LOG
 #undef LOG
@@ -45,12 +50,121 @@ namespace Gwenview
 // Amount of pixels to keep so that smooth scale is correct
 static const int SMOOTH_MARGIN = 3;
 
+/**
+ * Scales the part of @a image covered by @a rect, which is in zoomed image
+ * coordinates. Returns a null image if there is nothing to scale, otherwise
+ * @a pos is set to the position of the returned image.
+ *
+ * Only works on its arguments so that it can run in the thread pool.
+ */
+static QImage scaleRect(const QImage& image, qreal zoom, const QRect& rect, Qt::TransformationMode transformationMode, QPoint* pos)
+{
+    GV_LATENCY_SCOPE(ScaleLatency);
+    const qreal REAL_DELTA = 0.001;
+    if (qAbs(zoom - 1.0) < REAL_DELTA) {
+        *pos = rect.topLeft();
+        return image.copy(rect);
+    }
+
+    // If rect contains "half" pixels, make sure sourceRect includes them
+    QRectF sourceRectF(
+        rect.left() / zoom,
+        rect.top() / zoom,
+        rect.width() / zoom,
+        rect.height() / zoom);
+
+    sourceRectF = sourceRectF.intersected(image.rect());
+    QRect sourceRect = PaintUtils::containingRect(sourceRectF);
+    if (sourceRect.isEmpty()) {
+        return QImage();
+    }
+
+    // Compute smooth margin
+    bool needsSmoothMargins = transformationMode == Qt::SmoothTransformation;
+
+    int sourceLeftMargin, sourceRightMargin, sourceTopMargin, sourceBottomMargin;
+    int destLeftMargin, destRightMargin, destTopMargin, destBottomMargin;
+    if (needsSmoothMargins) {
+        sourceLeftMargin = qMin(sourceRect.left(), SMOOTH_MARGIN);
+        sourceTopMargin = qMin(sourceRect.top(), SMOOTH_MARGIN);
+        sourceRightMargin = qMin(image.rect().right() - sourceRect.right(), SMOOTH_MARGIN);
+        sourceBottomMargin = qMin(image.rect().bottom() - sourceRect.bottom(), SMOOTH_MARGIN);
+        sourceRect.adjust(
+            -sourceLeftMargin,
+            -sourceTopMargin,
+            sourceRightMargin,
+            sourceBottomMargin);
+        destLeftMargin = int(sourceLeftMargin * zoom);
+        destTopMargin = int(sourceTopMargin * zoom);
+        destRightMargin = int(sourceRightMargin * zoom);
+        destBottomMargin = int(sourceBottomMargin * zoom);
+    } else {
+        sourceLeftMargin = sourceRightMargin = sourceTopMargin = sourceBottomMargin = 0;
+        destLeftMargin = destRightMargin = destTopMargin = destBottomMargin = 0;
+    }
+
+    // destRect is almost like rect, but it contains only "full" pixels
+    QRectF destRectF = QRectF(
+                           sourceRect.left() * zoom,
+                           sourceRect.top() * zoom,
+                           sourceRect.width() * zoom,
+                           sourceRect.height() * zoom
+                       );
+    QRect destRect = PaintUtils::containingRect(destRectF);
+
+    QImage tmp;
+    tmp = image.copy(sourceRect);
+    tmp = tmp.scaled(
+              destRect.width(),
+              destRect.height(),
+              Qt::IgnoreAspectRatio, // Do not use KeepAspectRatio, it can lead to skipped rows or columns
+              transformationMode);
+
+    if (needsSmoothMargins) {
+        tmp = tmp.copy(
+                  destLeftMargin, destTopMargin,
+                  destRect.width() - (destLeftMargin + destRightMargin),
+                  destRect.height() - (destTopMargin + destBottomMargin)
+              );
+    }
+
+    *pos = QPoint(destRect.left() + destLeftMargin, destRect.top() + destTopMargin);
+    return tmp;
+}
+
 struct ImageScalerPrivate
 {
     Qt::TransformationMode mTransformationMode;
     Document::Ptr mDocument;
     qreal mZoom;
     QRegion mRegion;
+    QPointer<ImageScalerBatch> mBatch;
+    // Incremented each time the document or the zoom changes. Batched rects
+    // requested for an older generation are dropped.
+    int mGeneration;
+    // Batched rects which have been requested but not delivered yet, and the
+    // source image and mode they are scaled with. They are still valid when
+    // the region changes, so they are not requested again.
+    QRegion mPendingRegion;
+    qint64 mPendingImageKey;
+    Qt::TransformationMode mPendingTransformationMode;
+
+    /**
+     * Returns the image to scale for the current zoom, and the zoom to apply
+     * to it
+     */
+    QImage sourceImage(qreal* zoom) const
+    {
+        if (mZoom < Document::maxDownSampledZoom()) {
+            QImage image = mDocument->downSampledImageForZoom(mZoom);
+            Q_ASSERT(!image.isNull());
+            qreal zoom1 = qreal(image.width()) / mDocument->width();
+            *zoom = mZoom / zoom1;
+            return image;
+        }
+        *zoom = mZoom;
+        return mDocument->image();
+    }
 };
 
 ImageScaler::ImageScaler(QObject* parent)
@@ -59,6 +173,9 @@ ImageScaler::ImageScaler(QObject* parent)
 {
     d->mTransformationMode = Qt::FastTransformation;
     d->mZoom = 0;
+    d->mGeneration = 0;
+    d->mPendingImageKey = 0;
+    d->mPendingTransformationMode = Qt::FastTransformation;
 }
 
 ImageScaler::~ImageScaler()
@@ -72,6 +189,8 @@ void ImageScaler::setDocument(Document::Ptr document)
         disconnect(d->mDocument.data(), 0, this, 0);
     }
     d->mDocument = document;
+    ++d->mGeneration;
+    d->mPendingRegion = QRegion();
     // Used when scaler asked for a down-sampled image
     connect(d->mDocument.data(), SIGNAL(downSampledImageReady()),
             SLOT(doScale()));
@@ -82,7 +201,12 @@ void ImageScaler::setDocument(Document::Ptr document)
 
 void ImageScaler::setZoom(qreal zoom)
 {
+    if (zoom == d->mZoom) {
+        return;
+    }
     d->mZoom = zoom;
+    ++d->mGeneration;
+    d->mPendingRegion = QRegion();
 }
 
 void ImageScaler::setTransformationMode(Qt::TransformationMode mode)
@@ -103,8 +227,14 @@ void ImageScaler::setDestinationRegion(const QRegion& region)
     }
 }
 
+void ImageScaler::setBatch(ImageScalerBatch* batch)
+{
+    d->mBatch = batch;
+}
+
 void ImageScaler::doScale()
 {
+    GV_TRACE_SCOPE("ImageScaler::doScale");
     if (d->mZoom < Document::maxDownSampledZoom()) {
         if (!d->mDocument->prepareDownSampledImageForZoom(d->mZoom)) {
             LOG("Asked for a down sampled image");
@@ -116,97 +246,223 @@ void ImageScaler::doScale()
         return;
     }
 
+    qreal zoom;
+    const QImage image = d->sourceImage(&zoom);
+    if (d->mBatch) {
+        // Rects scaled from another image or with another mode must be
+        // requested again, they are delivered before the new ones
+        if (image.cacheKey() != d->mPendingImageKey || d->mTransformationMode != d->mPendingTransformationMode) {
+            d->mPendingRegion = QRegion();
+            d->mPendingImageKey = image.cacheKey();
+            d->mPendingTransformationMode = d->mTransformationMode;
+        }
+        const QRegion region = d->mRegion - d->mPendingRegion;
+        d->mPendingRegion |= region;
+        Q_FOREACH(const QRect & rect, region.rects()) {
+            d->mBatch->addRect(this, image, zoom, rect, d->mTransformationMode);
+        }
+        return;
+    }
+
     LOG("Starting");
     Q_FOREACH(const QRect & rect, d->mRegion.rects()) {
         LOG(rect);
-        scaleRect(rect);
+        QPoint pos;
+        const QImage tmp = scaleRect(image, zoom, rect, d->mTransformationMode, &pos);
+        if (!tmp.isNull()) {
+            scaledRect(pos.x(), pos.y(), tmp);
+        }
     }
     LOG("Done");
 }
 
-void ImageScaler::scaleRect(const QRect& rect)
+void ImageScaler::deliverBatchedRect(int generation, const QRect& rect, const QPoint& pos, const QImage& image)
 {
-    const qreal REAL_DELTA = 0.001;
-    if (qAbs(d->mZoom - 1.0) < REAL_DELTA) {
-        QImage tmp = d->mDocument->image().copy(rect);
-        scaledRect(rect.left(), rect.top(), tmp);
+    // The document or the zoom may have changed while the batch was running,
+    // the view would draw an outdated rect
+    if (generation != d->mGeneration) {
+        LOG("Dropping outdated rect");
         return;
     }
+    d->mPendingRegion -= rect;
+    if (!image.isNull()) {
+        scaledRect(pos.x(), pos.y(), image);
+    }
+}
 
-    QImage image;
-    qreal zoom;
-    if (d->mZoom < Document::maxDownSampledZoom()) {
-        image = d->mDocument->downSampledImageForZoom(d->mZoom);
-        Q_ASSERT(!image.isNull());
-        qreal zoom1 = qreal(image.width()) / d->mDocument->width();
-        zoom = d->mZoom / zoom1;
-    } else {
-        image = d->mDocument->image();
-        zoom = d->mZoom;
+//------------------------------------------------------------------------
+//
+// ImageScalerBatch
+//
+//------------------------------------------------------------------------
+/**
+ * Scales one rect of one scaler. run() is called in the thread pool, the
+ * other members are only used in the GUI thread.
+ */
+struct ImageScalerJob
+{
+    QPointer<ImageScaler> mScaler;
+    // The generation of the scaler when the rect was requested
+    int mScalerGeneration;
+
+    QImage mImage;
+    qreal mZoom;
+    QRect mRect;
+    Qt::TransformationMode mTransformationMode;
+
+    QImage mResult;
+    QPoint mPos;
+    QFuture<void> mFuture;
+
+    void run()
+    {
+        GV_TRACE_SCOPE("ImageScaler::scaleRect");
+        mResult = scaleRect(mImage, mZoom, mRect, mTransformationMode, &mPos);
+        // Release the source as soon as possible, it may be the last
+        // reference to an outdated down sampled image
+        mImage = QImage();
     }
-    // If rect contains "half" pixels, make sure sourceRect includes them
-    QRectF sourceRectF(
-        rect.left() / zoom,
-        rect.top() / zoom,
-        rect.width() / zoom,
-        rect.height() / zoom);
+};
 
-    sourceRectF = sourceRectF.intersected(image.rect());
-    QRect sourceRect = PaintUtils::containingRect(sourceRectF);
-    if (sourceRect.isEmpty()) {
-        return;
+struct ImageScalerBatchPrivate
+{
+    ImageScalerBatch* q;
+    // Jobs waiting for the next batch
+    QList<ImageScalerJob*> mPendingJobs;
+    // Jobs of the batch being scaled
+    QList<ImageScalerJob*> mRunningJobs;
+    int mRemainingJobCount;
+    bool mFlushScheduled;
+
+    void scheduleFlush()
+    {
+        if (mFlushScheduled) {
+            return;
+        }
+        mFlushScheduled = true;
+        QMetaObject::invokeMethod(q, "flush", Qt::QueuedConnection);
     }
 
-    // Compute smooth margin
-    bool needsSmoothMargins = d->mTransformationMode == Qt::SmoothTransformation;
+    static bool isOutdated(const ImageScalerJob* job)
+    {
+        return !job->mScaler || job->mScalerGeneration != job->mScaler.data()->d->mGeneration;
+    }
 
-    int sourceLeftMargin, sourceRightMargin, sourceTopMargin, sourceBottomMargin;
-    int destLeftMargin, destRightMargin, destTopMargin, destBottomMargin;
-    if (needsSmoothMargins) {
-        sourceLeftMargin = qMin(sourceRect.left(), SMOOTH_MARGIN);
-        sourceTopMargin = qMin(sourceRect.top(), SMOOTH_MARGIN);
-        sourceRightMargin = qMin(image.rect().right() - sourceRect.right(), SMOOTH_MARGIN);
-        sourceBottomMargin = qMin(image.rect().bottom() - sourceRect.bottom(), SMOOTH_MARGIN);
-        sourceRect.adjust(
-            -sourceLeftMargin,
-            -sourceTopMargin,
-            sourceRightMargin,
-            sourceBottomMargin);
-        destLeftMargin = int(sourceLeftMargin * zoom);
-        destTopMargin = int(sourceTopMargin * zoom);
-        destRightMargin = int(sourceRightMargin * zoom);
-        destBottomMargin = int(sourceBottomMargin * zoom);
-    } else {
-        sourceLeftMargin = sourceRightMargin = sourceTopMargin = sourceBottomMargin = 0;
-        destLeftMargin = destRightMargin = destTopMargin = destBottomMargin = 0;
+    /**
+     * Drops pending jobs whose scaler is gone or has changed since they were
+     * requested: they would be dropped when delivered anyway
+     */
+    void dropOutdatedJobs()
+    {
+        QList<ImageScalerJob*>::Iterator it = mPendingJobs.begin();
+        while (it != mPendingJobs.end()) {
+            ImageScalerJob* job = *it;
+            if (isOutdated(job)) {
+                delete job;
+                it = mPendingJobs.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
+};
 
-    // destRect is almost like rect, but it contains only "full" pixels
-    QRectF destRectF = QRectF(
-                           sourceRect.left() * zoom,
-                           sourceRect.top() * zoom,
-                           sourceRect.width() * zoom,
-                           sourceRect.height() * zoom
-                       );
-    QRect destRect = PaintUtils::containingRect(destRectF);
+ImageScalerBatch::ImageScalerBatch(QObject* parent)
+: QObject(parent)
+, d(new ImageScalerBatchPrivate)
+{
+    d->q = this;
+    d->mRemainingJobCount = 0;
+    d->mFlushScheduled = false;
+}
 
-    QImage tmp;
-    tmp = image.copy(sourceRect);
-    tmp = tmp.scaled(
-              destRect.width(),
-              destRect.height(),
-              Qt::IgnoreAspectRatio, // Do not use KeepAspectRatio, it can lead to skipped rows or columns
-              d->mTransformationMode);
+ImageScalerBatch::~ImageScalerBatch()
+{
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    Q_FOREACH(ImageScalerJob* job, d->mRunningJobs) {
+        scheduler->cancel(job->mFuture);
+    }
+    Q_FOREACH(ImageScalerJob* job, d->mRunningJobs) {
+        job->mFuture.waitForFinished();
+    }
+    qDeleteAll(d->mRunningJobs);
+    qDeleteAll(d->mPendingJobs);
+    delete d;
+}
 
-    if (needsSmoothMargins) {
-        tmp = tmp.copy(
-                  destLeftMargin, destTopMargin,
-                  destRect.width() - (destLeftMargin + destRightMargin),
-                  destRect.height() - (destTopMargin + destBottomMargin)
-              );
+bool ImageScalerBatch::isBusy() const
+{
+    return !d->mPendingJobs.isEmpty() || !d->mRunningJobs.isEmpty();
+}
+
+void ImageScalerBatch::addRect(ImageScaler* scaler, const QImage& image, qreal zoom, const QRect& rect, Qt::TransformationMode transformationMode)
+{
+    d->dropOutdatedJobs();
+
+    ImageScalerJob* job = new ImageScalerJob;
+    job->mScaler = scaler;
+    job->mScalerGeneration = scaler->d->mGeneration;
+    job->mImage = image;
+    job->mZoom = zoom;
+    job->mRect = rect;
+    job->mTransformationMode = transformationMode;
+    d->mPendingJobs << job;
+
+    // Wait for the end of the event loop iteration, so that the other
+    // scalers get a chance to join the batch
+    if (d->mRunningJobs.isEmpty()) {
+        d->scheduleFlush();
+    }
+}
+
+void ImageScalerBatch::flush()
+{
+    d->mFlushScheduled = false;
+    if (!d->mRunningJobs.isEmpty()) {
+        return;
+    }
+    // Scalers may have changed since the jobs were queued
+    d->dropOutdatedJobs();
+    if (d->mPendingJobs.isEmpty()) {
+        return;
+    }
+    d->mRunningJobs.swap(d->mPendingJobs);
+    d->mRemainingJobCount = d->mRunningJobs.count();
+    LOG("Starting batch of" << d->mRemainingJobCount << "rects");
+
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    Q_FOREACH(ImageScalerJob* job, d->mRunningJobs) {
+        QFutureWatcher<void>* watcher = new QFutureWatcher<void>(this);
+        connect(watcher, SIGNAL(finished()), SLOT(slotJobFinished()));
+        job->mFuture = scheduler->run(TaskScheduler::VisibleDocument, job, &ImageScalerJob::run);
+        watcher->setFuture(job->mFuture);
     }
+}
 
-    scaledRect(destRect.left() + destLeftMargin, destRect.top() + destTopMargin, tmp);
+void ImageScalerBatch::slotJobFinished()
+{
+    QObject* watcher = sender();
+    if (watcher) {
+        watcher->deleteLater();
+    }
+    --d->mRemainingJobCount;
+    if (d->mRemainingJobCount > 0) {
+        return;
+    }
+
+    LOG("Delivering batch");
+    QList<ImageScalerJob*> jobs;
+    jobs.swap(d->mRunningJobs);
+    Q_FOREACH(ImageScalerJob* job, jobs) {
+        if (job->mScaler) {
+            job->mScaler.data()->deliverBatchedRect(job->mScalerGeneration, job->mRect, job->mPos, job->mResult);
+        }
+    }
+    qDeleteAll(jobs);
+
+    if (!d->mPendingJobs.isEmpty()) {
+        d->scheduleFlush();
+    }
 }
 
 } // namespace
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <document/document.h>
 
 class QImage;
+class QPoint;
 class QRect;
 class QRegion;
 
@@ -37,6 +38,7 @@ namespace Gwenview
 {
 
 class Document;
+class ImageScalerBatch;
 
 struct ImageScalerPrivate;
 class GWENVIEWLIB_EXPORT ImageScaler : public QObject
@@ -51,17 +53,60 @@ public:
 
     void setTransformationMode(Qt::TransformationMode);
 
+    /**
+     * When a batch is set, rects are scaled in the thread pool and
+     * scaledRect() is emitted later, together with the rects of the other
+     * scalers of the batch. Pass 0 to go back to scaling synchronously.
+     */
+    void setBatch(ImageScalerBatch*);
+
 Q_SIGNALS:
     void scaledRect(int left, int top, const QImage&);
 
 private:
     ImageScalerPrivate * const d;
-    void scaleRect(const QRect&);
+    void deliverBatchedRect(int generation, const QRect& rect, const QPoint& pos, const QImage&);
+    friend class ImageScalerBatch;
+    friend struct ImageScalerBatchPrivate;
 
 private Q_SLOTS:
     void doScale();
 };
 
+struct ImageScalerBatchPrivate;
+/**
+ * Groups the work of several ImageScaler instances, for example the views of
+ * the compare mode.
+ *
+ * All the rects requested during one event loop iteration are scaled in
+ * parallel by the TaskScheduler, and their scaledRect() signals are emitted
+ * in a row once they are all done, so that the views are repainted in the
+ * same frame. Rects requested while a batch is running are queued for the
+ * next one. Rects requested before the document, the zoom or the destination
+ * region of their scaler changed are dropped.
+ */
+class GWENVIEWLIB_EXPORT ImageScalerBatch : public QObject
+{
+    Q_OBJECT
+public:
+    ImageScalerBatch(QObject* parent = 0);
+    ~ImageScalerBatch();
+
+    /**
+     * Returns true if some rects have not been delivered yet
+     */
+    bool isBusy() const;
+
+private Q_SLOTS:
+    void flush();
+    void slotJobFinished();
+
+private:
+    ImageScalerBatchPrivate* const d;
+    void addRect(ImageScaler*, const QImage& image, qreal zoom, const QRect& rect, Qt::TransformationMode);
+    friend class ImageScaler;
+};
+
 } // namespace
 
 #endif /* IMAGESCALER_H */
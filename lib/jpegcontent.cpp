@@ -36,6 +36,7 @@ extern "C" {
 #include <QImage>
 #include <QImageWriter>
 #include <QMatrix>
+#include <QRect>
 #include <QDebug>
 
 // KDE
@@ -56,6 +57,18 @@ namespace Gwenview
 
 const int INMEM_DST_DELTA = 4096;
 
+// Markers which are not defined in jpeglib.h
+const uchar MARKER_SOI = 0xD8;
+const uchar MARKER_EOI = 0xD9;
+const uchar MARKER_SOS = 0xDA;
+const uchar MARKER_APP1 = 0xE1;
+
+const char EXIF_HEADER[] = "Exif\0\0";
+const int EXIF_HEADER_SIZE = 6;
+
+// Markers are followed by a 16 bit length, which includes itself
+const int MAX_SEGMENT_LENGTH = 0xFFFF;
+
 //-----------------------------------------------
 //
 // In-memory data destination manager for libjpeg
@@ -115,16 +128,29 @@ struct JpegContent::Private
     // pixels are kept in mImage until updateRawDataFromImage() is called.
     QImage mImage;
     QByteArray mRawData;
+    // Size of the image as shown, mStoredSize with the EXIF orientation
+    // applied
     QSize mSize;
+    QSize mStoredSize;
     QString mComment;
     bool mPendingTransformation;
     QMatrix mTransformMatrix;
     Exiv2::ExifData mExifData;
+    Exiv2::ByteOrder mExifByteOrder;
+    // The Exif data mExifData was decoded from, as stored in the APP1
+    // segment. Exiv2 updates it instead of encoding mExifData from scratch,
+    // which would move the MakerNote data it does not fully understand.
+    QByteArray mExifBuffer;
+    // True once save() has written mExifData and mComment: mRawData still
+    // contains the metadata it was loaded with
+    bool mRawDataHasOldMetadata;
     QString mErrorString;
 
     Private()
     {
         mPendingTransformation = false;
+        mExifByteOrder = Exiv2::littleEndian;
+        mRawDataHasOldMetadata = false;
     }
 
     void setupInmemDestination(j_compress_ptr cinfo, QByteArray* outputData)
@@ -141,6 +167,10 @@ struct JpegContent::Private
 
         dest->mOutput = outputData;
     }
+
+    bool transformRawData(JXFORM_CODE jxform);
+    bool cropRawData(QRect* cropRect, bool exact);
+
     bool readSize()
     {
         struct jpeg_decompress_struct srcinfo;
@@ -169,7 +199,7 @@ struct JpegContent::Private
             jpeg_destroy_decompress(&srcinfo);
             return false;
         }
-        mSize = QSize(srcinfo.image_width, srcinfo.image_height);
+        mStoredSize = QSize(srcinfo.image_width, srcinfo.image_height);
 
         jpeg_destroy_decompress(&srcinfo);
         return true;
@@ -187,6 +217,174 @@ struct JpegContent::Private
         mImage = QImage();
         return true;
     }
+
+    bool writeData(QIODevice* device, const uchar* data, int size)
+    {
+        if (device->write(reinterpret_cast<const char*>(data), size) != size) {
+            mErrorString = device->errorString();
+            return false;
+        }
+        return true;
+    }
+
+    static void appendSegmentHeader(QByteArray* segments, uchar marker, int length)
+    {
+        segments->append(char(0xFF));
+        segments->append(char(marker));
+        segments->append(char(length >> 8));
+        segments->append(char(length & 0xFF));
+    }
+
+    bool createMetadataSegments(QByteArray* segments)
+    {
+        if (!mExifData.empty()) {
+            Exiv2::Blob blob;
+            try {
+                if (mExifBuffer.isEmpty()) {
+                    Exiv2::ExifParser::encode(blob, mExifByteOrder, mExifData);
+                } else {
+                    Exiv2::ExifParser::encode(blob,
+                        reinterpret_cast<const Exiv2::byte*>(mExifBuffer.constData()), mExifBuffer.size(),
+                        mExifByteOrder, mExifData);
+                }
+            } catch (const Exiv2::Error& error) {
+                mErrorString = QString::fromUtf8(error.what());
+                return false;
+            }
+            if (!blob.empty()) {
+                const int length = 2 + EXIF_HEADER_SIZE + int(blob.size());
+                if (length > MAX_SEGMENT_LENGTH) {
+                    mErrorString = i18nc("@info", "Exif data is too large.");
+                    return false;
+                }
+                appendSegmentHeader(segments, MARKER_APP1, length);
+                segments->append(EXIF_HEADER, EXIF_HEADER_SIZE);
+                mExifBuffer = QByteArray(reinterpret_cast<const char*>(&blob[0]), int(blob.size()));
+                segments->append(mExifBuffer);
+            }
+        }
+        if (!mComment.isEmpty()) {
+            const QByteArray comment = mComment.toUtf8().left(MAX_SEGMENT_LENGTH - 2);
+            appendSegmentHeader(segments, JPEG_COM, comment.size() + 2);
+            segments->append(comment);
+        }
+        return true;
+    }
+
+    static bool isMetadataSegment(uchar marker, const uchar* payload, int payloadSize)
+    {
+        if (marker == JPEG_COM) {
+            return true;
+        }
+        return marker == MARKER_APP1
+               && payloadSize >= EXIF_HEADER_SIZE
+               && memcmp(payload, EXIF_HEADER, EXIF_HEADER_SIZE) == 0;
+    }
+
+    /**
+     * Returns the payload of the Exif segment of @a rawData, without the
+     * Exif header, or an empty array if there is none
+     */
+    static QByteArray findExifBuffer(const QByteArray& rawData)
+    {
+        const uchar* data = reinterpret_cast<const uchar*>(rawData.constData());
+        const int size = rawData.size();
+        int pos = 2;
+        while (pos + 4 <= size && data[pos] == 0xFF) {
+            const uchar marker = data[pos + 1];
+            if (marker == MARKER_SOS || marker == MARKER_EOI) {
+                break;
+            }
+            const int length = (data[pos + 2] << 8) | data[pos + 3];
+            if (length < 2 || pos + 2 + length > size) {
+                break;
+            }
+            const uchar* payload = data + pos + 4;
+            const int payloadSize = length - 2;
+            if (marker == MARKER_APP1 && payloadSize > EXIF_HEADER_SIZE
+                    && memcmp(payload, EXIF_HEADER, EXIF_HEADER_SIZE) == 0) {
+                return QByteArray(reinterpret_cast<const char*>(payload + EXIF_HEADER_SIZE), payloadSize - EXIF_HEADER_SIZE);
+            }
+            pos += 2 + length;
+        }
+        return QByteArray();
+    }
+
+    /**
+     * Writes mRawData to device, with its Exif and comment segments replaced
+     * with mExifData and mComment. The segments are copied straight from
+     * mRawData, without decoding or re-encoding anything.
+     */
+    bool writeWithMetadata(QIODevice* device)
+    {
+        const uchar* data = reinterpret_cast<const uchar*>(mRawData.constData());
+        const int size = mRawData.size();
+        const QString invalidDataError = i18nc("@info", "Invalid JPEG data.");
+        if (size < 4 || data[0] != 0xFF || data[1] != MARKER_SOI) {
+            mErrorString = invalidDataError;
+            return false;
+        }
+
+        QByteArray metadata;
+        if (!createMetadataSegments(&metadata)) {
+            return false;
+        }
+
+        if (!writeData(device, data, 2)) {
+            return false;
+        }
+        bool metadataWritten = false;
+        int pos = 2;
+        while (pos < size) {
+            if (data[pos] != 0xFF) {
+                break;
+            }
+            const int markerPos = pos;
+            // Skip fill bytes
+            while (pos < size && data[pos] == 0xFF) {
+                ++pos;
+            }
+            if (pos >= size) {
+                break;
+            }
+            const uchar marker = data[pos];
+            ++pos;
+
+            if (marker == MARKER_SOS || marker == MARKER_EOI) {
+                // Everything from here is image data, copy it as is
+                if (!metadataWritten && !writeData(device, reinterpret_cast<const uchar*>(metadata.constData()), metadata.size())) {
+                    return false;
+                }
+                return writeData(device, data + markerPos, size - markerPos);
+            }
+
+            if (pos + 2 > size) {
+                break;
+            }
+            const int length = (data[pos] << 8) | data[pos + 1];
+            if (length < 2 || pos + length > size) {
+                break;
+            }
+            const int segmentEnd = pos + length;
+
+            // JFIF segments must stay in front of the Exif segment
+            const bool keepInFront = marker == JPEG_APP0 && !metadataWritten;
+            if (!keepInFront && !metadataWritten) {
+                if (!writeData(device, reinterpret_cast<const uchar*>(metadata.constData()), metadata.size())) {
+                    return false;
+                }
+                metadataWritten = true;
+            }
+            if (keepInFront || !isMetadataSegment(marker, data + pos + 2, length - 2)) {
+                if (!writeData(device, data + markerPos, segmentEnd - markerPos)) {
+                    return false;
+                }
+            }
+            pos = segmentEnd;
+        }
+        mErrorString = invalidDataError;
+        return false;
+    }
 };
 
 //------------
@@ -240,10 +438,23 @@ bool JpegContent::loadFromData(const QByteArray& data, Exiv2::Image* exiv2Image)
     if (!d->readSize()) return false;
 
     d->mExifData = exiv2Image->exifData();
+    d->mExifBuffer = d->mExifData.empty() ? QByteArray() : Private::findExifBuffer(d->mRawData);
+    d->mExifByteOrder = exiv2Image->byteOrder();
+    if (d->mExifByteOrder == Exiv2::invalidByteOrder) {
+        d->mExifByteOrder = Exiv2::littleEndian;
+    }
     d->mComment = QString::fromUtf8(exiv2Image->comment().c_str());
+    d->mRawDataHasOldMetadata = false;
 
+    updateSize();
+    return true;
+}
+
+void JpegContent::updateSize()
+{
+    d->mSize = d->mStoredSize;
     if (!GwenviewConfig::applyExifOrientation()) {
-        return true;
+        return;
     }
 
     // Adjust the size according to the orientation
@@ -257,12 +468,19 @@ bool JpegContent::loadFromData(const QByteArray& data, Exiv2::Image* exiv2Image)
     default:
         break;
     }
-
-    return true;
 }
 
 QByteArray JpegContent::rawData() const
 {
+    if (d->mRawDataHasOldMetadata) {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (d->writeWithMetadata(&buffer)) {
+            d->mRawData = data;
+            d->mRawDataHasOldMetadata = false;
+        }
+    }
     return d->mRawData;
 }
 
@@ -448,13 +666,22 @@ static JXFORM_CODE findJxform(const QMatrix& matrix)
     return JXFORM_NONE;
 }
 
-void JpegContent::applyPendingTransformation()
+static JXFORM_CODE jxformForOrientation(Orientation orientation)
 {
-    if (d->mRawData.size() == 0) {
-        qCritical() << "No data loaded\n";
-        return;
+    OrientationInfoList::ConstIterator it(orientationInfoList().begin()), end(orientationInfoList().end());
+    for (; it != end; ++it) {
+        if ((*it).orientation == orientation) {
+            return (*it).jxform;
+        }
     }
+    return JXFORM_NONE;
+}
 
+/**
+ * Rewrites mRawData with @a jxform applied, without decoding the pixels.
+ */
+bool JpegContent::Private::transformRawData(JXFORM_CODE jxform)
+{
     // The following code is inspired by jpegtran.c from the libjpeg
 
     // Init JPEG structs
@@ -469,7 +696,7 @@ void JpegContent::applyPendingTransformation()
     jpeg_create_decompress(&srcinfo);
     if (setjmp(srcErrorManager.jmp_buffer)) {
         qCritical() << "libjpeg error in src\n";
-        return;
+        return false;
     }
 
     // Initialize the JPEG compression object
@@ -478,11 +705,11 @@ void JpegContent::applyPendingTransformation()
     jpeg_create_compress(&dstinfo);
     if (setjmp(dstErrorManager.jmp_buffer)) {
         qCritical() << "libjpeg error in dst\n";
-        return;
+        return false;
     }
 
     // Specify data source for decompression
-    QBuffer buffer(&d->mRawData);
+    QBuffer buffer(&mRawData);
     buffer.open(QIODevice::ReadOnly);
     IODeviceJpegSourceManager::setup(&srcinfo, &buffer);
 
@@ -494,7 +721,7 @@ void JpegContent::applyPendingTransformation()
     // Init transformation
     jpeg_transform_info transformoption;
     memset(&transformoption, 0, sizeof(jpeg_transform_info));
-    transformoption.transform = findJxform(d->mTransformMatrix);
+    transformoption.transform = jxform;
     jtransform_request_workspace(&srcinfo, &transformoption);
 
     /* Read source file as DCT coefficients */
@@ -512,8 +739,8 @@ void JpegContent::applyPendingTransformation()
 
     /* Specify data destination for compression */
     QByteArray output;
-    output.resize(d->mRawData.size());
-    d->setupInmemDestination(&dstinfo, &output);
+    output.resize(mRawData.size());
+    setupInmemDestination(&dstinfo, &output);
 
     /* Start compressor (note no image data is actually written here) */
     jpeg_write_coefficients(&dstinfo, dst_coef_arrays);
@@ -533,7 +760,206 @@ void JpegContent::applyPendingTransformation()
     jpeg_destroy_decompress(&srcinfo);
 
     // Set rawData to our new JPEG
-    d->mRawData = output;
+    mRawData = output;
+
+    switch (transformoption.transform) {
+    case JXFORM_TRANSPOSE:
+    case JXFORM_TRANSVERSE:
+    case JXFORM_ROT_90:
+    case JXFORM_ROT_270:
+        mStoredSize.transpose();
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+/**
+ * Returns @a pos moved to the nearest multiple of @a blockSize, without
+ * reaching @a end
+ */
+static int snapToBlock(int pos, int end, int blockSize)
+{
+    const int snapped = (pos + blockSize / 2) / blockSize * blockSize;
+    return snapped < end ? snapped : pos / blockSize * blockSize;
+}
+
+/**
+ * Rewrites mRawData cropped to @a cropRect, which is expressed in the
+ * coordinates of the stored image, without decoding the pixels. Unless
+ * @a exact is true, the top-left corner of @a cropRect is moved to the
+ * nearest iMCU boundary. On return, @a cropRect contains the rect which has
+ * actually been cropped.
+ *
+ * This does what the crop support of transupp.c does, which is not
+ * available in the libjpeg 6b version of the file.
+ */
+bool JpegContent::Private::cropRawData(QRect* cropRect, bool exact)
+{
+    struct jpeg_decompress_struct srcinfo;
+    struct jpeg_compress_struct dstinfo;
+
+    JPEGErrorManager srcErrorManager;
+    srcinfo.err = &srcErrorManager;
+    jpeg_create_decompress(&srcinfo);
+    if (setjmp(srcErrorManager.jmp_buffer)) {
+        qCritical() << "libjpeg error in src\n";
+        return false;
+    }
+
+    JPEGErrorManager dstErrorManager;
+    dstinfo.err = &dstErrorManager;
+    jpeg_create_compress(&dstinfo);
+    if (setjmp(dstErrorManager.jmp_buffer)) {
+        qCritical() << "libjpeg error in dst\n";
+        return false;
+    }
+
+    QBuffer buffer(&mRawData);
+    buffer.open(QIODevice::ReadOnly);
+    IODeviceJpegSourceManager::setup(&srcinfo, &buffer);
+    jcopy_markers_setup(&srcinfo, JCOPYOPT_ALL);
+    (void) jpeg_read_header(&srcinfo, true);
+
+    // Size of an iMCU, in pixels and in blocks. Single component images are
+    // not interleaved: their iMCU is one block, whatever the sampling factor.
+    int hSampFactor = 1;
+    int vSampFactor = 1;
+    if (srcinfo.num_components > 1) {
+        hSampFactor = srcinfo.max_h_samp_factor;
+        vSampFactor = srcinfo.max_v_samp_factor;
+    }
+    const int iMCUWidth = hSampFactor * DCTSIZE;
+    const int iMCUHeight = vSampFactor * DCTSIZE;
+
+    QRect rect = *cropRect & QRect(0, 0, srcinfo.image_width, srcinfo.image_height);
+    if (!rect.isEmpty() && !exact) {
+        const int right = rect.x() + rect.width();
+        const int bottom = rect.y() + rect.height();
+        rect.setLeft(snapToBlock(rect.x(), right, iMCUWidth));
+        rect.setTop(snapToBlock(rect.y(), bottom, iMCUHeight));
+    }
+    if (rect.isEmpty() || rect.x() % iMCUWidth != 0 || rect.y() % iMCUHeight != 0
+            || (exact && rect != *cropRect)) {
+        jpeg_destroy_compress(&dstinfo);
+        jpeg_destroy_decompress(&srcinfo);
+        return false;
+    }
+    const int xOffsetInIMCUs = rect.x() / iMCUWidth;
+    const int yOffsetInIMCUs = rect.y() / iMCUHeight;
+
+    // Destination coefficient arrays, padded to the next iMCU boundary. They
+    // must be requested before jpeg_read_coefficients() realizes the arrays.
+    const int widthInIMCUs = (rect.width() + iMCUWidth - 1) / iMCUWidth;
+    const int heightInIMCUs = (rect.height() + iMCUHeight - 1) / iMCUHeight;
+    jvirt_barray_ptr* dst_coef_arrays = (jvirt_barray_ptr*) (*srcinfo.mem->alloc_small)(
+        (j_common_ptr) &srcinfo, JPOOL_IMAGE, sizeof(jvirt_barray_ptr) * srcinfo.num_components);
+    for (int ci = 0; ci < srcinfo.num_components; ++ci) {
+        const jpeg_component_info* compptr = srcinfo.comp_info + ci;
+        const int hSamp = srcinfo.num_components > 1 ? compptr->h_samp_factor : 1;
+        const int vSamp = srcinfo.num_components > 1 ? compptr->v_samp_factor : 1;
+        dst_coef_arrays[ci] = (*srcinfo.mem->request_virt_barray)(
+            (j_common_ptr) &srcinfo, JPOOL_IMAGE, false,
+            widthInIMCUs * hSamp, heightInIMCUs * vSamp, vSamp);
+    }
+
+    jvirt_barray_ptr* src_coef_arrays = jpeg_read_coefficients(&srcinfo);
+
+    jpeg_copy_critical_parameters(&srcinfo, &dstinfo);
+    dstinfo.image_width = rect.width();
+    dstinfo.image_height = rect.height();
+
+    QByteArray output;
+    output.resize(mRawData.size());
+    setupInmemDestination(&dstinfo, &output);
+
+    jpeg_write_coefficients(&dstinfo, dst_coef_arrays);
+    jcopy_markers_execute(&srcinfo, &dstinfo, JCOPYOPT_ALL);
+
+    // Copy the blocks of the crop rect, iMCU row by iMCU row
+    for (int ci = 0; ci < dstinfo.num_components; ++ci) {
+        const jpeg_component_info* compptr = dstinfo.comp_info + ci;
+        const int hSamp = dstinfo.num_components > 1 ? compptr->h_samp_factor : 1;
+        const int vSamp = dstinfo.num_components > 1 ? compptr->v_samp_factor : 1;
+        const JDIMENSION xOffsetInBlocks = xOffsetInIMCUs * hSamp;
+        const JDIMENSION yOffsetInBlocks = yOffsetInIMCUs * vSamp;
+        for (JDIMENSION blockY = 0; blockY < compptr->height_in_blocks; blockY += vSamp) {
+            JBLOCKARRAY dstBuffer = (*srcinfo.mem->access_virt_barray)(
+                (j_common_ptr) &srcinfo, dst_coef_arrays[ci], blockY, vSamp, true);
+            JBLOCKARRAY srcBuffer = (*srcinfo.mem->access_virt_barray)(
+                (j_common_ptr) &srcinfo, src_coef_arrays[ci], blockY + yOffsetInBlocks, vSamp, false);
+            for (int row = 0; row < vSamp; ++row) {
+                memcpy(dstBuffer[row], srcBuffer[row] + xOffsetInBlocks,
+                       compptr->width_in_blocks * sizeof(JBLOCK));
+            }
+        }
+    }
+
+    jpeg_finish_compress(&dstinfo);
+    jpeg_destroy_compress(&dstinfo);
+    (void) jpeg_finish_decompress(&srcinfo);
+    jpeg_destroy_decompress(&srcinfo);
+
+    mRawData = output;
+    mStoredSize = rect.size();
+    *cropRect = rect;
+    return true;
+}
+
+void JpegContent::applyPendingTransformation()
+{
+    if (d->mRawData.size() == 0) {
+        qCritical() << "No data loaded\n";
+        return;
+    }
+    d->transformRawData(findJxform(d->mTransformMatrix));
+}
+
+QRect JpegContent::crop(const QRect& rect, bool exact, bool applyExifOrientation)
+{
+    // Once setImage() has been called, there is nothing to crop losslessly
+    if (!d->mImage.isNull() || d->mRawData.isEmpty()) {
+        return QRect();
+    }
+
+    const Orientation exifOrientation = orientation();
+    if (applyExifOrientation && exifOrientation != NORMAL && exifOrientation != NOT_AVAILABLE) {
+        // Pending transformations have been shown on top of the EXIF
+        // orientation, but they apply to the stored image: the result would
+        // not match what the user sees
+        if (d->mPendingTransformation) {
+            return QRect();
+        }
+        // rect is expressed in the coordinates of the image as shown: store
+        // the image that way, as setImage() does
+        if (!d->transformRawData(jxformForOrientation(exifOrientation))) {
+            return QRect();
+        }
+        resetOrientation();
+        // mRawData still contains the old orientation
+        d->mRawDataHasOldMetadata = true;
+    }
+
+    if (d->mPendingTransformation) {
+        if (!d->transformRawData(findJxform(d->mTransformMatrix))) {
+            return QRect();
+        }
+        d->mPendingTransformation = false;
+        d->mTransformMatrix.reset();
+    }
+
+    QRect cropRect = rect;
+    if (!d->cropRawData(&cropRect, exact)) {
+        return QRect();
+    }
+    d->mExifData["Exif.Photo.PixelXDimension"] = cropRect.width();
+    d->mExifData["Exif.Photo.PixelYDimension"] = cropRect.height();
+    // mRawData still contains the old dimensions
+    d->mRawDataHasOldMetadata = true;
+
+    d->mSize = cropRect.size();
+    return cropRect;
 }
 
 QImage JpegContent::thumbnail() const
@@ -601,25 +1027,17 @@ bool JpegContent::save(QIODevice* device)
     if (d->mPendingTransformation) {
         applyPendingTransformation();
         d->mPendingTransformation = false;
+        d->mTransformMatrix.reset();
     }
 
-    Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open((unsigned char*)d->mRawData.data(), d->mRawData.size());
-
-    // Store Exif info
-    image->setExifData(d->mExifData);
-    image->setComment(d->mComment.toUtf8().data());
-    image->writeMetadata();
-
-    // Update mRawData
-    Exiv2::BasicIo& io = image->io();
-    d->mRawData.resize(io.size());
-    io.read((unsigned char*)d->mRawData.data(), io.size());
-
-    QDataStream stream(device);
-    stream.writeRawData(d->mRawData.data(), d->mRawData.size());
+    if (!d->writeWithMetadata(device)) {
+        return false;
+    }
 
-    // Make sure we are up to date
-    loadFromData(d->mRawData);
+    // mExifData and mComment are now what has been written, there is no need
+    // to parse the data again. mRawData is updated lazily by rawData().
+    d->mRawDataHasOldMetadata = true;
+    updateSize();
     return true;
 }
 
@@ -633,12 +1051,14 @@ void JpegContent::setImage(const QImage& image)
     d->mRawData.clear();
     d->mImage = image;
     d->mSize = image.size();
+    d->mStoredSize = image.size();
     d->mExifData["Exif.Photo.PixelXDimension"] = image.width();
     d->mExifData["Exif.Photo.PixelYDimension"] = image.height();
     resetOrientation();
 
     d->mPendingTransformation = false;
     d->mTransformMatrix = QMatrix();
+    d->mRawDataHasOldMetadata = false;
 }
 
 } // namespace
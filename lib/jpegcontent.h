@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/gwenviewlib_export.h>
 #include <QByteArray>
 class QImage;
+class QRect;
 class QSize;
 class QString;
 class QIODevice;
@@ -57,6 +58,25 @@ public:
 
     void transform(Orientation);
 
+    /**
+     * Crops the image to @a rect, without decoding it. @a rect is expressed
+     * in the coordinates of the image with pending transformations applied,
+     * and with the EXIF orientation applied if @a applyExifOrientation is
+     * true. In the latter case, the EXIF orientation is applied to the
+     * stored image and reset, like setImage() does.
+     *
+     * JPEG can only be cropped losslessly on a grid of 8 or 16 pixels, the
+     * size of an iMCU. The right and bottom edges of @a rect can be
+     * anywhere, but its top-left corner is moved to the nearest grid point.
+     * If @a exact is true and the top-left corner is not on the grid, the
+     * image is not cropped.
+     *
+     * Returns the rect which has been cropped, or a null rect if the image
+     * cannot be cropped this way, for example because it has been replaced
+     * with setImage().
+     */
+    QRect crop(const QRect& rect, bool exact, bool applyExifOrientation);
+
     QImage thumbnail() const;
     void setThumbnail(const QImage&);
 
@@ -84,6 +104,7 @@ private:
     JpegContent(const JpegContent&);
     void operator=(const JpegContent&);
     void applyPendingTransformation();
+    void updateSize();
     int dotsPerMeter(const QString& keyName) const;
 };
 
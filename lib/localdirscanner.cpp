@@ -0,0 +1,297 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "localdirscanner.h"
+
+// System
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Qt
+#include <QAtomicInt>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QUrl>
+#include <QDebug>
+
+// KDE
+#include <KIO/UDSEntry>
+
+// Local
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Number of items a worker collects before handing them to the GUI thread
+static const int BATCH_SIZE = 1000;
+
+static KFileItem createItem(const QMimeDatabase& db, const QUrl& dirUrl, const QString& name, const struct stat& st)
+{
+    KIO::UDSEntry entry;
+    entry.insert(KIO::UDSEntry::UDS_NAME, name);
+    entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, qlonglong(st.st_mode & S_IFMT));
+    entry.insert(KIO::UDSEntry::UDS_ACCESS, qlonglong(st.st_mode & 07777));
+    entry.insert(KIO::UDSEntry::UDS_SIZE, qlonglong(st.st_size));
+    entry.insert(KIO::UDSEntry::UDS_MODIFICATION_TIME, qlonglong(st.st_mtime));
+    if (S_ISDIR(st.st_mode)) {
+        entry.insert(KIO::UDSEntry::UDS_MIME_TYPE, QStringLiteral("inode/directory"));
+    } else {
+        // Only trust the name if it matches a single mimetype. Otherwise
+        // KFileItem looks at the content, but only when the mimetype is
+        // needed.
+        const QList<QMimeType> mimeTypes = db.mimeTypesForFileName(name);
+        if (mimeTypes.count() == 1) {
+            entry.insert(KIO::UDSEntry::UDS_MIME_TYPE, mimeTypes.first().name());
+        }
+    }
+    return KFileItem(entry, dirUrl, true /* delayedMimeTypes */, true /* urlIsDirectory */);
+}
+
+struct ScanResult
+{
+    QUrl mDirUrl;
+    KFileItemList mItems;
+    // True for the last result of mDirUrl
+    bool mDirDone;
+};
+
+struct LocalDirScannerPrivate
+{
+    LocalDirScanner* q;
+    QThreadPool mPool;
+    // Incremented by stop(), so that workers know their results are not
+    // wanted anymore
+    QAtomicInt mGeneration;
+
+    // Protects the members below
+    QMutex mMutex;
+    QQueue<ScanResult> mResults;
+    // Number of dirs whose last result has not been delivered yet
+    int mPendingDirCount;
+    bool mDeliveryScheduled;
+
+    void startTask(const QUrl& url, bool recursive, int generation);
+
+    /**
+     * Queues @a result for delivery in the GUI thread. Returns false if the
+     * scan has been stopped.
+     */
+    bool postResult(int generation, const ScanResult& result)
+    {
+        QMutexLocker locker(&mMutex);
+        if (generation != mGeneration.load()) {
+            return false;
+        }
+        mResults.enqueue(result);
+        if (!mDeliveryScheduled) {
+            mDeliveryScheduled = true;
+            QMetaObject::invokeMethod(q, "deliverResults", Qt::QueuedConnection);
+        }
+        return true;
+    }
+};
+
+class LocalDirScanTask : public QRunnable
+{
+public:
+    LocalDirScanTask(LocalDirScannerPrivate* scanner, const QUrl& url, bool recursive, int generation)
+    : mScanner(scanner)
+    , mUrl(url)
+    , mRecursive(recursive)
+    , mGeneration(generation)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        if (isCanceled()) {
+            return;
+        }
+        ScanResult result;
+        result.mDirUrl = mUrl;
+        result.mDirDone = false;
+
+        const QString path = mUrl.toLocalFile();
+        LOG("Scanning" << path);
+        DIR* dir = opendir(QFile::encodeName(path).constData());
+        if (dir) {
+            scanDir(dir, &result);
+            closedir(dir);
+        } else {
+            qWarning() << "Could not list" << path;
+        }
+        result.mDirDone = true;
+        mScanner->postResult(mGeneration, result);
+    }
+
+private:
+    LocalDirScannerPrivate* mScanner;
+    QUrl mUrl;
+    bool mRecursive;
+    int mGeneration;
+
+    bool isCanceled() const
+    {
+        return mScanner->mGeneration.load() != mGeneration;
+    }
+
+    void scanDir(DIR* dir, ScanResult* result)
+    {
+        QMimeDatabase db;
+        const int fd = dirfd(dir);
+        while (dirent* ent = readdir(dir)) {
+            // Skips ".", ".." and hidden files
+            if (ent->d_name[0] == '.') {
+                continue;
+            }
+            if (isCanceled()) {
+                return;
+            }
+            // Follow symlinks like KIO does, but still list broken ones
+            struct stat st;
+            if (fstatat(fd, ent->d_name, &st, 0) != 0
+                && fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                continue;
+            }
+            const KFileItem item = createItem(db, mUrl, QFile::decodeName(ent->d_name), st);
+            result->mItems << item;
+
+            if (mRecursive && S_ISDIR(st.st_mode) && !isLink(fd, ent)) {
+                mScanner->startTask(item.url(), true, mGeneration);
+            }
+            if (result->mItems.count() == BATCH_SIZE) {
+                if (!mScanner->postResult(mGeneration, *result)) {
+                    return;
+                }
+                result->mItems.clear();
+            }
+        }
+    }
+
+    static bool isLink(int fd, const dirent* ent)
+    {
+        if (ent->d_type != DT_UNKNOWN) {
+            return ent->d_type == DT_LNK;
+        }
+        struct stat st;
+        return fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(st.st_mode);
+    }
+};
+
+void LocalDirScannerPrivate::startTask(const QUrl& url, bool recursive, int generation)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        if (generation != mGeneration.load()) {
+            return;
+        }
+        ++mPendingDirCount;
+    }
+    mPool.start(new LocalDirScanTask(this, url, recursive, generation));
+}
+
+LocalDirScanner::LocalDirScanner(QObject* parent)
+: QObject(parent)
+, d(new LocalDirScannerPrivate)
+{
+    d->q = this;
+    d->mPool.setMaxThreadCount(qMax(1, envInt("GV_MAX_SCANNER_THREADS", 4)));
+    d->mPendingDirCount = 0;
+    d->mDeliveryScheduled = false;
+}
+
+LocalDirScanner::~LocalDirScanner()
+{
+    stop();
+    d->mPool.waitForDone();
+    delete d;
+}
+
+void LocalDirScanner::scan(const QUrl& url, bool recursive)
+{
+    GV_RETURN_IF_FAIL(url.isLocalFile());
+    d->startTask(url, recursive, d->mGeneration.load());
+}
+
+void LocalDirScanner::stop()
+{
+    QMutexLocker locker(&d->mMutex);
+    d->mGeneration.ref();
+    d->mResults.clear();
+    d->mPendingDirCount = 0;
+}
+
+bool LocalDirScanner::isScanning() const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mPendingDirCount > 0;
+}
+
+void LocalDirScanner::deliverResults()
+{
+    QQueue<ScanResult> results;
+    int generation;
+    {
+        QMutexLocker locker(&d->mMutex);
+        results.swap(d->mResults);
+        d->mDeliveryScheduled = false;
+        generation = d->mGeneration.load();
+    }
+    Q_FOREACH(const ScanResult& result, results) {
+        // Receivers may have called stop()
+        if (d->mGeneration.load() != generation) {
+            return;
+        }
+        if (!result.mItems.isEmpty()) {
+            emit itemsFound(result.mDirUrl, result.mItems);
+        }
+        if (!result.mDirDone || d->mGeneration.load() != generation) {
+            continue;
+        }
+        {
+            QMutexLocker locker(&d->mMutex);
+            --d->mPendingDirCount;
+        }
+        emit dirScanned(result.mDirUrl);
+        if (d->mGeneration.load() == generation && !isScanning()) {
+            emit finished();
+        }
+    }
+}
+
+} // namespace
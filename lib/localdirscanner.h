@@ -0,0 +1,105 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef LOCALDIRSCANNER_H
+#define LOCALDIRSCANNER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+
+// KDE
+#include <KFileItem>
+
+// Local
+
+class QUrl;
+
+namespace Gwenview
+{
+
+struct LocalDirScannerPrivate;
+/**
+ * Lists local dirs without going through KIO.
+ *
+ * Dirs are read with readdir() and fstatat() in worker threads, several dirs
+ * at the same time. The mimetype of the items is guessed from their name when
+ * it is not ambiguous, otherwise it is left to be determined by KFileItem
+ * when it is needed.
+ *
+ * Items are delivered to the GUI thread in batches, a big dir is reported
+ * through several itemsFound() signals. Like KDirLister, hidden files are
+ * skipped.
+ *
+ * Only RecursiveDirModel uses it. SortedDirModel lists dirs through
+ * KDirModel, which can only be fed by a KDirLister: it gets its items from
+ * the KDirLister cache, which also keeps them up to date, so items found
+ * here cannot be handed to it.
+ *
+ * The number of worker threads can be changed with the GV_MAX_SCANNER_THREADS
+ * environment variable.
+ */
+class GWENVIEWLIB_EXPORT LocalDirScanner : public QObject
+{
+    Q_OBJECT
+public:
+    LocalDirScanner(QObject* parent = 0);
+    ~LocalDirScanner();
+
+    /**
+     * Starts listing @a url, which must be a local dir. If @a recursive is
+     * true, subdirs are listed as well, except symlinks to dirs.
+     *
+     * Scans which are already running are not interrupted.
+     */
+    void scan(const QUrl& url, bool recursive);
+
+    /**
+     * Stops all scans. Items which have not been delivered yet are dropped.
+     */
+    void stop();
+
+    bool isScanning() const;
+
+Q_SIGNALS:
+    void itemsFound(const QUrl& dirUrl, const KFileItemList& items);
+
+    /**
+     * Emitted once all the items of @a dirUrl have been delivered. For
+     * recursive scans, it is emitted for each subdir.
+     */
+    void dirScanned(const QUrl& dirUrl);
+
+    /**
+     * Emitted when there are no more scans running
+     */
+    void finished();
+
+private Q_SLOTS:
+    void deliverResults();
+
+private:
+    LocalDirScannerPrivate* const d;
+};
+
+} // namespace
+
+#endif /* LOCALDIRSCANNER_H */
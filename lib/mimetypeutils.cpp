@@ -151,6 +151,14 @@ Kind mimeTypeKind(const QString& mimeType)
 Kind fileItemKind(const KFileItem& item)
 {
     GV_RETURN_VALUE_IF_FAIL(!item.isNull(), KIND_UNKNOWN);
+    if (!item.isMimeTypeKnown() && !item.isDir()) {
+        // Do not look at the content if the name is enough
+        QMimeDatabase db;
+        const QList<QMimeType> mimeTypes = db.mimeTypesForFileName(item.name());
+        if (mimeTypes.count() == 1) {
+            return mimeTypeKind(mimeTypes.first().name());
+        }
+    }
     return mimeTypeKind(item.mimetype());
 }
 
@@ -0,0 +1,206 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "perfcounters.h"
+
+// Qt
+#include <QAtomicInt>
+#include <QStringList>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+// Bucket i holds the latencies whose bit length is i, the last one also holds
+// everything above 2^31 microseconds
+static const int BUCKET_COUNT = 32;
+
+static const int PERCENTILES[] = { 50, 90, 99 };
+static const int PERCENTILE_COUNT = sizeof(PERCENTILES) / sizeof(int);
+
+static const char* const COUNTER_NAMES[PerfCounters::CounterCount] = {
+    "thumbnailCacheHits",
+    "thumbnailCacheMisses",
+    "thumbnailQueueDepth",
+    "documentCacheKiB",
+    "documentCacheEvictions",
+    "documentPendingJobs"
+};
+
+static const char* const LATENCY_NAMES[PerfCounters::LatencyCount] = {
+    "decodeLatency",
+    "scaleLatency"
+};
+
+static QAtomicInt sCounters[PerfCounters::CounterCount];
+static QAtomicInt sBuckets[PerfCounters::LatencyCount][BUCKET_COUNT];
+
+static bool isGauge(PerfCounters::Counter counter)
+{
+    return counter == PerfCounters::ThumbnailQueueDepth
+           || counter == PerfCounters::DocumentCacheKiB
+           || counter == PerfCounters::DocumentPendingJobs;
+}
+
+static int bucketForLatency(qint64 usecs)
+{
+    int bucket = 0;
+    for (; usecs > 0 && bucket < BUCKET_COUNT - 1; usecs >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+static QString formatLatency(qint64 usecs)
+{
+    if (usecs < 1000) {
+        return QString("%1 us").arg(usecs);
+    }
+    return QString("%1 ms").arg(usecs / 1000);
+}
+
+void PerfCounters::add(Counter counter, int delta)
+{
+    sCounters[counter].fetchAndAddRelaxed(delta);
+}
+
+void PerfCounters::set(Counter counter, int value)
+{
+    sCounters[counter].fetchAndStoreRelaxed(value);
+}
+
+int PerfCounters::value(Counter counter)
+{
+    return sCounters[counter].load();
+}
+
+void PerfCounters::addLatency(Latency latency, qint64 usecs)
+{
+    sBuckets[latency][bucketForLatency(usecs)].fetchAndAddRelaxed(1);
+}
+
+int PerfCounters::latencyCount(Latency latency)
+{
+    int count = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        count += sBuckets[latency][bucket].load();
+    }
+    return count;
+}
+
+qint64 PerfCounters::latencyPercentile(Latency latency, int percentile)
+{
+    // Take a copy, other threads may be recording latencies
+    int counts[BUCKET_COUNT];
+    qint64 total = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        counts[bucket] = sBuckets[latency][bucket].load();
+        total += counts[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const qint64 rank = qMax(qint64(1), (total * qBound(0, percentile, 100) + 99) / 100);
+    qint64 cumulated = 0;
+    int bucket = 0;
+    for (; bucket < BUCKET_COUNT - 1; ++bucket) {
+        cumulated += counts[bucket];
+        if (cumulated >= rank) {
+            break;
+        }
+    }
+    return bucket == 0 ? 0 : qint64(1) << bucket;
+}
+
+QVariantMap PerfCounters::snapshot()
+{
+    QVariantMap map;
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        map.insert(COUNTER_NAMES[counter], value(Counter(counter)));
+    }
+    const int hits = value(ThumbnailCacheHits);
+    const int lookups = hits + value(ThumbnailCacheMisses);
+    map.insert("thumbnailCacheHitRatio", lookups > 0 ? qreal(hits) / lookups : qreal(0));
+
+    for (int latency = 0; latency < LatencyCount; ++latency) {
+        const QString name = LATENCY_NAMES[latency];
+        map.insert(name + "Count", latencyCount(Latency(latency)));
+        for (int idx = 0; idx < PERCENTILE_COUNT; ++idx) {
+            map.insert(name + 'P' + QString::number(PERCENTILES[idx]),
+                       latencyPercentile(Latency(latency), PERCENTILES[idx]));
+        }
+    }
+    return map;
+}
+
+QString PerfCounters::report()
+{
+    QStringList lines;
+    const int hits = value(ThumbnailCacheHits);
+    const int misses = value(ThumbnailCacheMisses);
+    lines << QString("Thumbnail cache: %1 hits, %2 misses (%3%)")
+          .arg(hits)
+          .arg(misses)
+          .arg(hits + misses > 0 ? hits * 100 / (hits + misses) : 0);
+    lines << QString("Thumbnail queue: %1").arg(value(ThumbnailQueueDepth));
+    lines << QString("Document cache: %1 MiB, %2 evictions")
+          .arg(value(DocumentCacheKiB) / 1024)
+          .arg(value(DocumentCacheEvictions));
+    lines << QString("Document jobs: %1").arg(value(DocumentPendingJobs));
+
+    static const char* const labels[LatencyCount] = { "Decode", "Scale" };
+    for (int latency = 0; latency < LatencyCount; ++latency) {
+        QString line = QString("%1: %2 samples")
+                       .arg(labels[latency])
+                       .arg(latencyCount(Latency(latency)));
+        for (int idx = 0; idx < PERCENTILE_COUNT; ++idx) {
+            line += QString(", p%1 %2")
+                    .arg(PERCENTILES[idx])
+                    .arg(formatLatency(latencyPercentile(Latency(latency), PERCENTILES[idx])));
+        }
+        lines << line;
+    }
+    return lines.join("\n");
+}
+
+bool PerfCounters::isReportingEnabled()
+{
+    return !qgetenv("GV_PERF_OVERLAY").isEmpty();
+}
+
+void PerfCounters::reset()
+{
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        if (!isGauge(Counter(counter))) {
+            sCounters[counter].store(0);
+        }
+    }
+    for (int latency = 0; latency < LatencyCount; ++latency) {
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            sBuckets[latency][bucket].store(0);
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,144 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+// KDE
+
+// Local
+
+class QString;
+
+namespace Gwenview
+{
+
+/**
+ * Live counters describing what Gwenview is busy with, to diagnose slow
+ * folders on users machines.
+ *
+ * Counters are atomic integers and can be updated from any thread. Latencies
+ * are recorded in histograms with power of two buckets, in microseconds, so
+ * percentiles are approximated by the upper bound of their bucket.
+ *
+ * Values are cumulative since the application started or since the last call
+ * to reset(). Gauges (queue depths, cache size) are not affected by reset().
+ *
+ * The application shows them over the view page and exports them on D-Bus
+ * when the GV_PERF_OVERLAY environment variable is set, see
+ * isReportingEnabled().
+ */
+class GWENVIEWLIB_EXPORT PerfCounters
+{
+public:
+    enum Counter {
+        ThumbnailCacheHits,
+        ThumbnailCacheMisses,
+        /// Gauge: items waiting for a thumbnail, in all ThumbnailProviders
+        ThumbnailQueueDepth,
+        /// Gauge: memory used by the documents of DocumentFactory, in KiB
+        DocumentCacheKiB,
+        DocumentCacheEvictions,
+        /// Gauge: running and queued jobs, in all Documents
+        DocumentPendingJobs,
+        CounterCount
+    };
+
+    enum Latency {
+        DecodeLatency,
+        ScaleLatency,
+        LatencyCount
+    };
+
+    static void add(Counter, int delta = 1);
+    static void set(Counter, int value);
+    static int value(Counter);
+
+    static void addLatency(Latency, qint64 usecs);
+    static int latencyCount(Latency);
+
+    /**
+     * Returns an upper bound of the @a percentile (0 to 100) of the recorded
+     * latencies, in microseconds. Returns 0 if nothing has been recorded.
+     */
+    static qint64 latencyPercentile(Latency, int percentile);
+
+    /**
+     * Returns all the values, keyed by camel case names such as
+     * "thumbnailCacheHits" or "decodeLatencyP90"
+     */
+    static QVariantMap snapshot();
+
+    /**
+     * Returns the values as human readable text, one line per value
+     */
+    static QString report();
+
+    static void reset();
+
+    /**
+     * Returns true if the counters must be shown to the user and exported,
+     * which is the case when GV_PERF_OVERLAY is set
+     */
+    static bool isReportingEnabled();
+};
+
+/**
+ * Records how long its lifetime lasts in a latency histogram. Use it through
+ * GV_LATENCY_SCOPE().
+ */
+class LatencyScope
+{
+public:
+    explicit LatencyScope(PerfCounters::Latency latency)
+    : mLatency(latency)
+    {
+        mTimer.start();
+    }
+
+    ~LatencyScope()
+    {
+        PerfCounters::addLatency(mLatency, mTimer.nsecsElapsed() / 1000);
+    }
+
+private:
+    Q_DISABLE_COPY(LatencyScope)
+    PerfCounters::Latency mLatency;
+    QElapsedTimer mTimer;
+};
+
+} // namespace
+
+#define GV_LATENCY_CONCAT2(a, b) a##b
+#define GV_LATENCY_CONCAT(a, b) GV_LATENCY_CONCAT2(a, b)
+
+/**
+ * Records how long the rest of the current block takes in the @a latency
+ * histogram, for example GV_LATENCY_SCOPE(DecodeLatency)
+ */
+#define GV_LATENCY_SCOPE(latency) Gwenview::LatencyScope GV_LATENCY_CONCAT(gvLatencyScope, __LINE__)(Gwenview::PerfCounters::latency)
+
+#endif /* PERFCOUNTERS_H */
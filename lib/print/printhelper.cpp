@@ -26,9 +26,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Qt
 #include <QCheckBox>
+#include <QFuture>
 #include <QPainter>
 #include <QPrinter>
 #include <QPrintDialog>
+#include <QDebug>
 
 // KDE
 #include <KLocalizedString>
@@ -36,10 +38,59 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include "printoptionspage.h"
+#include <lib/resize/imageresampler.h>
+#include <lib/taskscheduler.h>
 
 namespace Gwenview
 {
 
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// The page is sent to the printer in bands of about this size
+static const int PRINT_BAND_BYTES = 16 * 1024 * 1024;
+
+/**
+ * Renders one band of the image to print, scaled to the size it is printed
+ * at
+ */
+class PrintBandRenderer
+{
+public:
+    PrintBandRenderer(const QImage& image, const QSize& size)
+    : mImage(image)
+    , mSize(size)
+    , mFirstRow(0)
+    , mRowCount(0)
+    {}
+
+    void setBand(int firstRow, int rowCount)
+    {
+        mFirstRow = firstRow;
+        mRowCount = rowCount;
+    }
+
+    QImage render()
+    {
+        if (mSize == mImage.size()) {
+            return mImage.copy(0, mFirstRow, mImage.width(), mRowCount);
+        }
+        return ImageResampler::resampleRows(mImage, mSize, mFirstRow, mRowCount, ImageResampler::Mitchell);
+    }
+
+private:
+    QImage mImage;
+    QSize mSize;
+    int mFirstRow;
+    int mRowCount;
+};
+
 struct PrintHelperPrivate
 {
     QWidget* mParent;
@@ -101,6 +152,58 @@ struct PrintHelperPrivate
 
         return QPoint(posX, posY);
     }
+
+    /**
+     * Returns the image to send to the printer for a print of @a size device
+     * pixels: a down sampled image if one is available and still big enough,
+     * the full image otherwise
+     */
+    QImage sourceImage(Document::Ptr doc, const QSize& size)
+    {
+        const QSize fullSize = doc->size();
+        const qreal zoom = qMax(qreal(size.width()) / fullSize.width(), qreal(size.height()) / fullSize.height());
+        if (zoom < 1.) {
+            const QImage& image = doc->downSampledImageForZoom(zoom);
+            if (!image.isNull()) {
+                return image;
+            }
+        }
+        return doc->image();
+    }
+
+    /**
+     * Draws @a image to @a painter, whose window must be set to @a size, one
+     * band at a time. The next band is rendered in a worker thread while the
+     * current one is being drawn.
+     */
+    void drawInBands(QPainter* painter, const QImage& image, const QSize& size)
+    {
+        const int bandHeight = qMax(1, PRINT_BAND_BYTES / (size.width() * 4));
+        LOG("Printing" << image.size() << "at" << size << "in bands of" << bandHeight << "rows");
+
+        PrintBandRenderer renderers[2] = {
+            PrintBandRenderer(image, size),
+            PrintBandRenderer(image, size)
+        };
+        QFuture<QImage> futures[2];
+        TaskScheduler* scheduler = TaskScheduler::instance();
+
+        renderers[0].setBand(0, qMin(bandHeight, size.height()));
+        futures[0] = scheduler->run(TaskScheduler::VisibleDocument, &renderers[0], &PrintBandRenderer::render);
+        for (int row = 0, band = 0; row < size.height(); row += bandHeight, ++band) {
+            const int current = band % 2;
+            const int next = 1 - current;
+            const int nextRow = row + bandHeight;
+            if (nextRow < size.height()) {
+                renderers[next].setBand(nextRow, qMin(bandHeight, size.height() - nextRow));
+                futures[next] = scheduler->run(TaskScheduler::VisibleDocument, &renderers[next], &PrintBandRenderer::render);
+            }
+            scheduler->waitForFinished(futures[current]);
+            painter->drawImage(0, row, futures[current].result());
+            // Do not keep the band around while the next one is drawn
+            futures[current] = QFuture<QImage>();
+        }
+    }
 };
 
 PrintHelper::PrintHelper(QWidget* parent)
@@ -141,10 +244,19 @@ void PrintHelper::print(Document::Ptr doc)
     QSize size = d->adjustSize(optionsPage, doc, printer.resolution(), rect.size());
     QPoint pos = d->adjustPosition(optionsPage, size, rect.size());
     painter.setViewport(pos.x(), pos.y(), size.width(), size.height());
+    if (size.isEmpty()) {
+        return;
+    }
 
-    QImage image = doc->image();
-    painter.setWindow(image.rect());
-    painter.drawImage(0, 0, image);
+    // Never send more pixels than the printer can use. If the image is
+    // smaller than the print, let the print engine enlarge it.
+    const QImage image = d->sourceImage(doc, size);
+    QSize printSize = image.size();
+    if (printSize.width() > size.width() || printSize.height() > size.height()) {
+        printSize = size;
+    }
+    painter.setWindow(QRect(QPoint(0, 0), printSize));
+    d->drawInBands(&painter, image, printSize);
 }
 
 } // namespace
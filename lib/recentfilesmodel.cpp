@@ -96,6 +96,12 @@ void RecentFilesModel::addUrl(const QUrl &url)
     sort(0);
 }
 
+QModelIndex RecentFilesModel::indexForUrl(const QUrl &url) const
+{
+    const RecentFilesItem* item = d->mRecentFilesItemForUrl.value(url);
+    return item ? item->index() : QModelIndex();
+}
+
 bool RecentFilesModel::removeRows(int start, int count, const QModelIndex& parent)
 {
     Q_ASSERT(!parent.isValid());
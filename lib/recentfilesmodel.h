@@ -50,6 +50,12 @@ public:
 
     void addUrl(const QUrl&);
 
+    /**
+     * Returns the index of the item for @a url, or an invalid index if there
+     * is no such item.
+     */
+    QModelIndex indexForUrl(const QUrl&) const;
+
     virtual bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex()) Q_DECL_OVERRIDE;
 
 private:
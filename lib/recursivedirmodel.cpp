@@ -23,49 +23,162 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/gvdebug.h>
+#include <lib/localdirscanner.h>
 
 // KDE
 #include <KDirLister>
 #include <KDirModel>
+#include <KDirWatch>
 
 // Qt
+#include <QFileInfo>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
 #include <QDebug>
 
 namespace Gwenview
 {
 
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Maximum number of dirs listed at the same time
+static const int MAX_CONCURRENT_LISTINGS = 4;
+
+// Items added within this delay are inserted with one beginInsertRows() call
+static const int INSERT_DELAY = 100;
+
+// Changes to a local dir within this delay are handled with one rescan
+static const int RESCAN_DELAY = 100;
+
+static QUrl normalizedDirUrl(const QUrl& url)
+{
+    return url.adjusted(QUrl::StripTrailingSlash);
+}
+
+static QUrl parentDirUrl(const QUrl& url)
+{
+    return url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash);
+}
+
 struct RecursiveDirModelPrivate {
+    QUrl mUrl;
+    QTimer* mInsertTimer;
+
+    // Dirs are listed either with mDirLister, or with mScanner and
+    // mDirWatch. Only one of them is set.
     KDirLister* mDirLister;
+    LocalDirScanner* mScanner;
+    KDirWatch* mDirWatch;
+    bool mLocalDirScannerEnabled;
+
+    // Local dirs which have been scanned, and are now watched
+    QSet<QUrl> mWatchedDirs;
+    // Local dirs which changed and must be scanned again
+    QSet<QUrl> mDirtyDirs;
+    QTimer* mRescanTimer;
+    // Local dirs being scanned again, with the urls of the files found so far
+    QHash<QUrl, QSet<QUrl> > mRescannedDirs;
+
+    // Dirs waiting to be listed
+    QQueue<QUrl> mPendingDirs;
+    // Dirs being listed
+    QSet<QUrl> mListedDirs;
+
+    // Items waiting to be inserted
+    KFileItemList mPendingItems;
+    QSet<QUrl> mPendingUrls;
+
+    RecursiveDirModelPrivate()
+    : mDirLister(0)
+    , mScanner(0)
+    , mDirWatch(0)
+    , mLocalDirScannerEnabled(true)
+    , mIndexedRowCount(0)
+    {}
 
     int rowForUrl(const QUrl &url) const
     {
+        int row = mRowForUrl.value(url, -1);
+        if (row >= 0 && row < mList.count() && mList.at(row).url() == url) {
+            return row;
+        }
+        if (mIndexedRowCount == mList.count()) {
+            return -1;
+        }
+        reindex();
         return mRowForUrl.value(url, -1);
     }
 
-    void removeAt(int row)
+    /**
+     * Removes @a count rows starting at @a first. Rows after them are not
+     * reindexed right away: this is done once, on the next lookup which
+     * needs it.
+     */
+    void removeRows(int first, int count)
     {
-        KFileItem item = mList.takeAt(row);
-        mRowForUrl.remove(item.url());
-
-        // Decrease row value for all urls after the one we removed
-        // ("row" now points to the item after the one we removed since we used takeAt)
-        const int count = mList.count();
-        for (; row < count; ++row) {
-            QUrl url = mList.at(row).url();
-            mRowForUrl[url]--;
+        for (int row = first; row < first + count; ++row) {
+            mRowForUrl.remove(mList.at(row).url());
         }
+        mList.erase(mList.begin() + first, mList.begin() + first + count);
+        mIndexedRowCount = qMin(mIndexedRowCount, first);
     }
 
     void addItem(const KFileItem& item)
     {
-        mRowForUrl.insert(item.url(), mList.count());
+        const int row = mList.count();
+        mRowForUrl.insert(item.url(), row);
         mList.append(item);
+        if (mIndexedRowCount == row) {
+            ++mIndexedRowCount;
+        }
     }
 
     void clear()
     {
         mRowForUrl.clear();
         mList.clear();
+        mIndexedRowCount = 0;
+        mPendingItems.clear();
+        mPendingUrls.clear();
+        mPendingDirs.clear();
+        mListedDirs.clear();
+        mInsertTimer->stop();
+        mWatchedDirs.clear();
+        mDirtyDirs.clear();
+        mRescannedDirs.clear();
+        mRescanTimer->stop();
+    }
+
+    bool isListing() const
+    {
+        if (mScanner) {
+            return mScanner->isScanning();
+        }
+        return !mPendingDirs.isEmpty() || !mListedDirs.isEmpty();
+    }
+
+    bool containsFile(const QUrl& url) const
+    {
+        return mPendingUrls.contains(url) || rowForUrl(url) != -1;
+    }
+
+    void listPendingDirs()
+    {
+        while (!mPendingDirs.isEmpty() && mListedDirs.count() < MAX_CONCURRENT_LISTINGS) {
+            const QUrl url = mPendingDirs.dequeue();
+            LOG("Listing" << url);
+            mListedDirs.insert(url);
+            mDirLister->openUrl(url, KDirLister::Keep);
+        }
     }
 
     // RecursiveDirModel can only access mList through this read-only getter.
@@ -77,29 +190,46 @@ struct RecursiveDirModelPrivate {
 
 private:
     KFileItemList mList;
-    QHash<QUrl, int> mRowForUrl;
+    // Only entries for rows below mIndexedRowCount are guaranteed to be
+    // up to date
+    mutable QHash<QUrl, int> mRowForUrl;
+    mutable int mIndexedRowCount;
+
+    void reindex() const
+    {
+        LOG("Reindexing from" << mIndexedRowCount);
+        const int count = mList.count();
+        for (int row = mIndexedRowCount; row < count; ++row) {
+            mRowForUrl.insert(mList.at(row).url(), row);
+        }
+        mIndexedRowCount = count;
+    }
 };
 
 RecursiveDirModel::RecursiveDirModel(QObject* parent)
 : QAbstractListModel(parent)
 , d(new RecursiveDirModelPrivate)
 {
-    d->mDirLister = new KDirLister(this);
-    connect(d->mDirLister, &KDirLister::itemsAdded, this, &RecursiveDirModel::slotItemsAdded);
-    connect(d->mDirLister, &KDirLister::itemsDeleted, this, &RecursiveDirModel::slotItemsDeleted);
-    connect(d->mDirLister, static_cast<void (KDirLister::*)()>(&KDirLister::completed), this, &RecursiveDirModel::completed);
-    connect(d->mDirLister, static_cast<void (KDirLister::*)()>(&KDirLister::clear), this, &RecursiveDirModel::slotCleared);
-    connect(d->mDirLister, static_cast<void (KDirLister::*)(const QUrl &)>(&KDirLister::clear), this, &RecursiveDirModel::slotDirCleared);
+    d->mInsertTimer = new QTimer(this);
+    d->mInsertTimer->setSingleShot(true);
+    d->mInsertTimer->setInterval(INSERT_DELAY);
+    connect(d->mInsertTimer, &QTimer::timeout, this, &RecursiveDirModel::insertPendingItems);
+
+    d->mRescanTimer = new QTimer(this);
+    d->mRescanTimer->setSingleShot(true);
+    d->mRescanTimer->setInterval(RESCAN_DELAY);
+    connect(d->mRescanTimer, &QTimer::timeout, this, &RecursiveDirModel::rescanDirtyDirs);
 }
 
 RecursiveDirModel::~RecursiveDirModel()
 {
+    delete d->mScanner;
     delete d;
 }
 
 QUrl RecursiveDirModel::url() const
 {
-    return d->mDirLister->url();
+    return d->mUrl;
 }
 
 void RecursiveDirModel::setUrl(const QUrl &url)
@@ -107,9 +237,48 @@ void RecursiveDirModel::setUrl(const QUrl &url)
     beginResetModel();
     d->clear();
     endResetModel();
+    d->mUrl = url;
+
+    delete d->mDirLister;
+    d->mDirLister = 0;
+    delete d->mScanner;
+    d->mScanner = 0;
+    delete d->mDirWatch;
+    d->mDirWatch = 0;
+
+    if (url.isLocalFile() && d->mLocalDirScannerEnabled) {
+        d->mScanner = new LocalDirScanner(this);
+        connect(d->mScanner, &LocalDirScanner::itemsFound, this, &RecursiveDirModel::slotItemsFound);
+        connect(d->mScanner, &LocalDirScanner::dirScanned, this, &RecursiveDirModel::slotDirScanned);
+        connect(d->mScanner, &LocalDirScanner::finished, this, &RecursiveDirModel::slotScanFinished);
+        d->mDirWatch = new KDirWatch(this);
+        connect(d->mDirWatch, &KDirWatch::dirty, this, &RecursiveDirModel::slotDirDirty);
+        d->mScanner->scan(url, true /* recursive */);
+        return;
+    }
+
+    d->mDirLister = new KDirLister(this);
+    connect(d->mDirLister, &KDirLister::itemsAdded, this, &RecursiveDirModel::slotItemsAdded);
+    connect(d->mDirLister, &KDirLister::itemsDeleted, this, &RecursiveDirModel::slotItemsDeleted);
+    connect(d->mDirLister, static_cast<void (KDirLister::*)(const QUrl &)>(&KDirLister::completed), this, &RecursiveDirModel::slotDirListed);
+    connect(d->mDirLister, static_cast<void (KDirLister::*)(const QUrl &)>(&KDirLister::canceled), this, &RecursiveDirModel::slotDirListed);
+    connect(d->mDirLister, static_cast<void (KDirLister::*)()>(&KDirLister::clear), this, &RecursiveDirModel::slotCleared);
+    connect(d->mDirLister, static_cast<void (KDirLister::*)(const QUrl &)>(&KDirLister::clear), this, &RecursiveDirModel::slotDirCleared);
+    d->mListedDirs.insert(url);
     d->mDirLister->openUrl(url);
 }
 
+void RecursiveDirModel::setLocalDirScannerEnabled(bool enabled)
+{
+    d->mLocalDirScannerEnabled = enabled;
+}
+
+QModelIndex RecursiveDirModel::indexForUrl(const QUrl& url) const
+{
+    const int row = d->rowForUrl(url);
+    return row == -1 ? QModelIndex() : index(row, 0);
+}
+
 int RecursiveDirModel::rowCount(const QModelIndex& parent) const
 {
     if (parent.isValid()) {
@@ -143,49 +312,218 @@ QVariant RecursiveDirModel::data(const QModelIndex& index, int role) const
     return QVariant();
 }
 
+void RecursiveDirModel::addPendingItem(const KFileItem& item)
+{
+    const QUrl url = item.url();
+    if (d->containsFile(url)) {
+        return;
+    }
+    d->mPendingItems << item;
+    d->mPendingUrls.insert(url);
+    if (!d->mInsertTimer->isActive()) {
+        d->mInsertTimer->start();
+    }
+}
+
 void RecursiveDirModel::slotItemsAdded(const QUrl&, const KFileItemList& newList)
 {
-    QList<QUrl> dirUrls;
-    KFileItemList fileList;
+    Q_FOREACH(const KFileItem& item, newList) {
+        const QUrl url = item.url();
+        if (item.isFile()) {
+            addPendingItem(item);
+        } else if (!d->mListedDirs.contains(url) && !d->mPendingDirs.contains(url)) {
+            d->mPendingDirs.enqueue(url);
+        }
+    }
+    d->listPendingDirs();
+}
+
+void RecursiveDirModel::slotItemsFound(const QUrl& dirUrl, const KFileItemList& newList)
+{
+    QHash<QUrl, QSet<QUrl> >::Iterator rescanIt = d->mRescannedDirs.find(normalizedDirUrl(dirUrl));
+    const bool isRescan = rescanIt != d->mRescannedDirs.end();
     Q_FOREACH(const KFileItem& item, newList) {
         if (item.isFile()) {
-            if (d->rowForUrl(item.url()) == -1) {
-                fileList << item;
+            addPendingItem(item);
+            if (isRescan) {
+                rescanIt.value().insert(item.url());
             }
-        } else {
-            dirUrls << item.url();
+        } else if (isRescan) {
+            // Subdirs of a first scan are scanned by the scanner itself, but
+            // a rescan is not recursive: new subdirs must be scanned here
+            const QUrl url = normalizedDirUrl(item.url());
+            if (!d->mWatchedDirs.contains(url)) {
+                d->mScanner->scan(url, true /* recursive */);
+            }
+        }
+    }
+}
+
+void RecursiveDirModel::slotDirScanned(const QUrl& dirUrl)
+{
+    const QUrl url = normalizedDirUrl(dirUrl);
+    if (!d->mWatchedDirs.contains(url) && QFileInfo(url.toLocalFile()).isDir()) {
+        d->mWatchedDirs.insert(url);
+        d->mDirWatch->addDir(url.toLocalFile());
+    }
+    if (!d->mRescannedDirs.contains(url)) {
+        return;
+    }
+
+    // Forget the files and subdirs which are gone
+    const QSet<QUrl> foundUrls = d->mRescannedDirs.take(url);
+    KFileItemList pendingItems;
+    Q_FOREACH(const KFileItem& item, d->mPendingItems) {
+        if (parentDirUrl(item.url()) == url && !foundUrls.contains(item.url())) {
+            pendingItems << item;
+        }
+    }
+    removePendingItems(pendingItems);
+
+    QList<int> rows;
+    const KFileItemList& list = d->list();
+    for (int row = 0; row < list.count(); ++row) {
+        const QUrl itemUrl = list.at(row).url();
+        if (parentDirUrl(itemUrl) == url && !foundUrls.contains(itemUrl)) {
+            rows << row;
+        }
+    }
+    removeRowList(rows);
+
+    Q_FOREACH(const QUrl& watchedUrl, d->mWatchedDirs) {
+        if (parentDirUrl(watchedUrl) == url && !QFileInfo(watchedUrl.toLocalFile()).isDir()) {
+            LOG("Dir is gone:" << watchedUrl);
+            slotDirCleared(watchedUrl);
+            Q_FOREACH(const QUrl& subDirUrl, d->mWatchedDirs) {
+                if (subDirUrl == watchedUrl || watchedUrl.isParentOf(subDirUrl)) {
+                    d->mWatchedDirs.remove(subDirUrl);
+                    d->mDirtyDirs.remove(subDirUrl);
+                    d->mDirWatch->removeDir(subDirUrl.toLocalFile());
+                }
+            }
+        }
+    }
+
+    if (!d->mDirtyDirs.isEmpty()) {
+        d->mRescanTimer->start();
+    }
+}
+
+void RecursiveDirModel::slotScanFinished()
+{
+    insertPendingItems();
+    emit completed();
+}
+
+void RecursiveDirModel::slotDirDirty(const QString& path)
+{
+    QUrl url = normalizedDirUrl(QUrl::fromLocalFile(path));
+    if (!d->mWatchedDirs.contains(url)) {
+        // A file inside a watched dir
+        url = parentDirUrl(url);
+        if (!d->mWatchedDirs.contains(url)) {
+            return;
+        }
+    }
+    d->mDirtyDirs.insert(url);
+    if (!d->mRescanTimer->isActive()) {
+        d->mRescanTimer->start();
+    }
+}
+
+void RecursiveDirModel::rescanDirtyDirs()
+{
+    Q_FOREACH(const QUrl& url, d->mDirtyDirs) {
+        // Dirs which are being rescanned are rescanned again once done
+        if (d->mRescannedDirs.contains(url)) {
+            continue;
         }
+        LOG("Rescanning" << url);
+        d->mDirtyDirs.remove(url);
+        d->mRescannedDirs.insert(url, QSet<QUrl>());
+        d->mScanner->scan(url, false /* recursive */);
     }
+}
+
+void RecursiveDirModel::insertPendingItems()
+{
+    d->mInsertTimer->stop();
+    if (d->mPendingItems.isEmpty()) {
+        return;
+    }
+    const int first = d->list().count();
+    beginInsertRows(QModelIndex(), first, first + d->mPendingItems.count() - 1);
+    Q_FOREACH(const KFileItem& item, d->mPendingItems) {
+        d->addItem(item);
+    }
+    d->mPendingItems.clear();
+    d->mPendingUrls.clear();
+    endInsertRows();
+}
+
+void RecursiveDirModel::slotDirListed(const QUrl& url)
+{
+    d->mListedDirs.remove(url);
+    d->listPendingDirs();
+    if (!d->isListing()) {
+        insertPendingItems();
+        emit completed();
+    }
+}
 
-    if (!fileList.isEmpty()) {
-        beginInsertRows(QModelIndex(), d->list().count(), d->list().count() + fileList.count());
-        Q_FOREACH(const KFileItem& item, fileList) {
-            d->addItem(item);
+void RecursiveDirModel::removeRowList(QList<int> rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    // Remove ranges of consecutive rows, starting from the end so that the
+    // remaining rows do not move
+    qSort(rows);
+    int last = rows.last();
+    int first = last;
+    for (int pos = rows.count() - 2; pos >= -1; --pos) {
+        if (pos >= 0 && rows.at(pos) == first - 1) {
+            first = rows.at(pos);
+            continue;
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        d->removeRows(first, last - first + 1);
+        endRemoveRows();
+        if (pos >= 0) {
+            last = first = rows.at(pos);
         }
-        endInsertRows();
     }
+}
 
-    Q_FOREACH(const QUrl &url, dirUrls) {
-        d->mDirLister->openUrl(url, KDirLister::Keep);
+void RecursiveDirModel::removePendingItems(const KFileItemList& list)
+{
+    Q_FOREACH(const KFileItem& item, list) {
+        if (d->mPendingUrls.remove(item.url())) {
+            d->mPendingItems.removeOne(item);
+        }
     }
 }
 
 void RecursiveDirModel::slotItemsDeleted(const KFileItemList& list)
 {
+    QList<int> rows;
     Q_FOREACH(const KFileItem& item, list) {
         if (item.isDir()) {
             continue;
         }
+        if (d->mPendingUrls.contains(item.url())) {
+            removePendingItems(KFileItemList() << item);
+            continue;
+        }
         int row = d->rowForUrl(item.url());
         if (row == -1) {
             qWarning() << "Received itemsDeleted for an unknown item: this should not happen!";
             GV_FATAL_FAILS;
             continue;
         }
-        beginRemoveRows(QModelIndex(), row, row);
-        d->removeAt(row);
-        endRemoveRows();
+        rows << row;
     }
+    removeRowList(rows);
 }
 
 void RecursiveDirModel::slotCleared()
@@ -200,15 +538,22 @@ void RecursiveDirModel::slotCleared()
 
 void RecursiveDirModel::slotDirCleared(const QUrl &dirUrl)
 {
-    int row;
-    for (row = d->list().count() - 1; row >= 0; --row) {
-        const QUrl url = d->list().at(row).url();
-        if (dirUrl.isParentOf(url)) {
-            beginRemoveRows(QModelIndex(), row, row);
-            d->removeAt(row);
-            endRemoveRows();
+    KFileItemList pendingItems;
+    Q_FOREACH(const KFileItem& item, d->mPendingItems) {
+        if (dirUrl.isParentOf(item.url())) {
+            pendingItems << item;
+        }
+    }
+    removePendingItems(pendingItems);
+
+    QList<int> rows;
+    const KFileItemList& list = d->list();
+    for (int row = 0; row < list.count(); ++row) {
+        if (dirUrl.isParentOf(list.at(row).url())) {
+            rows << row;
         }
     }
+    removeRowList(rows);
 }
 
 } // namespace
@@ -38,6 +38,14 @@ namespace Gwenview
 struct RecursiveDirModelPrivate;
 /**
  * Recursively list content of a dir
+ *
+ * Local dirs are listed with LocalDirScanner and watched with KDirWatch,
+ * changed dirs are scanned again. Other dirs, and local dirs when
+ * setLocalDirScannerEnabled(false) has been called, are listed with
+ * KDirLister, at most a few at the same time, the others are queued.
+ *
+ * Files are inserted in batches, and removed files are removed by ranges of
+ * consecutive rows.
  */
 class GWENVIEWLIB_EXPORT RecursiveDirModel : public QAbstractListModel
 {
@@ -49,6 +57,18 @@ public:
     QUrl url() const;
     void setUrl(const QUrl&);
 
+    /**
+     * Defaults to true. When false, local dirs are listed with KDirLister,
+     * like remote ones. Takes effect on the next call to setUrl().
+     */
+    void setLocalDirScannerEnabled(bool);
+
+    /**
+     * Returns the index of the item for @a url, or an invalid index if there
+     * is no such item. This is a hash lookup.
+     */
+    QModelIndex indexForUrl(const QUrl&) const;
+
     int rowCount(const QModelIndex&) const Q_DECL_OVERRIDE;
     QVariant data(const QModelIndex&, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
 
@@ -60,8 +80,19 @@ private Q_SLOTS:
     void slotItemsDeleted(const KFileItemList&);
     void slotDirCleared(const QUrl&);
     void slotCleared();
+    void slotDirListed(const QUrl&);
+    void slotItemsFound(const QUrl& dirUrl, const KFileItemList&);
+    void slotDirScanned(const QUrl&);
+    void slotScanFinished();
+    void slotDirDirty(const QString&);
+    void rescanDirtyDirs();
+    void insertPendingItems();
 private:
     RecursiveDirModelPrivate* const d;
+
+    void addPendingItem(const KFileItem&);
+    void removeRowList(QList<int> rows);
+    void removePendingItems(const KFileItemList&);
 };
 
 } // namespace
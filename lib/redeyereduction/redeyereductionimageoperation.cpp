@@ -25,8 +25,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <math.h>
 
 // Qt
+#include <QColor>
 #include <QImage>
-#include <QPainter>
+#include <QVector>
 #include <QDebug>
 
 // KDE
@@ -38,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/documentjob.h"
 #include "document/abstractdocumenteditor.h"
 #include "paintutils.h"
+#include "undoimagedata.h"
 
 namespace Gwenview
 {
@@ -67,7 +69,7 @@ private:
 struct RedEyeReductionImageOperationPrivate
 {
     QRectF mRectF;
-    QImage mOriginalImage;
+    QScopedPointer<UndoImageData> mUndoData;
 };
 
 RedEyeReductionImageOperation::RedEyeReductionImageOperation(const QRectF& rectF)
@@ -84,9 +86,9 @@ RedEyeReductionImageOperation::~RedEyeReductionImageOperation()
 
 void RedEyeReductionImageOperation::redo()
 {
-    QImage img = document()->image();
     QRect rect = PaintUtils::containingRect(d->mRectF);
-    d->mOriginalImage = img.copy(rect);
+    d->mUndoData.reset(new UndoImageData(document().data()));
+    d->mUndoData->storeRect(document()->image(), rect);
     redoAsDocumentJob(new RedEyeReductionJob(d->mRectF));
 }
 
@@ -96,35 +98,101 @@ void RedEyeReductionImageOperation::undo()
         qWarning() << "!document->editor()";
         return;
     }
-    QImage img = document()->image();
-    {
-        QPainter painter(&img);
-        painter.setCompositionMode(QPainter::CompositionMode_Source);
-        QRect rect = PaintUtils::containingRect(d->mRectF);
-        painter.drawImage(rect.topLeft(), d->mOriginalImage);
-    }
-    document()->editor()->setImage(img);
+    document()->editor()->setImage(d->mUndoData->restore(document()->image()));
 }
 
 /**
  * This code is inspired from code found in a Paint.net plugin:
  * http://paintdotnet.forumer.com/viewtopic.php?f=27&t=26193&p=205954&hilit=red+eye#p205954
+ *
+ * It used to go through QColor for each pixel. It now computes the same hue
+ * and saturation with integers, so that the output is unchanged:
+ * - Hue: QColor rounds hue * 100 computed with floating point. The exact
+ *   value is a fraction whose denominator is the difference between the
+ *   biggest and the smallest components. It is never close enough to a
+ *   rounding boundary for floating point errors to change the integer hue.
+ * - Saturation: it only depends on the biggest and the smallest
+ *   components, so it is read from a table filled by QColor itself.
  */
-inline qreal computeRedEyeAlpha(const QColor& src)
+class SaturationTable
+{
+public:
+    SaturationTable()
+    {
+        for (int max = 0; max < 256; ++max) {
+            for (int min = 0; min <= max; ++min) {
+                int hue, sat, value;
+                QColor(max, min, min).getHsv(&hue, &sat, &value);
+                mTable[max][min] = sat;
+            }
+        }
+    }
+
+    int operator()(int max, int min) const
+    {
+        return mTable[max][min];
+    }
+
+private:
+    uchar mTable[256][256];
+};
+
+static const SaturationTable& saturationTable()
 {
-    int hue, sat, value;
-    src.getHsv(&hue, &sat, &value);
+    static SaturationTable sTable;
+    return sTable;
+}
 
-    qreal axs = 1.0;
-    if (hue > 259) {
-        static const Ramp ramp(30, 35, 0., 1.);
-        axs = ramp(sat);
+/**
+ * Same result as QColor::getHsv(), but only for the hue. Returns -1 for
+ * achromatic colors.
+ */
+inline int computeHue(int r, int g, int b, int max, int delta)
+{
+    if (delta == 0) {
+        return -1;
+    }
+    // hue * 100 * delta
+    int hue100 = 0;
+    if (r == max) {
+        hue100 = 6000 * (g - b);
+        if (hue100 < 0) {
+            hue100 += 36000 * delta;
+        }
+    } else if (g == max) {
+        hue100 = 12000 * delta + 6000 * (b - r);
     } else {
-        const Ramp ramp(hue * 2 + 29, hue * 2 + 40, 0., 1.);
-        axs = ramp(sat);
+        hue100 = 24000 * delta + 6000 * (r - g);
     }
+    // Rounds hue * 100 like qRound()
+    hue100 = (2 * hue100 + delta) / (2 * delta);
+    return hue100 / 100;
+}
 
-    return qBound(qreal(0.), src.alphaF() * axs, qreal(1.));
+inline qreal computeRedEyeAlpha(const SaturationTable& saturationTable, QRgb src)
+{
+    const int r = qRed(src);
+    const int g = qGreen(src);
+    const int b = qBlue(src);
+    const int max = qMax(r, qMax(g, b));
+    const int min = qMin(r, qMin(g, b));
+    const int hue = computeHue(r, g, b, max, max - min);
+    const int sat = saturationTable(max, min);
+
+    // Same as Ramp(30, 35, 0, 1) or Ramp(hue * 2 + 29, hue * 2 + 40, 0, 1)
+    // applied to sat. The source alpha does not need to be taken into
+    // account: QColor ignores it.
+    static const qreal k1 = 1. / 5;
+    static const qreal k2 = 1. / 11;
+    const int x1 = hue > 259 ? 30 : hue * 2 + 29;
+    const int x2 = hue > 259 ? 35 : hue * 2 + 40;
+    if (sat < x1) {
+        return 0.;
+    }
+    if (sat > x2) {
+        return 1.;
+    }
+    return (sat - x1) * (hue > 259 ? k1 : k2);
 }
 
 void RedEyeReductionImageOperation::apply(QImage* img, const QRectF& rectF)
@@ -133,32 +201,56 @@ void RedEyeReductionImageOperation::apply(QImage* img, const QRectF& rectF)
     const qreal radius = rectF.width() / 2;
     const qreal centerX = rectF.x() + radius;
     const qreal centerY = rectF.y() + radius;
-    const Ramp radiusRamp(
-        qMin(qreal(radius * 0.7), qreal(radius - 1)), radius,
-        qreal(1.), qreal(0.));
-
-    uchar* line = img->scanLine(rect.top()) + rect.left() * 4;
-    for (int y = rect.top(); y < rect.bottom(); ++y, line += img->bytesPerLine()) {
-        QRgb* ptr = (QRgb*)line;
-
-        for (int x = rect.left(); x < rect.right(); ++x, ++ptr) {
-            const qreal currentRadius = sqrt(pow(y - centerY, 2) + pow(x - centerX, 2));
-            qreal alpha = radiusRamp(currentRadius);
-            if (qFuzzyCompare(alpha, 0)) {
+    const qreal innerRadius = qMin(qreal(radius * 0.7), qreal(radius - 1));
+    const Ramp radiusRamp(innerRadius, radius, qreal(1.), qreal(0.));
+
+    // Only compute the radius of pixels close to the edge of the ramp. The
+    // margins make sure pixels get the same alpha as if the radius had been
+    // computed.
+    const qreal innerSquare = innerRadius > 0 ? innerRadius * innerRadius * (1 - 1e-9) : qreal(-1.);
+    const qreal outerSquare = radius * radius * (1 + 1e-9);
+
+    // Like the rect, the last row and the last column are left untouched
+    const int left = qMax(rect.left(), 0);
+    const int right = qMin(rect.right(), img->width());
+    const int top = qMax(rect.top(), 0);
+    const int bottom = qMin(rect.bottom(), img->height());
+    if (left >= right || top >= bottom) {
+        return;
+    }
+
+    const SaturationTable& table = saturationTable();
+    QVector<qreal> dxSquares(right - left);
+    for (int x = left; x < right; ++x) {
+        const qreal dx = x - centerX;
+        dxSquares[x - left] = dx * dx;
+    }
+
+    for (int y = top; y < bottom; ++y) {
+        QRgb* ptr = reinterpret_cast<QRgb*>(img->scanLine(y)) + left;
+        const qreal dy = y - centerY;
+        const qreal dySquare = dy * dy;
+
+        for (int x = left; x < right; ++x, ++ptr) {
+            const qreal square = dySquare + dxSquares[x - left];
+            if (square > outerSquare) {
                 continue;
             }
+            qreal alpha = 1.;
+            if (square >= innerSquare) {
+                alpha = radiusRamp(sqrt(square));
+                if (qFuzzyCompare(alpha, 0)) {
+                    continue;
+                }
+            }
 
-            const QColor src(*ptr);
-            alpha *= computeRedEyeAlpha(src);
-            int r = src.red();
-            int g = src.green();
-            int b = src.blue();
-            QColor dst;
+            const QRgb src = *ptr;
+            alpha *= computeRedEyeAlpha(table, src);
+            const int r = qRed(src);
+            const int g = qGreen(src);
+            const int b = qBlue(src);
             // Replace red with green, and blend according to alpha
-            dst.setRed(int((1 - alpha) * r + alpha * g));
-            dst.setGreen(g);
-            dst.setBlue(b);
-            *ptr = dst.rgba();
+            *ptr = qRgb(int((1 - alpha) * r + alpha * g), g, b);
         }
     }
 }
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Qt
 #include <QGraphicsSceneMouseEvent>
+#include <QImage>
 #include <QPainter>
 #include <QPushButton>
 #include <QRect>
@@ -68,6 +69,12 @@ struct RedEyeReductionToolPrivate
     int mDiameter;
     RedEyeReductionWidget* mToolWidget;
 
+    // The corrected area shown while adjusting, only recomputed when the eye
+    // moves or is resized or when the image changes, not each time the view
+    // is repainted
+    QRectF mPreviewRectF;
+    QImage mPreviewImage;
+
     void setupToolWidget()
     {
         mToolWidget = new RedEyeReductionWidget;
@@ -98,6 +105,8 @@ RedEyeReductionTool::RedEyeReductionTool(RasterImageView* view)
     d->mStatus = NotSet;
     d->setupToolWidget();
 
+    connect(view->document().data(), SIGNAL(imageRectUpdated(QRect)),
+            SLOT(slotImageRectUpdated()));
     view->document()->startLoadingFullImage();
 }
 
@@ -117,17 +126,20 @@ void RedEyeReductionTool::paint(QPainter* painter)
     imageView()->document()->waitUntilLoaded();
 
     QRect docRect = PaintUtils::containingRect(docRectF);
-    QImage img = imageView()->document()->image().copy(docRect);
     QRectF imgRectF(
         docRectF.left() - docRect.left(),
         docRectF.top()  - docRect.top(),
         docRectF.width(),
         docRectF.height()
     );
-    RedEyeReductionImageOperation::apply(&img, imgRectF);
+    if (docRectF != d->mPreviewRectF) {
+        d->mPreviewImage = imageView()->document()->image().copy(docRect);
+        RedEyeReductionImageOperation::apply(&d->mPreviewImage, imgRectF);
+        d->mPreviewRectF = docRectF;
+    }
 
     const QRectF viewRectF = imageView()->mapToView(docRectF);
-    painter->drawImage(viewRectF, img, imgRectF);
+    painter->drawImage(viewRectF, d->mPreviewImage, imgRectF);
 }
 
 void RedEyeReductionTool::mousePressEvent(QGraphicsSceneMouseEvent* event)
@@ -174,9 +186,18 @@ void RedEyeReductionTool::slotApplyClicked()
     emit imageOperationRequested(op);
 
     d->mStatus = NotSet;
+    d->mPreviewRectF = QRectF();
+    d->mPreviewImage = QImage();
     d->mToolWidget->showNotSetPage();
 }
 
+void RedEyeReductionTool::slotImageRectUpdated()
+{
+    // Undo, redo or another edit: the preview shows outdated pixels
+    d->mPreviewRectF = QRectF();
+    d->mPreviewImage = QImage();
+}
+
 void RedEyeReductionTool::setDiameter(int value)
 {
     d->mDiameter = value;
@@ -66,6 +66,7 @@ Q_SIGNALS:
 private Q_SLOTS:
     void setDiameter(int);
     void slotApplyClicked();
+    void slotImageRectUpdated();
 
 private:
     RedEyeReductionToolPrivate* const d;
@@ -0,0 +1,367 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "remotefilecache.h"
+
+// System
+#include <sys/types.h>
+#include <utime.h>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+#include <lib/taskscheduler.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Temporary download files which have not been modified for this long, in
+// seconds, belong to a download which has been interrupted
+static const int STALE_DOWNLOAD_DELAY = 3600;
+
+inline qint64 getRemoteCacheSize()
+{
+    // In megabytes
+    return qint64(envInt("GV_REMOTE_CACHE_SIZE", 512)) * 1024 * 1024;
+}
+
+struct RemoteFileCachePrivate;
+
+/**
+ * Writes the data passed to RemoteFileCache::insert() in a background task
+ */
+struct RemoteFileCacheWrite
+{
+    RemoteFileCachePrivate* mD;
+    QUrl mUrl;
+    QString mName;
+    QByteArray mData;
+    QFuture<void> mFuture;
+
+    void run();
+};
+
+struct RemoteFileCachePrivate
+{
+    mutable QMutex mMutex;
+    QString mDir;
+    qint64 mMaximumSize;
+    qint64 mSize;
+    // Entry names, least recently used first
+    QList<QString> mNames;
+    QHash<QString, qint64> mSizeForName;
+    // Number of leases of each entry. Leased entries are never evicted.
+    QHash<QString, int> mLeaseCountForName;
+    QList<RemoteFileCacheWrite*> mPendingWrites;
+
+    static QString nameForUrl(const QUrl& url, time_t mtime, KIO::filesize_t size)
+    {
+        QCryptographicHash md5(QCryptographicHash::Md5);
+        md5.addData(url.adjusted(QUrl::RemovePassword).toEncoded());
+        md5.addData(QByteArray::number(qlonglong(mtime)));
+        md5.addData(QByteArray::number(qulonglong(size)));
+        return QString::fromLatin1(md5.result().toHex());
+    }
+
+    static bool isCacheable(const QUrl& url, time_t mtime)
+    {
+        // Without a modification time we cannot tell if the cached copy is
+        // still valid
+        return url.isValid() && !url.isLocalFile() && mtime > 0;
+    }
+
+    QString pathForName(const QString& name) const
+    {
+        return mDir + '/' + name;
+    }
+
+    void scan()
+    {
+        if (!QDir().mkpath(mDir)) {
+            qWarning() << "Could not create remote file cache dir" << mDir;
+            return;
+        }
+        // A crash or a kill leaves the temporary file of a download behind.
+        // Running downloads, maybe from another instance, keep writing to
+        // theirs.
+        const QDateTime staleDateTime = QDateTime::currentDateTime().addSecs(-STALE_DOWNLOAD_DELAY);
+        const QFileInfoList downloadList = QDir(mDir).entryInfoList(
+            QStringList() << QStringLiteral(".download-*"), QDir::Files | QDir::Hidden);
+        Q_FOREACH(const QFileInfo& info, downloadList) {
+            if (info.lastModified() < staleDateTime) {
+                LOG("Removing stale download" << info.fileName());
+                QFile::remove(info.filePath());
+            }
+        }
+
+        // Oldest first. Temporary files are hidden, so they are skipped.
+        const QFileInfoList list = QDir(mDir).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+        Q_FOREACH(const QFileInfo& info, list) {
+            const QString name = info.fileName();
+            mNames << name;
+            mSizeForName.insert(name, info.size());
+            mSize += info.size();
+        }
+        LOG("Found" << mNames.count() << "entries using" << mSize << "bytes");
+    }
+
+    void touch(const QString& name)
+    {
+        mNames.removeOne(name);
+        mNames.append(name);
+        // Keep the order for the next sessions
+        utime(QFile::encodeName(pathForName(name)).constData(), 0);
+    }
+
+    void add(const QString& name, qint64 size)
+    {
+        remove(name);
+        mNames.append(name);
+        mSizeForName.insert(name, size);
+        mSize += size;
+        evict();
+    }
+
+    void remove(const QString& name)
+    {
+        if (!mSizeForName.contains(name)) {
+            return;
+        }
+        mNames.removeOne(name);
+        mSize -= mSizeForName.take(name);
+    }
+
+    void evict()
+    {
+        // Never evict the most recent entry: it is about to be used
+        int idx = 0;
+        while (mSize > mMaximumSize && idx < mNames.count() - 1) {
+            const QString name = mNames.at(idx);
+            if (mLeaseCountForName.contains(name)) {
+                ++idx;
+                continue;
+            }
+            LOG("Evicting" << name);
+            remove(name);
+            QFile::remove(pathForName(name));
+        }
+    }
+
+    bool canStore(qint64 size) const
+    {
+        return size <= mMaximumSize;
+    }
+
+    QString acquire(const QString& name)
+    {
+        ++mLeaseCountForName[name];
+        return pathForName(name);
+    }
+
+    // Must be called with mMutex locked
+    void deleteFinishedWrites()
+    {
+        QList<RemoteFileCacheWrite*>::Iterator it = mPendingWrites.begin();
+        while (it != mPendingWrites.end()) {
+            if ((*it)->mFuture.isFinished()) {
+                delete *it;
+                it = mPendingWrites.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+void RemoteFileCacheWrite::run()
+{
+    QSaveFile file(mD->pathForName(mName));
+    if (!file.open(QIODevice::WriteOnly) || file.write(mData) != mData.size() || !file.commit()) {
+        qWarning() << "Could not store" << mUrl << "in remote file cache:" << file.errorString();
+        return;
+    }
+    LOG("Stored" << mUrl);
+    QMutexLocker locker(&mD->mMutex);
+    mD->add(mName, mData.size());
+}
+
+RemoteFileCache::RemoteFileCache(const QString& dir, qint64 maximumSize)
+: d(new RemoteFileCachePrivate)
+{
+    d->mDir = dir;
+    d->mMaximumSize = maximumSize;
+    d->mSize = 0;
+    d->scan();
+    QMutexLocker locker(&d->mMutex);
+    d->evict();
+}
+
+RemoteFileCache::~RemoteFileCache()
+{
+    waitForPendingWrites();
+    delete d;
+}
+
+RemoteFileCache* RemoteFileCache::instance()
+{
+    // Create the scheduler first, so that it is still there when the cache
+    // is destroyed
+    TaskScheduler::instance();
+    static RemoteFileCache cache(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/remote-files"),
+        getRemoteCacheSize());
+    return &cache;
+}
+
+QString RemoteFileCache::acquire(const QUrl& url, time_t mtime, KIO::filesize_t size)
+{
+    if (!RemoteFileCachePrivate::isCacheable(url, mtime)) {
+        return QString();
+    }
+    const QString name = RemoteFileCachePrivate::nameForUrl(url, mtime, size);
+    QMutexLocker locker(&d->mMutex);
+    if (!d->mSizeForName.contains(name)) {
+        return QString();
+    }
+    if (!QFile::exists(d->pathForName(name))) {
+        // Removed behind our back
+        d->remove(name);
+        return QString();
+    }
+    LOG("Hit for" << url);
+    d->touch(name);
+    return d->acquire(name);
+}
+
+void RemoteFileCache::release(const QString& path)
+{
+    const QString name = QFileInfo(path).fileName();
+    QMutexLocker locker(&d->mMutex);
+    QHash<QString, int>::Iterator it = d->mLeaseCountForName.find(name);
+    GV_RETURN_IF_FAIL(it != d->mLeaseCountForName.end());
+    if (--it.value() == 0) {
+        d->mLeaseCountForName.erase(it);
+        // The entry may have been kept over the maximum size
+        d->evict();
+    }
+}
+
+QFuture<void> RemoteFileCache::insert(const QUrl& url, time_t mtime, KIO::filesize_t size, const QByteArray& data)
+{
+    if (!RemoteFileCachePrivate::isCacheable(url, mtime) || !d->canStore(data.size())) {
+        return QFuture<void>();
+    }
+    RemoteFileCacheWrite* write = new RemoteFileCacheWrite;
+    write->mD = d;
+    write->mUrl = url;
+    write->mName = RemoteFileCachePrivate::nameForUrl(url, mtime, size);
+    write->mData = data;
+    // Cache writes are low priority background writes, like thumbnail ones
+    write->mFuture = TaskScheduler::instance()->run(TaskScheduler::OffscreenThumbnail, write, &RemoteFileCacheWrite::run);
+    QMutexLocker locker(&d->mMutex);
+    d->deleteFinishedWrites();
+    d->mPendingWrites << write;
+    return write->mFuture;
+}
+
+QString RemoteFileCache::insertFile(const QUrl& url, time_t mtime, KIO::filesize_t size, const QString& localPath)
+{
+    const qint64 fileSize = QFileInfo(localPath).size();
+    if (!RemoteFileCachePrivate::isCacheable(url, mtime) || !d->canStore(fileSize)) {
+        return QString();
+    }
+    const QString name = RemoteFileCachePrivate::nameForUrl(url, mtime, size);
+    const QString path = d->pathForName(name);
+    QMutexLocker locker(&d->mMutex);
+    QFile::remove(path);
+    if (!QFile::rename(localPath, path)) {
+        qWarning() << "Could not move" << localPath << "to remote file cache";
+        return QString();
+    }
+    // Renaming keeps the modification time of the original
+    utime(QFile::encodeName(path).constData(), 0);
+    LOG("Stored" << url);
+    // Lease it before adding it, so that it cannot be evicted right away
+    d->acquire(name);
+    d->add(name, fileSize);
+    return path;
+}
+
+QString RemoteFileCache::temporaryFileTemplate() const
+{
+    return d->mDir + QStringLiteral("/.download-XXXXXX");
+}
+
+void RemoteFileCache::waitForPendingWrites()
+{
+    QList<QFuture<void> > futures;
+    {
+        QMutexLocker locker(&d->mMutex);
+        Q_FOREACH(RemoteFileCacheWrite* write, d->mPendingWrites) {
+            futures << write->mFuture;
+        }
+    }
+    Q_FOREACH(const QFuture<void>& future, futures) {
+        if (!future.isFinished()) {
+            TaskScheduler::instance()->waitForFinished(future);
+        }
+    }
+    QMutexLocker locker(&d->mMutex);
+    d->deleteFinishedWrites();
+}
+
+qint64 RemoteFileCache::size() const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mSize;
+}
+
+qint64 RemoteFileCache::maximumSize() const
+{
+    return d->mMaximumSize;
+}
+
+} // namespace
@@ -0,0 +1,128 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef REMOTEFILECACHE_H
+#define REMOTEFILECACHE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QFuture>
+#include <QString>
+
+// KDE
+#include <KIO/Global>
+
+// Local
+
+class QByteArray;
+class QUrl;
+
+namespace Gwenview
+{
+
+struct RemoteFileCachePrivate;
+/**
+ * Keeps local copies of remote files, so that showing or thumbnailing them
+ * again does not require transferring them again.
+ *
+ * Entries are keyed by url, modification time and size: a modified remote
+ * file is never served from the cache. The total size of the cache is bounded,
+ * the least recently used entries are removed when it is exceeded. The bound
+ * can be changed with the GV_REMOTE_CACHE_SIZE environment variable (in
+ * megabytes).
+ *
+ * Entries are stored in the user cache dir, so they survive restarts. The
+ * least recently used order is kept in the modification time of the cached
+ * files.
+ *
+ * Paths returned by acquire() and insertFile() are leased: the entry is not
+ * evicted until release() is called for it, so it can safely be read in the
+ * meantime.
+ *
+ * All methods are thread-safe.
+ */
+class GWENVIEWLIB_EXPORT RemoteFileCache
+{
+public:
+    /**
+     * Creates a cache storing its entries in @a dir. Use instance() except
+     * for unit-testing.
+     */
+    RemoteFileCache(const QString& dir, qint64 maximumSize);
+    ~RemoteFileCache();
+
+    static RemoteFileCache* instance();
+
+    /**
+     * Returns the path of the cached copy of @a url, or an empty string if
+     * there is no copy matching @a mtime and @a size. If a path is returned,
+     * it must be released with release().
+     */
+    QString acquire(const QUrl& url, time_t mtime, KIO::filesize_t size);
+
+    /**
+     * Lets the cache evict @a path again
+     */
+    void release(const QString& path);
+
+    /**
+     * Stores @a data as the content of @a url. The file is written by a
+     * background task, the returned future is finished once it is done.
+     */
+    QFuture<void> insert(const QUrl& url, time_t mtime, KIO::filesize_t size, const QByteArray& data);
+
+    /**
+     * Moves the local file @a localPath to the cache, as the content of @a
+     * url. Returns the path of the cached copy, which must be released with
+     * release(), or an empty string if the file could not be stored, in which
+     * case @a localPath is left untouched.
+     *
+     * Moving is only cheap if @a localPath has been created from
+     * temporaryFileTemplate(), other files have to be copied.
+     */
+    QString insertFile(const QUrl& url, time_t mtime, KIO::filesize_t size, const QString& localPath);
+
+    /**
+     * A QTemporaryFile template in the cache dir, for files which are meant
+     * to be passed to insertFile()
+     */
+    QString temporaryFileTemplate() const;
+
+    /**
+     * Blocks until the files passed to insert() have been written
+     */
+    void waitForPendingWrites();
+
+    /**
+     * Total size of the cached files
+     */
+    qint64 size() const;
+
+    qint64 maximumSize() const;
+
+private:
+    Q_DISABLE_COPY(RemoteFileCache)
+    RemoteFileCachePrivate* const d;
+};
+
+} // namespace
+
+#endif /* REMOTEFILECACHE_H */
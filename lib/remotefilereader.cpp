@@ -0,0 +1,157 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "remotefilereader.h"
+
+// Qt
+#include <QPointer>
+#include <QUrl>
+#include <QDebug>
+
+// KDE
+#include <KIO/FileJob>
+
+// Local
+#include <lib/gvdebug.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+struct RemoteFileReaderPrivate
+{
+    QUrl mUrl;
+    QPointer<KIO::FileJob> mJob;
+    QByteArray mData;
+    qint64 mWantedSize;
+    // -1 as long as the protocol did not tell us
+    qint64 mFileSize;
+    bool mStarted;
+    bool mDone;
+    bool mEndReached;
+};
+
+RemoteFileReader::RemoteFileReader(const QUrl& url, QObject* parent)
+: QObject(parent)
+, d(new RemoteFileReaderPrivate)
+{
+    d->mUrl = url;
+    d->mWantedSize = 0;
+    d->mFileSize = -1;
+    d->mStarted = false;
+    d->mDone = false;
+    d->mEndReached = false;
+}
+
+RemoteFileReader::~RemoteFileReader()
+{
+    if (d->mJob) {
+        d->mJob->kill();
+    }
+    delete d;
+}
+
+void RemoteFileReader::readHeader(qint64 size)
+{
+    GV_RETURN_IF_FAIL(!d->mStarted);
+    LOG(d->mUrl << size);
+    d->mStarted = true;
+    d->mWantedSize = size;
+    openFile(d->mUrl);
+}
+
+void RemoteFileReader::openFile(const QUrl& url)
+{
+    d->mJob = KIO::open(url, QIODevice::ReadOnly);
+    d->mJob->addMetaData(QStringLiteral("no-auth-prompt"), QStringLiteral("true"));
+    connect(d->mJob, SIGNAL(open(KIO::Job*)), SLOT(slotOpen(KIO::Job*)));
+    connect(d->mJob, SIGNAL(size(KIO::Job*,KIO::filesize_t)), SLOT(slotSize(KIO::Job*,KIO::filesize_t)));
+    connect(d->mJob, SIGNAL(data(KIO::Job*,QByteArray)), SLOT(slotData(KIO::Job*,QByteArray)));
+    connect(d->mJob, SIGNAL(result(KJob*)), SLOT(slotResult(KJob*)));
+}
+
+void RemoteFileReader::readFile(qint64 size)
+{
+    d->mJob->read(KIO::filesize_t(size));
+}
+
+void RemoteFileReader::closeFile()
+{
+    d->mJob->close();
+}
+
+void RemoteFileReader::slotOpen(KIO::Job*)
+{
+    LOG("");
+    if (d->mFileSize == 0) {
+        d->mEndReached = true;
+        slotData(0, QByteArray());
+        return;
+    }
+    readFile(d->mWantedSize - d->mData.size());
+}
+
+void RemoteFileReader::slotSize(KIO::Job*, KIO::filesize_t size)
+{
+    LOG(size);
+    d->mFileSize = qint64(size);
+}
+
+void RemoteFileReader::slotData(KIO::Job*, const QByteArray& chunk)
+{
+    if (d->mDone) {
+        return;
+    }
+    // An empty chunk means the end of the file has been reached
+    if (chunk.isEmpty()) {
+        d->mEndReached = true;
+    }
+    d->mData.append(chunk);
+    const bool complete = d->mEndReached || (d->mFileSize >= 0 && d->mData.size() >= d->mFileSize);
+    if (!complete && d->mData.size() < d->mWantedSize) {
+        readFile(d->mWantedSize - d->mData.size());
+        return;
+    }
+    LOG("Read" << d->mData.size() << "bytes, complete:" << complete);
+    d->mDone = true;
+    closeFile();
+    emit headerRead(d->mData, complete);
+}
+
+void RemoteFileReader::slotResult(KJob* job)
+{
+    if (d->mDone) {
+        return;
+    }
+    d->mDone = true;
+    LOG("Failed:" << job->errorString());
+    emit failed(job->error() ? job->errorString() : QString());
+}
+
+} // namespace
@@ -0,0 +1,111 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef REMOTEFILEREADER_H
+#define REMOTEFILEREADER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QObject>
+
+// KDE
+#include <KIO/Global>
+
+// Local
+
+class KJob;
+class QUrl;
+
+namespace KIO
+{
+class Job;
+}
+
+namespace Gwenview
+{
+
+/**
+ * Amount of data read from remote files until the image itself is needed. It
+ * is enough to hold the headers and the EXIF data, including the embedded
+ * thumbnail, of most images.
+ */
+const int REMOTE_HEADER_SIZE = 128 * 1024;
+
+struct RemoteFileReaderPrivate;
+/**
+ * Reads the beginning of a file through KIO, without downloading the whole
+ * file. This is enough to find out the kind, the size, the orientation or the
+ * embedded thumbnail of most images.
+ *
+ * The file is read with KIO::open(), so the protocol must support random
+ * access, like file, sftp or smb do. If it does not, failed() is emitted and
+ * the caller should fall back to downloading the file.
+ */
+class GWENVIEWLIB_EXPORT RemoteFileReader : public QObject
+{
+    Q_OBJECT
+public:
+    RemoteFileReader(const QUrl&, QObject* parent = 0);
+    ~RemoteFileReader();
+
+    /**
+     * Starts reading the first @a size bytes of the file
+     */
+    void readHeader(qint64 size);
+
+Q_SIGNALS:
+    /**
+     * Emitted once the data has been read. @a complete is true if @a data is
+     * the whole content of the file.
+     */
+    void headerRead(const QByteArray& data, bool complete);
+
+    void failed(const QString& errorString);
+
+protected:
+    /**
+     * Starts the job reading the file. The job must call slotSize() if it
+     * knows the size of the file, then slotOpen(), slotData() for each read
+     * chunk and slotResult() when it fails. Tests reimplement openFile(),
+     * readFile() and closeFile() to stream data without KIO.
+     */
+    virtual void openFile(const QUrl&);
+
+    /**
+     * Asks the job for at most @a size more bytes
+     */
+    virtual void readFile(qint64 size);
+
+    virtual void closeFile();
+
+protected Q_SLOTS:
+    void slotOpen(KIO::Job*);
+    void slotSize(KIO::Job*, KIO::filesize_t);
+    void slotData(KIO::Job*, const QByteArray&);
+    void slotResult(KJob*);
+
+private:
+    RemoteFileReaderPrivate* const d;
+};
+
+} // namespace
+
+#endif /* REMOTEFILEREADER_H */
@@ -0,0 +1,380 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imageresampler.h"
+
+// System
+#include <math.h>
+
+// Qt
+#include <QImage>
+#include <QList>
+#include <QSize>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/gvdebug.h>
+
+namespace Gwenview
+{
+
+namespace ImageResampler
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Bands smaller than this are not worth a task of their own
+static const int MIN_BAND_PIXELS = 64 * 1024;
+
+static double sinc(double x)
+{
+    if (x == 0.) {
+        return 1.;
+    }
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double bilinearFilter(double x)
+{
+    x = fabs(x);
+    return x < 1. ? 1. - x : 0.;
+}
+
+static double mitchellFilter(double x)
+{
+    // Mitchell-Netravali, with B = C = 1/3
+    static const double B = 1. / 3.;
+    static const double C = 1. / 3.;
+    x = fabs(x);
+    if (x < 1.) {
+        return ((12. - 9. * B - 6. * C) * x * x * x
+                + (-18. + 12. * B + 6. * C) * x * x
+                + (6. - 2. * B)) / 6.;
+    }
+    if (x < 2.) {
+        return ((-B - 6. * C) * x * x * x
+                + (6. * B + 30. * C) * x * x
+                + (-12. * B - 48. * C) * x
+                + (8. * B + 24. * C)) / 6.;
+    }
+    return 0.;
+}
+
+static double lanczos3Filter(double x)
+{
+    x = fabs(x);
+    return x < 3. ? sinc(x) * sinc(x / 3.) : 0.;
+}
+
+struct FilterInfo
+{
+    double (*mFunction)(double);
+    double mSupport;
+};
+
+static FilterInfo filterInfo(Filter filter)
+{
+    FilterInfo info;
+    switch (filter) {
+    case Bilinear:
+        info.mFunction = bilinearFilter;
+        info.mSupport = 1.;
+        break;
+    case Mitchell:
+        info.mFunction = mitchellFilter;
+        info.mSupport = 2.;
+        break;
+    case Lanczos3:
+    default:
+        info.mFunction = lanczos3Filter;
+        info.mSupport = 3.;
+        break;
+    }
+    return info;
+}
+
+/**
+ * The source pixels which contribute to each destination pixel along one
+ * axis, with their weights
+ */
+struct Contributions
+{
+    // For each destination pixel, index of the first source pixel and number
+    // of source pixels
+    QVector<int> mStart;
+    QVector<int> mCount;
+    // mStride weights per destination pixel
+    QVector<float> mWeights;
+    int mStride;
+
+    void init(int srcSize, int dstSize, const FilterInfo& info)
+    {
+        const double scale = double(srcSize) / dstSize;
+        // When downscaling, the filter is stretched so that it covers all
+        // the source pixels of a destination pixel
+        const double filterScale = qMax(scale, 1.);
+        const double support = info.mSupport * filterScale;
+        mStride = int(ceil(support)) * 2 + 1;
+
+        mStart.resize(dstSize);
+        mCount.resize(dstSize);
+        mWeights.fill(0.f, dstSize * mStride);
+        for (int dst = 0; dst < dstSize; ++dst) {
+            const double center = (dst + 0.5) * scale;
+            const int first = qMax(int(center - support + 0.5), 0);
+            const int last = qMin(int(center + support + 0.5), srcSize);
+            const int count = qMin(last - first, mStride);
+            float* weights = mWeights.data() + dst * mStride;
+
+            double total = 0;
+            for (int k = 0; k < count; ++k) {
+                const double weight = info.mFunction((first + k - center + 0.5) / filterScale);
+                weights[k] = weight;
+                total += weight;
+            }
+            if (total != 0.) {
+                for (int k = 0; k < count; ++k) {
+                    weights[k] /= total;
+                }
+            }
+            mStart[dst] = first;
+            mCount[dst] = count;
+        }
+    }
+};
+
+static inline int clamp8(float value)
+{
+    const int rounded = int(value + 0.5f);
+    return rounded < 0 ? 0 : (rounded > 255 ? 255 : rounded);
+}
+
+static inline QRgb packPixel(float a, float r, float g, float b, bool hasAlpha)
+{
+    if (!hasAlpha) {
+        return qRgb(clamp8(r), clamp8(g), clamp8(b));
+    }
+    // Ringing of the filters can produce color values which are not valid
+    // in a premultiplied image
+    const int alpha = clamp8(a);
+    return qRgba(qMin(clamp8(r), alpha), qMin(clamp8(g), alpha), qMin(clamp8(b), alpha), alpha);
+}
+
+struct ResampleContext
+{
+    // The source rows needed for the destination rows, starting at row
+    // mSrcFirstRow of the source image
+    QImage mSrc;
+    int mSrcFirstRow;
+    // mSrc resampled horizontally only
+    QImage mTmp;
+    // The destination rows, starting at row mDstFirstRow of the whole
+    // destination image
+    QImage mDst;
+    int mDstFirstRow;
+    Contributions mHorizontal;
+    Contributions mVertical;
+    bool mHasAlpha;
+};
+
+/**
+ * Resamples rows [mStart, mEnd[ of one of the two passes
+ */
+class ResampleBand
+{
+public:
+    ResampleBand(ResampleContext* context, bool vertical, int start, int end)
+    : mContext(context)
+    , mVertical(vertical)
+    , mStart(start)
+    , mEnd(end)
+    {}
+
+    void run()
+    {
+        if (mVertical) {
+            runVertical();
+        } else {
+            runHorizontal();
+        }
+    }
+
+private:
+    ResampleContext* mContext;
+    bool mVertical;
+    int mStart;
+    int mEnd;
+
+    void runHorizontal()
+    {
+        const Contributions& contribs = mContext->mHorizontal;
+        const int width = mContext->mTmp.width();
+        for (int y = mStart; y < mEnd; ++y) {
+            const QRgb* src = reinterpret_cast<const QRgb*>(mContext->mSrc.constScanLine(y));
+            QRgb* dst = reinterpret_cast<QRgb*>(mContext->mTmp.scanLine(y));
+            for (int x = 0; x < width; ++x) {
+                const QRgb* pixel = src + contribs.mStart[x];
+                const float* weights = contribs.mWeights.constData() + x * contribs.mStride;
+                const int count = contribs.mCount[x];
+                float a = 0, r = 0, g = 0, b = 0;
+                for (int k = 0; k < count; ++k) {
+                    const QRgb value = pixel[k];
+                    const float weight = weights[k];
+                    a += weight * qAlpha(value);
+                    r += weight * qRed(value);
+                    g += weight * qGreen(value);
+                    b += weight * qBlue(value);
+                }
+                dst[x] = packPixel(a, r, g, b, mContext->mHasAlpha);
+            }
+        }
+    }
+
+    void runVertical()
+    {
+        const Contributions& contribs = mContext->mVertical;
+        const int width = mContext->mDst.width();
+        QVector<float> line(width * 4);
+        for (int y = mStart; y < mEnd; ++y) {
+            line.fill(0.f);
+            float* acc = line.data();
+            const int dstRow = mContext->mDstFirstRow + y;
+            const float* weights = contribs.mWeights.constData() + dstRow * contribs.mStride;
+            const int first = contribs.mStart[dstRow] - mContext->mSrcFirstRow;
+            const int count = contribs.mCount[dstRow];
+            // Walk the source rows in memory order, accumulating in a line
+            // buffer
+            for (int k = 0; k < count; ++k) {
+                const QRgb* src = reinterpret_cast<const QRgb*>(mContext->mTmp.constScanLine(first + k));
+                const float weight = weights[k];
+                for (int x = 0; x < width; ++x) {
+                    const QRgb value = src[x];
+                    acc[x * 4] += weight * qAlpha(value);
+                    acc[x * 4 + 1] += weight * qRed(value);
+                    acc[x * 4 + 2] += weight * qGreen(value);
+                    acc[x * 4 + 3] += weight * qBlue(value);
+                }
+            }
+            QRgb* dst = reinterpret_cast<QRgb*>(mContext->mDst.scanLine(y));
+            for (int x = 0; x < width; ++x) {
+                dst[x] = packPixel(acc[x * 4], acc[x * 4 + 1], acc[x * 4 + 2], acc[x * 4 + 3], mContext->mHasAlpha);
+            }
+        }
+    }
+};
+
+/**
+ * Splits the @a rowCount rows of @a width pixels in bands and resamples them
+ * in parallel
+ */
+static void runPass(ResampleContext* context, bool vertical, int rowCount, int width, TaskScheduler::Priority priority)
+{
+    int bandCount = qMin(QThread::idealThreadCount(), rowCount * width / MIN_BAND_PIXELS);
+    bandCount = qBound(1, bandCount, rowCount);
+    if (bandCount == 1) {
+        ResampleBand(context, vertical, 0, rowCount).run();
+        return;
+    }
+    LOG("Running" << (vertical ? "vertical" : "horizontal") << "pass in" << bandCount << "bands");
+
+    QList<ResampleBand*> bands;
+    QList<QFuture<void> > futures;
+    for (int band = 0; band < bandCount; ++band) {
+        const int start = rowCount * band / bandCount;
+        const int end = rowCount * (band + 1) / bandCount;
+        ResampleBand* task = new ResampleBand(context, vertical, start, end);
+        bands << task;
+        futures << TaskScheduler::instance()->run(priority, task, &ResampleBand::run);
+    }
+    Q_FOREACH(const QFuture<void>& future, futures) {
+        TaskScheduler::instance()->waitForFinished(future);
+    }
+    qDeleteAll(bands);
+}
+
+QImage resample(const QImage& image, const QSize& size, Filter filter, TaskScheduler::Priority priority)
+{
+    return resampleRows(image, size, 0, size.height(), filter, priority);
+}
+
+QImage resampleRows(const QImage& image, const QSize& size, int firstRow, int rowCount, Filter filter, TaskScheduler::Priority priority)
+{
+    GV_RETURN_VALUE_IF_FAIL(!image.isNull(), QImage());
+    GV_RETURN_VALUE_IF_FAIL(!size.isEmpty(), QImage());
+    GV_RETURN_VALUE_IF_FAIL(firstRow >= 0 && rowCount > 0 && firstRow + rowCount <= size.height(), QImage());
+
+    ResampleContext context;
+    context.mHasAlpha = image.hasAlphaChannel();
+    const QImage::Format format = context.mHasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    const FilterInfo info = filterInfo(filter);
+    context.mVertical.init(image.height(), size.height(), info);
+
+    // Only convert the source rows which are needed
+    int srcFirstRow = image.height();
+    int srcEndRow = 0;
+    for (int row = firstRow; row < firstRow + rowCount; ++row) {
+        srcFirstRow = qMin(srcFirstRow, context.mVertical.mStart[row]);
+        srcEndRow = qMax(srcEndRow, context.mVertical.mStart[row] + context.mVertical.mCount[row]);
+    }
+    if (size == image.size()) {
+        srcFirstRow = firstRow;
+        srcEndRow = firstRow + rowCount;
+    }
+    if (srcFirstRow == 0 && srcEndRow == image.height()) {
+        context.mSrc = image.convertToFormat(format);
+    } else {
+        context.mSrc = image.copy(0, srcFirstRow, image.width(), srcEndRow - srcFirstRow).convertToFormat(format);
+    }
+    if (size == image.size()) {
+        return context.mSrc;
+    }
+    context.mSrcFirstRow = srcFirstRow;
+    context.mDstFirstRow = firstRow;
+    context.mHorizontal.init(image.width(), size.width(), info);
+
+    context.mTmp = QImage(size.width(), context.mSrc.height(), format);
+    runPass(&context, false, context.mSrc.height(), size.width(), priority);
+    // Release the source as early as possible, it can be big
+    context.mSrc = QImage();
+
+    context.mDst = QImage(size.width(), rowCount, format);
+    runPass(&context, true, rowCount, size.width(), priority);
+
+    context.mDst.setDotsPerMeterX(image.dotsPerMeterX());
+    context.mDst.setDotsPerMeterY(image.dotsPerMeterY());
+    return context.mDst;
+}
+
+} // namespace ImageResampler
+
+} // namespace Gwenview
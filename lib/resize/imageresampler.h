@@ -0,0 +1,79 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGERESAMPLER_H
+#define IMAGERESAMPLER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+
+// KDE
+
+// Local
+#include <lib/taskscheduler.h>
+
+class QImage;
+class QSize;
+
+namespace Gwenview
+{
+
+/**
+ * A separable resampler, which takes all the source pixels covered by a
+ * destination pixel into account. Unlike QImage::scaled(), it gives good
+ * results when downscaling by large factors.
+ *
+ * The image is split in bands of rows which are resampled in parallel
+ * through the TaskScheduler.
+ */
+namespace ImageResampler
+{
+enum Filter {
+    Bilinear,
+    Mitchell,
+    Lanczos3
+};
+
+/**
+ * Returns @a image resampled to @a size. Bands are scheduled with
+ * @a priority. Call this from a worker thread: it blocks until the image is
+ * done, and runs bands itself if the scheduler is busy.
+ *
+ * The result is in Format_ARGB32_Premultiplied if @a image has an alpha
+ * channel, and in Format_RGB32 otherwise.
+ */
+GWENVIEWLIB_EXPORT QImage resample(const QImage& image, const QSize& size, Filter filter,
+                                   TaskScheduler::Priority priority = TaskScheduler::VisibleDocument);
+
+/**
+ * Returns @a rowCount rows of @a image resampled to @a size, starting at row
+ * @a firstRow. Only the source rows which contribute to them are read, so
+ * a big image can be resampled one band at a time, without seams between
+ * the bands.
+ */
+GWENVIEWLIB_EXPORT QImage resampleRows(const QImage& image, const QSize& size, int firstRow, int rowCount, Filter filter,
+                                       TaskScheduler::Priority priority = TaskScheduler::VisibleDocument);
+
+} // namespace ImageResampler
+
+} // namespace Gwenview
+
+#endif /* IMAGERESAMPLER_H */
@@ -65,6 +65,11 @@ ResizeImageDialog::ResizeImageDialog(QWidget* parent)
     setWindowTitle(content->windowTitle());
     d->mWidthSpinBox->setFocus();
 
+    d->mFilterComboBox->addItem(i18n("Fast (Bilinear)"), int(ImageResampler::Bilinear));
+    d->mFilterComboBox->addItem(i18n("Smooth (Mitchell)"), int(ImageResampler::Mitchell));
+    d->mFilterComboBox->addItem(i18n("Sharp (Lanczos)"), int(ImageResampler::Lanczos3));
+    setFilter(ImageResampler::Lanczos3);
+
     connect(d->mWidthSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &ResizeImageDialog::slotWidthChanged);
     connect(d->mHeightSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &ResizeImageDialog::slotHeightChanged);
     connect(d->mKeepAspectCheckBox, &QCheckBox::toggled, this, &ResizeImageDialog::slotKeepAspectChanged);
@@ -92,6 +97,19 @@ QSize ResizeImageDialog::size() const
            );
 }
 
+void ResizeImageDialog::setFilter(ImageResampler::Filter filter)
+{
+    const int index = d->mFilterComboBox->findData(int(filter));
+    if (index != -1) {
+        d->mFilterComboBox->setCurrentIndex(index);
+    }
+}
+
+ImageResampler::Filter ResizeImageDialog::filter() const
+{
+    return ImageResampler::Filter(d->mFilterComboBox->currentData().toInt());
+}
+
 void ResizeImageDialog::slotWidthChanged(int width)
 {
     if (!d->mKeepAspectCheckBox->isChecked()) {
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KDE
 
 // Local
+#include <lib/resize/imageresampler.h>
 
 namespace Gwenview
 {
@@ -44,6 +45,9 @@ public:
     void setOriginalSize(const QSize&);
     QSize size() const;
 
+    void setFilter(ImageResampler::Filter);
+    ImageResampler::Filter filter() const;
+
 private Q_SLOTS:
     void slotWidthChanged(int);
     void slotHeightChanged(int);
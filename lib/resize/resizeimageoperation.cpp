@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/abstractdocumenteditor.h"
 #include "document/document.h"
 #include "document/documentjob.h"
+#include "undoimagedata.h"
 
 namespace Gwenview
 {
@@ -39,14 +40,17 @@ namespace Gwenview
 struct ResizeImageOperationPrivate
 {
     QSize mSize;
-    QImage mOriginalImage;
+    ImageResampler::Filter mFilter;
+    QScopedPointer<UndoImageData> mUndoData;
 };
 
 class ResizeJob : public ThreadedDocumentJob
 {
 public:
-    ResizeJob(const QSize& size)
+    ResizeJob(const QSize& size, ImageResampler::Filter filter, UndoImageData* undoData)
         : mSize(size)
+        , mFilter(filter)
+        , mUndoData(undoData)
     {}
 
     virtual void threadedStart()
@@ -55,19 +59,23 @@ public:
             return;
         }
         QImage image = document()->image();
-        image = image.scaled(mSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        mUndoData->storeImage(image);
+        image = ImageResampler::resample(image, mSize, mFilter, document()->taskPriority());
         document()->editor()->setImage(image);
         setError(NoError);
     }
 
 private:
     QSize mSize;
+    ImageResampler::Filter mFilter;
+    UndoImageData* mUndoData;
 };
 
-ResizeImageOperation::ResizeImageOperation(const QSize& size)
+ResizeImageOperation::ResizeImageOperation(const QSize& size, ImageResampler::Filter filter)
 : d(new ResizeImageOperationPrivate)
 {
     d->mSize = size;
+    d->mFilter = filter;
     setText(i18nc("(qtundo-format)", "Resize"));
 }
 
@@ -78,8 +86,8 @@ ResizeImageOperation::~ResizeImageOperation()
 
 void ResizeImageOperation::redo()
 {
-    d->mOriginalImage = document()->image();
-    redoAsDocumentJob(new ResizeJob(d->mSize));
+    d->mUndoData.reset(new UndoImageData(document().data()));
+    redoAsDocumentJob(new ResizeJob(d->mSize, d->mFilter, d->mUndoData.data()));
 }
 
 void ResizeImageOperation::undo()
@@ -88,7 +96,7 @@ void ResizeImageOperation::undo()
         qWarning() << "!document->editor()";
         return;
     }
-    document()->editor()->setImage(d->mOriginalImage);
+    document()->editor()->setImage(d->mUndoData->restore(document()->image()));
 }
 
 } // namespace
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include <lib/abstractimageoperation.h>
+#include <lib/resize/imageresampler.h>
 
 namespace Gwenview
 {
@@ -37,7 +38,7 @@ struct ResizeImageOperationPrivate;
 class GWENVIEWLIB_EXPORT ResizeImageOperation : public AbstractImageOperation
 {
 public:
-    ResizeImageOperation(const QSize& size);
+    ResizeImageOperation(const QSize& size, ImageResampler::Filter filter = ImageResampler::Lanczos3);
     ~ResizeImageOperation();
 
     virtual void redo() Q_DECL_OVERRIDE;
@@ -52,7 +52,10 @@ struct SemanticInfoCacheItem
     SemanticInfoCacheItem()
         : mValid(false)
         {}
-    QPersistentModelIndex mIndex;
+    // The url of the item in the model, which can differ from the targetUrl()
+    // used as a key. The index is looked up when needed: keeping a
+    // QPersistentModelIndex would slow down sorting and filtering.
+    QUrl mUrl;
     bool mValid;
     SemanticInfo mInfo;
 };
@@ -136,7 +139,7 @@ void SemanticInfoDirModel::retrieveSemanticInfoForIndex(const QModelIndex& index
         return;
     }
     SemanticInfoCacheItem cacheItem;
-    cacheItem.mIndex = QPersistentModelIndex(index);
+    cacheItem.mUrl = item.url();
     d->mSemanticInfoCache[item.targetUrl()] = cacheItem;
     d->mBackEnd->retrieveSemanticInfo(item.targetUrl());
 }
@@ -220,13 +223,14 @@ void SemanticInfoDirModel::slotSemanticInfoRetrieved(const QUrl &url, const Sema
         return;
     }
     SemanticInfoCacheItem& cacheItem = it.value();
-    if (!cacheItem.mIndex.isValid()) {
+    const QModelIndex index = indexForUrl(cacheItem.mUrl);
+    if (!index.isValid()) {
         qWarning() << "Index for" << url << "is invalid";
         return;
     }
     cacheItem.mInfo = semanticInfo;
     cacheItem.mValid = true;
-    emit dataChanged(cacheItem.mIndex, cacheItem.mIndex);
+    emit dataChanged(index, index);
 }
 
 void SemanticInfoDirModel::slotRowsAboutToBeRemoved(const QModelIndex& parent, int start, int end)
@@ -80,6 +80,11 @@ SortedDirModel::SortedDirModel(QObject* parent)
 #else
     d->mSourceModel = new SemanticInfoDirModel(this);
 #endif
+    // Listing huge dirs is much faster if mimetypes are only determined when
+    // needed. Most items get their kind from their name anyway, see
+    // MimeTypeUtils::fileItemKind(). Dirs are still listed with KDirLister,
+    // not with LocalDirScanner, see the LocalDirScanner documentation.
+    d->mSourceModel->dirLister()->setDelayedMimeTypes(true);
     setSourceModel(d->mSourceModel);
     d->mDelayedApplyFiltersTimer.setInterval(0);
     d->mDelayedApplyFiltersTimer.setSingleShot(true);
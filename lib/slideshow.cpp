@@ -27,6 +27,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Qt
 #include <QAction>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QTimer>
 #include <QDebug>
 
@@ -34,7 +36,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <KLocalizedString>
 
 // Local
+#include <lib/document/documentfactory.h>
 #include <lib/gvdebug.h>
+#include <lib/mimetypeutils.h>
 #include <gwenviewconfig.h>
 
 namespace Gwenview
@@ -52,7 +56,21 @@ namespace Gwenview
 enum State {
     Stopped,
     Started,
-    WaitForEndOfUrl
+    WaitForEndOfUrl,
+    WaitForNextDocument
+};
+
+// How many of the next slides are loaded ahead of time
+static const int PRELOAD_COUNT = 2;
+
+/**
+ * A slide which is loaded ahead of time, at the size it is going to be shown
+ */
+struct PreloadedSlide
+{
+    QUrl mUrl;
+    Document::Ptr mDocument;
+    bool mLoadingStarted;
 };
 
 /**
@@ -78,14 +96,28 @@ private:
 
 struct SlideShowPrivate
 {
+    SlideShow* q;
     QTimer* mTimer;
     State mState;
     QVector<QUrl> mUrls;
+    // Position of each url in mUrls, so that stepping does not have to
+    // search mUrls
+    QHash<QUrl, int> mIndexForUrl;
     QVector<QUrl> mShuffledUrls;
-    QVector<QUrl>::ConstIterator mStartIt;
+    int mStartIndex;
+    int mCurrentIndex;
     QUrl mCurrentUrl;
     QUrl mLastShuffledUrl;
 
+    QSize mPreloadSize;
+    QList<PreloadedSlide> mPreloadedSlides;
+    // Measures how long the next slide took to be ready after the timer
+    // expired
+    QElapsedTimer mWaitTimer;
+    // Added to the configured interval when slides are not ready in time,
+    // so that the slides are shown at a steady pace
+    int mExtraDelay;
+
     QAction* mLoopAction;
     QAction* mRandomAction;
 
@@ -98,30 +130,36 @@ struct SlideShowPrivate
         }
     }
 
-    QUrl findNextOrderedUrl()
+    /**
+     * Returns the index of the url coming after the one at @a index, or -1
+     * if the slideshow is over
+     */
+    int nextOrderedIndex(int index) const
     {
-        QVector<QUrl>::ConstIterator it = qFind(mUrls.constBegin(), mUrls.constEnd(), mCurrentUrl);
-        GV_RETURN_VALUE_IF_FAIL2(it != mUrls.constEnd(), QUrl(), "Current url not found in list.");
-
-        ++it;
+        if (index < 0 || mUrls.isEmpty()) {
+            return -1;
+        }
+        ++index;
         if (GwenviewConfig::loop()) {
             // Looping, if we reach the end, start again
-            if (it == mUrls.constEnd()) {
-                it = mUrls.constBegin();
+            if (index == mUrls.count()) {
+                index = 0;
             }
         } else {
             // Not looping, have we reached the end?
             // FIXME: stopAtEnd
-            if (/*(it==mUrls.end() && GwenviewConfig::stopAtEnd()) ||*/ it == mStartIt) {
-                it = mUrls.constEnd();
+            if (/*(index == mUrls.count() && GwenviewConfig::stopAtEnd()) ||*/ index == mStartIndex) {
+                return -1;
             }
         }
+        return index < mUrls.count() ? index : -1;
+    }
 
-        if (it != mUrls.constEnd()) {
-            return *it;
-        } else {
-            return QUrl();
-        }
+    QUrl findNextOrderedUrl()
+    {
+        GV_RETURN_VALUE_IF_FAIL2(mCurrentIndex != -1, QUrl(), "Current url not found in list.");
+        const int index = nextOrderedIndex(mCurrentIndex);
+        return index != -1 ? mUrls.at(index) : QUrl();
     }
 
     void initShuffledUrls()
@@ -153,9 +191,144 @@ struct SlideShowPrivate
         return url;
     }
 
+    /**
+     * Returns the urls which are going to be shown next, without moving
+     * forward
+     */
+    QList<QUrl> upcomingUrls(int count)
+    {
+        QList<QUrl> urls;
+        if (GwenviewConfig::random()) {
+            if (mShuffledUrls.empty() && GwenviewConfig::loop()) {
+                initShuffledUrls();
+            }
+            for (int idx = mShuffledUrls.count() - 1; idx >= 0 && urls.count() < count; --idx) {
+                urls << mShuffledUrls.at(idx);
+            }
+        } else {
+            int index = mCurrentIndex;
+            while (urls.count() < count) {
+                index = nextOrderedIndex(index);
+                if (index == -1 || index == mCurrentIndex) {
+                    break;
+                }
+                urls << mUrls.at(index);
+            }
+        }
+        return urls;
+    }
+
+    void updatePreloadedSlides()
+    {
+        QList<PreloadedSlide> slides;
+        if (mState != Stopped && mPreloadSize.isValid()) {
+            Q_FOREACH(const QUrl& url, upcomingUrls(PRELOAD_COUNT)) {
+                slides << preloadedSlideForUrl(url);
+            }
+        }
+        // Forget about the slides which are not coming anymore, keeping a
+        // reference to them would prevent them from being garbage collected
+        Q_FOREACH(const PreloadedSlide& slide, mPreloadedSlides) {
+            if (slide.mDocument) {
+                QObject::disconnect(slide.mDocument.data(), 0, q, 0);
+            }
+        }
+        mPreloadedSlides = slides;
+        for (int idx = 0; idx < mPreloadedSlides.count(); ++idx) {
+            PreloadedSlide& slide = mPreloadedSlides[idx];
+            if (slide.mDocument) {
+                connectDocument(slide.mDocument.data());
+                startLoading(&slide);
+            }
+        }
+    }
+
+    PreloadedSlide preloadedSlideForUrl(const QUrl& url) const
+    {
+        Q_FOREACH(const PreloadedSlide& slide, mPreloadedSlides) {
+            if (slide.mUrl == url) {
+                return slide;
+            }
+        }
+        PreloadedSlide slide;
+        slide.mUrl = url;
+        slide.mLoadingStarted = false;
+        // Only preload what the Preloader would preload: other kinds of
+        // documents are shown as soon as their time comes
+        if (url.isLocalFile() && MimeTypeUtils::urlKind(url) == MimeTypeUtils::KIND_RASTER_IMAGE) {
+            slide.mDocument = DocumentFactory::instance()->load(url, TaskScheduler::Preload);
+        }
+        return slide;
+    }
+
+    void connectDocument(Document* doc)
+    {
+        QObject::connect(doc, SIGNAL(metaInfoUpdated()), q, SLOT(slotPreloadedDocumentUpdated()));
+        QObject::connect(doc, SIGNAL(downSampledImageReady()), q, SLOT(slotPreloadedDocumentUpdated()));
+        QObject::connect(doc, SIGNAL(loaded(QUrl)), q, SLOT(slotPreloadedDocumentUpdated()));
+        QObject::connect(doc, SIGNAL(loadingFailed(QUrl)), q, SLOT(slotPreloadedDocumentUpdated()));
+    }
+
+    qreal zoomForDocument(const Document::Ptr& doc) const
+    {
+        return qMin(
+            mPreloadSize.width() / qreal(doc->width()),
+            mPreloadSize.height() / qreal(doc->height())
+        );
+    }
+
+    void startLoading(PreloadedSlide* slide)
+    {
+        const Document::Ptr& doc = slide->mDocument;
+        if (slide->mLoadingStarted || doc->loadingState() == Document::LoadingFailed || !doc->size().isValid()) {
+            return;
+        }
+        slide->mLoadingStarted = true;
+        const qreal zoom = zoomForDocument(doc);
+        if (zoom < Document::maxDownSampledZoom()) {
+            LOG("preloading" << slide->mUrl << "down sampled, zoom=" << zoom);
+            doc->prepareDownSampledImageForZoom(zoom);
+        } else {
+            LOG("preloading" << slide->mUrl << "full image");
+            doc->startLoadingFullImage();
+        }
+    }
+
+    bool isReady(const PreloadedSlide& slide) const
+    {
+        const Document::Ptr& doc = slide.mDocument;
+        if (!doc || doc->loadingState() == Document::LoadingFailed) {
+            return true;
+        }
+        if (!doc->size().isValid()) {
+            return false;
+        }
+        const qreal zoom = zoomForDocument(doc);
+        if (zoom < Document::maxDownSampledZoom()) {
+            return !doc->downSampledImageForZoom(zoom).isNull();
+        }
+        return doc->loadingState() == Document::Loaded;
+    }
+
+    bool isNextSlideReady() const
+    {
+        if (mPreloadedSlides.isEmpty()) {
+            return true;
+        }
+        return isReady(mPreloadedSlides.first());
+    }
+
     void updateTimerInterval()
     {
-        mTimer->setInterval(int(GwenviewConfig::interval() * 1000));
+        mTimer->setInterval(int(GwenviewConfig::interval() * 1000) + mExtraDelay);
+    }
+
+    void updateExtraDelay(int waitTime)
+    {
+        // Smooth the delay, it goes back to 0 once slides are ready in time
+        mExtraDelay = (mExtraDelay + waitTime) / 2;
+        LOG("waitTime=" << waitTime << "extraDelay=" << mExtraDelay);
+        updateTimerInterval();
     }
 
     void doStart()
@@ -170,6 +343,9 @@ struct SlideShowPrivate
             mTimer->start();
             mState = Started;
         }
+        if (mPreloadSize.isValid()) {
+            updatePreloadedSlides();
+        }
     }
 };
 
@@ -177,7 +353,11 @@ SlideShow::SlideShow(QObject* parent)
 : QObject(parent)
 , d(new SlideShowPrivate)
 {
+    d->q = this;
     d->mState = Stopped;
+    d->mStartIndex = -1;
+    d->mCurrentIndex = -1;
+    d->mExtraDelay = 0;
 
     d->mTimer = new QTimer(this);
     connect(d->mTimer, &QTimer::timeout, this, &SlideShow::goToNextUrl);
@@ -217,26 +397,39 @@ void SlideShow::start(const QList<QUrl>& urls)
 {
     d->mUrls.resize(urls.size());
     qCopy(urls.begin(), urls.end(), d->mUrls.begin());
+    d->mIndexForUrl.clear();
+    d->mIndexForUrl.reserve(d->mUrls.count());
+    for (int idx = 0; idx < d->mUrls.count(); ++idx) {
+        d->mIndexForUrl.insert(d->mUrls.at(idx), idx);
+    }
 
-    d->mStartIt = qFind(d->mUrls.constBegin(), d->mUrls.constEnd(), d->mCurrentUrl);
-    if (d->mStartIt == d->mUrls.constEnd()) {
+    d->mStartIndex = d->mIndexForUrl.value(d->mCurrentUrl, -1);
+    if (d->mStartIndex == -1) {
         qWarning() << "Current url not found in list, aborting.\n";
         return;
     }
+    d->mCurrentIndex = d->mStartIndex;
 
     if (GwenviewConfig::random()) {
         d->initShuffledUrls();
     }
 
+    d->mExtraDelay = 0;
     d->updateTimerInterval();
     d->mTimer->setSingleShot(false);
     d->doStart();
     stateChanged(true);
 }
 
+void SlideShow::setPreloadSize(const QSize& size)
+{
+    d->mPreloadSize = size;
+}
+
 void SlideShow::setInterval(int intervalInSeconds)
 {
     GwenviewConfig::setInterval(double(intervalInSeconds));
+    d->mExtraDelay = 0;
     d->updateTimerInterval();
 }
 
@@ -245,6 +438,7 @@ void SlideShow::stop()
     LOG("Stopping timer");
     d->mTimer->stop();
     d->mState = Stopped;
+    d->updatePreloadedSlides();
     stateChanged(false);
 }
 
@@ -259,6 +453,19 @@ void SlideShow::resumeAndGoToNextUrl()
 void SlideShow::goToNextUrl()
 {
     LOG("");
+    if (d->mState == Started && !d->isNextSlideReady()) {
+        LOG("Next slide is not ready yet, waiting for it");
+        d->mTimer->stop();
+        d->mState = WaitForNextDocument;
+        d->mWaitTimer.start();
+        return;
+    }
+    if (d->mState == WaitForNextDocument) {
+        d->updateExtraDelay(int(d->mWaitTimer.elapsed()));
+        d->mState = Started;
+    } else if (d->mState == Started && d->mExtraDelay > 0) {
+        d->updateExtraDelay(0);
+    }
     QUrl url = d->findNextUrl();
     LOG("url:" << url);
     if (!url.isValid()) {
@@ -268,6 +475,19 @@ void SlideShow::goToNextUrl()
     goToUrl(url);
 }
 
+void SlideShow::slotPreloadedDocumentUpdated()
+{
+    for (int idx = 0; idx < d->mPreloadedSlides.count(); ++idx) {
+        PreloadedSlide& slide = d->mPreloadedSlides[idx];
+        if (slide.mDocument) {
+            d->startLoading(&slide);
+        }
+    }
+    if (d->mState == WaitForNextDocument && d->isNextSlideReady()) {
+        goToNextUrl();
+    }
+}
+
 void SlideShow::setCurrentUrl(const QUrl &url)
 {
     LOG(url);
@@ -275,6 +495,7 @@ void SlideShow::setCurrentUrl(const QUrl &url)
         return;
     }
     d->mCurrentUrl = url;
+    d->mCurrentIndex = d->mIndexForUrl.value(url, -1);
     // Restart timer to avoid showing new url for the remaining time of the old
     // url
     if (d->mState != Stopped) {
@@ -291,6 +512,9 @@ void SlideShow::updateConfig()
 {
     GwenviewConfig::setLoop(d->mLoopAction->isChecked());
     GwenviewConfig::setRandom(d->mRandomAction->isChecked());
+    if (d->mState != Stopped) {
+        d->updatePreloadedSlides();
+    }
 }
 
 void SlideShow::slotRandomActionToggled(bool on)
@@ -30,11 +30,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QUrl>
 
 class QAction;
+class QSize;
 
 namespace Gwenview
 {
 
 struct SlideShowPrivate;
+/**
+ * Steps through a list of urls at a regular interval.
+ *
+ * If a preload size has been set, the next slides are loaded ahead of time at
+ * this size. When the interval expires before the next slide is ready, the
+ * slideshow waits for it and lengthens the interval for the following slides.
+ */
 class GWENVIEWLIB_EXPORT SlideShow : public QObject
 {
     Q_OBJECT
@@ -45,6 +53,12 @@ public:
     void start(const QList<QUrl>& urls);
     void stop();
 
+    /**
+     * Defines the size at which the next slides are loaded ahead of time.
+     * Slides are not preloaded if @a size is not valid.
+     */
+    void setPreloadSize(const QSize& size);
+
     QAction* loopAction() const;
     QAction* randomAction() const;
 
@@ -71,6 +85,7 @@ private Q_SLOTS:
     void goToNextUrl();
     void updateConfig();
     void slotRandomActionToggled(bool on);
+    void slotPreloadedDocumentUpdated();
 
 private:
     SlideShowPrivate* const d;
@@ -0,0 +1,311 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "taskscheduler.h"
+
+// Qt
+#include <QCoreApplication>
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// The task running in the current thread, if any
+static QThreadStorage<QFutureInterfaceBase> sCurrentTask;
+
+struct TaskSchedulerPrivate
+{
+    mutable QMutex mMutex;
+    QThreadPool mThreadPool;
+    QQueue<AbstractTask*> mQueues[TaskScheduler::PriorityCount];
+    int mRunningCounts[TaskScheduler::PriorityCount];
+    int mMaxRunningCounts[TaskScheduler::PriorityCount];
+    int mRunningCount;
+
+    static void runTask(AbstractTask* task)
+    {
+        QFutureInterfaceBase* futureInterface = task->futureInterface();
+        if (!futureInterface->isCanceled()) {
+            // A task may run another one if it waits for it
+            const QFutureInterfaceBase previousTask = sCurrentTask.hasLocalData()
+                ? sCurrentTask.localData() : QFutureInterfaceBase();
+            sCurrentTask.setLocalData(*futureInterface);
+            task->run();
+            sCurrentTask.setLocalData(previousTask);
+        }
+        futureInterface->reportFinished();
+        delete task;
+    }
+
+    static void dropTask(AbstractTask* task)
+    {
+        QFutureInterfaceBase* futureInterface = task->futureInterface();
+        futureInterface->reportCanceled();
+        futureInterface->reportFinished();
+        delete task;
+    }
+
+    // Must be called with mMutex locked
+    bool findTask(const AbstractTaskMatcher& matcher, int* taskPriority, int* taskIndex) const
+    {
+        for (int priority = 0; priority < TaskScheduler::PriorityCount; ++priority) {
+            const QQueue<AbstractTask*>& queue = mQueues[priority];
+            for (int idx = 0; idx < queue.size(); ++idx) {
+                if (matcher.matches(queue.at(idx))) {
+                    *taskPriority = priority;
+                    *taskIndex = idx;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Must be called with mMutex locked
+    AbstractTask* takeTask(const AbstractTaskMatcher& matcher)
+    {
+        int priority, idx;
+        if (!findTask(matcher, &priority, &idx)) {
+            return 0;
+        }
+        return mQueues[priority].takeAt(idx);
+    }
+
+    // Must be called with mMutex locked
+    void dispatch();
+
+    void taskFinished(int priority)
+    {
+        QMutexLocker locker(&mMutex);
+        --mRunningCounts[priority];
+        --mRunningCount;
+        dispatch();
+    }
+
+    /**
+     * Called when the application quits: runs the queued writes and waits
+     * for them, drops the other queued tasks
+     */
+    static void drain()
+    {
+        TaskSchedulerPrivate* d = TaskScheduler::instance()->d;
+        {
+            QMutexLocker locker(&d->mMutex);
+            for (int priority = 0; priority < TaskScheduler::PriorityCount; ++priority) {
+                if (priority == TaskScheduler::Save || priority == TaskScheduler::OffscreenThumbnail) {
+                    continue;
+                }
+                while (!d->mQueues[priority].isEmpty()) {
+                    dropTask(d->mQueues[priority].dequeue());
+                }
+            }
+        }
+        // Running tasks start the queued ones when they are done, so the
+        // pool is only idle once the queues are empty
+        d->mThreadPool.waitForDone();
+    }
+};
+
+class TaskRunner : public QRunnable
+{
+public:
+    TaskRunner(TaskSchedulerPrivate* d, AbstractTask* task, int priority)
+    : mD(d)
+    , mTask(task)
+    , mPriority(priority)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        TaskSchedulerPrivate::runTask(mTask);
+        mD->taskFinished(mPriority);
+    }
+
+private:
+    TaskSchedulerPrivate* mD;
+    AbstractTask* mTask;
+    int mPriority;
+};
+
+void TaskSchedulerPrivate::dispatch()
+{
+    const int maxThreadCount = mThreadPool.maxThreadCount();
+    while (mRunningCount < maxThreadCount) {
+        int priority = 0;
+        for (; priority < TaskScheduler::PriorityCount; ++priority) {
+            if (mQueues[priority].isEmpty() || mRunningCounts[priority] >= mMaxRunningCounts[priority]) {
+                continue;
+            }
+            // Keep the last thread for the visible document
+            if (priority != TaskScheduler::VisibleDocument && mRunningCount >= maxThreadCount - 1) {
+                continue;
+            }
+            break;
+        }
+        if (priority == TaskScheduler::PriorityCount) {
+            return;
+        }
+        AbstractTask* task = mQueues[priority].dequeue();
+        ++mRunningCounts[priority];
+        ++mRunningCount;
+        LOG("Starting task, priority=" << priority << "running tasks:" << mRunningCount);
+        mThreadPool.start(new TaskRunner(this, task, priority));
+    }
+}
+
+TaskScheduler::TaskScheduler()
+: d(new TaskSchedulerPrivate)
+{
+    const int threadCount = qMax(2, QThread::idealThreadCount());
+    const int halfThreadCount = qMax(1, threadCount / 2);
+    d->mThreadPool.setMaxThreadCount(threadCount);
+    d->mRunningCount = 0;
+    for (int priority = 0; priority < PriorityCount; ++priority) {
+        d->mRunningCounts[priority] = 0;
+    }
+    d->mMaxRunningCounts[VisibleDocument] = threadCount;
+    d->mMaxRunningCounts[Preload] = halfThreadCount;
+    d->mMaxRunningCounts[VisibleThumbnail] = threadCount;
+    d->mMaxRunningCounts[OffscreenThumbnail] = halfThreadCount;
+    d->mMaxRunningCounts[Save] = qMax(1, envInt("GV_MAX_CONCURRENT_SAVES", halfThreadCount));
+    d->mMaxRunningCounts[Import] = halfThreadCount;
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        QMutexLocker locker(&d->mMutex);
+        for (int priority = 0; priority < PriorityCount; ++priority) {
+            while (!d->mQueues[priority].isEmpty()) {
+                TaskSchedulerPrivate::dropTask(d->mQueues[priority].dequeue());
+            }
+        }
+    }
+    d->mThreadPool.waitForDone();
+    delete d;
+}
+
+TaskScheduler* TaskScheduler::instance()
+{
+    static TaskScheduler scheduler;
+    static bool drainRegistered = false;
+    if (!drainRegistered) {
+        // The scheduler outlives QCoreApplication, drain it before the
+        // objects the queued tasks work on are gone
+        drainRegistered = true;
+        qAddPostRoutine(TaskSchedulerPrivate::drain);
+    }
+    return &scheduler;
+}
+
+void TaskScheduler::schedule(Priority priority, AbstractTask* task)
+{
+    // Report the task as started right away, so that waiting for it blocks
+    // even before it is dequeued
+    task->futureInterface()->reportStarted();
+    QMutexLocker locker(&d->mMutex);
+    d->mQueues[priority].enqueue(task);
+    d->dispatch();
+}
+
+bool TaskScheduler::cancelQueuedTask(const AbstractTaskMatcher& matcher)
+{
+    AbstractTask* task;
+    {
+        QMutexLocker locker(&d->mMutex);
+        task = d->takeTask(matcher);
+    }
+    if (!task) {
+        return false;
+    }
+    LOG("Dropping queued task");
+    TaskSchedulerPrivate::dropTask(task);
+    return true;
+}
+
+bool TaskScheduler::runQueuedTask(const AbstractTaskMatcher& matcher)
+{
+    AbstractTask* task;
+    {
+        QMutexLocker locker(&d->mMutex);
+        task = d->takeTask(matcher);
+    }
+    if (!task) {
+        return false;
+    }
+    LOG("Running queued task in the calling thread");
+    TaskSchedulerPrivate::runTask(task);
+    return true;
+}
+
+void TaskScheduler::setQueuedTaskPriority(const AbstractTaskMatcher& matcher, Priority priority)
+{
+    QMutexLocker locker(&d->mMutex);
+    int oldPriority, idx;
+    if (!d->findTask(matcher, &oldPriority, &idx) || oldPriority == priority) {
+        return;
+    }
+    LOG("Moving queued task from priority" << oldPriority << "to" << priority);
+    d->mQueues[priority].enqueue(d->mQueues[oldPriority].takeAt(idx));
+    d->dispatch();
+}
+
+void TaskScheduler::setMaxConcurrentTasks(Priority priority, int count)
+{
+    GV_RETURN_IF_FAIL(count > 0);
+    QMutexLocker locker(&d->mMutex);
+    d->mMaxRunningCounts[priority] = count;
+    d->dispatch();
+}
+
+int TaskScheduler::maxConcurrentTasks(Priority priority) const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mMaxRunningCounts[priority];
+}
+
+bool TaskScheduler::isCurrentTaskCanceled()
+{
+    return sCurrentTask.hasLocalData() && sCurrentTask.localData().isCanceled();
+}
+
+} // namespace
@@ -0,0 +1,241 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QFuture>
+#include <QFutureInterface>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+/**
+ * A unit of work run by TaskScheduler. Use TaskScheduler::run() rather than
+ * implementing this class.
+ */
+class GWENVIEWLIB_EXPORT AbstractTask
+{
+public:
+    virtual ~AbstractTask() {}
+    virtual void run() = 0;
+    virtual QFutureInterfaceBase* futureInterface() = 0;
+};
+
+/**
+ * A task reporting its progress through a QFutureInterface<R>. The interface
+ * is only reachable from the task, callers get a QFuture<R> out of it.
+ */
+template <class R>
+class FutureTask : public AbstractTask
+{
+public:
+    QFuture<R> future()
+    {
+        return mInterface.future();
+    }
+
+    QFutureInterfaceBase* futureInterface() Q_DECL_OVERRIDE
+    {
+        return &mInterface;
+    }
+
+protected:
+    QFutureInterface<R> mInterface;
+};
+
+template <class T, class R>
+class MemberFunctionTask : public FutureTask<R>
+{
+public:
+    MemberFunctionTask(T* object, R (T::*function)())
+    : mObject(object)
+    , mFunction(function)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        this->mInterface.reportResult((mObject->*mFunction)());
+    }
+
+private:
+    T* mObject;
+    R (T::*mFunction)();
+};
+
+template <class T>
+class MemberFunctionTask<T, void> : public FutureTask<void>
+{
+public:
+    MemberFunctionTask(T* object, void (T::*function)())
+    : mObject(object)
+    , mFunction(function)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        (mObject->*mFunction)();
+    }
+
+private:
+    T* mObject;
+    void (T::*mFunction)();
+};
+
+/**
+ * Finds the queued task a future has been returned for
+ */
+class GWENVIEWLIB_EXPORT AbstractTaskMatcher
+{
+public:
+    virtual ~AbstractTaskMatcher() {}
+    virtual bool matches(AbstractTask*) const = 0;
+};
+
+template <class R>
+class FutureTaskMatcher : public AbstractTaskMatcher
+{
+public:
+    FutureTaskMatcher(const QFuture<R>& future)
+    : mFuture(future)
+    {}
+
+    bool matches(AbstractTask* task) const Q_DECL_OVERRIDE
+    {
+        FutureTask<R>* futureTask = dynamic_cast<FutureTask<R>*>(task);
+        return futureTask && futureTask->future() == mFuture;
+    }
+
+private:
+    QFuture<R> mFuture;
+};
+
+struct TaskSchedulerPrivate;
+/**
+ * Runs background work in a thread pool shared by loading, thumbnailing,
+ * editing and saving.
+ *
+ * Each task belongs to a priority class. Queued tasks of a higher class are
+ * always started first, each class has its own concurrency limit, and one
+ * thread is kept for the VisibleDocument class so that the image the user is
+ * looking at never waits for a long batch to finish. The limit of the Save
+ * class can be changed with the GV_MAX_CONCURRENT_SAVES environment variable.
+ *
+ * Tasks are cancelled cooperatively: cancel() removes a task which has not
+ * started yet, and marks a running task as cancelled so that it can stop
+ * early by checking isCurrentTaskCanceled().
+ *
+ * When the application quits, queued Save and OffscreenThumbnail tasks are
+ * still run so that no pending write is lost. Other queued tasks are dropped.
+ */
+class GWENVIEWLIB_EXPORT TaskScheduler
+{
+public:
+    enum Priority {
+        VisibleDocument,
+        Preload,
+        VisibleThumbnail,
+        OffscreenThumbnail,
+        Save,
+        // File operations of the importer, kept apart from document saves
+        Import
+    };
+    enum {
+        PriorityCount = Import + 1
+    };
+
+    static TaskScheduler* instance();
+
+    /**
+     * Queues a call to object->function() in the thread pool. The returned
+     * future can be monitored with a QFutureWatcher.
+     */
+    template <class T, class R>
+    QFuture<R> run(Priority priority, T* object, R (T::*function)())
+    {
+        MemberFunctionTask<T, R>* task = new MemberFunctionTask<T, R>(object, function);
+        QFuture<R> future = task->future();
+        schedule(priority, task);
+        return future;
+    }
+
+    template <class T>
+    void cancel(const QFuture<T>& future)
+    {
+        if (!cancelQueuedTask(FutureTaskMatcher<T>(future))) {
+            QFuture<T>(future).cancel();
+        }
+    }
+
+    /**
+     * Blocks until the task of @a future is done. If it has not started yet,
+     * it is run in the calling thread instead of waiting for its turn.
+     */
+    template <class T>
+    void waitForFinished(const QFuture<T>& future)
+    {
+        if (!runQueuedTask(FutureTaskMatcher<T>(future))) {
+            QFuture<T>(future).waitForFinished();
+        }
+    }
+
+    /**
+     * Moves the task of @a future to the queue of @a priority if it has not
+     * started yet. Does nothing for running or finished tasks.
+     */
+    template <class T>
+    void setPriority(const QFuture<T>& future, Priority priority)
+    {
+        setQueuedTaskPriority(FutureTaskMatcher<T>(future), priority);
+    }
+
+    void setMaxConcurrentTasks(Priority, int count);
+    int maxConcurrentTasks(Priority) const;
+
+    /**
+     * Returns true if the task running in the calling thread has been
+     * cancelled. Long tasks should check it regularly and return early.
+     */
+    static bool isCurrentTaskCanceled();
+
+private:
+    TaskScheduler();
+    ~TaskScheduler();
+    Q_DISABLE_COPY(TaskScheduler)
+
+    void schedule(Priority, AbstractTask*);
+    bool cancelQueuedTask(const AbstractTaskMatcher&);
+    bool runQueuedTask(const AbstractTaskMatcher&);
+    void setQueuedTaskPriority(const AbstractTaskMatcher&, Priority);
+
+    friend struct TaskSchedulerPrivate;
+    TaskSchedulerPrivate* const d;
+};
+
+} // namespace
+
+#endif /* TASKSCHEDULER_H */
@@ -26,6 +26,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "jpegcontent.h"
 #include "gwenviewconfig.h"
 #include "exiv2imageloader.h"
+#include "gvdebug.h"
+#include "tracer.h"
 
 // KDE
 #include <QDebug>
@@ -59,6 +61,7 @@ const int MIN_PREV_SIZE = 1000;
 //------------------------------------------------------------------------
 bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
 {
+    GV_TRACE_SCOPE("ThumbnailContext::load");
     mImage = QImage();
     mNeedCaching = true;
     Orientation orientation = NORMAL;
@@ -194,26 +197,36 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
 //------------------------------------------------------------------------
 ThumbnailGenerator::ThumbnailGenerator()
 : mCancel(false)
-{}
+{
+    connect(&mFutureWatcher, SIGNAL(finished()), SIGNAL(finished()));
+}
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+    TaskScheduler::instance()->cancel(mFuture);
+    TaskScheduler::instance()->waitForFinished(mFuture);
+}
 
 void ThumbnailGenerator::load(
     const QString& originalUri, time_t originalTime, KIO::filesize_t originalFileSize, const QString& originalMimeType,
     const QString& pixPath,
     const QString& thumbnailPath,
-    ThumbnailGroup::Enum group)
+    ThumbnailGroup::Enum group,
+    TaskScheduler::Priority priority)
 {
-    QMutexLocker lock(&mMutex);
-    Q_ASSERT(mPixPath.isNull());
-
-    mOriginalUri = originalUri;
-    mOriginalTime = originalTime;
-    mOriginalFileSize = originalFileSize;
-    mOriginalMimeType = originalMimeType;
-    mPixPath = pixPath;
-    mThumbnailPath = thumbnailPath;
-    mThumbnailGroup = group;
-    if (!isRunning()) start();
-    mCond.wakeOne();
+    GV_RETURN_IF_FAIL(!isRunning());
+    {
+        QMutexLocker lock(&mMutex);
+        mOriginalUri = originalUri;
+        mOriginalTime = originalTime;
+        mOriginalFileSize = originalFileSize;
+        mOriginalMimeType = originalMimeType;
+        mPixPath = pixPath;
+        mThumbnailPath = thumbnailPath;
+        mThumbnailGroup = group;
+    }
+    mFuture = TaskScheduler::instance()->run(priority, this, &ThumbnailGenerator::generate);
+    mFutureWatcher.setFuture(mFuture);
 }
 
 QString ThumbnailGenerator::originalUri() const
@@ -244,66 +257,69 @@ bool ThumbnailGenerator::testCancel()
 
 void ThumbnailGenerator::cancel()
 {
-    QMutexLocker lock(&mMutex);
-    mCancel = true;
-    mCond.wakeOne();
+    {
+        QMutexLocker lock(&mMutex);
+        mCancel = true;
+    }
+    if (isRunning()) {
+        TaskScheduler::instance()->cancel(mFuture);
+    } else {
+        // Nothing to interrupt, but callers wait for finished() before
+        // deleting us
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    }
 }
 
-void ThumbnailGenerator::run()
+bool ThumbnailGenerator::isRunning() const
 {
-    LOG("");
-    while (!testCancel()) {
-        QString pixPath;
-        int pixelSize;
-        {
-            QMutexLocker lock(&mMutex);
-            // empty mPixPath means nothing to do
-            LOG("Waiting for mPixPath");
-            if (mPixPath.isNull()) {
-                LOG("mPixPath.isNull");
-                mCond.wait(&mMutex);
-            }
-        }
-        if (testCancel()) {
+    return mFuture.isRunning();
+}
+
+void ThumbnailGenerator::generate()
+{
+    QString pixPath;
+    int pixelSize;
+    {
+        QMutexLocker lock(&mMutex);
+        if (mCancel) {
             return;
         }
-        {
-            QMutexLocker lock(&mMutex);
-            pixPath = mPixPath;
-            pixelSize = ThumbnailGroup::pixelSize(mThumbnailGroup);
-        }
+        pixPath = mPixPath;
+        pixelSize = ThumbnailGroup::pixelSize(mThumbnailGroup);
+    }
+
+    Q_ASSERT(!pixPath.isNull());
+    LOG("Loading" << pixPath);
+    ThumbnailContext context;
+    bool ok = context.load(pixPath, pixelSize);
 
-        Q_ASSERT(!pixPath.isNull());
-        LOG("Loading" << pixPath);
-        ThumbnailContext context;
-        bool ok = context.load(pixPath, pixelSize);
-
-        {
-            QMutexLocker lock(&mMutex);
-            if (ok) {
-                mImage = context.mImage;
-                mOriginalWidth = context.mOriginalWidth;
-                mOriginalHeight = context.mOriginalHeight;
-                if (context.mNeedCaching) {
-                    cacheThumbnail();
-                }
-            } else {
-                qWarning() << "Could not generate thumbnail for file" << mOriginalUri;
+    {
+        QMutexLocker lock(&mMutex);
+        if (ok) {
+            mImage = context.mImage;
+            mOriginalWidth = context.mOriginalWidth;
+            mOriginalHeight = context.mOriginalHeight;
+            // Cache the thumbnail even if we have been cancelled in the
+            // meantime: a new generator may be waiting for it
+            if (context.mNeedCaching) {
+                cacheThumbnail();
             }
-            mPixPath.clear(); // done, ready for next
-        }
-        if (testCancel()) {
-            return;
-        }
-        {
-            QSize size(mOriginalWidth, mOriginalHeight);
-            LOG("emitting done signal, size=" << size);
-            QMutexLocker lock(&mMutex);
-            done(mImage, size);
-            LOG("Done");
+        } else {
+            qWarning() << "Could not generate thumbnail for file" << mOriginalUri;
+            mImage = QImage();
         }
+        mPixPath.clear(); // done, ready for next
+    }
+    if (testCancel()) {
+        return;
+    }
+    {
+        QSize size(mOriginalWidth, mOriginalHeight);
+        LOG("emitting done signal, size=" << size);
+        QMutexLocker lock(&mMutex);
+        done(mImage, size);
+        LOG("Done");
     }
-    LOG("Ending thread");
 }
 
 void ThumbnailGenerator::cacheThumbnail()
@@ -22,21 +22,24 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #define THUMBNAILGENERATOR_H
 
 // Local
+#include <lib/gwenviewlib_export.h>
+#include <lib/taskscheduler.h>
 #include <lib/thumbnailgroup.h>
 
 // KDE
 #include <KFileItem>
 
 // Qt
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QMutex>
-#include <QThread>
-#include <QWaitCondition>
+#include <QObject>
 
 namespace Gwenview
 {
 
-struct ThumbnailContext {
+struct GWENVIEWLIB_EXPORT ThumbnailContext {
     QImage mImage;
     int mOriginalWidth;
     int mOriginalHeight;
@@ -45,11 +48,18 @@ struct ThumbnailContext {
     bool load(const QString &pixPath, int pixelSize);
 };
 
-class ThumbnailGenerator : public QThread
+/**
+ * Generates thumbnails one at a time, as tasks of the TaskScheduler.
+ *
+ * finished() is emitted every time a thumbnail has been generated, and once
+ * after cancel() has been called.
+ */
+class ThumbnailGenerator : public QObject
 {
     Q_OBJECT
 public:
     ThumbnailGenerator();
+    ~ThumbnailGenerator();
 
     void load(
         const QString& originalUri,
@@ -58,23 +68,30 @@ public:
         const QString& originalMimeType,
         const QString& pixPath,
         const QString& thumbnailPath,
-        ThumbnailGroup::Enum group);
+        ThumbnailGroup::Enum group,
+        TaskScheduler::Priority priority);
 
     void cancel();
 
+    /**
+     * Returns true if a thumbnail is being generated or waiting to be
+     * generated
+     */
+    bool isRunning() const;
+
     QString originalUri() const;
     time_t originalTime() const;
     KIO::filesize_t originalFileSize() const;
     QString originalMimeType() const;
-protected:
-    virtual void run() Q_DECL_OVERRIDE;
 
 Q_SIGNALS:
     void done(const QImage&, const QSize&);
     void thumbnailReadyToBeCached(const QString& thumbnailPath, const QImage&);
+    void finished();
 
 private:
     bool testCancel();
+    void generate();
     void cacheThumbnail();
     QImage mImage;
     QString mPixPath;
@@ -86,9 +103,10 @@ private:
     int mOriginalWidth;
     int mOriginalHeight;
     QMutex mMutex;
-    QWaitCondition mCond;
     ThumbnailGroup::Enum mThumbnailGroup;
     bool mCancel;
+    QFuture<void> mFuture;
+    QFutureWatcher<void> mFutureWatcher;
 };
 
 } // namespace
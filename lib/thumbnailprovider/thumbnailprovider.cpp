@@ -34,6 +34,7 @@
 #include <QPixmap>
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QMatrix>
 #include <QTemporaryFile>
 #include <QApplication>
 #include <QStandardPaths>
@@ -47,7 +48,14 @@
 #include <KFileMetaInfo>
 
 // Local
+#include "exiv2imageloader.h"
+#include "gwenviewconfig.h"
+#include "imageutils.h"
+#include "jpegcontent.h"
 #include "mimetypeutils.h"
+#include "perfcounters.h"
+#include "remotefilecache.h"
+#include "remotefilereader.h"
 #include "thumbnailwriter.h"
 #include "thumbnailgenerator.h"
 #include "urlutils.h"
@@ -72,6 +80,40 @@ static QString generateOriginalUri(const QUrl &url_)
     return url.adjusted(QUrl::RemovePassword).url();
 }
 
+/**
+ * Loads the EXIF thumbnail of the image whose beginning is @a data. Returns
+ * false if there is none or if it is smaller than @a pixelSize.
+ */
+static bool loadEmbeddedThumbnail(const QByteArray& data, int pixelSize, QImage* thumbnail, QSize* originalSize)
+{
+    // Same rule as ThumbnailContext::load(): the embedded thumbnail might not
+    // be rotated like the image if applyExifOrientation is not set
+    if (!GwenviewConfig::applyExifOrientation()) {
+        return false;
+    }
+    Exiv2ImageLoader loader;
+    if (!loader.load(data)) {
+        return false;
+    }
+    Exiv2::Image::AutoPtr exiv2Image = loader.popImage();
+    JpegContent content;
+    if (!content.loadFromData(data, exiv2Image.get())) {
+        return false;
+    }
+    QImage image = content.thumbnail();
+    if (qMax(image.width(), image.height()) < pixelSize) {
+        return false;
+    }
+    const Orientation orientation = content.orientation();
+    if (orientation != NORMAL && orientation != NOT_AVAILABLE) {
+        image = image.transformed(ImageUtils::transformMatrix(orientation));
+    }
+    *thumbnail = image;
+    // JpegContent::size() is already transposed
+    *originalSize = content.size();
+    return true;
+}
+
 static QString generateThumbnailPath(const QString& uri, ThumbnailGroup::Enum group)
 {
     QString baseDir = ThumbnailProvider::thumbnailBaseDir(group);
@@ -155,6 +197,7 @@ ThumbnailProvider::ThumbnailProvider()
 : KIO::Job()
 , mState(STATE_NEXTTHUMB)
 , mOriginalTime(0)
+, mReportedQueueDepth(0)
 {
     LOG(this);
 
@@ -173,7 +216,10 @@ ThumbnailProvider::ThumbnailProvider()
 ThumbnailProvider::~ThumbnailProvider()
 {
     LOG(this);
+    mItems.clear();
+    updateQueueDepth();
     abortSubjob();
+    releaseCachedPath();
     mThumbnailGenerator->cancel();
     disconnect(mThumbnailGenerator, 0, this, 0);
     disconnect(mThumbnailGenerator, 0, sThumbnailWriter, 0);
@@ -190,7 +236,10 @@ void ThumbnailProvider::stop()
     // but also make sure that at most two ThumbnailGenerators are running.
     // startCreatingThumbnail() will take care that these two threads won't work on the same item.
     mItems.clear();
-    abortSubjob();
+    updateQueueDepth();
+    if (abortSubjob()) {
+        mCurrentItem = KFileItem();
+    }
     if (mThumbnailGenerator->isRunning() && !mPreviousThumbnailGenerator) {
         mPreviousThumbnailGenerator = mThumbnailGenerator;
         mPreviousThumbnailGenerator->cancel();
@@ -211,6 +260,11 @@ void ThumbnailProvider::setThumbnailGroup(ThumbnailGroup::Enum group)
     mThumbnailGroup = group;
 }
 
+void ThumbnailProvider::setVisibleUrls(const QSet<QUrl>& urls)
+{
+    mVisibleUrls = urls;
+}
+
 void ThumbnailProvider::appendItems(const KFileItemList& items)
 {
     if (!mItems.isEmpty()) {
@@ -227,6 +281,7 @@ void ThumbnailProvider::appendItems(const KFileItemList& items)
     } else {
         mItems = items;
     }
+    updateQueueDepth();
 
     if (mCurrentItem.isNull()) {
         determineNextIcon();
@@ -243,10 +298,12 @@ void ThumbnailProvider::removeItems(const KFileItemList& itemList)
         // first if we removed the last item
         mItems.removeAll(item);
 
-        if (item == mCurrentItem) {
-            abortSubjob();
+        if (item == mCurrentItem && abortSubjob()) {
+            // Nothing is going to finish the current item, move on
+            mCurrentItem = KFileItem();
         }
     }
+    updateQueueDepth();
 
     // No more current item, carry on to the next remaining item
     if (mCurrentItem.isNull()) {
@@ -257,6 +314,7 @@ void ThumbnailProvider::removeItems(const KFileItemList& itemList)
 void ThumbnailProvider::removePendingItems()
 {
     mItems.clear();
+    updateQueueDepth();
 }
 
 bool ThumbnailProvider::isRunning() const
@@ -277,21 +335,37 @@ void ThumbnailProvider::createNewThumbnailGenerator()
             Qt::QueuedConnection);
 }
 
-void ThumbnailProvider::abortSubjob()
+bool ThumbnailProvider::abortSubjob()
 {
+    bool aborted = false;
+    if (mHeaderReader) {
+        LOG("Aborting header reading");
+        mHeaderReader->disconnect(this);
+        mHeaderReader->deleteLater();
+        aborted = true;
+    }
+    if (mCacheWriteWatcher) {
+        LOG("Not waiting for the cached copy anymore");
+        // Deleting the watcher drops its pending finished() signal
+        delete mCacheWriteWatcher;
+        mRemoteData.clear();
+        aborted = true;
+    }
     if (hasSubjobs()) {
         LOG("Killing subjob");
         KJob* job = subjobs().first();
         job->kill();
         removeSubjob(job);
-        mCurrentItem = KFileItem();
+        aborted = true;
     }
+    return aborted;
 }
 
 void ThumbnailProvider::determineNextIcon()
 {
     LOG(this);
     mState = STATE_NEXTTHUMB;
+    releaseCachedPath();
 
     // No more items ?
     if (mItems.isEmpty()) {
@@ -302,6 +376,7 @@ void ThumbnailProvider::determineNextIcon()
     }
 
     mCurrentItem = mItems.takeFirst();
+    updateQueueDepth();
     LOG("mCurrentItem.url=" << mCurrentItem.url());
 
     // First, stat the orig file
@@ -336,6 +411,8 @@ void ThumbnailProvider::slotResult(KJob * job)
 
     switch (mState) {
     case STATE_NEXTTHUMB:
+    case STATE_READHEADER:
+    case STATE_STORECOPY:
         Q_ASSERT(false);
         determineNextIcon();
         return;
@@ -363,7 +440,15 @@ void ThumbnailProvider::slotResult(KJob * job)
             mTempPath.clear();
             determineNextIcon();
         } else {
-            startCreatingThumbnail(mTempPath);
+            const QString path = RemoteFileCache::instance()->insertFile(mCurrentUrl, mOriginalTime, mOriginalFileSize, mTempPath);
+            if (!path.isEmpty()) {
+                // The file now belongs to the cache
+                mTempPath.clear();
+                mCachedPath = path;
+                startCreatingThumbnail(path);
+            } else {
+                startCreatingThumbnail(mTempPath);
+            }
         }
         return;
 
@@ -458,6 +543,7 @@ void ThumbnailProvider::checkThumbnail()
                 // Don't try to determine the size of a video, it probably won't work and
                 // will cause high I/O usage with big files (bug #307007).
                 if (MimeTypeUtils::urlKind(mCurrentUrl) == MimeTypeUtils::KIND_VIDEO) {
+                    PerfCounters::add(PerfCounters::ThumbnailCacheHits);
                     emitThumbnailLoaded(thumb, QSize());
                     determineNextIcon();
                     return;
@@ -474,6 +560,7 @@ void ThumbnailProvider::checkThumbnail()
                     qWarning() << "Could not get a valid KFileMetaInfo instance for" << mOriginalUri;
                 }
             }
+            PerfCounters::add(PerfCounters::ThumbnailCacheHits);
             emitThumbnailLoaded(thumb, size);
             determineNextIcon();
             return;
@@ -481,29 +568,21 @@ void ThumbnailProvider::checkThumbnail()
     }
 
     // Thumbnail not found or not valid
+    PerfCounters::add(PerfCounters::ThumbnailCacheMisses);
     if (MimeTypeUtils::fileItemKind(mCurrentItem) == MimeTypeUtils::KIND_RASTER_IMAGE) {
         if (mCurrentUrl.isLocalFile()) {
             // Original is a local file, create the thumbnail
             startCreatingThumbnail(mCurrentUrl.toLocalFile());
         } else {
-            // Original is remote, download it
-            mState = STATE_DOWNLOADORIG;
-
-            QTemporaryFile tempFile;
-            tempFile.setAutoRemove(false);
-            if (!tempFile.open()) {
-                qWarning() << "Couldn't create temp file to download " << mCurrentUrl.toDisplayString();
-                emitThumbnailLoadingFailed();
-                determineNextIcon();
-                return;
+            // Original is remote, use our copy if we have one, otherwise look
+            // for an embedded thumbnail before downloading it
+            const QString path = RemoteFileCache::instance()->acquire(mCurrentUrl, mOriginalTime, mOriginalFileSize);
+            if (!path.isEmpty()) {
+                mCachedPath = path;
+                startCreatingThumbnail(path);
+            } else {
+                startReadingHeader();
             }
-            mTempPath = tempFile.fileName();
-
-            QUrl url = QUrl::fromLocalFile(mTempPath);
-            KIO::Job* job = KIO::file_copy(mCurrentUrl, url, -1, KIO::Overwrite | KIO::HideProgressInfo);
-            KJobWidgets::setWindow(job, qApp->activeWindow());
-            LOG("Download remote file" << mCurrentUrl.toDisplayString() << "to" << url.toDisplayString());
-            addSubjob(job);
         }
     } else {
         // Not a raster image, use a KPreviewJob
@@ -525,6 +604,142 @@ void ThumbnailProvider::checkThumbnail()
     }
 }
 
+bool ThumbnailProvider::createTempFile()
+{
+    // Download to the cache dir, so that moving the file to the cache does
+    // not copy it
+    QTemporaryFile tempFile(RemoteFileCache::instance()->temporaryFileTemplate());
+    tempFile.setAutoRemove(false);
+    if (!tempFile.open()) {
+        qWarning() << "Couldn't create temp file to download " << mCurrentUrl.toDisplayString();
+        return false;
+    }
+    mTempPath = tempFile.fileName();
+    return true;
+}
+
+bool ThumbnailProvider::writeTempFile(const QByteArray& data)
+{
+    QTemporaryFile tempFile;
+    tempFile.setAutoRemove(false);
+    if (!tempFile.open() || tempFile.write(data) != data.size()) {
+        qWarning() << "Couldn't write temp file for" << mCurrentUrl.toDisplayString();
+        tempFile.setAutoRemove(true);
+        return false;
+    }
+    mTempPath = tempFile.fileName();
+    return true;
+}
+
+void ThumbnailProvider::startReadingHeader()
+{
+    LOG("Read header of" << mCurrentUrl.toDisplayString());
+    mState = STATE_READHEADER;
+    mHeaderReader = new RemoteFileReader(mCurrentUrl, this);
+    connect(mHeaderReader, SIGNAL(headerRead(QByteArray,bool)),
+            SLOT(slotHeaderRead(QByteArray,bool)));
+    connect(mHeaderReader, SIGNAL(failed(QString)),
+            SLOT(slotHeaderReadFailed()));
+    mHeaderReader->readHeader(REMOTE_HEADER_SIZE);
+}
+
+void ThumbnailProvider::slotHeaderRead(const QByteArray& data, bool complete)
+{
+    mHeaderReader->deleteLater();
+    if (mCurrentItem.isNull()) {
+        determineNextIcon();
+        return;
+    }
+
+    if (complete) {
+        // Small file, we already have all of it. Store it in the background
+        // and create the thumbnail from the cached copy once it is written
+        mState = STATE_STORECOPY;
+        mRemoteData = data;
+        mCacheWriteWatcher = new QFutureWatcher<void>(this);
+        connect(mCacheWriteWatcher, SIGNAL(finished()), SLOT(slotCachedCopyStored()));
+        mCacheWriteWatcher->setFuture(RemoteFileCache::instance()->insert(mCurrentUrl, mOriginalTime, mOriginalFileSize, data));
+        return;
+    }
+
+    QImage thumbnail;
+    QSize size;
+    if (!loadEmbeddedThumbnail(data, ThumbnailGroup::pixelSize(mThumbnailGroup), &thumbnail, &size)) {
+        startDownloading();
+        return;
+    }
+    LOG("Using embedded thumbnail of" << mCurrentUrl.toDisplayString());
+    thumbnail.setText("Thumb::URI"          , mOriginalUri);
+    thumbnail.setText("Thumb::MTime"        , QString::number(mOriginalTime));
+    thumbnail.setText("Thumb::Size"         , QString::number(mOriginalFileSize));
+    thumbnail.setText("Thumb::Mimetype"     , mCurrentItem.mimetype());
+    thumbnail.setText("Thumb::Image::Width" , QString::number(size.width()));
+    thumbnail.setText("Thumb::Image::Height", QString::number(size.height()));
+    thumbnail.setText("Software"            , QStringLiteral("Gwenview"));
+    sThumbnailWriter->queueThumbnail(mThumbnailPath, thumbnail);
+    emitThumbnailLoaded(thumbnail, size);
+    determineNextIcon();
+}
+
+void ThumbnailProvider::slotCachedCopyStored()
+{
+    mCacheWriteWatcher->deleteLater();
+    const QByteArray data = mRemoteData;
+    mRemoteData.clear();
+    if (mCurrentItem.isNull()) {
+        determineNextIcon();
+        return;
+    }
+
+    const QString path = RemoteFileCache::instance()->acquire(mCurrentUrl, mOriginalTime, mOriginalFileSize);
+    if (!path.isEmpty()) {
+        mCachedPath = path;
+        startCreatingThumbnail(path);
+        return;
+    }
+    // The cache could not keep it
+    if (!writeTempFile(data)) {
+        emitThumbnailLoadingFailed();
+        determineNextIcon();
+        return;
+    }
+    startCreatingThumbnail(mTempPath);
+}
+
+void ThumbnailProvider::releaseCachedPath()
+{
+    if (!mCachedPath.isEmpty()) {
+        RemoteFileCache::instance()->release(mCachedPath);
+        mCachedPath.clear();
+    }
+}
+
+void ThumbnailProvider::slotHeaderReadFailed()
+{
+    mHeaderReader->deleteLater();
+    if (mCurrentItem.isNull()) {
+        determineNextIcon();
+        return;
+    }
+    startDownloading();
+}
+
+void ThumbnailProvider::startDownloading()
+{
+    mState = STATE_DOWNLOADORIG;
+    if (!createTempFile()) {
+        emitThumbnailLoadingFailed();
+        determineNextIcon();
+        return;
+    }
+
+    QUrl url = QUrl::fromLocalFile(mTempPath);
+    KIO::Job* job = KIO::file_copy(mCurrentUrl, url, -1, KIO::Overwrite | KIO::HideProgressInfo);
+    KJobWidgets::setWindow(job, qApp->activeWindow());
+    LOG("Download remote file" << mCurrentUrl.toDisplayString() << "to" << url.toDisplayString());
+    addSubjob(job);
+}
+
 void ThumbnailProvider::startCreatingThumbnail(const QString& pixPath)
 {
     LOG("Creating thumbnail from" << pixPath);
@@ -540,10 +755,14 @@ void ThumbnailProvider::startCreatingThumbnail(const QString& pixPath)
         mCurrentItem.mimetype() == mPreviousThumbnailGenerator->originalMimeType()) {
             connect(mPreviousThumbnailGenerator, SIGNAL(finished()), SLOT(determineNextIcon()));
             mItems.prepend(mCurrentItem);
+            updateQueueDepth();
             return;
     }
+    TaskScheduler::Priority priority = mVisibleUrls.contains(mCurrentItem.url())
+        ? TaskScheduler::VisibleThumbnail
+        : TaskScheduler::OffscreenThumbnail;
     mThumbnailGenerator->load(mOriginalUri, mOriginalTime, mOriginalFileSize,
-                          mCurrentItem.mimetype(), pixPath, mThumbnailPath, mThumbnailGroup);
+                          mCurrentItem.mimetype(), pixPath, mThumbnailPath, mThumbnailGroup, priority);
 }
 
 void ThumbnailProvider::slotGotPreview(const KFileItem& item, const QPixmap& pixmap)
@@ -568,6 +787,13 @@ void ThumbnailProvider::emitThumbnailLoaded(const QImage& img, const QSize& size
     emit thumbnailLoaded(mCurrentItem, thumb, size, mOriginalFileSize);
 }
 
+void ThumbnailProvider::updateQueueDepth()
+{
+    const int depth = mItems.count();
+    PerfCounters::add(PerfCounters::ThumbnailQueueDepth, depth - mReportedQueueDepth);
+    mReportedQueueDepth = depth;
+}
+
 void ThumbnailProvider::emitThumbnailLoadingFailed()
 {
     if (mCurrentItem.isNull()) {
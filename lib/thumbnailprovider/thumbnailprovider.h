@@ -27,9 +27,12 @@
 #include <lib/gwenviewlib_export.h>
 
 // Qt
+#include <QFutureWatcher>
 #include <QImage>
 #include <QPixmap>
 #include <QPointer>
+#include <QSet>
+#include <QUrl>
 
 // KDE
 #include <KIO/Job>
@@ -41,6 +44,7 @@
 namespace Gwenview
 {
 
+class RemoteFileReader;
 class ThumbnailGenerator;
 class ThumbnailWriter;
 
@@ -81,6 +85,12 @@ public:
      */
     void setThumbnailGroup(ThumbnailGroup::Enum);
 
+    /**
+     * Defines which items are currently visible: their thumbnails are
+     * generated with a higher priority than the others
+     */
+    void setVisibleUrls(const QSet<QUrl>&);
+
     bool isRunning() const;
 
     /**
@@ -136,9 +146,12 @@ private Q_SLOTS:
     void checkThumbnail();
     void thumbnailReady(const QImage&, const QSize&);
     void emitThumbnailLoadingFailed();
+    void slotHeaderRead(const QByteArray&, bool complete);
+    void slotHeaderReadFailed();
+    void slotCachedCopyStored();
 
 private:
-    enum { STATE_STATORIG, STATE_DOWNLOADORIG, STATE_PREVIEWJOB, STATE_NEXTTHUMB } mState;
+    enum { STATE_STATORIG, STATE_READHEADER, STATE_STORECOPY, STATE_DOWNLOADORIG, STATE_PREVIEWJOB, STATE_NEXTTHUMB } mState;
 
     KFileItemList mItems;
     KFileItem mCurrentItem;
@@ -161,20 +174,46 @@ private:
     // The temporary path for remote urls
     QString mTempPath;
 
+    // The RemoteFileCache copy of remote urls, leased until the item is done
+    QString mCachedPath;
+
+    // Content of small remote files, while it is being stored in the
+    // RemoteFileCache
+    QByteArray mRemoteData;
+    QPointer<QFutureWatcher<void> > mCacheWriteWatcher;
+
     // Thumbnail group
     ThumbnailGroup::Enum mThumbnailGroup;
 
+    QSet<QUrl> mVisibleUrls;
+
     ThumbnailGenerator* mThumbnailGenerator;
     QPointer<ThumbnailGenerator> mPreviousThumbnailGenerator;
 
+    QPointer<RemoteFileReader> mHeaderReader;
+
     QStringList mPreviewPlugins;
 
+    // Size of mItems, as last added to PerfCounters::ThumbnailQueueDepth
+    int mReportedQueueDepth;
+
     void createNewThumbnailGenerator();
-    void abortSubjob();
+    /**
+     * Stops reading or downloading the current item. Returns false if
+     * nothing was in progress.
+     */
+    bool abortSubjob();
     void startCreatingThumbnail(const QString& path);
+    void startReadingHeader();
+    void startDownloading();
+    bool createTempFile();
+    void releaseCachedPath();
+    bool writeTempFile(const QByteArray&);
 
     void emitThumbnailLoaded(const QImage& img, const QSize& size);
 
+    void updateQueueDepth();
+
     QImage loadThumbnailFromCache() const;
 };
 
@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "thumbnailwriter.h"
 
 // Local
+#include "taskscheduler.h"
+#include "tracer.h"
 
 // KDE
 #include <kde_file.h>
@@ -45,6 +47,7 @@ namespace Gwenview
 
 static void storeThumbnailToDiskCache(const QString& path, const QImage& image)
 {
+    GV_TRACE_SCOPE("storeThumbnailToDiskCache");
     LOG(path);
     QTemporaryFile tmp(path + QStringLiteral(".gwenview.tmpXXXXXX.png"));
     if (!tmp.open()) {
@@ -60,15 +63,22 @@ static void storeThumbnailToDiskCache(const QString& path, const QImage& image)
     KDE_rename(QFile::encodeName(tmp.fileName()), QFile::encodeName(path));
 }
 
+ThumbnailWriter::ThumbnailWriter()
+: mTaskPending(false)
+{}
+
 void ThumbnailWriter::queueThumbnail(const QString& path, const QImage& image)
 {
     LOG(path);
     QMutexLocker locker(&mMutex);
     mCache.insert(path, image);
-    start();
+    if (!mTaskPending) {
+        mTaskPending = true;
+        mFuture = TaskScheduler::instance()->run(TaskScheduler::OffscreenThumbnail, this, &ThumbnailWriter::storeThumbnails);
+    }
 }
 
-void ThumbnailWriter::run()
+void ThumbnailWriter::storeThumbnails()
 {
     QMutexLocker locker(&mMutex);
     while (!mCache.isEmpty()) {
@@ -76,7 +86,7 @@ void ThumbnailWriter::run()
         const QString path = it.key();
         const QImage image = it.value();
 
-        // This part of the thread is the most time consuming but it does not
+        // This part of the task is the most time consuming but it does not
         // depend on mCache so we can unlock here. This way other thumbnails
         // can be added or queried
         locker.unlock();
@@ -85,6 +95,17 @@ void ThumbnailWriter::run()
 
         mCache.remove(path);
     }
+    mTaskPending = false;
+}
+
+void ThumbnailWriter::wait()
+{
+    QFuture<void> future;
+    {
+        QMutexLocker locker(&mMutex);
+        future = mFuture;
+    }
+    TaskScheduler::instance()->waitForFinished(future);
 }
 
 QImage ThumbnailWriter::value(const QString& path) const
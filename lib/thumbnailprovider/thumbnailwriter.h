@@ -26,9 +26,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KDE
 
 // Qt
+#include <QFuture>
 #include <QHash>
 #include <QMutex>
-#include <QThread>
+#include <QObject>
 
 class QImage;
 
@@ -36,27 +37,38 @@ namespace Gwenview
 {
 
 /**
- * Store thumbnails to disk when done generating them
+ * Store thumbnails to disk when done generating them. Thumbnails are written
+ * by a low priority task of the TaskScheduler.
  */
-class ThumbnailWriter : public QThread
+class ThumbnailWriter : public QObject
 {
     Q_OBJECT
 public:
+    ThumbnailWriter();
+
     // Return thumbnail if it has still not been stored
     QImage value(const QString&) const;
 
     bool isEmpty() const;
 
+    /**
+     * Blocks until all queued thumbnails have been written
+     */
+    void wait();
+
 public Q_SLOTS:
     void queueThumbnail(const QString&, const QImage&);
 
-protected:
-    void run() Q_DECL_OVERRIDE;
-
 private:
+    void storeThumbnails();
+
     typedef QHash<QString, QImage> Cache;
     Cache mCache;
     mutable QMutex mMutex;
+    // True while a task is queued or running, it is responsible for writing
+    // everything in mCache
+    bool mTaskPending;
+    QFuture<void> mFuture;
 };
 
 } // namespace
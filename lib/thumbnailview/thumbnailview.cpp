@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <math.h>
 
 // Qt
+#include <QAbstractProxyModel>
 #include <QApplication>
 #include <QDragEnterEvent>
 #include <QDropEvent>
@@ -51,6 +52,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "mimetypeutils.h"
 #include "urlutils.h"
 #include <lib/gvdebug.h>
+#include <lib/historymodel.h>
+#include <lib/recentfilesmodel.h>
+#include <lib/recursivedirmodel.h>
 #include <lib/thumbnailprovider/thumbnailprovider.h>
 
 namespace Gwenview
@@ -86,11 +90,50 @@ static QUrl urlForIndex(const QModelIndex& index)
     return item.isNull() ? QUrl() : item.url();
 }
 
+/**
+ * Returns the index of @a url in @a model, which must be one of the models
+ * ThumbnailView is used with, or a chain of proxy models on top of one. The
+ * lookup goes through the url map of the source model.
+ */
+static QModelIndex indexForUrl(const QAbstractItemModel* model, const QUrl& url)
+{
+    if (!model || !url.isValid()) {
+        return QModelIndex();
+    }
+    const QAbstractProxyModel* proxyModel = qobject_cast<const QAbstractProxyModel*>(model);
+    if (proxyModel) {
+        const QModelIndex sourceIndex = indexForUrl(proxyModel->sourceModel(), url);
+        return sourceIndex.isValid() ? proxyModel->mapFromSource(sourceIndex) : QModelIndex();
+    }
+    const KDirModel* dirModel = qobject_cast<const KDirModel*>(model);
+    if (dirModel) {
+        return dirModel->indexForUrl(url);
+    }
+    const RecursiveDirModel* recursiveDirModel = qobject_cast<const RecursiveDirModel*>(model);
+    if (recursiveDirModel) {
+        return recursiveDirModel->indexForUrl(url);
+    }
+    const HistoryModel* historyModel = qobject_cast<const HistoryModel*>(model);
+    if (historyModel) {
+        return historyModel->indexForUrl(url);
+    }
+    const RecentFilesModel* recentFilesModel = qobject_cast<const RecentFilesModel*>(model);
+    if (recentFilesModel) {
+        return recentFilesModel->indexForUrl(url);
+    }
+    qWarning() << "Unsupported model" << model->metaObject()->className();
+    return QModelIndex();
+}
+
+/**
+ * Thumbnails are looked up by url, they do not keep a QPersistentModelIndex:
+ * Qt would have to update all of them each time the model is sorted or
+ * filtered, which is slow for big dirs.
+ */
 struct Thumbnail
 {
-    Thumbnail(const QPersistentModelIndex& index_, const QDateTime& mtime)
-        : mIndex(index_)
-        , mModificationTime(mtime)
+    Thumbnail(const QDateTime& mtime)
+        : mModificationTime(mtime)
         , mFileSize(0)
         , mRough(true)
         , mWaitingForThumbnail(true) {}
@@ -140,7 +183,6 @@ struct Thumbnail
         mWaitingForThumbnail = true;
     }
 
-    QPersistentModelIndex mIndex;
     QDateTime mModificationTime;
     /// The pix loaded from .thumbnails/{large,normal}
     QPixmap mGroupPix;
@@ -162,7 +204,7 @@ struct Thumbnail
 
 typedef QHash<QUrl, Thumbnail> ThumbnailForUrl;
 typedef QQueue<QUrl> UrlQueue;
-typedef QSet<QPersistentModelIndex> PersistentModelIndexSet;
+typedef QSet<QUrl> UrlSet;
 
 struct ThumbnailViewPrivate
 {
@@ -181,7 +223,7 @@ struct ThumbnailViewPrivate
     QPixmap mWaitingThumbnail;
     QPointer<ThumbnailProvider> mThumbnailProvider;
 
-    PersistentModelIndexSet mBusyIndexSet;
+    UrlSet mBusyUrlSet;
     KPixmapSequence mBusySequence;
     QTimeLine* mBusyAnimationTimeLine;
 
@@ -197,6 +239,11 @@ struct ThumbnailViewPrivate
         QObject::connect(mBusyAnimationTimeLine, &QTimeLine::frameChanged, q, &ThumbnailView::updateBusyIndexes);
     }
 
+    QModelIndex indexForUrl(const QUrl& url) const
+    {
+        return Gwenview::indexForUrl(q->model(), url);
+    }
+
     void scheduleThumbnailGeneration()
     {
         if (mThumbnailProvider) {
@@ -215,7 +262,7 @@ struct ThumbnailViewPrivate
         QPixmap pix;
         QSize fullSize;
         mDocumentInfoProvider->thumbnailForDocument(url, group, &pix, &fullSize);
-        mThumbnailForUrl[url] = Thumbnail(QPersistentModelIndex(index), QDateTime::currentDateTime());
+        mThumbnailForUrl[url] = Thumbnail(QDateTime::currentDateTime());
         q->setThumbnail(item, pix, fullSize, 0);
     }
 
@@ -476,6 +523,7 @@ void ThumbnailView::rowsAboutToBeRemoved(const QModelIndex& parent, int start, i
         QUrl url = item.url();
         d->mThumbnailForUrl.remove(url);
         d->mSmoothThumbnailQueue.removeAll(url);
+        d->mBusyUrlSet.remove(url);
 
         itemList.append(item);
     }
@@ -483,6 +531,9 @@ void ThumbnailView::rowsAboutToBeRemoved(const QModelIndex& parent, int start, i
     if (d->mThumbnailProvider) {
         d->mThumbnailProvider->removeItems(itemList);
     }
+    if (d->mBusyUrlSet.isEmpty()) {
+        d->mBusyAnimationTimeLine->stop();
+    }
 
     // Removing rows might make new images visible, make sure their thumbnail
     // is generated
@@ -559,7 +610,7 @@ void ThumbnailView::setThumbnail(const KFileItem& item, const QPixmap& pixmap, c
     thumbnail.mWaitingForThumbnail = false;
     thumbnail.mFileSize = fileSize;
 
-    update(thumbnail.mIndex);
+    update(d->indexForUrl(item.url()));
     if (d->mScaleMode != ScaleToFit) {
         scheduleDelayedItemsLayout();
     }
@@ -589,7 +640,7 @@ void ThumbnailView::setBrokenThumbnail(const KFileItem& item)
         thumbnail.initAsIcon(DesktopIcon("image-missing", 48));
         thumbnail.mFullSize = thumbnail.mGroupPix.size();
     }
-    update(thumbnail.mIndex);
+    update(d->indexForUrl(item.url()));
 }
 
 QPixmap ThumbnailView::thumbnailForIndex(const QModelIndex& index, QSize* fullSize)
@@ -607,7 +658,7 @@ QPixmap ThumbnailView::thumbnailForIndex(const QModelIndex& index, QSize* fullSi
     // Find or create Thumbnail instance
     ThumbnailForUrl::Iterator it = d->mThumbnailForUrl.find(url);
     if (it == d->mThumbnailForUrl.end()) {
-        Thumbnail thumbnail = Thumbnail(QPersistentModelIndex(index), item.time(KFileItem::ModificationTime));
+        Thumbnail thumbnail = Thumbnail(item.time(KFileItem::ModificationTime));
         it = d->mThumbnailForUrl.insert(url, thumbnail);
     }
     Thumbnail& thumbnail = it.value();
@@ -800,6 +851,7 @@ void ThumbnailView::generateThumbnailsForItems()
 
     // distance => item
     QMultiMap<int, KFileItem> itemMap;
+    QSet<QUrl> visibleUrls;
 
     for (int row = 0; row < model()->rowCount(); ++row) {
         QModelIndex index = model()->index(row, 0);
@@ -839,6 +891,7 @@ void ThumbnailView::generateThumbnailsForItems()
             visibleItemFract = visibleItemRect.width() * visibleItemRect.height() / itemSurface;
         }
         if (visibleItemFract > 0.7) {
+            visibleUrls.insert(url);
             // Item is visible, order thumbnails from left to right, top to bottom
             // Distance is computed so that it is between 0 and visibleSurface
             distance = itemRect.top() * visibleRect.width() + itemRect.left();
@@ -860,12 +913,15 @@ void ThumbnailView::generateThumbnailsForItems()
         // Insert the thumbnail in mThumbnailForUrl, so that
         // setThumbnail() can find the item to update
         if (it == d->mThumbnailForUrl.constEnd()) {
-            Thumbnail thumbnail = Thumbnail(QPersistentModelIndex(index), item.time(KFileItem::ModificationTime));
+            Thumbnail thumbnail = Thumbnail(item.time(KFileItem::ModificationTime));
             d->mThumbnailForUrl.insert(url, thumbnail);
         }
     }
 
     if (!itemMap.isEmpty()) {
+        if (d->mThumbnailProvider) {
+            d->mThumbnailProvider->setVisibleUrls(visibleUrls);
+        }
         d->appendItemsToThumbnailProvider(itemMap.values());
     }
 }
@@ -883,18 +939,18 @@ void ThumbnailView::updateThumbnail(const QModelIndex& index)
     }
 }
 
-void ThumbnailView::updateThumbnailBusyState(const QModelIndex& _index, bool busy)
+void ThumbnailView::updateThumbnailBusyState(const QModelIndex& index, bool busy)
 {
-    QPersistentModelIndex index(_index);
-    if (busy && !d->mBusyIndexSet.contains(index)) {
-        d->mBusyIndexSet << index;
+    const QUrl url = urlForIndex(index);
+    if (busy && !d->mBusyUrlSet.contains(url)) {
+        d->mBusyUrlSet << url;
         update(index);
         if (d->mBusyAnimationTimeLine->state() != QTimeLine::Running) {
             d->mBusyAnimationTimeLine->start();
         }
-    } else if (!busy && d->mBusyIndexSet.remove(index)) {
+    } else if (!busy && d->mBusyUrlSet.remove(url)) {
         update(index);
-        if (d->mBusyIndexSet.isEmpty()) {
+        if (d->mBusyUrlSet.isEmpty()) {
             d->mBusyAnimationTimeLine->stop();
         }
     }
@@ -902,8 +958,11 @@ void ThumbnailView::updateThumbnailBusyState(const QModelIndex& _index, bool bus
 
 void ThumbnailView::updateBusyIndexes()
 {
-    Q_FOREACH(const QPersistentModelIndex & index, d->mBusyIndexSet) {
-        update(index);
+    Q_FOREACH(const QUrl& url, d->mBusyUrlSet) {
+        const QModelIndex index = d->indexForUrl(url);
+        if (index.isValid()) {
+            update(index);
+        }
     }
 }
 
@@ -932,8 +991,9 @@ void ThumbnailView::smoothNextThumbnail()
     thumbnail.mAdjustedPix = d->scale(thumbnail.mGroupPix, Qt::SmoothTransformation);
     thumbnail.mRough = false;
 
-    GV_RETURN_IF_FAIL2(thumbnail.mIndex.isValid(), "index for" << url << "is invalid.");
-    update(thumbnail.mIndex);
+    const QModelIndex index = d->indexForUrl(url);
+    GV_RETURN_IF_FAIL2(index.isValid(), "index for" << url << "is invalid.");
+    update(index);
 
     if (!d->mSmoothThumbnailQueue.isEmpty()) {
         d->mSmoothThumbnailTimer.start(0);
@@ -86,54 +86,60 @@ struct CacheItem
         if (!UrlUtils::urlIsFastLocalFile(url)) {
             return false;
         }
-        QString path = url.path();
-        Exiv2ImageLoader loader;
-        QByteArray header;
-        {
-            QFile file(path);
-            if (!file.open(QIODevice::ReadOnly)) {
-                qWarning() << "Could not open" << path << "for reading";
-                return false;
-            }
-            header = file.read(65536); // FIXME: Is this big enough?
-        }
-
-        if (!loader.load(header)) {
-            return false;
-        }
-        Exiv2::Image::AutoPtr img = loader.popImage();
-        try {
-            Exiv2::ExifData exifData = img->exifData();
-            if (exifData.empty()) {
-                return false;
-            }
-            Exiv2::ExifData::const_iterator it = findDateTimeKey(exifData);
-            if (it == exifData.end()) {
-                qWarning() << "No date in exif header of" << path;
-                return false;
-            }
-
-            std::ostringstream stream;
-            stream << *it;
-            QString value = QString::fromLocal8Bit(stream.str().c_str());
-
-            QDateTime dt = QDateTime::fromString(value, "yyyy:MM:dd hh:mm:ss");
-            if (!dt.isValid()) {
-                qWarning() << "Invalid date in exif header of" << path;
-                return false;
-            }
-
-            realTime = dt;
-            return true;
-        } catch (const Exiv2::Error& error) {
-            qWarning() << "Failed to read date from exif header of" << path << ". Error:" << error.what();
+        QDateTime dt = dateTimeFromExif(url.path());
+        if (!dt.isValid()) {
             return false;
         }
+        realTime = dt;
+        return true;
     }
 };
 
 typedef QHash<QUrl, CacheItem> Cache;
 
+QDateTime dateTimeFromExif(const QString& path)
+{
+    Exiv2ImageLoader loader;
+    QByteArray header;
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not open" << path << "for reading";
+            return QDateTime();
+        }
+        header = file.read(65536); // FIXME: Is this big enough?
+    }
+
+    if (!loader.load(header)) {
+        return QDateTime();
+    }
+    Exiv2::Image::AutoPtr img = loader.popImage();
+    try {
+        Exiv2::ExifData exifData = img->exifData();
+        if (exifData.empty()) {
+            return QDateTime();
+        }
+        Exiv2::ExifData::const_iterator it = findDateTimeKey(exifData);
+        if (it == exifData.end()) {
+            qWarning() << "No date in exif header of" << path;
+            return QDateTime();
+        }
+
+        std::ostringstream stream;
+        stream << *it;
+        QString value = QString::fromLocal8Bit(stream.str().c_str());
+
+        QDateTime dt = QDateTime::fromString(value, "yyyy:MM:dd hh:mm:ss");
+        if (!dt.isValid()) {
+            qWarning() << "Invalid date in exif header of" << path;
+        }
+        return dt;
+    } catch (const Exiv2::Error& error) {
+        qWarning() << "Failed to read date from exif header of" << path << ". Error:" << error.what();
+        return QDateTime();
+    }
+}
+
 QDateTime dateTimeForFileItem(const KFileItem& fileItem, CachePolicy cachePolicy)
 {
     if (cachePolicy == SkipCache) {
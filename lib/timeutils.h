@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 class KFileItem;
 class QDateTime;
+class QString;
 
 namespace Gwenview
 {
@@ -41,6 +42,13 @@ enum CachePolicy
 
 QDateTime GWENVIEWLIB_EXPORT dateTimeForFileItem(const KFileItem& fileItem, Gwenview::TimeUtils::CachePolicy cachePolicy = UseCache);
 
+/**
+ * Returns the date stored in the EXIF data of the local file @a path, or an
+ * invalid QDateTime if there is none. Unlike dateTimeForFileItem(), it can be
+ * called from a worker thread.
+ */
+QDateTime GWENVIEWLIB_EXPORT dateTimeFromExif(const QString& path);
+
 } // namespace
 
 } // namespace
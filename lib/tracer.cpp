@@ -0,0 +1,314 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "tracer.h"
+
+// Qt
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+// KDE
+
+// Local
+
+namespace Gwenview
+{
+
+static const int MAX_EVENTS = 1000000;
+
+// When there is a trace file, events are appended to it each time this many
+// events have been recorded
+static const int FLUSH_EVENT_COUNT = 100000;
+
+inline QString getTraceFile()
+{
+    return QString::fromLocal8Bit(qgetenv("GV_TRACE_FILE"));
+}
+
+QAtomicInt Tracer::sEnabled(!getTraceFile().isEmpty());
+
+struct TraceEvent
+{
+    const char* mName;
+    qint64 mBegin;
+    qint64 mDuration;
+    int mThreadId;
+};
+
+struct TracerPrivate
+{
+    QElapsedTimer mTimer;
+
+    // Protects the members below
+    QMutex mMutex;
+    QVector<TraceEvent> mEvents;
+    int mDroppedEventCount;
+    QHash<QThread*, int> mThreadIds;
+    QStringList mThreadNames;
+    QString mTraceFile;
+    // Number of threads whose name has been written to mFile
+    int mFlushedThreadCount;
+
+    // Protects the members below. Held while writing, so that flushes do not
+    // interleave, must be locked before mMutex.
+    QMutex mFileMutex;
+    QFile mFile;
+    int mFileItemCount;
+
+    TracerPrivate()
+    : mDroppedEventCount(0)
+    , mTraceFile(getTraceFile())
+    , mFlushedThreadCount(0)
+    , mFileItemCount(0)
+    {
+        mTimer.start();
+        qAddPostRoutine(finishTraceFile);
+    }
+
+    // Must be called with mMutex locked
+    int currentThreadId()
+    {
+        QThread* thread = QThread::currentThread();
+        QHash<QThread*, int>::ConstIterator it = mThreadIds.constFind(thread);
+        if (it != mThreadIds.constEnd()) {
+            return it.value();
+        }
+        const int id = mThreadNames.count() + 1;
+        QString name = thread->objectName();
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            name = QStringLiteral("Main");
+        } else if (name.isEmpty()) {
+            name = QStringLiteral("Thread %1").arg(id);
+        }
+        mThreadIds.insert(thread, id);
+        mThreadNames << name;
+        return id;
+    }
+
+    // Must be called with mFileMutex locked
+    void closeFile()
+    {
+        if (!mFile.isOpen()) {
+            return;
+        }
+        mFile.write("]\n");
+        mFile.close();
+        if (mFile.error() != QFile::NoError) {
+            qWarning() << "Could not write trace to" << mFile.fileName();
+        }
+    }
+
+    static void finishTraceFile();
+};
+
+static TracerPrivate* tracer()
+{
+    static TracerPrivate sTracer;
+    return &sTracer;
+}
+
+void TracerPrivate::finishTraceFile()
+{
+    TracerPrivate* d = tracer();
+    Tracer::flush();
+    QMutexLocker locker(&d->mFileMutex);
+    d->closeFile();
+}
+
+static QJsonObject eventObject(const TraceEvent& event, qint64 pid)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("name"), QString::fromLatin1(event.mName));
+    object.insert(QStringLiteral("cat"), QStringLiteral("gwenview"));
+    object.insert(QStringLiteral("ph"), QStringLiteral("X"));
+    object.insert(QStringLiteral("ts"), double(event.mBegin));
+    object.insert(QStringLiteral("dur"), double(event.mDuration));
+    object.insert(QStringLiteral("pid"), double(pid));
+    object.insert(QStringLiteral("tid"), event.mThreadId);
+    return object;
+}
+
+static QJsonObject threadNameObject(int threadId, const QString& name, qint64 pid)
+{
+    QJsonObject args;
+    args.insert(QStringLiteral("name"), name);
+    QJsonObject object;
+    object.insert(QStringLiteral("name"), QStringLiteral("thread_name"));
+    object.insert(QStringLiteral("ph"), QStringLiteral("M"));
+    object.insert(QStringLiteral("pid"), double(pid));
+    object.insert(QStringLiteral("tid"), threadId);
+    object.insert(QStringLiteral("args"), args);
+    return object;
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    sEnabled.store(enabled);
+}
+
+qint64 Tracer::now()
+{
+    return tracer()->mTimer.nsecsElapsed() / 1000;
+}
+
+void Tracer::addEvent(const char* name, qint64 begin, qint64 end)
+{
+    TracerPrivate* d = tracer();
+    bool needsFlush;
+    {
+        QMutexLocker locker(&d->mMutex);
+        if (d->mEvents.count() >= MAX_EVENTS) {
+            ++d->mDroppedEventCount;
+            return;
+        }
+        TraceEvent event;
+        event.mName = name;
+        event.mBegin = begin;
+        event.mDuration = end - begin;
+        event.mThreadId = d->currentThreadId();
+        d->mEvents.append(event);
+        needsFlush = !d->mTraceFile.isEmpty() && d->mEvents.count() == FLUSH_EVENT_COUNT;
+    }
+    if (needsFlush) {
+        flush();
+    }
+}
+
+void Tracer::setTraceFile(const QString& path)
+{
+    TracerPrivate* d = tracer();
+    QMutexLocker fileLocker(&d->mFileMutex);
+    d->closeFile();
+    d->mFileItemCount = 0;
+    QMutexLocker locker(&d->mMutex);
+    d->mTraceFile = path;
+    d->mFlushedThreadCount = 0;
+}
+
+bool Tracer::flush()
+{
+    TracerPrivate* d = tracer();
+    QMutexLocker fileLocker(&d->mFileMutex);
+    QVector<TraceEvent> events;
+    QStringList threadNames;
+    int firstThreadId;
+    QString path;
+    {
+        QMutexLocker locker(&d->mMutex);
+        path = d->mTraceFile;
+        if (path.isEmpty()) {
+            return false;
+        }
+        events.swap(d->mEvents);
+        firstThreadId = d->mFlushedThreadCount + 1;
+        threadNames = d->mThreadNames.mid(d->mFlushedThreadCount);
+        d->mFlushedThreadCount = d->mThreadNames.count();
+    }
+
+    if (!d->mFile.isOpen()) {
+        d->mFile.setFileName(path);
+        if (!d->mFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "Could not write trace to" << path;
+            return false;
+        }
+        d->mFile.write("[\n");
+    }
+
+    // Items are separated by commas, the closing bracket is only written by
+    // closeFile(): the trace can be read even if it is never called
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray data;
+    for (int idx = 0; idx < threadNames.count(); ++idx) {
+        if (d->mFileItemCount++ > 0) {
+            data += ",\n";
+        }
+        data += QJsonDocument(threadNameObject(firstThreadId + idx, threadNames.at(idx), pid)).toJson(QJsonDocument::Compact);
+    }
+    Q_FOREACH(const TraceEvent & event, events) {
+        if (d->mFileItemCount++ > 0) {
+            data += ",\n";
+        }
+        data += QJsonDocument(eventObject(event, pid)).toJson(QJsonDocument::Compact);
+    }
+    if (d->mFile.write(data) != data.size() || !d->mFile.flush()) {
+        qWarning() << "Could not write trace to" << path;
+        return false;
+    }
+    return true;
+}
+
+bool Tracer::writeTrace(const QString& path)
+{
+    TracerPrivate* d = tracer();
+    QVector<TraceEvent> events;
+    QStringList threadNames;
+    int droppedEventCount;
+    {
+        QMutexLocker locker(&d->mMutex);
+        events = d->mEvents;
+        threadNames = d->mThreadNames;
+        droppedEventCount = d->mDroppedEventCount;
+    }
+    if (droppedEventCount > 0) {
+        qWarning() << "Trace is full," << droppedEventCount << "events have been dropped";
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray array;
+    Q_FOREACH(const TraceEvent & event, events) {
+        array.append(eventObject(event, pid));
+    }
+    for (int idx = 0; idx < threadNames.count(); ++idx) {
+        array.append(threadNameObject(idx + 1, threadNames.at(idx), pid));
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), array);
+    root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write trace to" << path;
+        return false;
+    }
+    const QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    return file.write(data) == data.size();
+}
+
+void Tracer::clear()
+{
+    TracerPrivate* d = tracer();
+    QMutexLocker locker(&d->mMutex);
+    d->mEvents.clear();
+    d->mDroppedEventCount = 0;
+}
+
+} // namespace
@@ -0,0 +1,134 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QAtomicInt>
+
+// KDE
+
+// Local
+
+class QString;
+
+namespace Gwenview
+{
+
+/**
+ * Records how long hot paths take, to diagnose performance issues without
+ * rebuilding.
+ *
+ * Tracing is disabled by default, a disabled GV_TRACE_SCOPE() costs a single
+ * test. It is enabled by setting the GV_TRACE_FILE environment variable to
+ * the path of a file: the recorded events are appended there in batches
+ * while the application runs, and when it quits, in the array flavor of the
+ * Chrome trace event format. A trace cut short by a crash can still be
+ * opened. Traces can be opened with chrome://tracing or
+ * https://ui.perfetto.dev.
+ *
+ * Without a trace file, at most one million events are kept, later events
+ * are dropped.
+ */
+class GWENVIEWLIB_EXPORT Tracer
+{
+public:
+    static bool isEnabled()
+    {
+        return sEnabled.load();
+    }
+
+    static void setEnabled(bool);
+
+    /**
+     * Returns the current time in microseconds, for addEvent()
+     */
+    static qint64 now();
+
+    /**
+     * Records an event which started at @a begin and ended at @a end, in the
+     * calling thread. @a name must remain valid until the trace is written,
+     * use a string literal.
+     */
+    static void addEvent(const char* name, qint64 begin, qint64 end);
+
+    /**
+     * Sets the file recorded events are appended to by flush(), finishing
+     * the previous one. Defaults to the value of GV_TRACE_FILE.
+     */
+    static void setTraceFile(const QString& path);
+
+    /**
+     * Appends the recorded events to the trace file and forgets them. This
+     * is done automatically when many events have been recorded and when the
+     * application quits.
+     */
+    static bool flush();
+
+    /**
+     * Writes the recorded events to @a path, in the Chrome trace event format
+     */
+    static bool writeTrace(const QString& path);
+
+    static void clear();
+
+private:
+    static QAtomicInt sEnabled;
+};
+
+/**
+ * Records an event covering its lifetime. Use it through GV_TRACE_SCOPE().
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+    : mName(Tracer::isEnabled() ? name : 0)
+    , mBegin(mName ? Tracer::now() : 0)
+    {}
+
+    ~TraceScope()
+    {
+        if (mName) {
+            Tracer::addEvent(mName, mBegin, Tracer::now());
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+    const char* mName;
+    qint64 mBegin;
+};
+
+} // namespace
+
+#define GV_TRACE_CONCAT2(a, b) a##b
+#define GV_TRACE_CONCAT(a, b) GV_TRACE_CONCAT2(a, b)
+
+/**
+ * Records how long the rest of the current block takes. @a name must be a
+ * string literal.
+ */
+#define GV_TRACE_SCOPE(name) Gwenview::TraceScope GV_TRACE_CONCAT(gvTraceScope, __LINE__)(name)
+
+#endif /* TRACER_H */
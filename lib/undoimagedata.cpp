@@ -0,0 +1,318 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "undoimagedata.h"
+
+// Qt
+#include <QDataStream>
+#include <QDir>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QPainter>
+#include <QRect>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QDebug>
+
+// KDE
+
+// Local
+#include <lib/envutils.h>
+#include <lib/gvdebug.h>
+
+namespace Gwenview
+{
+
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qDebug() << x
+#else
+#define LOG(x) ;
+#endif
+
+// Read each time the budget is enforced, so that it can be changed while
+// running, by tests for example
+static qint64 undoMemoryBudget()
+{
+    return qint64(envInt("GV_UNDO_MEMORY_BUDGET", 256)) * 1024 * 1024;
+}
+
+static qint64 imageMemoryUsage(const QImage& image)
+{
+    return qint64(image.bytesPerLine()) * image.height();
+}
+
+/**
+ * Writes @a image to a temporary file. Lines are written one by one so that
+ * images bigger than 2 GB do not overflow QDataStream lengths.
+ */
+static QTemporaryFile* writeImage(const QImage& image)
+{
+    LOG("Moving" << image.size() << "to a temporary file");
+    QScopedPointer<QTemporaryFile> file(new QTemporaryFile(QDir::tempPath() + QStringLiteral("/gwenview-undo-XXXXXX")));
+    if (!file->open()) {
+        qWarning() << "Could not create temporary file for undo data";
+        return 0;
+    }
+    QDataStream stream(file.data());
+    stream << qint32(image.format()) << image.size() << image.colorTable();
+    for (int y = 0; y < image.height(); ++y) {
+        stream.writeRawData(reinterpret_cast<const char*>(image.constScanLine(y)), image.bytesPerLine());
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Could not write undo data to" << file->fileName();
+        return 0;
+    }
+    return file.take();
+}
+
+static QImage readImage(QFile* file)
+{
+    file->seek(0);
+    QDataStream stream(file);
+    qint32 format;
+    QSize size;
+    QVector<QRgb> colorTable;
+    stream >> format >> size >> colorTable;
+    QImage image(size, QImage::Format(format));
+    image.setColorTable(colorTable);
+    for (int y = 0; y < image.height(); ++y) {
+        stream.readRawData(reinterpret_cast<char*>(image.scanLine(y)), image.bytesPerLine());
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Could not read undo data from" << file->fileName();
+        return QImage();
+    }
+    return image;
+}
+
+struct UndoImageDataPrivate
+{
+    // Identifies the instance while it is being moved to a temporary file
+    quint64 mId;
+    const Document* mDocument;
+    // Null if the whole image has been stored
+    QRect mRect;
+    // Null once the data has been moved to mFile
+    QImage mImage;
+    QTemporaryFile* mFile;
+    // True while mImage is being written to a temporary file
+    bool mSpilling;
+
+    qint64 memoryUsage() const
+    {
+        return imageMemoryUsage(mImage);
+    }
+
+};
+
+struct SpillCandidate
+{
+    quint64 mId;
+    QImage mImage;
+};
+
+/**
+ * Keeps track of all the UndoImageData instances, oldest first, to enforce
+ * the memory budget
+ */
+struct UndoImageDataRegistry
+{
+    QMutex mMutex;
+    QList<UndoImageDataPrivate*> mList;
+    qint64 mMemoryUsage;
+    quint64 mNextId;
+
+    UndoImageDataRegistry()
+    : mMemoryUsage(0)
+    , mNextId(0)
+    {}
+
+    /**
+     * Returns the oldest images to move to temporary files to get back under
+     * the budget, and marks them as being spilled. Must be called with
+     * mMutex locked.
+     */
+    QList<SpillCandidate> takeSpillCandidates()
+    {
+        QList<SpillCandidate> candidates;
+        const qint64 budget = undoMemoryBudget();
+        // Images already being spilled by another thread will soon be out of
+        // memory
+        qint64 usage = mMemoryUsage;
+        Q_FOREACH(const UndoImageDataPrivate* data, mList) {
+            if (data->mSpilling) {
+                usage -= data->memoryUsage();
+            }
+        }
+        QList<UndoImageDataPrivate*>::ConstIterator it = mList.constBegin(), end = mList.constEnd();
+        for (; it != end && usage > budget; ++it) {
+            UndoImageDataPrivate* data = *it;
+            if (data->mImage.isNull() || data->mSpilling) {
+                continue;
+            }
+            data->mSpilling = true;
+            usage -= data->memoryUsage();
+            SpillCandidate candidate;
+            candidate.mId = data->mId;
+            candidate.mImage = data->mImage;
+            candidates << candidate;
+        }
+        return candidates;
+    }
+
+    /**
+     * Writes @a candidates to temporary files. Must be called with mMutex
+     * unlocked: the registry is only locked to publish each file.
+     */
+    void spill(const QList<SpillCandidate>& candidates)
+    {
+        Q_FOREACH(const SpillCandidate& candidate, candidates) {
+            QTemporaryFile* file = writeImage(candidate.mImage);
+            QMutexLocker locker(&mMutex);
+            UndoImageDataPrivate* data = find(candidate.mId);
+            if (!data) {
+                LOG("Undo data has been deleted while being spilled");
+                delete file;
+                continue;
+            }
+            data->mSpilling = false;
+            if (!file) {
+                continue;
+            }
+            mMemoryUsage -= data->memoryUsage();
+            data->mFile = file;
+            data->mImage = QImage();
+        }
+    }
+
+    // Must be called with mMutex locked
+    UndoImageDataPrivate* find(quint64 id) const
+    {
+        Q_FOREACH(UndoImageDataPrivate* data, mList) {
+            if (data->mId == id) {
+                return data;
+            }
+        }
+        return 0;
+    }
+};
+
+static UndoImageDataRegistry* registry()
+{
+    static UndoImageDataRegistry sRegistry;
+    return &sRegistry;
+}
+
+UndoImageData::UndoImageData(const Document* document)
+: d(new UndoImageDataPrivate)
+{
+    d->mId = 0;
+    d->mDocument = document;
+    d->mFile = 0;
+    d->mSpilling = false;
+}
+
+UndoImageData::~UndoImageData()
+{
+    UndoImageDataRegistry* reg = registry();
+    {
+        QMutexLocker locker(&reg->mMutex);
+        if (reg->mList.removeOne(d)) {
+            reg->mMemoryUsage -= d->memoryUsage();
+        }
+    }
+    delete d->mFile;
+    delete d;
+}
+
+void UndoImageData::storeImage(const QImage& image)
+{
+    storeRect(image, QRect());
+}
+
+void UndoImageData::storeRect(const QImage& image, const QRect& rect)
+{
+    // Storing the whole image does not copy it: it is implicitly shared
+    // until the document replaces its own image
+    const QImage stored = rect.isNull() ? image : image.copy(rect);
+
+    UndoImageDataRegistry* reg = registry();
+    QList<SpillCandidate> candidates;
+    {
+        QMutexLocker locker(&reg->mMutex);
+        GV_RETURN_IF_FAIL(d->mImage.isNull() && !d->mFile);
+        d->mId = ++reg->mNextId;
+        d->mRect = rect;
+        d->mImage = stored;
+        reg->mList.append(d);
+        reg->mMemoryUsage += d->memoryUsage();
+        candidates = reg->takeSpillCandidates();
+    }
+    reg->spill(candidates);
+}
+
+QImage UndoImageData::restore(const QImage& current) const
+{
+    // Once set, mFile does not change: it can be read without holding the
+    // registry lock
+    QImage stored;
+    QTemporaryFile* file;
+    {
+        QMutexLocker locker(&registry()->mMutex);
+        stored = d->mImage;
+        file = d->mFile;
+    }
+    if (file) {
+        stored = readImage(file);
+    }
+    if (stored.isNull()) {
+        return current;
+    }
+    if (d->mRect.isNull()) {
+        return stored;
+    }
+    QImage image = current;
+    {
+        QPainter painter(&image);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(d->mRect.topLeft(), stored);
+    }
+    return image;
+}
+
+qint64 UndoImageData::memoryUsage(const Document* document)
+{
+    UndoImageDataRegistry* reg = registry();
+    QMutexLocker locker(&reg->mMutex);
+    qint64 usage = 0;
+    Q_FOREACH(const UndoImageDataPrivate* data, reg->mList) {
+        if (data->mDocument == document) {
+            usage += data->memoryUsage();
+        }
+    }
+    return usage;
+}
+
+} // namespace
@@ -0,0 +1,84 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef UNDOIMAGEDATA_H
+#define UNDOIMAGEDATA_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QtGlobal>
+
+// KDE
+
+// Local
+
+class QImage;
+class QRect;
+
+namespace Gwenview
+{
+
+class Document;
+
+struct UndoImageDataPrivate;
+/**
+ * Holds the pixels an image operation needs to restore when it is undone.
+ *
+ * Operations which only change a part of the image should only store this
+ * part with storeRect(). Operations which replace the whole image, like
+ * resize or crop, use storeImage().
+ *
+ * All instances share a memory budget, which can be changed with the
+ * GV_UNDO_MEMORY_BUDGET environment variable (in megabytes). When the budget
+ * is exceeded, the oldest data is moved to temporary files. Files are
+ * written and read without holding the lock shared by all instances.
+ *
+ * The store*() methods can be called from a ThreadedDocumentJob.
+ */
+class GWENVIEWLIB_EXPORT UndoImageData
+{
+public:
+    UndoImageData(const Document*);
+    ~UndoImageData();
+
+    void storeImage(const QImage&);
+    void storeRect(const QImage&, const QRect&);
+
+    /**
+     * Returns @a current with the stored data restored: the stored rect
+     * painted back, or the whole stored image.
+     */
+    QImage restore(const QImage& current) const;
+
+    /**
+     * Returns how much memory is used by the undo data of @a document, data
+     * moved to temporary files is not counted.
+     */
+    static qint64 memoryUsage(const Document* document);
+
+private:
+    Q_DISABLE_COPY(UndoImageData)
+    UndoImageDataPrivate* const d;
+};
+
+} // namespace
+
+#endif /* UNDOIMAGEDATA_H */
@@ -0,0 +1,109 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "batchtransformjobtest.h"
+
+// Qt
+#include <QFile>
+#include <QImage>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/batchtransformjob.h"
+#include "../lib/jpegcontent.h"
+#include "testutils.h"
+
+QTEST_MAIN(BatchTransformJobTest)
+
+using namespace Gwenview;
+
+// orient6.jpg is stored as a 256x128 image, with an EXIF orientation of ROT_90
+static const QSize ORIENT6_STORED_SIZE(256, 128);
+
+void BatchTransformJobTest::init()
+{
+    mTempDir.reset(new QTemporaryDir);
+    QVERIFY(mTempDir->isValid());
+}
+
+QString BatchTransformJobTest::copyTestFile(const QString& name)
+{
+    const QString path = mTempDir->path() + '/' + name;
+    if (!QFile::copy(pathForTestFile(name), path)) {
+        qWarning() << "Could not copy" << name;
+    }
+    QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+    return path;
+}
+
+void BatchTransformJobTest::testCanTransform()
+{
+    QVERIFY(BatchTransformJob::canTransform(urlForTestFile("orient6.jpg")));
+    QVERIFY(!BatchTransformJob::canTransform(urlForTestFile("test.png")));
+    QVERIFY(!BatchTransformJob::canTransform(QUrl("http://example.com/image.jpg")));
+}
+
+void BatchTransformJobTest::testExifOrientationIsApplied()
+{
+    // Rotating left an image whose EXIF orientation is ROT_90 must leave the
+    // pixels untouched and only reset the orientation
+    const QString path = copyTestFile("orient6.jpg");
+    QImage expected(pathForTestFile("orient6.jpg"));
+    QCOMPARE(expected.size(), ORIENT6_STORED_SIZE);
+
+    BatchTransformJob* job = new BatchTransformJob(QList<QUrl>() << QUrl::fromLocalFile(path), ROT_270);
+    QVERIFY(job->exec());
+
+    JpegContent content;
+    QVERIFY(content.load(path));
+    QCOMPARE(content.orientation(), NORMAL);
+    QCOMPARE(content.size(), ORIENT6_STORED_SIZE);
+    QCOMPARE(QImage(path), expected);
+}
+
+void BatchTransformJobTest::testFlipRotatedImage()
+{
+    // Mirroring does not change the displayed size, but once the EXIF
+    // orientation has been applied the stored size is transposed
+    const QString path = copyTestFile("orient6.jpg");
+
+    BatchTransformJob* job = new BatchTransformJob(QList<QUrl>() << QUrl::fromLocalFile(path), HFLIP);
+    QVERIFY(job->exec());
+
+    JpegContent content;
+    QVERIFY(content.load(path));
+    QCOMPARE(content.orientation(), NORMAL);
+    QCOMPARE(content.size(), ORIENT6_STORED_SIZE.transposed());
+    QCOMPARE(QImage(path).size(), ORIENT6_STORED_SIZE.transposed());
+}
+
+void BatchTransformJobTest::testInvalidFile()
+{
+    const QUrl invalidUrl = QUrl::fromLocalFile(copyTestFile("png-with-jpeg-extension.jpg"));
+    const QUrl validUrl = QUrl::fromLocalFile(copyTestFile("orient6.jpg"));
+
+    BatchTransformJob* job = new BatchTransformJob(QList<QUrl>() << invalidUrl << validUrl, ROT_90);
+    job->setAutoDelete(false);
+    QVERIFY(!job->exec());
+    QCOMPARE(job->errors().keys(), QList<QUrl>() << invalidUrl);
+    QCOMPARE(job->processedAmount(KJob::Files), qulonglong(2));
+    delete job;
+}
@@ -32,10 +32,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include "../lib/abstractimageoperation.h"
 #include "../lib/document/abstractdocumenteditor.h"
+#include "../lib/document/animationplayer.h"
 #include "../lib/document/documentjob.h"
 #include "../lib/document/documentfactory.h"
 #include "../lib/imagemetainfomodel.h"
 #include "../lib/imageutils.h"
+#include "../lib/perfcounters.h"
 #include "../lib/transformimageoperation.h"
 #include "testutils.h"
 
@@ -288,27 +290,69 @@ void DocumentTest::testLoadAnimated()
     doc->startLoadingFullImage();
     doc->waitUntilLoaded();
     QVERIFY(doc->isAnimated());
+    QVERIFY(doc->animationPlayer());
+    QSignalSpy frameSpy(doc->animationPlayer(), SIGNAL(frameReady(QImage)));
 
-    // Test we receive only one imageRectUpdated() until animation is started
-    // (the imageRectUpdated() is triggered by the loading of the first image)
+    // Test we receive only one imageRectUpdated() and no frame until
+    // animation is started (the imageRectUpdated() is triggered by the
+    // loading of the first image)
     QTest::qWait(1000);
     QCOMPARE(spy.count(), 1);
+    QCOMPARE(frameSpy.count(), 0);
 
-    // Test we now receive some imageRectUpdated()
+    // Test we now receive some frames, and that they do not go through the
+    // document image
     doc->startAnimation();
     QTest::qWait(1000);
-    int count = spy.count();
+    int count = frameSpy.count();
     doc->stopAnimation();
-    QVERIFY2(count > 0, "No imageRectUpdated() signal received");
+    QVERIFY2(count > 0, "No frameReady() signal received");
+    QCOMPARE(spy.count(), 1);
 
-    // Test we do not receive imageRectUpdated() anymore
+    // Test we do not receive frames anymore
     QTest::qWait(1000);
-    QCOMPARE(count, spy.count());
+    QCOMPARE(count, frameSpy.count());
 
-    // Start again, we should receive imageRectUpdated() again
+    // Start again, we should receive frames again
     doc->startAnimation();
     QTest::qWait(1000);
-    QVERIFY2(spy.count() > count, "No imageRectUpdated() signal received after restarting");
+    QVERIFY2(frameSpy.count() > count, "No frameReady() signal received after restarting");
+}
+
+void DocumentTest::testReplayFiniteAnimation()
+{
+    // This animation has no loop extension: it is played only once
+    QUrl srcUrl = urlForTestFile("4frames-once.gif");
+    Document::Ptr doc = DocumentFactory::instance()->load(srcUrl);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    QVERIFY(doc->isAnimated());
+    AnimationPlayer* player = doc->animationPlayer();
+    QVERIFY(player);
+    QSignalSpy frameSpy(player, SIGNAL(frameReady(QImage)));
+
+    // The animation stops by itself after its last frame
+    doc->startAnimation();
+    QTest::qWait(1500);
+    QCOMPARE(frameSpy.count(), 4);
+    QVERIFY(!player->isRunning());
+
+    // Starting it again replays all the frames
+    doc->startAnimation();
+    QTest::qWait(1500);
+    QCOMPARE(frameSpy.count(), 8);
+    QVERIFY(!player->isRunning());
+
+    // Stopping in the middle and starting again restarts from the first
+    // frame
+    doc->startAnimation();
+    QTest::qWait(150);
+    doc->stopAnimation();
+    const int count = frameSpy.count();
+    QVERIFY(count > 8 && count < 12);
+    doc->startAnimation();
+    QTest::qWait(1500);
+    QCOMPARE(frameSpy.count(), count + 4);
 }
 
 void DocumentTest::testPrepareDownSampledAfterFailure()
@@ -503,6 +547,40 @@ void DocumentTest::testLosslessRotate()
     QCOMPARE(image1, image2);
 }
 
+void DocumentTest::testLosslessCropWithExifOrientation()
+{
+    QUrl url1 = urlForTestFile("orient6.jpg");
+    Document::Ptr doc = DocumentFactory::instance()->load(url1);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+
+    // The rect is expressed in the coordinates of the image as shown, with
+    // its EXIF orientation applied
+    const QImage shownImage = doc->image();
+    QCOMPARE(shownImage.size(), QSize(128, 256));
+    const QRect rect(16, 32, 64, 96);
+    QVERIFY(doc->editor());
+    QCOMPARE(doc->editor()->applyLosslessCrop(rect, true /* exact */, true /* applyExifOrientation */), rect);
+    QCOMPARE(doc->image().size(), rect.size());
+
+    QUrl url2 = urlForTestOutputFile("losslesscrop.jpg");
+    QVERIFY(waitUntilJobIsDone(doc->save(url2, "jpeg")));
+
+    // The saved image must look like what was shown, not like the cropped
+    // stored pixels
+    DocumentFactory::instance()->clearCache();
+    doc = DocumentFactory::instance()->load(url2);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    const QImage savedImage = doc->image();
+    QCOMPARE(savedImage.size(), rect.size());
+
+    // Chroma upsampling uses neighbors which are gone on the edges, and the
+    // rotated blocks do not round exactly like the rotated pixels
+    const QRect inner = savedImage.rect().adjusted(2, 2, -2, -2);
+    QVERIFY(fuzzyImageCompare(savedImage.copy(inner), shownImage.copy(rect).copy(inner), 4));
+}
+
 void DocumentTest::testModifyAndSaveAs()
 {
     QVariantList args;
@@ -723,6 +801,140 @@ void DocumentTest::testJobQueue()
     QCOMPARE(str, QString("abc"));
 }
 
+class KillableTestJob : public TestJob
+{
+public:
+    KillableTestJob(QString* str, char ch)
+        : TestJob(str, ch)
+    {}
+
+protected:
+    virtual bool doKill() Q_DECL_OVERRIDE
+    {
+        return true;
+    }
+};
+
+void DocumentTest::testKillQueuedJob()
+{
+    QUrl url = urlForTestFile("orient6.jpg");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    const int pendingJobCount = PerfCounters::value(PerfCounters::DocumentPendingJobs);
+
+    QString str;
+    doc->enqueueJob(new TestJob(&str, 'a'));
+    KillableTestJob* job = new KillableTestJob(&str, 'b');
+    doc->enqueueJob(job);
+    doc->enqueueJob(new TestJob(&str, 'c'));
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentPendingJobs), pendingJobCount + 3);
+
+    // The job has not started yet, it must leave the queue
+    QVERIFY(job->kill(KJob::Quietly));
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentPendingJobs), pendingJobCount + 2);
+
+    QEventLoop loop;
+    connect(doc.data(), SIGNAL(allTasksDone()),
+            &loop, SLOT(quit()));
+    loop.exec();
+    QCOMPARE(str, QString("ac"));
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentPendingJobs), pendingJobCount);
+}
+
+/**
+ * A job which does not modify the image and only finishes when told to
+ */
+class BlockingReadOnlyJob : public DocumentJob
+{
+public:
+    bool isReadOnly() const Q_DECL_OVERRIDE
+    {
+        return true;
+    }
+
+    void finish()
+    {
+        setError(NoError);
+        emitResult();
+    }
+
+protected:
+    virtual void doStart()
+    {}
+};
+
+void DocumentTest::testDownSampleWhileSaving()
+{
+    QUrl url = urlForTestFile("orient6.jpg");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    QSignalSpy readySpy(doc.data(), SIGNAL(downSampledImageReady()));
+    QSignalSpy savedSpy(doc.data(), SIGNAL(saved(QUrl,QUrl)));
+
+    // Keep the save queued behind another job
+    BlockingReadOnlyJob* blockingJob = new BlockingReadOnlyJob;
+    doc->enqueueJob(blockingJob);
+    DocumentJob* saveJob = doc->save(urlForTestOutputFile("testDownSampleWhileSaving.jpg"), "jpeg");
+
+    // None of the queued jobs modifies the image: down sampling must not
+    // wait for them
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.2));
+    QVERIFY(waitForSignal(readySpy));
+    QCOMPARE(doc->downSampledImageForZoom(0.2).size(), doc->size() / 2);
+    QCOMPARE(savedSpy.count(), 0);
+    QVERIFY(doc->isBusy());
+
+    blockingJob->finish();
+    QVERIFY(waitUntilJobIsDone(saveJob));
+    QCOMPARE(savedSpy.count(), 1);
+}
+
+void DocumentTest::testDropDownSampledImageAfterSetImage()
+{
+    QUrl url = urlForTestFile("orient6.jpg");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    QVERIFY(doc->editor());
+    QSignalSpy readySpy(doc.data(), SIGNAL(downSampledImageReady()));
+
+    // The image is replaced before the job can deliver its result: the
+    // result belongs to the old image and must be dropped
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.2));
+    QImage image(200, 100, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    doc->editor()->setImage(image);
+    QTest::qWait(500);
+    QCOMPARE(readySpy.count(), 0);
+    QVERIFY(doc->downSampledImageForZoom(0.2).isNull());
+
+    // Asking again down samples the new image
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.2));
+    QVERIFY(waitForSignal(readySpy));
+    const QImage downSampledImage = doc->downSampledImageForZoom(0.2);
+    QCOMPARE(downSampledImage.size(), image.size() / 2);
+    QCOMPARE(QColor(downSampledImage.pixel(0, 0)), QColor(Qt::red));
+}
+
+void DocumentTest::testNewerZoomDiscardsDownSampling()
+{
+    QUrl url = urlForTestFile("orient6.jpg");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    QSignalSpy readySpy(doc.data(), SIGNAL(downSampledImageReady()));
+
+    // The first job is discarded as soon as another zoom is requested, even
+    // if it already got the time to finish its work
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.1));
+    QVERIFY(!doc->prepareDownSampledImageForZoom(0.2));
+    QVERIFY(waitForSignal(readySpy));
+    QTest::qWait(500);
+    QCOMPARE(readySpy.count(), 1);
+    QCOMPARE(doc->downSampledImageForZoom(0.2).size(), doc->size() / 2);
+    QVERIFY(doc->downSampledImageForZoom(0.1).isNull());
+}
+
 class TestCheckDocumentEditorJob : public DocumentJob
 {
 public:
@@ -113,6 +113,7 @@ private Q_SLOTS:
     void testLoadDownSampledPng();
     void testLoadRemote();
     void testLoadAnimated();
+    void testReplayFiniteAnimation();
     void testPrepareDownSampledAfterFailure();
     void testDeleteWhileLoading();
     void testLoadRotated();
@@ -121,12 +122,17 @@ private Q_SLOTS:
     void testSaveRemote();
     void testLosslessSave();
     void testLosslessRotate();
+    void testLosslessCropWithExifOrientation();
     void testModifyAndSaveAs();
     void testMetaInfoJpeg();
     void testMetaInfoBmp();
     void testForgetModifiedDocument();
     void testModifiedAndSavedSignals();
     void testJobQueue();
+    void testKillQueuedJob();
+    void testDownSampleWhileSaving();
+    void testDropDownSampledImageAfterSetImage();
+    void testNewerZoomDiscardsDownSampling();
     void testCheckDocumentEditor();
     void testUndoStackPush();
 
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // KDE
 #include <QDebug>
+#include <KConfig>
+#include <KConfigGroup>
 #include <KFilePlacesModel>
 #include <QTemporaryDir>
 #include <qtest.h>
@@ -116,4 +118,72 @@ void HistoryModelTest::testRemoveRows()
     QCOMPARE(model.rowCount(), 1);
     QDir qDir(dir.path());
     QCOMPARE(qDir.entryList(QDir::Files | QDir::NoDotAndDotDot).count(), 1);
+
+    HistoryModel model2(0, dir.path(), 2);
+    QCOMPARE(model2.rowCount(), 1);
+    QCOMPARE(model2.data(model2.index(0, 0), KFilePlacesModel::UrlRole).value<QUrl>(), u1);
+}
+
+void HistoryModelTest::testImportLegacyFiles()
+{
+    QUrl u1 = QUrl::fromLocalFile("/home");
+    QUrl u2 = QUrl::fromLocalFile("/root");
+    QTemporaryDir dir;
+    const QString d1 = "2008-02-03T12:34:56";
+    const QString d2 = "2009-01-29T23:01:47";
+    const QString d3 = "2009-03-24T22:42:15";
+    // u1 is stored twice, the most recent dateTime must win
+    const QStringList urls = QStringList() << u1.toString() << u2.toString() << u1.toString();
+    const QStringList dateTimes = QStringList() << d1 << d2 << d3;
+    for (int idx = 0; idx < urls.count(); ++idx) {
+        KConfig config(dir.path() + QStringLiteral("/gvhistory%1rc").arg(idx), KConfig::SimpleConfig);
+        KConfigGroup group(&config, "general");
+        group.writeEntry("url", urls.at(idx));
+        group.writeEntry("dateTime", dateTimes.at(idx));
+        config.sync();
+    }
+    // Other files of the storage dir must be left alone
+    const QString otherFileName = QStringLiteral("otherrc");
+    {
+        KConfig config(dir.path() + '/' + otherFileName, KConfig::SimpleConfig);
+        KConfigGroup group(&config, "general");
+        group.writeEntry("url", QUrl::fromLocalFile("/tmp").toString());
+        group.writeEntry("dateTime", d1);
+        config.sync();
+    }
+
+    {
+        HistoryModel model(0, dir.path());
+        testModel(model, u1, u2);
+    }
+    QDir qDir(dir.path());
+    QCOMPARE(qDir.entryList(QStringList() << "*rc", QDir::Files), QStringList() << otherFileName);
+
+    HistoryModel model(0, dir.path());
+    testModel(model, u1, u2);
+}
+
+void HistoryModelTest::testCompaction()
+{
+    QUrl u1 = QUrl::fromLocalFile("/home");
+    QUrl u2 = QUrl::fromLocalFile("/root");
+    QDateTime dateTime = QDateTime::fromString("2008-02-03T12:34:56", Qt::ISODate);
+    QTemporaryDir dir;
+    const int count = 2000;
+    {
+        HistoryModel model(0, dir.path(), 2);
+        for (int idx = 0; idx < count; ++idx) {
+            model.addUrl(idx % 2 ? u1 : u2, dateTime.addSecs(idx));
+        }
+        testModel(model, u1, u2);
+    }
+
+    QDir qDir(dir.path());
+    const QFileInfoList infos = qDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    QCOMPARE(infos.count(), 1);
+    // Without compaction the store would contain one line per addUrl() call
+    QVERIFY(infos.first().size() < count * 10);
+
+    HistoryModel model(0, dir.path(), 2);
+    testModel(model, u1, u2);
 }
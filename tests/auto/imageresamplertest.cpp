@@ -0,0 +1,153 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "imageresamplertest.h"
+
+// Qt
+#include <QImage>
+#include <QPainter>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/resize/imageresampler.h"
+
+QTEST_MAIN(ImageResamplerTest)
+
+using namespace Gwenview;
+
+Q_DECLARE_METATYPE(ImageResampler::Filter)
+
+void ImageResamplerTest::testSolidColor_data()
+{
+    QTest::addColumn<ImageResampler::Filter>("filter");
+    QTest::addColumn<QSize>("size");
+
+    // Big enough to be split in several bands
+    QTest::newRow("bilinear-down") << ImageResampler::Bilinear << QSize(300, 200);
+    QTest::newRow("mitchell-down") << ImageResampler::Mitchell << QSize(300, 200);
+    QTest::newRow("lanczos3-down") << ImageResampler::Lanczos3 << QSize(300, 200);
+    QTest::newRow("lanczos3-odd") << ImageResampler::Lanczos3 << QSize(777, 1);
+    QTest::newRow("bilinear-up") << ImageResampler::Bilinear << QSize(2400, 1600);
+    QTest::newRow("mitchell-up") << ImageResampler::Mitchell << QSize(2400, 1600);
+    QTest::newRow("lanczos3-up") << ImageResampler::Lanczos3 << QSize(2400, 1600);
+}
+
+void ImageResamplerTest::testSolidColor()
+{
+    QFETCH(ImageResampler::Filter, filter);
+    QFETCH(QSize, size);
+
+    const QRgb color = qRgb(200, 100, 30);
+    QImage image(1200, 800, QImage::Format_RGB32);
+    image.fill(color);
+
+    const QImage result = ImageResampler::resample(image, size, filter);
+    QCOMPARE(result.size(), size);
+    QCOMPARE(result.format(), QImage::Format_RGB32);
+    for (int y = 0; y < result.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(result.constScanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            if (line[x] != color) {
+                QFAIL(qPrintable(QString("Pixel %1,%2 is %3").arg(x).arg(y).arg(line[x], 0, 16)));
+            }
+        }
+    }
+}
+
+void ImageResamplerTest::testAlpha()
+{
+    // Left half is transparent, right half is opaque white
+    QImage image(400, 100, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = image.width() / 2; x < image.width(); ++x) {
+            line[x] = qRgba(255, 255, 255, 255);
+        }
+    }
+
+    const QImage result = ImageResampler::resample(image, QSize(100, 25), ImageResampler::Lanczos3);
+    QCOMPARE(result.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(result.pixel(0, 10), qRgba(0, 0, 0, 0));
+    QCOMPARE(qAlpha(result.pixel(99, 10)), 255);
+    // Ringing must not produce invalid premultiplied pixels
+    for (int y = 0; y < result.height(); ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(result.constScanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            const int alpha = qAlpha(line[x]);
+            QVERIFY(qRed(line[x]) <= alpha);
+            QVERIFY(qGreen(line[x]) <= alpha);
+            QVERIFY(qBlue(line[x]) <= alpha);
+        }
+    }
+}
+
+void ImageResamplerTest::testGradient()
+{
+    QImage image(1024, 16, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int value = x / 4;
+            line[x] = qRgb(value, value, value);
+        }
+    }
+
+    // A smooth ramp must stay a ramp, in both directions
+    const QImage down = ImageResampler::resample(image, QSize(100, 4), ImageResampler::Mitchell);
+    const QImage up = ImageResampler::resample(image, QSize(3000, 4), ImageResampler::Mitchell);
+    Q_FOREACH(const QImage& result, QList<QImage>() << down << up) {
+        for (int x = 1; x < result.width(); ++x) {
+            QVERIFY(qGray(result.pixel(x, 2)) >= qGray(result.pixel(x - 1, 2)));
+        }
+        QVERIFY(qGray(result.pixel(0, 2)) <= 2);
+        QVERIFY(qGray(result.pixel(result.width() - 1, 2)) >= 253);
+    }
+}
+
+void ImageResamplerTest::testRows()
+{
+    QImage image(640, 480, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = qRgb(x % 256, y % 256, (x * y) % 256);
+        }
+    }
+
+    // Resampling band by band must give the same result as resampling the
+    // whole image at once
+    Q_FOREACH(const QSize& size, QList<QSize>() << QSize(200, 150) << QSize(1280, 960)) {
+        const QImage expected = ImageResampler::resample(image, size, ImageResampler::Lanczos3);
+        QImage result(size, QImage::Format_RGB32);
+        QPainter painter(&result);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        const int bandHeight = 37;
+        for (int row = 0; row < size.height(); row += bandHeight) {
+            const int rowCount = qMin(bandHeight, size.height() - row);
+            const QImage band = ImageResampler::resampleRows(image, size, row, rowCount, ImageResampler::Lanczos3);
+            QCOMPARE(band.size(), QSize(size.width(), rowCount));
+            painter.drawImage(0, row, band);
+        }
+        painter.end();
+        QCOMPARE(result, expected);
+    }
+}
@@ -65,6 +65,128 @@ void ImageScalerTest::testScaleFullImage()
     QVERIFY(TestUtils::imageCompare(scaledImage, expectedImage));
 }
 
+/**
+ * Scalers sharing a batch must deliver the same rects as synchronous
+ * scalers, and only once all the rects of the batch have been scaled
+ */
+void ImageScalerTest::testBatch()
+{
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+
+    ImageScalerBatch batch;
+    const qreal zooms[] = {2, 3};
+    QImage expectedImages[2];
+    ImageScaler scalers[2];
+    for (int idx = 0; idx < 2; ++idx) {
+        const QRect rect(QPoint(0, 0), doc->size() * zooms[idx]);
+        ImageScaler syncScaler;
+        ImageScalerClient syncClient(&syncScaler);
+        syncScaler.setDocument(doc);
+        syncScaler.setZoom(zooms[idx]);
+        syncScaler.setDestinationRegion(rect);
+        expectedImages[idx] = syncClient.createFullImage();
+
+        scalers[idx].setDocument(doc);
+        scalers[idx].setZoom(zooms[idx]);
+        scalers[idx].setBatch(&batch);
+    }
+
+    ImageScalerClient client0(&scalers[0]);
+    ImageScalerClient client1(&scalers[1]);
+    QSignalSpy spy0(&scalers[0], SIGNAL(scaledRect(int,int,QImage)));
+    QSignalSpy spy1(&scalers[1], SIGNAL(scaledRect(int,int,QImage)));
+    for (int idx = 0; idx < 2; ++idx) {
+        scalers[idx].setDestinationRegion(QRect(QPoint(0, 0), doc->size() * zooms[idx]));
+    }
+    QVERIFY(batch.isBusy());
+    QCOMPARE(spy0.count(), 0);
+    QCOMPARE(spy1.count(), 0);
+
+    while (batch.isBusy()) {
+        QTest::qWait(10);
+    }
+    QCOMPARE(spy0.count(), 1);
+    QCOMPARE(spy1.count(), 1);
+    QVERIFY(TestUtils::imageCompare(client0.createFullImage(), expectedImages[0]));
+    QVERIFY(TestUtils::imageCompare(client1.createFullImage(), expectedImages[1]));
+}
+
+/**
+ * Rects requested before the zoom changed must not be delivered
+ */
+void ImageScalerTest::testBatchDropsOutdatedRects()
+{
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+
+    const qreal zoom = 3;
+    ImageScaler syncScaler;
+    ImageScalerClient syncClient(&syncScaler);
+    syncScaler.setDocument(doc);
+    syncScaler.setZoom(zoom);
+    syncScaler.setDestinationRegion(QRect(QPoint(0, 0), doc->size() * zoom));
+    const QImage expectedImage = syncClient.createFullImage();
+
+    ImageScalerBatch batch;
+    ImageScaler scaler;
+    scaler.setDocument(doc);
+    scaler.setBatch(&batch);
+    ImageScalerClient client(&scaler);
+    QSignalSpy spy(&scaler, SIGNAL(scaledRect(int,int,QImage)));
+
+    scaler.setZoom(2);
+    scaler.setDestinationRegion(QRect(QPoint(0, 0), doc->size() * 2));
+    scaler.setZoom(zoom);
+    scaler.setDestinationRegion(QRect(QPoint(0, 0), doc->size() * zoom));
+
+    while (batch.isBusy()) {
+        QTest::qWait(10);
+    }
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(TestUtils::imageCompare(client.createFullImage(), expectedImage));
+}
+
+void ImageScalerTest::testBatchKeepsRectsWhenRegionChanges()
+{
+    QUrl url = urlForTestFile("test.png");
+    Document::Ptr doc = DocumentFactory::instance()->load(url);
+    doc->waitUntilLoaded();
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+
+    const qreal zoom = 3;
+    const QRect fullRect(QPoint(0, 0), doc->size() * zoom);
+    ImageScaler syncScaler;
+    ImageScalerClient syncClient(&syncScaler);
+    syncScaler.setDocument(doc);
+    syncScaler.setZoom(zoom);
+    syncScaler.setDestinationRegion(fullRect);
+    const QImage expectedImage = syncClient.createFullImage();
+
+    ImageScalerBatch batch;
+    ImageScaler scaler;
+    scaler.setDocument(doc);
+    scaler.setBatch(&batch);
+    ImageScalerClient client(&scaler);
+    QSignalSpy spy(&scaler, SIGNAL(scaledRect(int,int,QImage)));
+
+    // Panning at the same zoom: the rect requested first is still valid and
+    // must not be requested again
+    scaler.setZoom(zoom);
+    scaler.setDestinationRegion(QRect(0, 0, fullRect.width() / 2, fullRect.height()));
+    scaler.setDestinationRegion(fullRect);
+
+    while (batch.isBusy()) {
+        QTest::qWait(10);
+    }
+    QCOMPARE(spy.count(), 2);
+    QVERIFY(TestUtils::imageCompare(client.createFullImage(), expectedImage));
+}
+
 #if 0
 /**
  * Scale parts of an image
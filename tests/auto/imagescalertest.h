@@ -88,6 +88,9 @@ class ImageScalerTest : public QObject
 
 private Q_SLOTS:
     void testScaleFullImage();
+    void testBatch();
+    void testBatchDropsOutdatedRects();
+    void testBatchKeepsRectsWhenRegionChanges();
 
     // FIXME Disabled for now, does not compile since ImageScaler::setImage() has
     // been replaced with ImageScaler::setDocument()
@@ -0,0 +1,117 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "importindextest.h"
+
+// Qt
+#include <QDir>
+#include <QFile>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../importer/importindex.h"
+
+QTEST_MAIN(ImportIndexTest)
+
+using namespace Gwenview;
+
+void ImportIndexTest::init()
+{
+    mTempDir.reset(new QTemporaryDir);
+    QVERIFY(mTempDir->isValid());
+    mSrcDir = mTempDir->path() + "/src";
+    mDestDir = mTempDir->path() + "/dest";
+    mCacheDir = mTempDir->path() + "/cache";
+    QVERIFY(QDir().mkpath(mSrcDir));
+    QVERIFY(QDir().mkpath(mDestDir));
+}
+
+void ImportIndexTest::createFile(const QString& dir, const QString& name, const QByteArray& data)
+{
+    QFile file(dir + '/' + name);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+}
+
+QString ImportIndexTest::createDocument(const QString& name, const QByteArray& data)
+{
+    createFile(mSrcDir, name, data);
+    return mSrcDir + '/' + name;
+}
+
+void ImportIndexTest::testContains()
+{
+    const QByteArray data1(100, 'a');
+    const QByteArray data2(200, 'b');
+    createFile(mDestDir, "1.jpg", data1);
+    createFile(mDestDir, "2.jpg", data2);
+
+    ImportIndex index(mDestDir, mCacheDir);
+    QVERIFY(index.containsSize(100));
+    QVERIFY(index.containsSize(200));
+    QVERIFY(!index.containsSize(300));
+
+    QVERIFY(index.contains(100, createDocument("a.jpg", data1)));
+    QVERIFY(index.contains(200, createDocument("b.jpg", data2)));
+
+    // Same size, different content
+    QVERIFY(!index.contains(100, createDocument("c.jpg", QByteArray(100, 'c'))));
+}
+
+void ImportIndexTest::testBigFile()
+{
+    QByteArray data(ImportIndex::HEAD_SIZE * 2, 'a');
+    createFile(mDestDir, "big.jpg", data);
+
+    ImportIndex index(mDestDir, mCacheDir);
+    QVERIFY(index.contains(data.size(), createDocument("same.jpg", data)));
+
+    // Same beginning, different end: this is not the same document
+    QByteArray otherData = data;
+    otherData[otherData.size() - 1] = 'b';
+    QVERIFY(!index.contains(otherData.size(), createDocument("other-tail.jpg", otherData)));
+
+    QVERIFY(!index.contains(data.size(), createDocument("other.jpg", QByteArray(data.size(), 'b'))));
+}
+
+void ImportIndexTest::testSave()
+{
+    const QByteArray data1(100, 'a');
+    const QByteArray data2(200, 'b');
+    const QString path1 = createDocument("1.jpg", data1);
+    const QString path2 = createDocument("2.jpg", data2);
+    createFile(mDestDir, "1.jpg", data1);
+    {
+        ImportIndex index(mDestDir, mCacheDir);
+        QVERIFY(index.contains(100, path1));
+        QVERIFY(!index.containsSize(200));
+
+        // Imported file: save() must take it into account
+        createFile(mDestDir, "2.jpg", data2);
+        index.save();
+        QVERIFY(index.contains(200, path2));
+    }
+    QVERIFY(!QDir(mCacheDir).entryList(QDir::Files).isEmpty());
+
+    ImportIndex index(mDestDir, mCacheDir);
+    QVERIFY(index.contains(100, path1));
+    QVERIFY(index.contains(200, path2));
+}
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <iostream>
 
 // Qt
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
 #include <QImage>
@@ -32,10 +33,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <KFileMetaInfo>
 
 // Local
+#include "../lib/imageutils.h"
 #include "../lib/orientation.h"
 #include "../lib/jpegcontent.h"
 #include "testutils.h"
 
+#include <exiv2/exif.hpp>
+
 using namespace std;
 
 const char* ORIENT6_FILE = "orient6.jpg";
@@ -43,6 +47,7 @@ const char* ORIENT1_VFLIP_FILE = "orient1_vflip.jpg";
 const char* CUT_FILE = "cut.jpg";
 const char* TMP_FILE = "tmp.jpg";
 const char* THUMBNAIL_FILE = "test_thumbnail.jpg";
+const char* GRAY_FILE = "gray.jpg";
 
 const int ORIENT6_WIDTH = 128; // This size is the size *after* orientation
 const int ORIENT6_HEIGHT = 256; // has been applied
@@ -76,6 +81,7 @@ void JpegContentTest::initTestCase()
 void JpegContentTest::cleanupTestCase()
 {
     QDir::current().remove(CUT_FILE);
+    QDir::current().remove(GRAY_FILE);
 }
 
 typedef QMap<QString, QString> MetaInfoMap;
@@ -278,6 +284,92 @@ void JpegContentTest::testRawData()
     QCOMPARE(content.rawData(), fileData);
 }
 
+void JpegContentTest::testSaveUpdatesState()
+{
+    // Saving must leave the content in the same state as reloading the saved
+    // data would
+    Gwenview::JpegContent content;
+    bool result = content.load(pathForTestFile(ORIENT6_FILE));
+    QVERIFY(result);
+
+    QString comment = "new comment";
+    content.setComment(comment);
+    content.transform(Gwenview::ROT_90);
+
+    QByteArray savedData;
+    QBuffer buffer(&savedData);
+    buffer.open(QIODevice::WriteOnly);
+    result = content.save(&buffer);
+    QVERIFY(result);
+
+    QCOMPARE(content.rawData(), savedData);
+    QCOMPARE(content.size(), QSize(ORIENT6_HEIGHT, ORIENT6_WIDTH));
+
+    Gwenview::JpegContent reloaded;
+    result = reloaded.loadFromData(savedData);
+    QVERIFY(result);
+    QCOMPARE(reloaded.comment(), comment);
+    QCOMPARE(reloaded.orientation(), content.orientation());
+    QCOMPARE(reloaded.size(), content.size());
+    QCOMPARE(reloaded.thumbnail().isNull(), content.thumbnail().isNull());
+}
+
+/**
+ * Returns the Exif data stored in the APP1 segment of @a data
+ */
+static Exiv2::ExifData decodeExif(const QByteArray& data)
+{
+    Exiv2::ExifData exifData;
+    const int pos = data.indexOf(QByteArray("Exif\0\0", 6));
+    if (pos == -1) {
+        return exifData;
+    }
+    // The segment length is stored before the Exif header and includes
+    // itself
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    const int length = (bytes[pos - 2] << 8) | bytes[pos - 1];
+    Exiv2::ExifParser::decode(exifData, bytes + pos + 6, length - 2 - 6);
+    return exifData;
+}
+
+void JpegContentTest::testSaveKeepsMakerNote()
+{
+    QFile file(pathForTestFile(ORIENT6_FILE));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray originalData = file.readAll();
+
+    Gwenview::JpegContent content;
+    bool result = content.loadFromData(originalData);
+    QVERIFY(result);
+
+    // Change a tag, so that the Exif data has to be written again
+    content.resetOrientation();
+    QByteArray savedData;
+    QBuffer buffer(&savedData);
+    buffer.open(QIODevice::WriteOnly);
+    result = content.save(&buffer);
+    QVERIFY(result);
+
+    // The MakerNote is decoded at its offset, it must still be found there
+    const Exiv2::ExifData originalExif = decodeExif(originalData);
+    const Exiv2::ExifData savedExif = decodeExif(savedData);
+    int makerNoteTagCount = 0;
+    for (Exiv2::ExifData::const_iterator it = originalExif.begin(); it != originalExif.end(); ++it) {
+        if (it->groupName() != "Canon") {
+            continue;
+        }
+        ++makerNoteTagCount;
+        Exiv2::ExifData::const_iterator savedIt = savedExif.findKey(Exiv2::ExifKey(it->key()));
+        QVERIFY2(savedIt != savedExif.end(), it->key().c_str());
+        QCOMPARE(QString::fromStdString(savedIt->toString()), QString::fromStdString(it->toString()));
+    }
+    QVERIFY(makerNoteTagCount > 0);
+
+    Exiv2::ExifData::const_iterator orientationIt = savedExif.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+    QVERIFY(orientationIt != savedExif.end());
+    QCOMPARE(int(orientationIt->toLong()), int(Gwenview::NORMAL));
+}
+
 void JpegContentTest::testSetImage()
 {
     Gwenview::JpegContent content;
@@ -301,3 +393,159 @@ void JpegContentTest::testSetImage()
     ignoredKeys << "Orientation";
     compareMetaInfo(pathForTestFile(ORIENT6_FILE), pathForTestFile(TMP_FILE), ignoredKeys);
 }
+
+static QImage decode(const Gwenview::JpegContent& content)
+{
+    QImage image;
+    image.loadFromData(content.rawData(), "jpeg");
+    return image.convertToFormat(QImage::Format_RGB32);
+}
+
+/**
+ * Returns the size of an iMCU, read from the frame header of @a data
+ */
+static QSize iMCUSize(const QByteArray& data)
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    int pos = 2;
+    while (pos + 4 <= data.size()) {
+        if (bytes[pos] != 0xFF) {
+            ++pos;
+            continue;
+        }
+        const uchar marker = bytes[pos + 1];
+        const int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+        if (marker >= 0xC0 && marker <= 0xC2) {
+            // Single component images are not interleaved: their iMCU is
+            // one block, whatever the sampling factor
+            const int componentCount = bytes[pos + 9];
+            int hSampFactor = 1;
+            int vSampFactor = 1;
+            for (int i = 0; componentCount > 1 && i < componentCount; ++i) {
+                const uchar factors = bytes[pos + 11 + 3 * i];
+                hSampFactor = qMax(hSampFactor, factors >> 4);
+                vSampFactor = qMax(vSampFactor, factors & 0x0F);
+            }
+            return QSize(hSampFactor * 8, vSampFactor * 8);
+        }
+        pos += 2 + length;
+    }
+    return QSize();
+}
+
+void JpegContentTest::testLosslessCrop_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QSize>("expectedIMCUSize");
+
+    QTest::newRow("4:2:0") << pathForTestFile(ORIENT1_VFLIP_FILE) << QSize(16, 16);
+
+    // Qt writes gray images with a single component
+    QImage image(128, 96, QImage::Format_Indexed8);
+    QVector<QRgb> colorTable;
+    for (int i = 0; i < 256; ++i) {
+        colorTable << qRgb(i, i, i);
+    }
+    image.setColorTable(colorTable);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            image.setPixel(x, y, (x * 2 + y) % 256);
+        }
+    }
+    QVERIFY(image.save(GRAY_FILE, "JPEG"));
+    QTest::newRow("gray") << QString(GRAY_FILE) << QSize(8, 8);
+}
+
+void JpegContentTest::testLosslessCrop()
+{
+    QFETCH(QString, path);
+    QFETCH(QSize, expectedIMCUSize);
+
+    Gwenview::JpegContent content;
+    bool result = content.load(path);
+    QVERIFY(result);
+    QCOMPARE(iMCUSize(content.rawData()), expectedIMCUSize);
+    const int iMCUWidth = expectedIMCUSize.width();
+    const int iMCUHeight = expectedIMCUSize.height();
+    const QImage original = decode(content);
+
+    // Top-left corner aligned on the iMCU grid: the crop is exact, even if
+    // the right and bottom edges are not on the grid
+    const QRect alignedRect(iMCUWidth, iMCUHeight, 4 * iMCUWidth + 3, 2 * iMCUHeight + 5);
+    QRect rect = content.crop(alignedRect, true, true);
+    QCOMPARE(rect, alignedRect);
+    QCOMPARE(content.size(), alignedRect.size());
+
+    // The coefficients are not touched, so the pixels only differ where
+    // chroma upsampling uses neighbors which are now gone
+    const QImage cropped = decode(content);
+    QCOMPARE(cropped.size(), alignedRect.size());
+    const QRect inner = cropped.rect().adjusted(2, 2, -2, -2);
+    QCOMPARE(cropped.copy(inner), original.copy(alignedRect).copy(inner));
+
+    // Top-left corner not aligned: the crop is refused if it must be exact,
+    // otherwise the corner is moved to the nearest grid point and the
+    // bottom-right one is kept
+    result = content.load(path);
+    QVERIFY(result);
+    const QRect unalignedRect(iMCUWidth + iMCUWidth / 2 - 1, iMCUHeight / 2 + 1, 5 * iMCUWidth, 3 * iMCUHeight);
+    QVERIFY(content.crop(unalignedRect, true, true).isNull());
+    rect = content.crop(unalignedRect, false, true);
+    QVERIFY(!rect.isNull());
+    QCOMPARE(rect.topLeft(), QPoint(iMCUWidth, iMCUHeight));
+    QCOMPARE(rect.bottomRight(), unalignedRect.bottomRight());
+
+    // The cropped data must survive a save
+    result = content.save(TMP_FILE);
+    QVERIFY(result);
+    result = content.load(TMP_FILE);
+    QVERIFY(result);
+    QCOMPARE(content.size(), rect.size());
+
+    // Lossless crop is not possible once the pixels have been replaced
+    QImage image(400, 300, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    content.setImage(image);
+    QVERIFY(content.crop(alignedRect, false, true).isNull());
+}
+
+void JpegContentTest::testLosslessCropWithExifOrientation()
+{
+    Gwenview::JpegContent content;
+    bool result = content.load(pathForTestFile(ORIENT6_FILE));
+    QVERIFY(result);
+    QCOMPARE(content.orientation(), Gwenview::ROT_90);
+    const QMatrix matrix = Gwenview::ImageUtils::transformMatrix(content.orientation());
+    const QImage shown = decode(content).transformed(matrix);
+    QCOMPARE(shown.size(), QSize(ORIENT6_WIDTH, ORIENT6_HEIGHT));
+
+    // The rect is expressed in the coordinates of the image as shown. Like
+    // setImage(), the crop stores the image as shown and resets the
+    // orientation.
+    const QRect shownRect(16, 32, 64, 96);
+    const QRect rect = content.crop(shownRect, true, true);
+    QCOMPARE(rect, shownRect);
+    QCOMPARE(content.size(), shownRect.size());
+    QCOMPARE(content.orientation(), Gwenview::NORMAL);
+
+    // The rotated blocks do not round exactly like the rotated pixels
+    const QImage cropped = decode(content);
+    QCOMPARE(cropped.size(), shownRect.size());
+    const QRect inner = cropped.rect().adjusted(2, 2, -2, -2);
+    QVERIFY(fuzzyImageCompare(cropped.copy(inner), shown.copy(shownRect).copy(inner), 4));
+
+    // The orientation must survive a save
+    result = content.save(TMP_FILE);
+    QVERIFY(result);
+    result = content.load(TMP_FILE);
+    QVERIFY(result);
+    QCOMPARE(content.orientation(), Gwenview::NORMAL);
+    QCOMPARE(content.size(), shownRect.size());
+
+    // Without the EXIF orientation, the rect is expressed in the coordinates
+    // of the stored image
+    result = content.load(pathForTestFile(ORIENT6_FILE));
+    QVERIFY(result);
+    const QRect storedRect(32, 16, 96, 64);
+    QCOMPARE(content.crop(storedRect, true, false), storedRect);
+}
@@ -38,7 +38,12 @@ private Q_SLOTS:
     void testMultipleRotations();
     void testLoadTruncated();
     void testRawData();
+    void testSaveUpdatesState();
+    void testSaveKeepsMakerNote();
     void testSetImage();
+    void testLosslessCrop();
+    void testLosslessCrop_data();
+    void testLosslessCropWithExifOrientation();
 };
 
 #endif // JPEGCONTENTTEST_H
@@ -0,0 +1,169 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "localdirscannertest.h"
+
+// Qt
+#include <QSignalSpy>
+
+// KDE
+#include <KFileItem>
+#include <qtest.h>
+
+// Local
+#include "../lib/localdirscanner.h"
+#include "testutils.h"
+
+QTEST_MAIN(LocalDirScannerTest)
+
+using namespace Gwenview;
+
+/**
+ * Runs @a scanner until it is finished, and returns the urls of the items it
+ * found, sorted
+ */
+static QList<QUrl> collectUrls(LocalDirScanner* scanner, KFileItemList* items = 0, int* batchCount = 0)
+{
+    QSignalSpy itemsSpy(scanner, SIGNAL(itemsFound(QUrl,KFileItemList)));
+    TestUtils::TimedEventLoop loop;
+    QObject::connect(scanner, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+
+    QList<QUrl> urls;
+    for (int idx = 0; idx < itemsSpy.count(); ++idx) {
+        const KFileItemList list = itemsSpy.at(idx).at(1).value<KFileItemList>();
+        Q_FOREACH(const KFileItem& item, list) {
+            urls << item.url();
+            if (items) {
+                *items << item;
+            }
+        }
+    }
+    if (batchCount) {
+        *batchCount = itemsSpy.count();
+    }
+    qSort(urls);
+    return urls;
+}
+
+static QList<QUrl> expectedUrls(const QDir& dir, const QStringList& names)
+{
+    QList<QUrl> urls;
+    Q_FOREACH(const QString& name, names) {
+        urls << QUrl::fromLocalFile(dir.absoluteFilePath(name));
+    }
+    qSort(urls);
+    return urls;
+}
+
+void LocalDirScannerTest::initTestCase()
+{
+    qRegisterMetaType<KFileItemList>("KFileItemList");
+}
+
+void LocalDirScannerTest::testNonRecursive()
+{
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(QStringList()
+        << "a.jpg"
+        << "b.png"
+        << ".hidden.jpg"
+        << "sub/c.jpg"
+        );
+
+    LocalDirScanner scanner;
+    scanner.scan(QUrl::fromLocalFile(sandBoxDir.absolutePath()), false);
+    QVERIFY(scanner.isScanning());
+    KFileItemList items;
+    QList<QUrl> urls = collectUrls(&scanner, &items);
+    QVERIFY(!scanner.isScanning());
+
+    QCOMPARE(urls, expectedUrls(sandBoxDir, QStringList() << "a.jpg" << "b.png" << "sub"));
+
+    // Kinds are known from the names, without looking at the (empty) files
+    Q_FOREACH(const KFileItem& item, items) {
+        if (item.name() == "a.jpg") {
+            QVERIFY(item.isMimeTypeKnown());
+            QCOMPARE(item.mimetype(), QString("image/jpeg"));
+        } else if (item.name() == "sub") {
+            QVERIFY(item.isDir());
+        }
+    }
+}
+
+void LocalDirScannerTest::testRecursive()
+{
+    QStringList files;
+    for (int dir = 0; dir < 10; ++dir) {
+        files << QString("d%1/pict.jpg").arg(dir);
+        files << QString("d%1/sub/pict.jpg").arg(dir);
+    }
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(files);
+
+    LocalDirScanner scanner;
+    QSignalSpy dirSpy(&scanner, SIGNAL(dirScanned(QUrl)));
+    scanner.scan(QUrl::fromLocalFile(sandBoxDir.absolutePath()), true);
+    QList<QUrl> urls = collectUrls(&scanner);
+
+    QStringList names = files;
+    for (int dir = 0; dir < 10; ++dir) {
+        names << QString("d%1").arg(dir);
+        names << QString("d%1/sub").arg(dir);
+    }
+    QCOMPARE(urls, expectedUrls(sandBoxDir, names));
+    // Root dir, 10 dirs and their subdirs
+    QCOMPARE(dirSpy.count(), 21);
+}
+
+void LocalDirScannerTest::testBatches()
+{
+    const int count = 2500;
+    QStringList files;
+    for (int idx = 0; idx < count; ++idx) {
+        files << QString("pict%1.jpg").arg(idx);
+    }
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(files);
+
+    LocalDirScanner scanner;
+    scanner.scan(QUrl::fromLocalFile(sandBoxDir.absolutePath()), false);
+    int batchCount;
+    QList<QUrl> urls = collectUrls(&scanner, 0, &batchCount);
+
+    QCOMPARE(urls, expectedUrls(sandBoxDir, files));
+    QVERIFY(batchCount > 1);
+}
+
+void LocalDirScannerTest::testStop()
+{
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(QStringList() << "a.jpg" << "sub/b.jpg");
+
+    LocalDirScanner scanner;
+    QSignalSpy itemsSpy(&scanner, SIGNAL(itemsFound(QUrl,KFileItemList)));
+    QSignalSpy finishedSpy(&scanner, SIGNAL(finished()));
+    scanner.scan(QUrl::fromLocalFile(sandBoxDir.absolutePath()), true);
+    scanner.stop();
+    QVERIFY(!scanner.isScanning());
+
+    QTest::qWait(500);
+    QCOMPARE(itemsSpy.count(), 0);
+    QCOMPARE(finishedSpy.count(), 0);
+}
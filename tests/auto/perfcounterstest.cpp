@@ -0,0 +1,148 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "perfcounterstest.h"
+
+// Qt
+#include <QThread>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/perfcounters.h"
+
+QTEST_MAIN(PerfCountersTest)
+
+using namespace Gwenview;
+
+static const int THREAD_COUNT = 4;
+static const int ITERATION_COUNT = 10000;
+
+class CountingThread : public QThread
+{
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < ITERATION_COUNT; ++i) {
+            PerfCounters::add(PerfCounters::ThumbnailCacheHits);
+            PerfCounters::addLatency(PerfCounters::ScaleLatency, i);
+        }
+    }
+};
+
+void PerfCountersTest::init()
+{
+    PerfCounters::reset();
+    PerfCounters::set(PerfCounters::ThumbnailQueueDepth, 0);
+    PerfCounters::set(PerfCounters::DocumentCacheKiB, 0);
+    PerfCounters::set(PerfCounters::DocumentPendingJobs, 0);
+}
+
+void PerfCountersTest::testCounters()
+{
+    PerfCounters::add(PerfCounters::ThumbnailCacheHits);
+    PerfCounters::add(PerfCounters::ThumbnailCacheHits);
+    PerfCounters::add(PerfCounters::ThumbnailCacheMisses);
+    QCOMPARE(PerfCounters::value(PerfCounters::ThumbnailCacheHits), 2);
+    QCOMPARE(PerfCounters::value(PerfCounters::ThumbnailCacheMisses), 1);
+
+    PerfCounters::add(PerfCounters::ThumbnailQueueDepth, 12);
+    PerfCounters::add(PerfCounters::ThumbnailQueueDepth, -5);
+    QCOMPARE(PerfCounters::value(PerfCounters::ThumbnailQueueDepth), 7);
+
+    PerfCounters::set(PerfCounters::DocumentCacheKiB, 2048);
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentCacheKiB), 2048);
+}
+
+void PerfCountersTest::testReset()
+{
+    PerfCounters::add(PerfCounters::DocumentCacheEvictions);
+    PerfCounters::add(PerfCounters::DocumentPendingJobs, 3);
+    PerfCounters::addLatency(PerfCounters::DecodeLatency, 100);
+
+    PerfCounters::reset();
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentCacheEvictions), 0);
+    QCOMPARE(PerfCounters::latencyCount(PerfCounters::DecodeLatency), 0);
+    // Gauges describe the current state, they must not be reset
+    QCOMPARE(PerfCounters::value(PerfCounters::DocumentPendingJobs), 3);
+}
+
+void PerfCountersTest::testLatencyPercentiles()
+{
+    QCOMPARE(PerfCounters::latencyPercentile(PerfCounters::DecodeLatency, 50), qint64(0));
+
+    // 90 fast decodes and 10 slow ones
+    for (int i = 0; i < 90; ++i) {
+        PerfCounters::addLatency(PerfCounters::DecodeLatency, 1000);
+    }
+    for (int i = 0; i < 10; ++i) {
+        PerfCounters::addLatency(PerfCounters::DecodeLatency, 100000);
+    }
+    QCOMPARE(PerfCounters::latencyCount(PerfCounters::DecodeLatency), 100);
+
+    // Percentiles are the upper bound of their power of two bucket
+    const qint64 p50 = PerfCounters::latencyPercentile(PerfCounters::DecodeLatency, 50);
+    const qint64 p90 = PerfCounters::latencyPercentile(PerfCounters::DecodeLatency, 90);
+    const qint64 p99 = PerfCounters::latencyPercentile(PerfCounters::DecodeLatency, 99);
+    QVERIFY(p50 > 1000 && p50 <= 2000);
+    QCOMPARE(p90, p50);
+    QVERIFY(p99 > 100000 && p99 <= 200000);
+
+    // Other histograms are not affected
+    QCOMPARE(PerfCounters::latencyCount(PerfCounters::ScaleLatency), 0);
+}
+
+void PerfCountersTest::testSnapshot()
+{
+    PerfCounters::add(PerfCounters::ThumbnailCacheHits, 3);
+    PerfCounters::add(PerfCounters::ThumbnailCacheMisses);
+    {
+        GV_LATENCY_SCOPE(ScaleLatency);
+        QTest::qSleep(2);
+    }
+
+    const QVariantMap map = PerfCounters::snapshot();
+    QCOMPARE(map.value("thumbnailCacheHits").toInt(), 3);
+    QCOMPARE(map.value("thumbnailCacheMisses").toInt(), 1);
+    QCOMPARE(map.value("thumbnailCacheHitRatio").toReal(), qreal(0.75));
+    QCOMPARE(map.value("scaleLatencyCount").toInt(), 1);
+    QVERIFY(map.value("scaleLatencyP50").toLongLong() >= 2000);
+    QVERIFY(map.contains("decodeLatencyP99"));
+    QVERIFY(map.contains("documentPendingJobs"));
+
+    QVERIFY(PerfCounters::report().contains("3 hits, 1 misses (75%)"));
+}
+
+void PerfCountersTest::testThreads()
+{
+    QList<CountingThread*> threads;
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+        CountingThread* thread = new CountingThread;
+        thread->start();
+        threads << thread;
+    }
+    Q_FOREACH(CountingThread* thread, threads) {
+        QVERIFY(thread->wait(5000));
+    }
+    qDeleteAll(threads);
+
+    QCOMPARE(PerfCounters::value(PerfCounters::ThumbnailCacheHits), THREAD_COUNT * ITERATION_COUNT);
+    QCOMPARE(PerfCounters::latencyCount(PerfCounters::ScaleLatency), THREAD_COUNT * ITERATION_COUNT);
+}
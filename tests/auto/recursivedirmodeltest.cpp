@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <lib/recursivedirmodel.h>
 
 // Qt
+#include <QSignalSpy>
 
 // KDE
 #include <KDirModel>
@@ -203,3 +204,90 @@ void RecursiveDirModelTest::testSetNewUrl()
     loop.exec();
     QCOMPARE(model.rowCount(QModelIndex()), 2);
 }
+
+void RecursiveDirModelTest::testManyDirs()
+{
+    // More dirs than RecursiveDirModel lists at the same time, some of them
+    // nested
+    QStringList files;
+    for (int dir = 0; dir < 10; ++dir) {
+        for (int file = 0; file < 3; ++file) {
+            files << QString("d%1/pict%2.jpg").arg(dir).arg(file);
+            files << QString("d%1/sub/pict%2.jpg").arg(dir).arg(file);
+        }
+    }
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(files);
+
+    RecursiveDirModel model;
+    TestUtils::TimedEventLoop loop;
+    connect(&model, SIGNAL(completed()), &loop, SLOT(quit()));
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+
+    QCOMPARE(listModelUrls(&model), listExpectedUrls(sandBoxDir, files));
+}
+
+void RecursiveDirModelTest::testDirListerManyDirs()
+{
+    // Same as testManyDirs(), but goes through the KDirLister backend, so
+    // that the queue of pending dirs is used
+    QStringList files;
+    for (int dir = 0; dir < 10; ++dir) {
+        for (int file = 0; file < 3; ++file) {
+            files << QString("d%1/pict%2.jpg").arg(dir).arg(file);
+            files << QString("d%1/sub/pict%2.jpg").arg(dir).arg(file);
+        }
+    }
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(files);
+
+    RecursiveDirModel model;
+    model.setLocalDirScannerEnabled(false);
+    QSignalSpy insertedSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    TestUtils::TimedEventLoop loop;
+    connect(&model, SIGNAL(completed()), &loop, SLOT(quit()));
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+
+    QCOMPARE(listModelUrls(&model), listExpectedUrls(sandBoxDir, files));
+    // Items are inserted in batches, not one by one
+    QVERIFY(insertedSpy.count() < files.count());
+}
+
+void RecursiveDirModelTest::testDirListerRemoveItems()
+{
+    QStringList files;
+    for (int file = 0; file < 8; ++file) {
+        files << QString("pict%1.jpg").arg(file);
+    }
+    TestUtils::SandBoxDir sandBoxDir;
+    sandBoxDir.fill(files);
+
+    RecursiveDirModel model;
+    model.setLocalDirScannerEnabled(false);
+    TestUtils::TimedEventLoop loop;
+    connect(&model, SIGNAL(completed()), &loop, SLOT(quit()));
+    model.setUrl(QUrl::fromLocalFile(sandBoxDir.absolutePath()));
+    loop.exec();
+    QCOMPARE(model.rowCount(QModelIndex()), files.count());
+
+    // Remove rows 0 to 2 and row 5, the way KDirLister::itemsDeleted()
+    // would. Relying on KDirLister to notice the files are gone is not
+    // reliable, see testBasic().
+    KFileItemList removedItems;
+    QList<QUrl> expected = listModelUrls(&model);
+    Q_FOREACH(int row, QList<int>() << 5 << 0 << 2 << 1) {
+        KFileItem item = model.index(row, 0).data(KDirModel::FileItemRole).value<KFileItem>();
+        removedItems << item;
+        expected.removeOne(item.url());
+    }
+
+    QSignalSpy removedSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    bool ok = QMetaObject::invokeMethod(&model, "slotItemsDeleted", Q_ARG(KFileItemList, removedItems));
+    QVERIFY(ok);
+
+    QCOMPARE(listModelUrls(&model), expected);
+    // One signal per range of consecutive rows
+    QCOMPARE(removedSpy.count(), 2);
+}
@@ -34,6 +34,9 @@ private Q_SLOTS:
     void testBasic_data();
     void testBasic();
     void testSetNewUrl();
+    void testManyDirs();
+    void testDirListerManyDirs();
+    void testDirListerRemoveItems();
 };
 
 #endif /* RECURSIVEDIRMODELTEST_H */
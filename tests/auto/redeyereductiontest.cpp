@@ -0,0 +1,181 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "redeyereductiontest.h"
+
+// Stdc
+#include <math.h>
+
+// Qt
+#include <QColor>
+#include <QImage>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/paintutils.h"
+#include "../lib/ramp.h"
+#include "../lib/redeyereduction/redeyereductionimageoperation.h"
+
+QTEST_MAIN(RedEyeReductionTest)
+
+using namespace Gwenview;
+
+/*
+ * The QColor based implementation RedEyeReductionImageOperation::apply() used
+ * before it switched to integer maths. Its output must not change.
+ */
+static qreal referenceRedEyeAlpha(const QColor& src)
+{
+    int hue, sat, value;
+    src.getHsv(&hue, &sat, &value);
+
+    qreal axs = 1.0;
+    if (hue > 259) {
+        static const Ramp ramp(30, 35, 0., 1.);
+        axs = ramp(sat);
+    } else {
+        const Ramp ramp(hue * 2 + 29, hue * 2 + 40, 0., 1.);
+        axs = ramp(sat);
+    }
+
+    return qBound(qreal(0.), src.alphaF() * axs, qreal(1.));
+}
+
+static void referenceApply(QImage* img, const QRectF& rectF)
+{
+    const QRect rect = PaintUtils::containingRect(rectF);
+    const qreal radius = rectF.width() / 2;
+    const qreal centerX = rectF.x() + radius;
+    const qreal centerY = rectF.y() + radius;
+    const Ramp radiusRamp(
+        qMin(qreal(radius * 0.7), qreal(radius - 1)), radius,
+        qreal(1.), qreal(0.));
+
+    uchar* line = img->scanLine(rect.top()) + rect.left() * 4;
+    for (int y = rect.top(); y < rect.bottom(); ++y, line += img->bytesPerLine()) {
+        QRgb* ptr = (QRgb*)line;
+
+        for (int x = rect.left(); x < rect.right(); ++x, ++ptr) {
+            const qreal currentRadius = sqrt(pow(y - centerY, 2) + pow(x - centerX, 2));
+            qreal alpha = radiusRamp(currentRadius);
+            if (qFuzzyCompare(alpha, 0)) {
+                continue;
+            }
+
+            const QColor src(*ptr);
+            alpha *= referenceRedEyeAlpha(src);
+            int r = src.red();
+            int g = src.green();
+            int b = src.blue();
+            QColor dst;
+            dst.setRed(int((1 - alpha) * r + alpha * g));
+            dst.setGreen(g);
+            dst.setBlue(b);
+            *ptr = dst.rgba();
+        }
+    }
+}
+
+/**
+ * Random pixels, half of them with a dominant red, like eyes on a flash photo
+ */
+static QImage createRandomImage(const QSize& size, uint seed)
+{
+    qsrand(seed);
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* ptr = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x, ++ptr) {
+            if (qrand() % 2) {
+                *ptr = qRgba(qrand() % 256, qrand() % 80, qrand() % 80, qrand() % 256);
+            } else {
+                *ptr = qRgba(qrand() % 256, qrand() % 256, qrand() % 256, qrand() % 256);
+            }
+        }
+    }
+    return image;
+}
+
+static void compareImages(const QImage& image, const QImage& expected)
+{
+    QCOMPARE(image.size(), expected.size());
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            if (image.pixel(x, y) != expected.pixel(x, y)) {
+                QFAIL(qPrintable(QString("Pixel %1,%2 is %3, expected %4")
+                    .arg(x).arg(y)
+                    .arg(image.pixel(x, y), 8, 16, QChar('0'))
+                    .arg(expected.pixel(x, y), 8, 16, QChar('0'))));
+            }
+        }
+    }
+}
+
+void RedEyeReductionTest::testSameAsReference_data()
+{
+    QTest::addColumn<QRectF>("rectF");
+    QTest::addColumn<uint>("seed");
+
+    QTest::newRow("whole") << QRectF(0, 0, 200, 200) << 1u;
+    QTest::newRow("fractional") << QRectF(10.3, 20.7, 75.5, 75.5) << 2u;
+    QTest::newRow("odd-diameter") << QRectF(40, 40, 33, 33) << 3u;
+    QTest::newRow("small") << QRectF(100.5, 100.5, 5, 5) << 4u;
+    QTest::newRow("tiny") << QRectF(50.2, 60.9, 1.5, 1.5) << 5u;
+    QTest::newRow("sub-pixel") << QRectF(12.4, 12.4, 0.8, 0.8) << 6u;
+}
+
+void RedEyeReductionTest::testSameAsReference()
+{
+    QFETCH(QRectF, rectF);
+    QFETCH(uint, seed);
+    const QImage image = createRandomImage(QSize(200, 200), seed);
+
+    QImage expected = image;
+    referenceApply(&expected, rectF);
+    QImage result = image;
+    RedEyeReductionImageOperation::apply(&result, rectF);
+
+    compareImages(result, expected);
+}
+
+void RedEyeReductionTest::testColorCube()
+{
+    // 64 values per component, laid out in a 512x512 block. The eye is big
+    // enough for the whole block to be in its inner, fully corrected part.
+    const int imageSize = 1100;
+    const int offset = (imageSize - 512) / 2;
+    QImage image(imageSize, imageSize, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    for (int idx = 0; idx < 64 * 64 * 64; ++idx) {
+        const int r = (idx / 4096) * 255 / 63;
+        const int g = ((idx / 64) % 64) * 255 / 63;
+        const int b = (idx % 64) * 255 / 63;
+        image.setPixel(offset + idx % 512, offset + idx / 512, qRgb(r, g, b));
+    }
+    const QRectF rectF(0, 0, imageSize, imageSize);
+
+    QImage expected = image;
+    referenceApply(&expected, rectF);
+    QImage result = image;
+    RedEyeReductionImageOperation::apply(&result, rectF);
+
+    compareImages(result, expected);
+}
@@ -0,0 +1,209 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "remotefilecachetest.h"
+
+// System
+#include <utime.h>
+
+// Qt
+#include <QFile>
+#include <QUrl>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/remotefilecache.h"
+
+QTEST_MAIN(RemoteFileCacheTest)
+
+using namespace Gwenview;
+
+static const time_t MTIME = 1234567890;
+
+static QUrl remoteUrl(const QString& name)
+{
+    return QUrl(QStringLiteral("sftp://example.com/photos/") + name);
+}
+
+static QByteArray readFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+void RemoteFileCacheTest::init()
+{
+    mTempDir.reset(new QTemporaryDir);
+    QVERIFY(mTempDir->isValid());
+}
+
+void RemoteFileCacheTest::testInsert()
+{
+    RemoteFileCache cache(mTempDir->path(), 1024);
+    const QByteArray data(100, 'a');
+    const QUrl url = remoteUrl("a.jpg");
+
+    QVERIFY(cache.acquire(url, MTIME, data.size()).isEmpty());
+
+    cache.insert(url, MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    const QString path = cache.acquire(url, MTIME, data.size());
+    QVERIFY(!path.isEmpty());
+    QCOMPARE(readFile(path), data);
+    QCOMPARE(cache.size(), qint64(100));
+    cache.release(path);
+}
+
+void RemoteFileCacheTest::testModifiedFile()
+{
+    RemoteFileCache cache(mTempDir->path(), 1024);
+    const QByteArray data(100, 'a');
+    const QUrl url = remoteUrl("a.jpg");
+    cache.insert(url, MTIME, data.size(), data);
+
+    // Files without a modification time cannot be checked, so they are not
+    // cached
+    cache.insert(remoteUrl("b.jpg"), -1, data.size(), data);
+    cache.waitForPendingWrites();
+    QCOMPARE(cache.size(), qint64(100));
+
+    QVERIFY(cache.acquire(url, MTIME + 1, data.size()).isEmpty());
+    QVERIFY(cache.acquire(url, MTIME, data.size() + 1).isEmpty());
+}
+
+void RemoteFileCacheTest::testInsertFile()
+{
+    RemoteFileCache cache(mTempDir->path() + "/cache", 1024);
+    const QByteArray data(100, 'a');
+    const QString localPath = mTempDir->path() + "/download";
+    {
+        QFile file(localPath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(data);
+    }
+
+    const QUrl url = remoteUrl("a.jpg");
+    const QString path = cache.insertFile(url, MTIME, data.size(), localPath);
+    QVERIFY(!path.isEmpty());
+    QVERIFY(!QFile::exists(localPath));
+    QCOMPARE(cache.acquire(url, MTIME, data.size()), path);
+    QCOMPARE(readFile(path), data);
+    cache.release(path);
+    cache.release(path);
+}
+
+void RemoteFileCacheTest::testEviction()
+{
+    RemoteFileCache cache(mTempDir->path(), 250);
+    const QByteArray data(100, 'a');
+    const QUrl urlA = remoteUrl("a.jpg");
+    const QUrl urlB = remoteUrl("b.jpg");
+    const QUrl urlC = remoteUrl("c.jpg");
+
+    cache.insert(urlA, MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    cache.insert(urlB, MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    const QString pathB = cache.acquire(urlB, MTIME, data.size());
+    cache.release(pathB);
+    // Use A, so that B becomes the least recently used entry
+    const QString pathA = cache.acquire(urlA, MTIME, data.size());
+    cache.release(pathA);
+    cache.insert(urlC, MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+
+    QCOMPARE(cache.size(), qint64(200));
+    QVERIFY(QFile::exists(pathA));
+    QVERIFY(cache.acquire(urlB, MTIME, data.size()).isEmpty());
+    QVERIFY(!QFile::exists(pathB));
+}
+
+void RemoteFileCacheTest::testLeasedEntryIsKept()
+{
+    RemoteFileCache cache(mTempDir->path(), 150);
+    const QByteArray data(100, 'a');
+    const QUrl urlA = remoteUrl("a.jpg");
+    cache.insert(urlA, MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    const QString pathA = cache.acquire(urlA, MTIME, data.size());
+    QVERIFY(!pathA.isEmpty());
+
+    // A is the least recently used entry, but it is still being read
+    cache.insert(remoteUrl("b.jpg"), MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    QVERIFY(QFile::exists(pathA));
+    QCOMPARE(cache.size(), qint64(200));
+
+    cache.release(pathA);
+    QVERIFY(!QFile::exists(pathA));
+    QCOMPARE(cache.size(), qint64(100));
+}
+
+void RemoteFileCacheTest::testTooBig()
+{
+    RemoteFileCache cache(mTempDir->path(), 50);
+    const QByteArray data(100, 'a');
+    cache.insert(remoteUrl("a.jpg"), MTIME, data.size(), data);
+    cache.waitForPendingWrites();
+    QCOMPARE(cache.size(), qint64(0));
+}
+
+void RemoteFileCacheTest::testPersistence()
+{
+    const QByteArray data(100, 'a');
+    const QUrl url = remoteUrl("a.jpg");
+    {
+        // Pending writes are done before the cache is destroyed
+        RemoteFileCache cache(mTempDir->path(), 1024);
+        cache.insert(url, MTIME, data.size(), data);
+    }
+    RemoteFileCache cache(mTempDir->path(), 1024);
+    QCOMPARE(cache.size(), qint64(100));
+    const QString path = cache.acquire(url, MTIME, data.size());
+    QVERIFY(!path.isEmpty());
+    QCOMPARE(readFile(path), data);
+    cache.release(path);
+}
+
+void RemoteFileCacheTest::testStaleDownloadsAreRemoved()
+{
+    // Left behind by an interrupted download
+    const QString stalePath = mTempDir->path() + QStringLiteral("/.download-abcdef");
+    // Still being written
+    const QString runningPath = mTempDir->path() + QStringLiteral("/.download-ghijkl");
+    Q_FOREACH(const QString& path, QStringList() << stalePath << runningPath) {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(100, 'a'));
+    }
+    struct utimbuf times;
+    times.actime = MTIME;
+    times.modtime = MTIME;
+    QCOMPARE(utime(QFile::encodeName(stalePath).constData(), &times), 0);
+
+    RemoteFileCache cache(mTempDir->path(), 1024);
+    QVERIFY(!QFile::exists(stalePath));
+    QVERIFY(QFile::exists(runningPath));
+    QCOMPARE(cache.size(), qint64(0));
+}
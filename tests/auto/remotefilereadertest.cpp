@@ -0,0 +1,169 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "remotefilereadertest.h"
+
+// Qt
+#include <QFile>
+#include <QSignalSpy>
+#include <QTimer>
+#include <QUrl>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "testutils.h"
+
+QTEST_MAIN(RemoteFileReaderTest)
+
+using namespace Gwenview;
+
+FakeRemoteFileReader::FakeRemoteFileReader(const QByteArray& content, int chunkSize, bool reportSize)
+: RemoteFileReader(QUrl("fake:/file"))
+, mReadCount(0)
+, mClosed(false)
+, mContent(content)
+, mChunkSize(chunkSize)
+, mReportSize(reportSize)
+, mPosition(0)
+, mRequestedSize(0)
+{}
+
+void FakeRemoteFileReader::openFile(const QUrl&)
+{
+    QTimer::singleShot(0, this, SLOT(emitOpen()));
+}
+
+void FakeRemoteFileReader::readFile(qint64 size)
+{
+    ++mReadCount;
+    mRequestedSize = size;
+    QTimer::singleShot(0, this, SLOT(emitChunk()));
+}
+
+void FakeRemoteFileReader::closeFile()
+{
+    mClosed = true;
+}
+
+void FakeRemoteFileReader::emitOpen()
+{
+    if (mReportSize) {
+        slotSize(0, KIO::filesize_t(mContent.size()));
+    }
+    slotOpen(0);
+}
+
+void FakeRemoteFileReader::emitChunk()
+{
+    // Like a slave, send less than requested and an empty chunk at the end
+    const int size = qMin(qint64(mChunkSize), mRequestedSize);
+    const QByteArray chunk = mContent.mid(mPosition, size);
+    mPosition += chunk.size();
+    slotData(0, chunk);
+}
+
+static QByteArray readTestFile(const QString& name)
+{
+    QFile file(pathForTestFile(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open" << name;
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+void RemoteFileReaderTest::testReadPartialHeader()
+{
+    const QString name = "orient6.jpg";
+    const QByteArray expected = readTestFile(name).left(1024);
+
+    RemoteFileReader reader(urlForTestFile(name));
+    QSignalSpy spy(&reader, SIGNAL(headerRead(QByteArray,bool)));
+    reader.readHeader(1024);
+    QVERIFY(spy.wait(5000));
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toByteArray(), expected);
+    QVERIFY(!spy.at(0).at(1).toBool());
+}
+
+void RemoteFileReaderTest::testReadWholeFile()
+{
+    const QString name = "embedded-thumbnail.jpg";
+    const QByteArray expected = readTestFile(name);
+    QVERIFY(expected.size() < 4096);
+
+    RemoteFileReader reader(urlForTestFile(name));
+    QSignalSpy spy(&reader, SIGNAL(headerRead(QByteArray,bool)));
+    reader.readHeader(4096);
+    QVERIFY(spy.wait(5000));
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toByteArray(), expected);
+    QVERIFY(spy.at(0).at(1).toBool());
+}
+
+void RemoteFileReaderTest::testMissingFile()
+{
+    RemoteFileReader reader(urlForTestFile("does-not-exist.jpg"));
+    QSignalSpy headerSpy(&reader, SIGNAL(headerRead(QByteArray,bool)));
+    QSignalSpy failedSpy(&reader, SIGNAL(failed(QString)));
+    reader.readHeader(1024);
+    QVERIFY(failedSpy.wait(5000));
+
+    QCOMPARE(failedSpy.count(), 1);
+    QCOMPARE(headerSpy.count(), 0);
+}
+
+void RemoteFileReaderTest::testStreamedHeader()
+{
+    const QByteArray content = readTestFile("orient6.jpg");
+    QVERIFY(content.size() > 4096);
+
+    FakeRemoteFileReader reader(content, 700, true);
+    QSignalSpy spy(&reader, SIGNAL(headerRead(QByteArray,bool)));
+    reader.readHeader(4096);
+    QVERIFY(spy.wait(5000));
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toByteArray(), content.left(4096));
+    QVERIFY(!spy.at(0).at(1).toBool());
+    // 5 chunks of 700 bytes, then the remaining 596 bytes
+    QCOMPARE(reader.mReadCount, 6);
+    QVERIFY(reader.mClosed);
+}
+
+void RemoteFileReaderTest::testStreamedWholeFileWithoutSize()
+{
+    const QByteArray content = readTestFile("embedded-thumbnail.jpg");
+    QVERIFY(content.size() < 4096);
+
+    // Without the size, only the empty chunk tells the end has been reached
+    FakeRemoteFileReader reader(content, 700, false);
+    QSignalSpy spy(&reader, SIGNAL(headerRead(QByteArray,bool)));
+    reader.readHeader(4096);
+    QVERIFY(spy.wait(5000));
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toByteArray(), content);
+    QVERIFY(spy.at(0).at(1).toBool());
+    QCOMPARE(reader.mReadCount, content.size() / 700 + 2);
+}
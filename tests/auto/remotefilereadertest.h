@@ -0,0 +1,70 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#ifndef REMOTEFILEREADERTEST_H
+#define REMOTEFILEREADERTEST_H
+
+// Qt
+#include <QObject>
+
+// Local
+#include "../lib/remotefilereader.h"
+
+/**
+ * Streams an in-memory file in chunks, the way a slow KIO slave would
+ */
+class FakeRemoteFileReader : public Gwenview::RemoteFileReader
+{
+    Q_OBJECT
+public:
+    FakeRemoteFileReader(const QByteArray& content, int chunkSize, bool reportSize);
+
+    int mReadCount;
+    bool mClosed;
+
+protected:
+    void openFile(const QUrl&) Q_DECL_OVERRIDE;
+    void readFile(qint64 size) Q_DECL_OVERRIDE;
+    void closeFile() Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void emitOpen();
+    void emitChunk();
+
+private:
+    QByteArray mContent;
+    int mChunkSize;
+    bool mReportSize;
+    int mPosition;
+    qint64 mRequestedSize;
+};
+
+class RemoteFileReaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testReadPartialHeader();
+    void testReadWholeFile();
+    void testMissingFile();
+    void testStreamedHeader();
+    void testStreamedWholeFileWithoutSize();
+};
+
+#endif /* REMOTEFILEREADERTEST_H */
@@ -0,0 +1,195 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "slideshowtest.h"
+
+// Qt
+#include <QSet>
+#include <QSignalSpy>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/document/documentfactory.h"
+#include "../lib/slideshow.h"
+#include <lib/gwenviewconfig.h>
+#include "testutils.h"
+
+QTEST_MAIN(SlideShowTest)
+
+using namespace Gwenview;
+
+static QList<QUrl> testUrls()
+{
+    QList<QUrl> urls;
+    urls << urlForTestFile("test.png")
+         << urlForTestFile("orient6.jpg")
+         << urlForTestFile("orient1_vflip.jpg")
+         << urlForTestFile("embedded-thumbnail.jpg")
+         << urlForTestFile("orient6-small.jpg");
+    return urls;
+}
+
+/**
+ * Makes @a slideShow go to the next url as if its interval had expired, and
+ * shows that url like the application does. Returns an invalid url if the
+ * slideshow stopped instead.
+ */
+static QUrl goToNextUrl(SlideShow* slideShow)
+{
+    QSignalSpy spy(slideShow, SIGNAL(goToUrl(QUrl)));
+    QMetaObject::invokeMethod(slideShow, "goToNextUrl");
+    if (spy.isEmpty() && slideShow->isRunning()) {
+        // Waiting for the next slide to be preloaded
+        waitForSignal(spy);
+    }
+    if (spy.isEmpty()) {
+        return QUrl();
+    }
+    const QUrl url = spy.takeFirst().at(0).value<QUrl>();
+    slideShow->setCurrentUrl(url);
+    return url;
+}
+
+void SlideShowTest::init()
+{
+    DocumentFactory::instance()->clearCache();
+    GwenviewConfig::setLoop(false);
+    GwenviewConfig::setRandom(false);
+}
+
+void SlideShowTest::testNextOrderedUrl()
+{
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setCurrentUrl(urls.at(1));
+    slideShow.start(urls);
+    QVERIFY(slideShow.isRunning());
+
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(2));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(3));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(4));
+
+    // Without loop, the slideshow stops at the end of the list
+    QCOMPARE(goToNextUrl(&slideShow), QUrl());
+    QVERIFY(!slideShow.isRunning());
+}
+
+void SlideShowTest::testNextOrderedUrlWithLoop()
+{
+    GwenviewConfig::setLoop(true);
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setCurrentUrl(urls.at(3));
+    slideShow.start(urls);
+
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(4));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(0));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(1));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(2));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(3));
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(4));
+    QVERIFY(slideShow.isRunning());
+}
+
+void SlideShowTest::testNextRandomUrl()
+{
+    GwenviewConfig::setRandom(true);
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setCurrentUrl(urls.at(0));
+    slideShow.start(urls);
+
+    // Every url is shown once, then the slideshow stops
+    QList<QUrl> shownUrls;
+    for (int idx = 0; idx < urls.count(); ++idx) {
+        const QUrl url = goToNextUrl(&slideShow);
+        QVERIFY(url.isValid());
+        shownUrls << url;
+    }
+    QCOMPARE(shownUrls.toSet(), urls.toSet());
+    QCOMPARE(goToNextUrl(&slideShow), QUrl());
+    QVERIFY(!slideShow.isRunning());
+}
+
+void SlideShowTest::testCurrentUrlNotInList()
+{
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setCurrentUrl(urls.at(0));
+    slideShow.start(urls);
+
+    // There is no next url for a url which is not in the list
+    slideShow.setCurrentUrl(urlForTestFile("test.svg"));
+    QCOMPARE(goToNextUrl(&slideShow), QUrl());
+    QVERIFY(!slideShow.isRunning());
+}
+
+void SlideShowTest::testPreloadUpcomingUrls()
+{
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setPreloadSize(QSize(1024, 768));
+    slideShow.setCurrentUrl(urls.at(0));
+    slideShow.start(urls);
+
+    // The next two slides are preloaded, not the others
+    DocumentFactory* factory = DocumentFactory::instance();
+    QVERIFY(!factory->hasUrl(urls.at(0)));
+    QVERIFY(factory->hasUrl(urls.at(1)));
+    QVERIFY(factory->hasUrl(urls.at(2)));
+    QVERIFY(!factory->hasUrl(urls.at(3)));
+    QVERIFY(!factory->hasUrl(urls.at(4)));
+
+    // Moving forward preloads the following one
+    QCOMPARE(goToNextUrl(&slideShow), urls.at(1));
+    QVERIFY(factory->hasUrl(urls.at(3)));
+    QVERIFY(!factory->hasUrl(urls.at(4)));
+}
+
+void SlideShowTest::testPreloadUpcomingRandomUrls()
+{
+    GwenviewConfig::setRandom(true);
+    const QList<QUrl> urls = testUrls();
+    SlideShow slideShow(0);
+    slideShow.setInterval(3600);
+    slideShow.setPreloadSize(QSize(1024, 768));
+    slideShow.setCurrentUrl(urls.at(0));
+    slideShow.start(urls);
+
+    QSet<QUrl> preloadedUrls;
+    Q_FOREACH(const QUrl& url, urls) {
+        if (DocumentFactory::instance()->hasUrl(url)) {
+            preloadedUrls << url;
+        }
+    }
+    QCOMPARE(preloadedUrls.count(), 2);
+
+    // The preloaded urls are the next ones of the shuffled list
+    QSet<QUrl> nextUrls;
+    nextUrls << goToNextUrl(&slideShow);
+    nextUrls << goToNextUrl(&slideShow);
+    QCOMPARE(nextUrls, preloadedUrls);
+}
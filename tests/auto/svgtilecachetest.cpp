@@ -0,0 +1,107 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "svgtilecachetest.h"
+
+// Qt
+#include <QImage>
+#include <QPainter>
+#include <QRegion>
+#include <QSignalSpy>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/documentview/svgtilecache.h"
+
+QTEST_MAIN(SvgTileCacheTest)
+
+using namespace Gwenview;
+
+static const QSize SVG_SIZE(1000, 800);
+
+static QByteArray createSvg()
+{
+    return QByteArray(
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" height=\"800\">"
+        "<rect width=\"1000\" height=\"800\" fill=\"#ff0000\"/>"
+        "</svg>");
+}
+
+static QImage paintCache(SvgTileCache* cache, const QRect& rect)
+{
+    QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    cache->paint(&painter, QPointF(0, 0), rect);
+    return image;
+}
+
+static bool waitForTiles(const QSignalSpy& spy, int count)
+{
+    for (int idx = 0; idx < 100 && spy.count() < count; ++idx) {
+        QTest::qWait(50);
+    }
+    return spy.count() >= count;
+}
+
+void SvgTileCacheTest::testRenderTiles()
+{
+    SvgTileCache cache;
+    QSignalSpy spy(&cache, SIGNAL(tileRendered(QRect)));
+    cache.setData(createSvg(), SVG_SIZE);
+    cache.setZoom(1);
+
+    // Nothing is cached yet: painting schedules the 2x2 tiles covering the rect
+    const QRect rect(0, 0, 500, 400);
+    QImage image = paintCache(&cache, rect);
+    QCOMPARE(image.pixel(250, 200), qRgba(0, 0, 0, 0));
+    QVERIFY(waitForTiles(spy, 4));
+
+    QRegion rendered;
+    for (int idx = 0; idx < spy.count(); ++idx) {
+        rendered += spy.at(idx).at(0).toRect();
+    }
+    QVERIFY(rendered.contains(rect));
+
+    image = paintCache(&cache, rect);
+    QCOMPARE(image.pixel(0, 0), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(250, 200), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(499, 399), qRgb(255, 0, 0));
+}
+
+void SvgTileCacheTest::testFallbackZoom()
+{
+    SvgTileCache cache;
+    QSignalSpy spy(&cache, SIGNAL(tileRendered(QRect)));
+    cache.setData(createSvg(), SVG_SIZE);
+    cache.setZoom(1);
+    paintCache(&cache, QRect(0, 0, 1000, 800));
+    QVERIFY(waitForTiles(spy, 16));
+
+    // The tiles of zoom 1 must be shown, scaled, until the ones of zoom 0.5
+    // are ready
+    spy.clear();
+    cache.setZoom(0.5);
+    const QImage image = paintCache(&cache, QRect(0, 0, 500, 400));
+    QCOMPARE(image.pixel(100, 100), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(400, 300), qRgb(255, 0, 0));
+    QVERIFY(waitForTiles(spy, 4));
+}
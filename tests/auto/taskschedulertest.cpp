@@ -0,0 +1,169 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+#include "taskschedulertest.h"
+
+// Qt
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QThread>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/taskscheduler.h"
+
+QTEST_MAIN(TaskSchedulerTest)
+
+using namespace Gwenview;
+
+/**
+ * Helper whose tasks can be held until the test releases them
+ */
+struct TestTaskRunner
+{
+    QSemaphore mStarted;
+    QSemaphore mRelease;
+    QAtomicInt mRunCount;
+    QThread* mThread;
+
+    TestTaskRunner()
+    : mRunCount(0)
+    , mThread(0)
+    {}
+
+    int compute()
+    {
+        mRunCount.ref();
+        return 42;
+    }
+
+    void block()
+    {
+        mStarted.release();
+        mRelease.acquire();
+    }
+
+    void waitUntilCanceled()
+    {
+        mStarted.release();
+        while (!TaskScheduler::isCurrentTaskCanceled()) {
+            QThread::msleep(1);
+        }
+    }
+
+    void recordThread()
+    {
+        mThread = QThread::currentThread();
+        mRunCount.ref();
+    }
+};
+
+static int sMaxSaves;
+
+void TaskSchedulerTest::init()
+{
+    // Run at most one Save task at a time, so that a blocked task keeps
+    // the other ones in the queue
+    sMaxSaves = TaskScheduler::instance()->maxConcurrentTasks(TaskScheduler::Save);
+    TaskScheduler::instance()->setMaxConcurrentTasks(TaskScheduler::Save, 1);
+}
+
+void TaskSchedulerTest::cleanup()
+{
+    TaskScheduler::instance()->setMaxConcurrentTasks(TaskScheduler::Save, sMaxSaves);
+}
+
+void TaskSchedulerTest::testResult()
+{
+    TestTaskRunner runner;
+    QFuture<int> future = TaskScheduler::instance()->run(TaskScheduler::VisibleDocument, &runner, &TestTaskRunner::compute);
+    TaskScheduler::instance()->waitForFinished(future);
+    QVERIFY(future.isFinished());
+    QCOMPARE(future.result(), 42);
+    QCOMPARE(runner.mRunCount.load(), 1);
+}
+
+void TaskSchedulerTest::testCancelQueuedTask()
+{
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    TestTaskRunner blocker;
+    QFuture<void> blockerFuture = scheduler->run(TaskScheduler::Save, &blocker, &TestTaskRunner::block);
+    blocker.mStarted.acquire();
+
+    TestTaskRunner runner;
+    QFuture<int> future = scheduler->run(TaskScheduler::Save, &runner, &TestTaskRunner::compute);
+    QVERIFY(future.isRunning());
+    scheduler->cancel(future);
+    QVERIFY(future.isCanceled());
+    QVERIFY(future.isFinished());
+
+    blocker.mRelease.release();
+    scheduler->waitForFinished(blockerFuture);
+    QCOMPARE(runner.mRunCount.load(), 0);
+}
+
+void TaskSchedulerTest::testCancelRunningTask()
+{
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    TestTaskRunner runner;
+    QFuture<void> future = scheduler->run(TaskScheduler::Save, &runner, &TestTaskRunner::waitUntilCanceled);
+    runner.mStarted.acquire();
+    scheduler->cancel(future);
+    scheduler->waitForFinished(future);
+    QVERIFY(future.isFinished());
+}
+
+void TaskSchedulerTest::testWaitRunsQueuedTask()
+{
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    TestTaskRunner blocker;
+    QFuture<void> blockerFuture = scheduler->run(TaskScheduler::Save, &blocker, &TestTaskRunner::block);
+    blocker.mStarted.acquire();
+
+    // The queued task must not wait for the blocker to be done
+    TestTaskRunner runner;
+    QFuture<void> future = scheduler->run(TaskScheduler::Save, &runner, &TestTaskRunner::recordThread);
+    scheduler->waitForFinished(future);
+    QVERIFY(future.isFinished());
+    QCOMPARE(runner.mRunCount.load(), 1);
+    QCOMPARE(runner.mThread, QThread::currentThread());
+
+    blocker.mRelease.release();
+    scheduler->waitForFinished(blockerFuture);
+}
+
+void TaskSchedulerTest::testPromoteQueuedTask()
+{
+    TaskScheduler* scheduler = TaskScheduler::instance();
+    TestTaskRunner blocker;
+    QFuture<void> blockerFuture = scheduler->run(TaskScheduler::Save, &blocker, &TestTaskRunner::block);
+    blocker.mStarted.acquire();
+
+    // Once promoted, the task must not wait for the Save class to be free
+    TestTaskRunner runner;
+    QFuture<void> future = scheduler->run(TaskScheduler::Save, &runner, &TestTaskRunner::recordThread);
+    scheduler->setPriority(future, TaskScheduler::VisibleDocument);
+    QTRY_VERIFY(future.isFinished());
+    QCOMPARE(runner.mRunCount.load(), 1);
+    QVERIFY(runner.mThread != QThread::currentThread());
+
+    blocker.mRelease.release();
+    scheduler->waitForFinished(blockerFuture);
+}
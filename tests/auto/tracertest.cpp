@@ -0,0 +1,188 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "tracertest.h"
+
+// Qt
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QThread>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/tracer.h"
+
+QTEST_MAIN(TracerTest)
+
+using namespace Gwenview;
+
+class TracedThread : public QThread
+{
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        GV_TRACE_SCOPE("worker");
+    }
+};
+
+/**
+ * Writes the trace and returns its events
+ */
+static QJsonArray writeAndReadTrace()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/trace.json";
+    if (!Tracer::writeTrace(path)) {
+        return QJsonArray();
+    }
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    return doc.object().value("traceEvents").toArray();
+}
+
+/**
+ * Returns the complete events of @a events, by name
+ */
+static QMap<QString, QJsonObject> completeEvents(const QJsonArray& events)
+{
+    QMap<QString, QJsonObject> map;
+    Q_FOREACH(const QJsonValue & value, events) {
+        const QJsonObject object = value.toObject();
+        if (object.value("ph").toString() == "X") {
+            map.insert(object.value("name").toString(), object);
+        }
+    }
+    return map;
+}
+
+void TracerTest::init()
+{
+    Tracer::clear();
+    Tracer::setEnabled(true);
+}
+
+void TracerTest::cleanup()
+{
+    Tracer::setEnabled(false);
+}
+
+void TracerTest::testDisabled()
+{
+    Tracer::setEnabled(false);
+    {
+        GV_TRACE_SCOPE("disabled");
+    }
+    QVERIFY(completeEvents(writeAndReadTrace()).isEmpty());
+}
+
+void TracerTest::testScopes()
+{
+    {
+        GV_TRACE_SCOPE("outer");
+        QTest::qSleep(5);
+        {
+            GV_TRACE_SCOPE("inner");
+            QTest::qSleep(5);
+        }
+    }
+    const QMap<QString, QJsonObject> events = completeEvents(writeAndReadTrace());
+    QCOMPARE(events.count(), 2);
+    QVERIFY(events.contains("outer"));
+    QVERIFY(events.contains("inner"));
+
+    const QJsonObject outer = events.value("outer");
+    const QJsonObject inner = events.value("inner");
+    QCOMPARE(outer.value("cat").toString(), QString("gwenview"));
+    // Timestamps and durations are in microseconds
+    QVERIFY(outer.value("dur").toDouble() >= 10000);
+    QVERIFY(inner.value("dur").toDouble() >= 5000);
+    QVERIFY(inner.value("ts").toDouble() >= outer.value("ts").toDouble());
+    QVERIFY(inner.value("ts").toDouble() + inner.value("dur").toDouble()
+            <= outer.value("ts").toDouble() + outer.value("dur").toDouble());
+    QCOMPARE(inner.value("tid").toInt(), outer.value("tid").toInt());
+}
+
+void TracerTest::testThreads()
+{
+    {
+        GV_TRACE_SCOPE("main");
+    }
+    TracedThread thread;
+    thread.start();
+    QVERIFY(thread.wait(5000));
+
+    const QJsonArray array = writeAndReadTrace();
+    const QMap<QString, QJsonObject> events = completeEvents(array);
+    QCOMPARE(events.count(), 2);
+    const int mainTid = events.value("main").value("tid").toInt();
+    const int workerTid = events.value("worker").value("tid").toInt();
+    QVERIFY(mainTid != workerTid);
+
+    // Threads are named by metadata events
+    QMap<int, QString> threadNames;
+    Q_FOREACH(const QJsonValue & value, array) {
+        const QJsonObject object = value.toObject();
+        if (object.value("ph").toString() == "M" && object.value("name").toString() == "thread_name") {
+            threadNames.insert(object.value("tid").toInt(), object.value("args").toObject().value("name").toString());
+        }
+    }
+    QCOMPARE(threadNames.value(mainTid), QString("Main"));
+    QVERIFY(!threadNames.value(workerTid).isEmpty());
+}
+
+void TracerTest::testFlush()
+{
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/trace.json";
+    Tracer::setTraceFile(path);
+    {
+        GV_TRACE_SCOPE("first");
+    }
+    QVERIFY(Tracer::flush());
+    {
+        GV_TRACE_SCOPE("second");
+    }
+    QVERIFY(Tracer::flush());
+    // Flushed events are forgotten
+    QVERIFY(completeEvents(writeAndReadTrace()).isEmpty());
+
+    // The closing bracket is only written when the file is finished, the
+    // trace must be readable without it
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll() + "]");
+    QMap<QString, QJsonObject> events = completeEvents(doc.array());
+    QCOMPARE(events.count(), 2);
+    QVERIFY(events.contains("first"));
+    QVERIFY(events.contains("second"));
+    file.close();
+
+    Tracer::setTraceFile(QString());
+    QVERIFY(!Tracer::flush());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    doc = QJsonDocument::fromJson(file.readAll());
+    QCOMPARE(completeEvents(doc.array()).count(), 2);
+}
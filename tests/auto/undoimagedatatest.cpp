@@ -0,0 +1,121 @@
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "undoimagedatatest.h"
+
+// Qt
+#include <QImage>
+
+// KDE
+#include <qtest.h>
+
+// Local
+#include "../lib/undoimagedata.h"
+
+QTEST_MAIN(UndoImageDataTest)
+
+using namespace Gwenview;
+
+static QImage createImage(const QSize& size, const QColor& color)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(color.rgb());
+    return image;
+}
+
+// UndoImageData only uses the document pointer as a key
+static const Document* fakeDocument(int id)
+{
+    return reinterpret_cast<const Document*>(quintptr(id));
+}
+
+void UndoImageDataTest::testRestoreRect()
+{
+    const QImage original = createImage(QSize(100, 80), Qt::red);
+    const QRect rect(10, 20, 30, 15);
+
+    UndoImageData data(fakeDocument(1));
+    data.storeRect(original, rect);
+
+    QImage modified = original;
+    modified.fill(QColor(Qt::blue).rgb());
+
+    QImage restored = data.restore(modified);
+    QCOMPARE(restored.size(), original.size());
+    QCOMPARE(restored.copy(rect), original.copy(rect));
+    QCOMPARE(restored.pixel(0, 0), QColor(Qt::blue).rgb());
+}
+
+void UndoImageDataTest::testRestoreImage()
+{
+    const QImage original = createImage(QSize(100, 80), Qt::red);
+
+    UndoImageData data(fakeDocument(1));
+    data.storeImage(original);
+
+    QImage restored = data.restore(createImage(QSize(10, 10), Qt::blue));
+    QCOMPARE(restored, original);
+}
+
+void UndoImageDataTest::testMemoryUsage()
+{
+    const QImage image = createImage(QSize(100, 80), Qt::red);
+    const QRect rect(0, 0, 10, 10);
+    QCOMPARE(UndoImageData::memoryUsage(fakeDocument(2)), qint64(0));
+    {
+        UndoImageData data1(fakeDocument(2));
+        data1.storeImage(image);
+        UndoImageData data2(fakeDocument(2));
+        data2.storeRect(image, rect);
+        UndoImageData data3(fakeDocument(3));
+        data3.storeImage(image);
+
+        QCOMPARE(UndoImageData::memoryUsage(fakeDocument(2)), qint64(image.byteCount() + image.copy(rect).byteCount()));
+        QCOMPARE(UndoImageData::memoryUsage(fakeDocument(3)), qint64(image.byteCount()));
+    }
+    QCOMPARE(UndoImageData::memoryUsage(fakeDocument(2)), qint64(0));
+    QCOMPARE(UndoImageData::memoryUsage(fakeDocument(3)), qint64(0));
+}
+
+void UndoImageDataTest::testSpill()
+{
+    // Budget in megabytes
+    qputenv("GV_UNDO_MEMORY_BUDGET", "1");
+
+    // Each image uses 400 KB: storing four of them goes over the 1 MB
+    // budget, the oldest ones must be moved to temporary files
+    const QSize size(320, 320);
+    QList<QColor> colors;
+    colors << Qt::red << Qt::green << Qt::blue << Qt::yellow;
+    QList<UndoImageData*> list;
+    Q_FOREACH(const QColor& color, colors) {
+        UndoImageData* data = new UndoImageData(fakeDocument(4));
+        data->storeImage(createImage(size, color));
+        list << data;
+    }
+    QVERIFY(UndoImageData::memoryUsage(fakeDocument(4)) <= 1024 * 1024);
+
+    // Spilled images are restored from their file
+    for (int idx = 0; idx < colors.count(); ++idx) {
+        QCOMPARE(list.at(idx)->restore(QImage()), createImage(size, colors.at(idx)));
+    }
+    qDeleteAll(list);
+    QCOMPARE(UndoImageData::memoryUsage(fakeDocument(4)), qint64(0));
+    qunsetenv("GV_UNDO_MEMORY_BUDGET");
+}
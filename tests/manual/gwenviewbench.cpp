@@ -0,0 +1,456 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+/*
+ * gwenview_bench: benchmarks of JPEG decoding at each DCT scale, ImageScaler,
+ * thumbnail generation, lossless JPEG transforms, SortedDirModel sorting and
+ * filtering, and color management transforms.
+ *
+ * It accepts the usual QTest arguments (-iterations, -callgrind, -perf...),
+ * and "-json <file>" to write the results as JSON:
+ *
+ * {
+ *     "benchmark": "gwenview_bench",
+ *     "qtVersion": "5.x.y",
+ *     "results": [
+ *         {"name": "benchJpegDecode", "tag": "1/8", "metric": "WalltimeMilliseconds",
+ *          "value": 4.5, "total": 72, "iterations": 16},
+ *         ...
+ *     ]
+ * }
+ *
+ * "value" is the value for one iteration.
+ */
+#include "gwenviewbench.h"
+
+// Qt
+#include <QApplication>
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRegExp>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QUrl>
+
+// KDE
+#include <KDirLister>
+#include <KDirModel>
+
+// Local
+#include <lib/document/document.h>
+#include <lib/document/documentfactory.h>
+#include <lib/imageformats/imageformats.h>
+#include <lib/imagescaler.h>
+#include <lib/jpegcontent.h>
+#include <lib/mimetypeutils.h>
+#include <lib/semanticinfo/sorteddirmodel.h>
+#include <lib/thumbnailprovider/thumbnailgenerator.h>
+
+// LCMS2
+#include <lcms2.h>
+
+using namespace Gwenview;
+
+static const QSize FIXTURE_SIZE(4096, 3072);
+static const QSize VIEWPORT_SIZE(1920, 1080);
+static const int LIST_TIMEOUT = 5 * 60 * 1000;
+static const int DOWN_SAMPLE_TIMEOUT = 30 * 1000;
+
+static QImage createImage(const QSize& size)
+{
+    // Gradients and thin lines, so that the image is neither trivial to
+    // compress nor to scale
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    painter.setPen(Qt::white);
+    for (int x = 0; x < size.width(); x += 7) {
+        painter.drawLine(x, 0, x, size.height());
+    }
+    return image;
+}
+
+static cmsHPROFILE createWideGamutProfile()
+{
+    // Adobe RGB (1998) primaries, with a plain 2.2 gamma
+    cmsCIExyY whitePoint;
+    cmsWhitePointFromTemp(&whitePoint, 6504);
+    cmsCIExyYTRIPLE primaries = {
+        {0.6400, 0.3300, 1.0},
+        {0.2100, 0.7100, 1.0},
+        {0.1500, 0.0600, 1.0}
+    };
+    cmsToneCurve* curve = cmsBuildGamma(0, 2.2);
+    cmsToneCurve* curves[3] = {curve, curve, curve};
+    cmsHPROFILE profile = cmsCreateRGBProfile(&whitePoint, &primaries, curves);
+    cmsFreeToneCurve(curve);
+    return profile;
+}
+
+void GwenviewBench::initTestCase()
+{
+    ImageFormats::registerPlugins();
+    QVERIFY(mDir.isValid());
+
+    const QImage image = createImage(FIXTURE_SIZE);
+    QBuffer buffer(&mJpegData);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "jpeg", 90));
+    mJpegSize = image.size();
+
+    mJpegPath = mDir.path() + QStringLiteral("/fixture.jpg");
+    QFile file(mJpegPath);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(mJpegData), qint64(mJpegData.size()));
+
+    mSRgbProfile = Cms::Profile::getSRgbProfile();
+    QVERIFY(mSRgbProfile.data());
+    mWideGamutProfile = createWideGamutProfile();
+    QVERIFY(mWideGamutProfile);
+}
+
+void GwenviewBench::cleanupTestCase()
+{
+    if (mWideGamutProfile) {
+        cmsCloseProfile(mWideGamutProfile);
+    }
+}
+
+QString GwenviewBench::dirWithFiles(int count)
+{
+    QString path = mDirForFileCount.value(count);
+    if (!path.isEmpty()) {
+        return path;
+    }
+    path = mDir.path() + QStringLiteral("/files%1").arg(count);
+    if (!QDir().mkpath(path)) {
+        return QString();
+    }
+    // Not created in sort order, and a mix of kinds for the filters
+    static const char* extensions[] = {"jpg", "png", "txt", "ogv"};
+    for (int idx = 0; idx < count; ++idx) {
+        const QString name = QStringLiteral("pict%1.%2")
+            .arg((idx * 7919) % count, 6, 10, QChar('0'))
+            .arg(QLatin1String(extensions[idx % 4]));
+        QFile file(path + '/' + name);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return QString();
+        }
+    }
+    mDirForFileCount.insert(count, path);
+    return path;
+}
+
+static void listDir(SortedDirModel* model, const QString& path, int count)
+{
+    KDirLister* lister = model->dirLister();
+    lister->openUrl(QUrl::fromLocalFile(path));
+    QTRY_VERIFY_WITH_TIMEOUT(lister->isFinished(), LIST_TIMEOUT);
+    QCOMPARE(model->rowCount(), count);
+}
+
+//
+// JPEG decoding
+//
+void GwenviewBench::benchJpegDecode_data()
+{
+    QTest::addColumn<int>("scale");
+    QTest::newRow("1/1") << 1;
+    QTest::newRow("1/2") << 2;
+    QTest::newRow("1/4") << 4;
+    QTest::newRow("1/8") << 8;
+}
+
+void GwenviewBench::benchJpegDecode()
+{
+    QFETCH(int, scale);
+    QBENCHMARK {
+        QBuffer buffer(&mJpegData);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "jpeg");
+        if (scale > 1) {
+            reader.setScaledSize(mJpegSize / scale);
+        }
+        const QImage image = reader.read();
+        QVERIFY(!image.isNull());
+    }
+}
+
+//
+// ImageScaler
+//
+void GwenviewBench::benchScaleRect_data()
+{
+    QTest::addColumn<qreal>("zoom");
+    QTest::newRow("zoom 0.25") << qreal(0.25);
+    QTest::newRow("zoom 0.5") << qreal(0.5);
+    QTest::newRow("zoom 1") << qreal(1);
+    QTest::newRow("zoom 1.5") << qreal(1.5);
+    QTest::newRow("zoom 3") << qreal(3);
+}
+
+void GwenviewBench::benchScaleRect()
+{
+    QFETCH(qreal, zoom);
+    Document::Ptr doc = DocumentFactory::instance()->load(QUrl::fromLocalFile(mJpegPath));
+    doc->waitUntilLoaded();
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+    if (zoom < Document::maxDownSampledZoom() && !doc->prepareDownSampledImageForZoom(zoom)) {
+        QSignalSpy spy(doc.data(), SIGNAL(downSampledImageReady()));
+        QVERIFY(spy.wait(DOWN_SAMPLE_TIMEOUT));
+    }
+
+    ImageScaler scaler;
+    scaler.setDocument(doc);
+    scaler.setZoom(zoom);
+    // Same as RasterImageView
+    scaler.setTransformationMode(zoom < 2 ? Qt::SmoothTransformation : Qt::FastTransformation);
+    const QRect rect = QRect(QPoint(0, 0), VIEWPORT_SIZE).intersected(QRect(QPoint(0, 0), doc->size() * zoom));
+    QSignalSpy spy(&scaler, SIGNAL(scaledRect(int,int,QImage)));
+    QBENCHMARK {
+        scaler.setDestinationRegion(rect);
+    }
+    QVERIFY(spy.count() > 0);
+}
+
+//
+// Thumbnails
+//
+void GwenviewBench::benchThumbnailLoad_data()
+{
+    QTest::addColumn<int>("pixelSize");
+    QTest::newRow("normal") << 128;
+    QTest::newRow("large") << 256;
+}
+
+void GwenviewBench::benchThumbnailLoad()
+{
+    QFETCH(int, pixelSize);
+    QBENCHMARK {
+        ThumbnailContext context;
+        QVERIFY(context.load(mJpegPath, pixelSize));
+    }
+}
+
+//
+// JpegContent
+//
+void GwenviewBench::benchJpegTransform_data()
+{
+    QTest::addColumn<int>("orientation");
+    QTest::newRow("rot90") << int(ROT_90);
+    QTest::newRow("rot180") << int(ROT_180);
+    QTest::newRow("hflip") << int(HFLIP);
+}
+
+void GwenviewBench::benchJpegTransform()
+{
+    QFETCH(int, orientation);
+    QBENCHMARK {
+        JpegContent content;
+        QVERIFY(content.loadFromData(mJpegData));
+        content.transform(Orientation(orientation));
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(content.save(&buffer));
+    }
+}
+
+//
+// SortedDirModel
+//
+void GwenviewBench::benchSortedDirModelSort_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("10000 rows") << 10000;
+    QTest::newRow("100000 rows") << 100000;
+}
+
+void GwenviewBench::benchSortedDirModelSort()
+{
+    QFETCH(int, count);
+    const QString path = dirWithFiles(count);
+    QVERIFY(!path.isEmpty());
+    SortedDirModel model;
+    listDir(&model, path, count);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QBENCHMARK {
+        order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+        model.sort(KDirModel::Name, order);
+    }
+}
+
+void GwenviewBench::benchSortedDirModelFilter_data()
+{
+    benchSortedDirModelSort_data();
+}
+
+void GwenviewBench::benchSortedDirModelFilter()
+{
+    QFETCH(int, count);
+    const QString path = dirWithFiles(count);
+    QVERIFY(!path.isEmpty());
+    SortedDirModel model;
+    listDir(&model, path, count);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    // Each pass runs SortedDirModel::filterAcceptsRow() on all the rows
+    QBENCHMARK {
+        model.setFilterWildcard(QStringLiteral("*5*"));
+        model.setFilterWildcard(QString());
+    }
+    QCOMPARE(model.rowCount(), count);
+}
+
+//
+// Color management
+//
+void GwenviewBench::benchCmsCreateTransform()
+{
+    QBENCHMARK {
+        cmsHTRANSFORM transform = cmsCreateTransform(
+            mWideGamutProfile, TYPE_BGRA_8, mSRgbProfile->handle(), TYPE_BGRA_8,
+            INTENT_PERCEPTUAL, cmsFLAGS_BLACKPOINTCOMPENSATION);
+        QVERIFY(transform);
+        cmsDeleteTransform(transform);
+    }
+}
+
+void GwenviewBench::benchCmsDoTransform_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("viewport") << VIEWPORT_SIZE;
+    QTest::newRow("full image") << FIXTURE_SIZE;
+}
+
+void GwenviewBench::benchCmsDoTransform()
+{
+    QFETCH(QSize, size);
+    // Same transform as RasterImageView
+    cmsHTRANSFORM transform = cmsCreateTransform(
+        mWideGamutProfile, TYPE_BGRA_8, mSRgbProfile->handle(), TYPE_BGRA_8,
+        INTENT_PERCEPTUAL, cmsFLAGS_BLACKPOINTCOMPENSATION);
+    QVERIFY(transform);
+    QImage image = createImage(size);
+    QBENCHMARK {
+        cmsDoTransform(transform, image.bits(), image.bits(), image.width() * image.height());
+    }
+    cmsDeleteTransform(transform);
+}
+
+//
+// JSON output
+//
+/**
+ * Converts the output of the QTest csv logger, one line per result:
+ * "function","tag","metric",value_per_iteration,total,iterations
+ */
+static bool writeJson(const QString& csvPath, const QString& jsonPath)
+{
+    QFile csvFile(csvPath);
+    if (!csvFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read" << csvPath;
+        return false;
+    }
+    QRegExp rx("^\"([^\"]*)\",\"([^\"]*)\",\"([^\"]*)\",([^,]+),([^,]+),(\\d+)$");
+    QJsonArray results;
+    while (!csvFile.atEnd()) {
+        const QString line = QString::fromUtf8(csvFile.readLine()).trimmed();
+        if (!rx.exactMatch(line)) {
+            continue;
+        }
+        QJsonObject result;
+        result.insert(QStringLiteral("name"), rx.cap(1));
+        result.insert(QStringLiteral("tag"), rx.cap(2));
+        result.insert(QStringLiteral("metric"), rx.cap(3));
+        result.insert(QStringLiteral("value"), rx.cap(4).toDouble());
+        result.insert(QStringLiteral("total"), rx.cap(5).toDouble());
+        result.insert(QStringLiteral("iterations"), rx.cap(6).toInt());
+        results.append(result);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("benchmark"), QStringLiteral("gwenview_bench"));
+    root.insert(QStringLiteral("qtVersion"), QString::fromLatin1(qVersion()));
+    root.insert(QStringLiteral("results"), results);
+
+    QFile jsonFile(jsonPath);
+    if (!jsonFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write" << jsonPath;
+        return false;
+    }
+    jsonFile.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    QApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    QString jsonPath;
+    const int jsonIndex = args.indexOf(QStringLiteral("-json"));
+    if (jsonIndex != -1) {
+        if (jsonIndex + 1 >= args.count()) {
+            qWarning() << "Usage: gwenview_bench [-json <file>] [QTest options]";
+            return 1;
+        }
+        jsonPath = args.at(jsonIndex + 1);
+        args.erase(args.begin() + jsonIndex, args.begin() + jsonIndex + 2);
+    }
+
+    // Results are read back from a csv log, the console keeps the usual
+    // output
+    QTemporaryFile csvFile;
+    if (!jsonPath.isEmpty()) {
+        if (!csvFile.open()) {
+            qWarning() << "Could not create temporary file";
+            return 1;
+        }
+        args << QStringLiteral("-o") << csvFile.fileName() + QStringLiteral(",csv")
+             << QStringLiteral("-o") << QStringLiteral("-,txt");
+    }
+
+    GwenviewBench bench;
+    const int ret = QTest::qExec(&bench, args);
+    if (!jsonPath.isEmpty() && !writeJson(csvFile.fileName(), jsonPath)) {
+        return 1;
+    }
+    return ret;
+}
@@ -0,0 +1,79 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef GWENVIEWBENCH_H
+#define GWENVIEWBENCH_H
+
+// Qt
+#include <QByteArray>
+#include <QMap>
+#include <QObject>
+#include <QSize>
+#include <QTemporaryDir>
+
+// Local
+#include <lib/cms/cmsprofile.h>
+
+/**
+ * Benchmarks of the hot paths of Gwenview. Fixtures are generated in
+ * initTestCase(), so the benchmarks do not need any data file.
+ */
+class GwenviewBench : public QObject
+{
+    Q_OBJECT
+public:
+    GwenviewBench()
+    : mWideGamutProfile(0)
+    {}
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchJpegDecode();
+    void benchJpegDecode_data();
+    void benchScaleRect();
+    void benchScaleRect_data();
+    void benchThumbnailLoad();
+    void benchThumbnailLoad_data();
+    void benchJpegTransform();
+    void benchJpegTransform_data();
+    void benchSortedDirModelSort();
+    void benchSortedDirModelSort_data();
+    void benchSortedDirModelFilter();
+    void benchSortedDirModelFilter_data();
+    void benchCmsCreateTransform();
+    void benchCmsDoTransform();
+    void benchCmsDoTransform_data();
+
+private:
+    QTemporaryDir mDir;
+    QByteArray mJpegData;
+    QString mJpegPath;
+    QSize mJpegSize;
+    // Dirs full of empty files, by file count
+    QMap<int, QString> mDirForFileCount;
+    Gwenview::Cms::Profile::Ptr mSRgbProfile;
+    cmsHPROFILE mWideGamutProfile;
+
+    QString dirWithFiles(int count);
+};
+
+#endif /* GWENVIEWBENCH_H */
@@ -0,0 +1,111 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+/*
+ * Measures how long it takes to downscale a 24 MP image to 2 MP and to
+ * upscale a 2 MP image 2x, with QImage::scaled() and with each filter of
+ * ImageResampler.
+ *
+ * Usage: resamplebench [image]. Without an image, a generated one is used.
+ */
+// Qt
+#include <QCoreApplication>
+#include <QDebug>
+#include <QImage>
+#include <QPainter>
+#include <QTime>
+
+// Local
+#include <lib/resize/imageresampler.h>
+
+using namespace Gwenview;
+
+static const int ITERATIONS = 3;
+
+static QImage createImage(const QSize& size)
+{
+    // Gradients and thin lines, so that the image is not trivial to scale
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, Qt::red);
+    gradient.setColorAt(0.5, Qt::green);
+    gradient.setColorAt(1, Qt::blue);
+    painter.fillRect(image.rect(), gradient);
+    painter.setPen(Qt::white);
+    for (int x = 0; x < size.width(); x += 7) {
+        painter.drawLine(x, 0, x, size.height());
+    }
+    return image;
+}
+
+static void benchQt(const QImage& image, const QSize& size)
+{
+    QTime chrono;
+    chrono.start();
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+        image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    qDebug() << "  QImage::scaled:" << chrono.elapsed() / ITERATIONS << "ms";
+}
+
+static void benchResampler(const QImage& image, const QSize& size, ImageResampler::Filter filter, const char* name)
+{
+    QTime chrono;
+    chrono.start();
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+        ImageResampler::resample(image, size, filter);
+    }
+    qDebug() << "  ImageResampler" << name << ":" << chrono.elapsed() / ITERATIONS << "ms";
+}
+
+static void bench(const QImage& image, const QSize& size)
+{
+    qDebug() << image.size() << "=>" << size;
+    benchQt(image, size);
+    benchResampler(image, size, ImageResampler::Bilinear, "Bilinear");
+    benchResampler(image, size, ImageResampler::Mitchell, "Mitchell");
+    benchResampler(image, size, ImageResampler::Lanczos3, "Lanczos3");
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QImage image;
+    if (argc == 2) {
+        if (!image.load(QString::fromLocal8Bit(argv[1]))) {
+            qDebug() << "Could not load" << argv[1];
+            return 1;
+        }
+    } else {
+        image = createImage(QSize(6000, 4000));
+    }
+
+    // 24 MP => 2 MP
+    QSize size = image.size();
+    size.scale(1732, 1732, Qt::KeepAspectRatio);
+    bench(image, size);
+
+    // 2 MP => 8 MP
+    const QImage small = ImageResampler::resample(image, size, ImageResampler::Lanczos3);
+    bench(small, small.size() * 2);
+
+    return 0;
+}
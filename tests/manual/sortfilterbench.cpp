@@ -0,0 +1,165 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2026 agent <agent@local>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+/*
+ * Measures how long it takes to sort and filter a big dir in SortedDirModel,
+ * shown by a ThumbnailView, with and without a QPersistentModelIndex for each
+ * row.
+ *
+ * ThumbnailView used to keep one QPersistentModelIndex per thumbnail, which
+ * Qt must update each time rows move. It now keeps urls and looks up the
+ * index with SortedDirModel::indexForUrl() when it needs it: this is the
+ * "url" case. The "persistent" case adds one persistent index per row, like
+ * the view used to.
+ */
+// Qt
+#include <QApplication>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QPersistentModelIndex>
+#include <QTemporaryDir>
+#include <QTime>
+#include <QUrl>
+
+// KDE
+#include <KDirLister>
+#include <KDirModel>
+
+// Local
+#include <lib/semanticinfo/sorteddirmodel.h>
+#include <lib/thumbnailview/thumbnailview.h>
+
+using namespace Gwenview;
+
+static const int DEFAULT_ROW_COUNT = 100000;
+static const int LOOKUP_COUNT = 1000;
+
+static bool createFiles(const QDir& dir, int count)
+{
+    // Created out of order, so that sorting moves rows around. One file out
+    // of two is filtered out by the blacklist.
+    for (int idx = 0; idx < count; ++idx) {
+        const int number = (idx * 7919) % count;
+        const QString name = QString("pict%1.%2")
+            .arg(number, 6, 10, QChar('0'))
+            .arg(number % 2 ? "png" : "jpg");
+        QFile file(dir.absoluteFilePath(name));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Could not create" << file.fileName();
+            return false;
+        }
+    }
+    return true;
+}
+
+static int elapsed(QTime* chrono)
+{
+    int value = chrono->elapsed();
+    chrono->restart();
+    return value;
+}
+
+static void applyBlackList(SortedDirModel* model, const QStringList& extensions)
+{
+    model->setBlackListedExtensions(extensions);
+    model->applyFilters();
+    // Filters are applied from the event loop
+    QCoreApplication::processEvents();
+}
+
+static void bench(const QUrl& dirUrl, bool usePersistentIndexes)
+{
+    SortedDirModel model;
+    ThumbnailView view(0);
+    view.setModel(&model);
+
+    QEventLoop loop;
+    QObject::connect(model.dirLister(), SIGNAL(completed()), &loop, SLOT(quit()));
+    model.dirLister()->openUrl(dirUrl);
+    loop.exec();
+    model.sort(KDirModel::Name, Qt::AscendingOrder);
+
+    QList<QPersistentModelIndex> persistentIndexes;
+    QList<QUrl> urls;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QModelIndex index = model.index(row, 0);
+        urls << model.urlForIndex(index);
+        if (usePersistentIndexes) {
+            persistentIndexes << QPersistentModelIndex(index);
+        }
+    }
+
+    QTime chrono;
+    chrono.start();
+    model.sort(KDirModel::Name, Qt::DescendingOrder);
+    const int sortTime = elapsed(&chrono);
+
+    applyBlackList(&model, QStringList() << "png");
+    const int filterTime = elapsed(&chrono);
+
+    applyBlackList(&model, QStringList());
+    const int unfilterTime = elapsed(&chrono);
+
+    // Cost of looking up indexes when a thumbnail arrives
+    const int lookupCount = qMin(LOOKUP_COUNT, urls.count());
+    for (int idx = 0; idx < lookupCount; ++idx) {
+        QModelIndex index;
+        if (usePersistentIndexes) {
+            index = persistentIndexes.at(idx);
+        } else {
+            index = model.indexForUrl(urls.at(idx));
+        }
+        Q_ASSERT(index.isValid());
+        Q_UNUSED(index);
+    }
+    const int lookupTime = elapsed(&chrono);
+
+    qDebug() << (usePersistentIndexes ? "persistent:" : "url:")
+             << "sort" << sortTime << "ms,"
+             << "filter" << filterTime << "ms,"
+             << "unfilter" << unfilterTime << "ms,"
+             << lookupCount << "lookups" << lookupTime << "ms";
+}
+
+int main(int argc, char** argv)
+{
+    QApplication app(argc, argv);
+    int rowCount = DEFAULT_ROW_COUNT;
+    if (argc == 2) {
+        rowCount = QString::fromUtf8(argv[1]).toInt();
+    }
+    if (rowCount <= 0) {
+        qDebug() << "Usage: sortfilterbench [row-count]";
+        return 1;
+    }
+
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid() || !createFiles(QDir(tempDir.path()), rowCount)) {
+        return 1;
+    }
+
+    qDebug() << "Rows:" << rowCount;
+    const QUrl dirUrl = QUrl::fromLocalFile(tempDir.path());
+    bench(dirUrl, true);
+    bench(dirUrl, false);
+    return 0;
+}